@@ -0,0 +1,392 @@
+// Renders the binary trace files written by resip::SipTrace as text, or as
+// a pcap capture of the SIP messages for wireshark and friends.
+//
+//   sipTraceDecode [-p out.pcap] trace-file...
+//
+// Rotated files should be given oldest first (trace.3 trace.2 trace.1 trace).
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+
+#include "rutil/BinaryTrace.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DnsUtil.hxx"
+#include "rutil/Socket.hxx"
+#include "rutil/Timer.hxx"
+#include "resip/stack/SipTrace.hxx"
+#include "resip/stack/Tuple.hxx"
+
+using namespace resip;
+using namespace std;
+
+// in TransactionState::Machine and TransactionState::State order
+static const char* MachineNames[] = { "ClientNonInvite", "ClientInvite", "ServerNonInvite", "ServerInvite",
+                                      "ClientStale", "ServerStale", "Stateless" };
+static const char* StateNames[] = { "Calling", "Trying", "Proceeding", "Completed", "Confirmed", "Terminated", "Bogus" };
+static const char* FailureNames[] = { "None", "Failure", "NoTransport", "NoRoute", "CertNameMismatch", "CertValidationFailure" };
+
+template <size_t N>
+static const char*
+name(const char* (&names)[N], unsigned int value)
+{
+   return value < N ? names[value] : "?";
+}
+
+static Data
+address(const UInt8* addr, int ipVersion, UInt16 port)
+{
+   Data result;
+#ifdef USE_IPV6
+   if (ipVersion == 6)
+   {
+      in6_addr a;
+      memcpy(&a, addr, sizeof(a));
+      result = "[" + DnsUtil::inet_ntop(a) + "]";
+   }
+   else
+#endif
+   {
+      in_addr a;
+      memcpy(&a, addr, sizeof(a));
+      result = DnsUtil::inet_ntop(a);
+   }
+   result += ":";
+   result += Data(port);
+   return result;
+}
+
+static Data
+timestamp(UInt64 time)
+{
+   time_t seconds = (time_t)(time / 1000000);
+   char buffer[64];
+   strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", gmtime(&seconds));
+   char micro[16];
+   sprintf(micro, ".%06u", (unsigned int)(time % 1000000));
+   return Data(buffer) + micro;
+}
+
+static void
+printRecord(const BinaryTrace::RecordHeader& header, const Data& payload)
+{
+   cout << timestamp(header.mTimestamp) << " ";
+   switch (header.mType)
+   {
+      case SipTrace::MessageReceived:
+      case SipTrace::MessageSent:
+      {
+         if (payload.size() < sizeof(SipTrace::TupleRecord))
+         {
+            cout << "truncated record" << endl;
+            return;
+         }
+         SipTrace::TupleRecord tuple;
+         memcpy(&tuple, payload.data(), sizeof(tuple));
+         const size_t size = payload.size() - sizeof(tuple);
+         cout << (header.mType == SipTrace::MessageReceived ? "RECV " : "SEND ")
+              << Tuple::toData((TransportType)tuple.mTransportType) << " "
+              << address(tuple.mSourceAddress, tuple.mIpVersion, tuple.mSourcePort) << " -> "
+              << address(tuple.mDestinationAddress, tuple.mIpVersion, tuple.mDestinationPort)
+              << " (" << size << " bytes)" << endl;
+         cout.write(payload.data() + sizeof(tuple), size);
+         cout << endl;
+         break;
+      }
+      case SipTrace::Event:
+      {
+         if (payload.size() < sizeof(SipTrace::EventRecord))
+         {
+            cout << "truncated record" << endl;
+            return;
+         }
+         SipTrace::EventRecord event;
+         memcpy(&event, payload.data(), sizeof(event));
+         const Data tid(payload.data() + sizeof(event), (int)(payload.size() - sizeof(event)));
+         cout << "EVENT tid=" << tid << " ";
+         switch (event.mCode)
+         {
+            case SipTrace::TransactionCreated:
+               cout << "created " << name(MachineNames, event.mArg >> 8) << " " << name(StateNames, event.mArg & 0xff);
+               break;
+            case SipTrace::TransactionStateChange:
+               cout << name(StateNames, event.mArg >> 8) << " -> " << name(StateNames, event.mArg & 0xff);
+               break;
+            case SipTrace::TransactionTimer:
+               cout << "timer " << Timer::toData((Timer::Type)event.mArg);
+               break;
+            case SipTrace::TransactionTransportFailure:
+               cout << "transport failure " << name(FailureNames, event.mArg);
+               break;
+            case SipTrace::TransactionDeleted:
+               cout << "deleted in " << name(StateNames, event.mArg);
+               break;
+            default:
+               cout << "event " << event.mCode << " arg " << event.mArg;
+         }
+         cout << endl;
+         break;
+      }
+      default:
+         cout << "record type " << header.mType << " (" << payload.size() << " bytes)" << endl;
+   }
+}
+
+/**
+   Writes the messages as raw IP packets (LINKTYPE_RAW) - UDP for datagram
+   transports, TCP segments with running sequence numbers for stream transports.
+*/
+class PcapWriter
+{
+   public:
+      PcapWriter(FILE* file) : mFile(file), mIpId(0)
+      {
+         UInt32 magic = 0xa1b2c3d4;
+         UInt16 major = 2, minor = 4;
+         UInt32 zone = 0, sigfigs = 0, snaplen = 65535, linkType = 101;
+         fwrite(&magic, 4, 1, mFile);
+         fwrite(&major, 2, 1, mFile);
+         fwrite(&minor, 2, 1, mFile);
+         fwrite(&zone, 4, 1, mFile);
+         fwrite(&sigfigs, 4, 1, mFile);
+         fwrite(&snaplen, 4, 1, mFile);
+         fwrite(&linkType, 4, 1, mFile);
+      }
+
+      /// Returns false for records that are not messages
+      bool write(const BinaryTrace::RecordHeader& header, const Data& payload)
+      {
+         if ((header.mType != SipTrace::MessageReceived && header.mType != SipTrace::MessageSent) ||
+             payload.size() < sizeof(SipTrace::TupleRecord))
+         {
+            return false;
+         }
+         SipTrace::TupleRecord tuple;
+         memcpy(&tuple, payload.data(), sizeof(tuple));
+         const char* data = payload.data() + sizeof(tuple);
+         size_t size = payload.size() - sizeof(tuple);
+
+         const bool stream = tuple.mTransportType == TCP || tuple.mTransportType == TLS;
+         const bool v6 = tuple.mIpVersion == 6;
+         const size_t ipHeaderSize = v6 ? 40 : 20;
+         const size_t transportHeaderSize = stream ? 20 : 8;
+         size = resipMin(size, 65535 - ipHeaderSize - transportHeaderSize);
+
+         unsigned char packet[65535];
+         unsigned char* ip = packet;
+         unsigned char* transport = packet + ipHeaderSize;
+         const size_t transportSize = transportHeaderSize + size;
+         const size_t packetSize = ipHeaderSize + transportSize;
+         memset(packet, 0, ipHeaderSize + transportHeaderSize);
+
+         if (v6)
+         {
+            ip[0] = 0x60;
+            put16(ip + 4, (UInt16)transportSize);
+            ip[6] = stream ? 6 : 17;
+            ip[7] = 64;
+            memcpy(ip + 8, tuple.mSourceAddress, 16);
+            memcpy(ip + 24, tuple.mDestinationAddress, 16);
+         }
+         else
+         {
+            ip[0] = 0x45;
+            put16(ip + 2, (UInt16)packetSize);
+            put16(ip + 4, (UInt16)++mIpId);
+            ip[6] = 0x40; // don't fragment
+            ip[8] = 64;
+            ip[9] = stream ? 6 : 17;
+            memcpy(ip + 12, tuple.mSourceAddress, 4);
+            memcpy(ip + 16, tuple.mDestinationAddress, 4);
+            put16(ip + 10, checksum(ip, 20));
+         }
+
+         put16(transport, tuple.mSourcePort);
+         put16(transport + 2, tuple.mDestinationPort);
+         if (stream)
+         {
+            UInt32& seq = mSequence[flow(tuple.mSourceAddress, tuple.mSourcePort,
+                                         tuple.mDestinationAddress, tuple.mDestinationPort)];
+            put32(transport + 4, seq);
+            put32(transport + 8, mSequence[flow(tuple.mDestinationAddress, tuple.mDestinationPort,
+                                                tuple.mSourceAddress, tuple.mSourcePort)]);
+            transport[12] = 0x50;
+            transport[13] = 0x18; // PSH, ACK
+            put16(transport + 14, 65535);
+            seq += (UInt32)size;
+         }
+         else
+         {
+            put16(transport + 4, (UInt16)transportSize);
+         }
+         memcpy(transport + transportHeaderSize, data, size);
+
+         UInt32 seconds = (UInt32)(header.mTimestamp / 1000000);
+         UInt32 micro = (UInt32)(header.mTimestamp % 1000000);
+         UInt32 length = (UInt32)packetSize;
+         fwrite(&seconds, 4, 1, mFile);
+         fwrite(&micro, 4, 1, mFile);
+         fwrite(&length, 4, 1, mFile);
+         fwrite(&length, 4, 1, mFile);
+         fwrite(packet, packetSize, 1, mFile);
+         return true;
+      }
+
+   private:
+      static Data flow(const UInt8* from, UInt16 fromPort, const UInt8* to, UInt16 toPort)
+      {
+         Data key(reinterpret_cast<const char*>(from), 16);
+         key.append(reinterpret_cast<const char*>(&fromPort), sizeof(fromPort));
+         key.append(reinterpret_cast<const char*>(to), 16);
+         key.append(reinterpret_cast<const char*>(&toPort), sizeof(toPort));
+         return key;
+      }
+
+      static void put16(unsigned char* p, UInt16 value) { p[0] = value >> 8; p[1] = value & 0xff; }
+      static void put32(unsigned char* p, UInt32 value) { put16(p, value >> 16); put16(p + 2, value & 0xffff); }
+      static UInt16 checksum(const unsigned char* p, size_t size)
+      {
+         UInt32 sum = 0;
+         for (size_t i = 0; i < size; i += 2)
+         {
+            sum += (p[i] << 8) | p[i + 1];
+         }
+         while (sum >> 16)
+         {
+            sum = (sum & 0xffff) + (sum >> 16);
+         }
+         return (UInt16)~sum;
+      }
+
+      FILE* mFile;
+      UInt16 mIpId;
+      std::map<Data, UInt32> mSequence;
+};
+
+static void
+usage(const char* name)
+{
+   cerr << "usage: " << name << " [-p output.pcap] trace-file..." << endl
+        << "  prints the records of SIP trace files as text, or with -p writes the" << endl
+        << "  SIP messages in them to a pcap file. Give rotated files oldest first." << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   const char* pcapFileName = 0;
+   int first = 1;
+   if (argc > 2 && strcmp(argv[1], "-p") == 0)
+   {
+      pcapFileName = argv[2];
+      first = 3;
+   }
+   if (first >= argc)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   FILE* pcapFile = 0;
+   PcapWriter* pcap = 0;
+   if (pcapFileName)
+   {
+      pcapFile = fopen(pcapFileName, "wb");
+      if (pcapFile == 0)
+      {
+         cerr << "Could not create " << pcapFileName << endl;
+         return 1;
+      }
+      pcap = new PcapWriter(pcapFile);
+   }
+
+   int result = 0;
+   unsigned long count = 0;
+   for (int i = first; i < argc; ++i)
+   {
+      BinaryTraceReader reader;
+      if (!reader.open(argv[i]))
+      {
+         cerr << argv[i] << " is not a SIP trace file" << endl;
+         result = 1;
+         continue;
+      }
+
+      BinaryTrace::RecordHeader header;
+      Data payload;
+      while (reader.next(header, payload))
+      {
+         if (pcap)
+         {
+            if (pcap->write(header, payload))
+            {
+               ++count;
+            }
+         }
+         else
+         {
+            printRecord(header, payload);
+         }
+      }
+   }
+
+   if (pcap)
+   {
+      delete pcap;
+      fclose(pcapFile);
+      cerr << "Wrote " << count << " messages to " << pcapFileName << endl;
+   }
+   return result;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
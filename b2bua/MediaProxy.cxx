@@ -16,121 +16,124 @@ void MediaProxy::setNatHelper(bool natHelper) {
 }
 
 MediaProxy::MediaProxy(MediaManager& mediaManager) : mediaManager(mediaManager) {
-  originalSdp = NULL;
   newSdp = NULL;
 }
 
 MediaProxy::~MediaProxy() {
-  if(originalSdp != NULL)
-    delete originalSdp;
   if(newSdp != NULL) 
     delete newSdp;
 }
 
 int MediaProxy::updateSdp(const resip::SdpContents& sdp, const in_addr_t& msgSourceAddress) {
-  bool callerAsymmetric = true;
-  bool calleeAsymmetric = true;
-  if(originalSdp != NULL)
-    delete originalSdp;
-  originalSdp = (SdpContents *)sdp.clone();
+  // Only the o=, c= and m= lines are rewritten, so work on a view of the
+  // SDP text rather than parsing and copying the whole SdpContents
+  SdpView view(sdp);
+  int result = rewriteSdp(view, msgSourceAddress);
+
+  // The copy made by clone() owns its text and stays unparsed until
+  // someone looks inside it
   if(newSdp != NULL)
     delete newSdp;
-  newSdp = (SdpContents *)sdp.clone();
+  Data text(Data::from(view));
+  HeaderFieldValue hfv(text.data(), text.size());
+  newSdp = static_cast<SdpContents*>(SdpContents(&hfv, SdpContents::getStaticType()).clone());
+
+  return result;
+}
+
+int MediaProxy::rewriteSdp(SdpView& view, const in_addr_t& msgSourceAddress) {
+  bool callerAsymmetric = true;
+  bool calleeAsymmetric = true;
+  const Data sessionAddress(view.connectionAddress());
 
   // Process the Origin
-  if(originalSdp->session().origin().getAddressType() != SdpContents::IP4) {
+  if(view.originAddressType() != "IP4") {
     // FIXME - implement IPv6
     B2BUA_LOG_WARNING("processing SDP origin, only IP4 is supported"); 
     return MM_SDP_BAD;
   }
   // FIXME - set username also
-  newSdp->session().origin().setAddress(MediaManager::proxyAddress);
+  view.setOriginAddress(MediaManager::proxyAddress);
 
   // Process the default connection
-  if(originalSdp->session().connection().getAddressType() != SdpContents::IP4) {
+  if(view.connectionAddressType() != "IP4") {
     // FIXME - implement IPv6
     B2BUA_LOG_WARNING("processing SDP connection, only IP4 is supported");
     return MM_SDP_BAD;
   }
-  newSdp->session().connection().setAddress(MediaManager::proxyAddress);
-
-  newSdp->session().clearMedium();
-  list<SdpContents::Session::Medium>::iterator i = originalSdp->session().media().begin();
-  while(i != originalSdp->session().media().end()) {
-    if(allowProtocol((*i).protocol())) {
-      if(newSdp->session().media().size() > 0) {
-	// FIXME
-        B2BUA_LOG_WARNING("only one medium definition supported");
-	return MM_SDP_BAD;
-      }
-      struct MediaProxy::EndPoint endpoint;
-      endpoint.address = originalSdp->session().connection().getAddress();
-      // Should we adjust the address because of NAT?
-      if(mNatHelper) {
-        in_addr_t sdpConnectionAddr = inet_addr(originalSdp->session().connection().getAddress().c_str());
-        // Is the endpoint a private address?
-        bool addressIsPrivate = isAddressPrivate(sdpConnectionAddr);
-        if(addressIsPrivate)
-          B2BUA_LOG_WARNING("IP address in SDP is private: %s", originalSdp->session().connection().getAddress().c_str());
-
-        // Does the endpoint address not match the msg source address?
-        bool matchesMsgSource = false;
-        if(sdpConnectionAddr == msgSourceAddress)
-          matchesMsgSource = true;
-
-        if(addressIsPrivate && !matchesMsgSource) {
-          // use the msg source address instead of the address in the SDP
-          struct in_addr sa;
-          sa.s_addr = msgSourceAddress;
-          endpoint.address = Data(inet_ntoa(sa));
-          callerAsymmetric = false;
-          B2BUA_LOG_WARNING("rewriting NAT address, was %s, using %s", originalSdp->session().connection().getAddress().c_str(), endpoint.address.c_str());
-        } 
-      }
-      // Check for a connection spec
-      if((*i).getMediumConnections().size() > 1) {
-        // FIXME - connection for each medium
-        B2BUA_LOG_WARNING("multiple medium specific connections not supported");
-	return MM_SDP_BAD;
-      }
-      if((*i).getMediumConnections().size() == 1) {
-        const SdpContents::Session::Connection& mc = (*i).getMediumConnections().front();
-	// FIXME - check address type, etc, or implement operator==
-        if(!(mc.getAddress() == originalSdp->session().connection().getAddress())) {
-          B2BUA_LOG_WARNING("medium specific connection doesn't match global connection");
-	  return MM_SDP_BAD;
-        }
-        
+  view.setConnectionAddress(MediaManager::proxyAddress);
+
+  int accepted = 0;
+  int i = 0;
+  while(i < view.numMedia()) {
+    if(!allowProtocol(view.protocol(i))) {
+      B2BUA_LOG_WARNING("media protocol %s not recognised, removed from SDP", view.protocol(i).c_str());
+      view.removeMedium(i);
+      continue;
+    }
+    if(accepted > 0) {
+      // FIXME
+      B2BUA_LOG_WARNING("only one medium definition supported");
+      return MM_SDP_BAD;
+    }
+    struct MediaProxy::EndPoint endpoint;
+    endpoint.address = sessionAddress;
+    // Should we adjust the address because of NAT?
+    if(mNatHelper) {
+      in_addr_t sdpConnectionAddr = inet_addr(sessionAddress.c_str());
+      // Is the endpoint a private address?
+      bool addressIsPrivate = isAddressPrivate(sdpConnectionAddr);
+      if(addressIsPrivate)
+        B2BUA_LOG_WARNING("IP address in SDP is private: %s", sessionAddress.c_str());
+
+      // Does the endpoint address not match the msg source address?
+      bool matchesMsgSource = false;
+      if(sdpConnectionAddr == msgSourceAddress)
+        matchesMsgSource = true;
+
+      if(addressIsPrivate && !matchesMsgSource) {
+        // use the msg source address instead of the address in the SDP
+        struct in_addr sa;
+        sa.s_addr = msgSourceAddress;
+        endpoint.address = Data(inet_ntoa(sa));
+        callerAsymmetric = false;
+        B2BUA_LOG_WARNING("rewriting NAT address, was %s, using %s", sessionAddress.c_str(), endpoint.address.c_str());
+      } 
+    }
+    // Check for a connection spec
+    if(view.numConnections(i) > 1) {
+      // FIXME - connection for each medium
+      B2BUA_LOG_WARNING("multiple medium specific connections not supported");
+      return MM_SDP_BAD;
+    }
+    if(view.hasConnection(i)) {
+      // FIXME - check address type, etc
+      if(!(view.connectionAddress(i) == sessionAddress)) {
+        B2BUA_LOG_WARNING("medium specific connection doesn't match global connection");
+        return MM_SDP_BAD;
       }
-      // Get the old port, insert new port
-      endpoint.originalPort = (*i).port();
-      SdpContents::Session::Medium m(*i);
-      // FIXME - only needed until more detailed handling of medium specific
-      // connections is implemented:
-      //m.getMediumConnections().clear();
-      m.setConnection(newSdp->session().connection());
-      if(mediaManager.aLegProxy == this) {
-        // this must be A leg
-        if(mediaManager.rtpProxyUtil == NULL) {
-	  mediaManager.rtpProxyUtil = new RtpProxyUtil();
-          mediaManager.rtpProxyUtil->setTimeoutListener(&mediaManager);
-        }
- 	endpoint.proxyPort = mediaManager.rtpProxyUtil->setupCaller(mediaManager.callId.c_str(), endpoint.address.c_str(), endpoint.originalPort, mediaManager.fromTag.c_str(), callerAsymmetric);
-        if(endpoint.proxyPort == 0)
-          throw new exception;
-      } else {
-	// this must be B leg
-	endpoint.proxyPort = mediaManager.rtpProxyUtil->setupCallee(endpoint.address.c_str(), endpoint.originalPort, mediaManager.toTag.c_str(), calleeAsymmetric);
-        if(endpoint.proxyPort == 0)
-          throw new exception;
+      view.setConnectionAddress(MediaManager::proxyAddress, i);
+    }
+    // Get the old port, insert new port
+    endpoint.originalPort = view.port(i);
+    if(mediaManager.aLegProxy == this) {
+      // this must be A leg
+      if(mediaManager.rtpProxyUtil == NULL) {
+        mediaManager.rtpProxyUtil = new RtpProxyUtil();
+        mediaManager.rtpProxyUtil->setTimeoutListener(&mediaManager);
       }
-      m.setPort(endpoint.proxyPort);
-      //newMedia.push_back(m);
-      newSdp->session().addMedium(m);
-      endpoints.push_back(endpoint);
+      endpoint.proxyPort = mediaManager.rtpProxyUtil->setupCaller(mediaManager.callId.c_str(), endpoint.address.c_str(), endpoint.originalPort, mediaManager.fromTag.c_str(), callerAsymmetric);
+      if(endpoint.proxyPort == 0)
+        throw new exception;
     } else {
-      B2BUA_LOG_WARNING("media protocol %s not recognised, removed from SDP", (*i).protocol().c_str());
+      // this must be B leg
+      endpoint.proxyPort = mediaManager.rtpProxyUtil->setupCallee(endpoint.address.c_str(), endpoint.originalPort, mediaManager.toTag.c_str(), calleeAsymmetric);
+      if(endpoint.proxyPort == 0)
+        throw new exception;
     }
+    view.setPort(i, endpoint.proxyPort);
+    endpoints.push_back(endpoint);
+    accepted++;
     i++;
   }
   if(endpoints.size() == 0) {
@@ -3,6 +3,7 @@
 #define __MediaProxy_h
 
 #include "resip/stack/SdpContents.hxx"
+#include "resip/stack/SdpView.hxx"
 
 namespace b2bua
 {
@@ -45,9 +46,10 @@ private:
   MediaManager& mediaManager;		// the MediaManager who controls us
   std::list<EndPoint> endpoints;	// the endpoints for each media
 					// offer in the SDP
-  resip::SdpContents *originalSdp;	// the original SDP
   resip::SdpContents *newSdp;		// the modified SDP
 
+  int rewriteSdp(resip::SdpView& view, const in_addr_t& msgSourceAddress);
+
 public:
   static void setNatHelper(bool natHelper);
   MediaProxy(MediaManager& mediaManager);
@@ -44,22 +44,32 @@ void
 AsyncSocketBase::doSend(const StunTuple& destination, unsigned short channel, boost::shared_ptr<DataBuffer>& data, unsigned int bufferStartPos)
 {
    bool writeInProgress = !mSendDataQueue.empty();
-   if(channel == NO_CHANNEL)
-   {
-      boost::shared_ptr<DataBuffer> empty;
-      mSendDataQueue.push_back(SendData(destination, empty, data, bufferStartPos));
-   }
-   else
+   boost::shared_ptr<DataBuffer> frame;
+   if(channel != NO_CHANNEL)
    {
       // Add Turn Framing
-      boost::shared_ptr<DataBuffer> frame = allocateBuffer(4);
+      unsigned short msgsize = htons((unsigned short)(data->size() - bufferStartPos));  // UDP doesn't need size - but shouldn't hurt to send it anyway
       channel = htons(channel);
-      memcpy(&(*frame)[0], &channel, 2);
-      unsigned short msgsize = htons((unsigned short)data->size());
-      memcpy(&(*frame)[2], (void*)&msgsize, 2);  // UDP doesn't need size - but shouldn't hurt to send it anyway
-
-      mSendDataQueue.push_back(SendData(destination, frame, data, bufferStartPos));
+      if(bufferStartPos == 0 && data->headroom() >= 4)
+      {
+         // Write the framing in front of the data (ie. relayed data in a receive buffer) - avoids a second buffer
+         char* framing = data->prepend(4);
+         memcpy(framing, &channel, 2);
+         memcpy(framing+2, (void*)&msgsize, 2);
+      }
+      else
+      {
+         frame = allocateBuffer(4);
+         memcpy(&(*frame)[0], &channel, 2);
+         memcpy(&(*frame)[2], (void*)&msgsize, 2);
+      }
    }
+   if(!writeInProgress && 
+      transportSendImmediate(destination, frame, data, bufferStartPos))
+   {
+      return;
+   }
+   mSendDataQueue.push_back(SendData(destination, frame, data, bufferStartPos));
    if (!writeInProgress)
    {
       sendFirstQueuedData();
@@ -110,7 +120,7 @@ AsyncSocketBase::doReceive()
    if(!mReceiving)
    {
       mReceiving=true;
-      mReceiveBuffer = allocateBuffer(RECEIVE_BUFFER_SIZE);
+      mReceiveBuffer = allocateReceiveBuffer();
       transportReceive();
    }
 }
@@ -127,7 +137,7 @@ AsyncSocketBase::doFramedReceive()
    if(!mReceiving)
    {
       mReceiving=true;
-      mReceiveBuffer = allocateBuffer(RECEIVE_BUFFER_SIZE);
+      mReceiveBuffer = allocateReceiveBuffer();
       transportFramedReceive();
    }
 }
@@ -161,6 +171,28 @@ AsyncSocketBase::allocateBuffer(unsigned int size)
    return boost::shared_ptr<DataBuffer>(new DataBuffer(size));
 }
 
+boost::shared_ptr<DataBuffer>  
+AsyncSocketBase::allocateReceiveBuffer()
+{
+   // Drop our reference to the last receive buffer first, so that it can be reused right away if the 
+   // application is done with it (ie. it was relayed by a synchronous send)
+   mReceiveBuffer.reset();
+   for(std::vector<boost::shared_ptr<DataBuffer> >::iterator it = mReceiveBufferPool.begin(); it != mReceiveBufferPool.end(); it++)
+   {
+      if(it->unique())
+      {
+         (*it)->reset();
+         return *it;
+      }
+   }
+   boost::shared_ptr<DataBuffer> buffer(new DataBuffer(RECEIVE_BUFFER_SIZE, RECEIVE_BUFFER_HEADROOM, RECEIVE_BUFFER_TAILROOM));
+   if(mReceiveBufferPool.size() < RECEIVE_BUFFER_POOL_SIZE)
+   {
+      mReceiveBufferPool.push_back(buffer);
+   }
+   return buffer;
+}
+
 } // namespace
 
 
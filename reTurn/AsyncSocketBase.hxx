@@ -5,17 +5,108 @@
 #include <asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/array.hpp>
 
 #include "DataBuffer.hxx"
 #include "StunTuple.hxx"
 
 #define RECEIVE_BUFFER_SIZE 2048 // ?slg? should we shrink this to something closer to MTU (1500 bytes)?
+// Receive buffers reserve room in front of the data for the largest header the relay adds when forwarding a
+// packet (Stun header 20 + XorPeerAddress (v6) 24 + Data attribute header 4), and behind it for padding, so that 
+// ChannelData framing and Data indications can be built in place without copying the payload
+#define RECEIVE_BUFFER_HEADROOM 48
+#define RECEIVE_BUFFER_TAILROOM 4
+#define RECEIVE_BUFFER_POOL_SIZE 32  // max receive buffers recycled per socket - enough for a recvmmsg batch still queued for sending plus the next one
 
 namespace reTurn {
 
+#if defined(SO_REUSEPORT)
+/// SO_REUSEPORT socket option - allows one listener per ioService shard to bind the same address and port.  
+/// The kernel then spreads datagrams and connections across the listeners by hashing the 5-tuple, so a given
+/// client always lands on the same shard.
+typedef asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#define RETURN_REUSE_PORT_SUPPORTED
+#endif
+
 class AsyncSocketBaseHandler;
 class AsyncSocketBaseDestroyedHandler;
 
+/// Storage for the handler of one outstanding asynchronous operation, so that asio does not need to allocate 
+/// from the heap each time the operation is started.  Handlers larger than the storage, or a second operation 
+/// started while the storage is in use, fall back to the heap.
+class HandlerAllocator : private boost::noncopyable
+{
+public:
+   HandlerAllocator() : mInUse(false) {}
+
+   void* allocate(std::size_t size)
+   {
+      if(!mInUse && size <= sizeof(mStorage))
+      {
+         mInUse = true;
+         return mStorage;
+      }
+      return ::operator new(size);
+   }
+
+   void deallocate(void* pointer)
+   {
+      if(pointer == mStorage)
+      {
+         mInUse = false;
+      }
+      else
+      {
+         ::operator delete(pointer);
+      }
+   }
+
+private:
+   union
+   {
+      char mStorage[512];
+      double mAlign;
+   };
+   bool mInUse;
+};
+
+/// Wraps a handler so that asio allocates the memory for its operation from a HandlerAllocator
+template <typename Handler>
+class AllocatedHandler
+{
+public:
+   AllocatedHandler(HandlerAllocator& allocator, Handler handler) : mAllocator(allocator), mHandler(handler) {}
+
+   void operator()() { mHandler(); }
+
+   template <typename Arg1>
+   void operator()(Arg1 arg1) { mHandler(arg1); }
+
+   template <typename Arg1, typename Arg2>
+   void operator()(Arg1 arg1, Arg2 arg2) { mHandler(arg1, arg2); }
+
+   friend void* asio_handler_allocate(std::size_t size, AllocatedHandler<Handler>* thisHandler)
+   {
+      return thisHandler->mAllocator.allocate(size);
+   }
+
+   friend void asio_handler_deallocate(void* pointer, std::size_t /*size*/, AllocatedHandler<Handler>* thisHandler)
+   {
+      thisHandler->mAllocator.deallocate(pointer);
+   }
+
+private:
+   HandlerAllocator& mAllocator;
+   Handler mHandler;
+};
+
+template <typename Handler>
+inline AllocatedHandler<Handler> makeAllocatedHandler(HandlerAllocator& allocator, Handler handler)
+{
+   return AllocatedHandler<Handler>(allocator, handler);
+}
+
 class AsyncSocketBase :
    public boost::enable_shared_from_this<AsyncSocketBase>
 {
@@ -58,6 +149,9 @@ public:
 
    /// Utility API
    static boost::shared_ptr<DataBuffer> allocateBuffer(unsigned int size);
+   /// Returns a RECEIVE_BUFFER_SIZE buffer (with RECEIVE_BUFFER_HEADROOM/TAILROOM) from this socket's pool.  A 
+   /// pooled buffer is only handed out again once nobody else holds a reference to it.
+   boost::shared_ptr<DataBuffer> allocateReceiveBuffer();
 
    // Stubbed out async handlers needed by Protocol specific Subclasses of this - the requirement for these 
    // to be in the base class all revolves around the shared_from_this() use/requirement
@@ -81,6 +175,11 @@ protected:
    /// Receive Buffer and state
    boost::shared_ptr<DataBuffer> mReceiveBuffer;
    bool mReceiving;
+   std::vector<boost::shared_ptr<DataBuffer> > mReceiveBufferPool;
+
+   /// Handler storage for the (at most one) outstanding receive and send operation
+   HandlerAllocator mReceiveHandlerAllocator;
+   HandlerAllocator mSendHandlerAllocator;
 
    /// Connected Info and State
    asio::ip::address mConnectedAddress;
@@ -90,15 +189,6 @@ protected:
    /// Handlers
    AsyncSocketBaseHandler* mAsyncSocketBaseHandler;
 
-private:
-   virtual void transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers) = 0;
-   virtual void transportReceive() = 0;
-   virtual void transportFramedReceive() = 0;
-   virtual void transportClose() = 0;
-
-   virtual const asio::ip::address getSenderEndpointAddress() = 0;
-   virtual unsigned short getSenderEndpointPort() = 0;
-
    virtual void sendFirstQueuedData();
    class SendData
    {
@@ -110,9 +200,24 @@ private:
       boost::shared_ptr<DataBuffer> mData;
       unsigned int mBufferStartPos;
    };
-   /// Queue of data to send
+   /// Queue of data to send - transportSend is only called for the front entry, and handleSend removes it
    typedef std::deque<SendData> SendDataQueue;
    SendDataQueue mSendDataQueue;
+
+private:
+   virtual void transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers) = 0;
+   /// Called to send data when nothing is queued (frame may be empty).  Transports that can complete a send 
+   /// synchronously without blocking, or that take the data over to send it themselves, do so (calling 
+   /// onSendSuccess/onSendFailure once sent) and return true - otherwise return false and the data is queued
+   /// and sent using transportSend
+   virtual bool transportSendImmediate(const StunTuple& destination, boost::shared_ptr<DataBuffer>& frame, boost::shared_ptr<DataBuffer>& data, unsigned int bufferStartPos) { return false; }
+   virtual void transportReceive() = 0;
+   virtual void transportFramedReceive() = 0;
+   virtual void transportClose() = 0;
+
+   virtual const asio::ip::address getSenderEndpointAddress() = 0;
+   virtual unsigned short getSenderEndpointPort() = 0;
+
 };
 
 typedef boost::shared_ptr<AsyncSocketBase> ConnectionPtr;
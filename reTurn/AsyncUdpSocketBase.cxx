@@ -5,6 +5,18 @@
 #include <rutil/Logger.hxx>
 #include "ReTurnSubsystem.hxx"
 
+#ifdef RETURN_BATCH_IO_SUPPORTED
+#include <errno.h>
+#include <string.h>
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103  // Linux 4.18+ - older headers do not define it
+#endif
+#endif
+
 #define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
 
 using namespace std;
@@ -14,7 +26,20 @@ namespace reTurn {
 AsyncUdpSocketBase::AsyncUdpSocketBase(asio::io_service& ioService) 
    : AsyncSocketBase(ioService),
      mSocket(ioService),
-     mResolver(ioService)
+     mResolver(ioService),
+     mReusePort(false),
+     mNonBlocking(false)
+#ifdef RETURN_BATCH_IO_SUPPORTED
+     , mBatchIo(false),
+     mGso(false),
+     mBatchSendPending(false),
+     mBatchSendQueueHead(0),
+     mDispatchingBatch(false),
+     mBatchReceiveRequested(false),
+     mBatchReceiveCount(0),
+     mBatchReceiveNext(0),
+     mBatchReceiveResumePending(false)
+#endif
 {
 }
 
@@ -36,11 +61,42 @@ AsyncUdpSocketBase::bind(const asio::ip::address& address, unsigned short port)
    if(!errorCode)
    {
       mSocket.set_option(asio::ip::udp::socket::reuse_address(true));
+#ifdef RETURN_REUSE_PORT_SUPPORTED
+      if(mReusePort)
+      {
+         mSocket.set_option(reuse_port(true));
+      }
+#endif
       mSocket.bind(asio::ip::udp::endpoint(address, port), errorCode);
    }
+   if(!errorCode)
+   {
+      // Non-blocking so that transportSendImmediate can try a send without ever stalling the ioService thread
+      asio::socket_base::non_blocking_io nonBlocking(true);
+      asio::error_code ignored;
+      mSocket.io_control(nonBlocking, ignored);
+      mNonBlocking = !ignored;
+   }
    return errorCode;
 }
 
+void 
+AsyncUdpSocketBase::setBatchIo(bool batchIo)
+{
+#ifdef RETURN_BATCH_IO_SUPPORTED
+   mBatchIo = batchIo && mSocket.is_open();
+   mGso = false;
+   if(mBatchIo)
+   {
+      // Kernels that support UDP GSO let us read the (default) segment size
+      int segmentSize = 0;
+      socklen_t len = sizeof(segmentSize);
+      mGso = getsockopt(mSocket.native(), SOL_UDP, UDP_SEGMENT, &segmentSize, &len) == 0;
+   }
+   DebugLog(<< "AsyncUdpSocketBase::setBatchIo: batchIo=" << mBatchIo << " gso=" << mGso);
+#endif
+}
+
 void 
 AsyncUdpSocketBase::connect(const std::string& address, unsigned short port)
 {
@@ -92,14 +148,78 @@ AsyncUdpSocketBase::transportSend(const StunTuple& destination, std::vector<asio
    //InfoLog(<< "AsyncUdpSocketBase::transportSend " << buffers.size() << " buffer(s) to " << destination << " - buf1 size=" << buffer_size(buffers.front()));
    mSocket.async_send_to(buffers, 
                          asio::ip::udp::endpoint(destination.getAddress(), destination.getPort()), 
-                         boost::bind(&AsyncUdpSocketBase::handleSend, shared_from_this(), asio::placeholders::error));
+                         makeAllocatedHandler(mSendHandlerAllocator, 
+                            boost::bind(&AsyncUdpSocketBase::handleSend, shared_from_this(), asio::placeholders::error)));
+}
+
+bool 
+AsyncUdpSocketBase::transportSendImmediate(const StunTuple& destination, boost::shared_ptr<DataBuffer>& frame, boost::shared_ptr<DataBuffer>& data, unsigned int bufferStartPos)
+{
+#ifdef RETURN_BATCH_IO_SUPPORTED
+   if(mBatchIo)
+   {
+      // Everything sent until the batchSend runs (ie. while handling a batch of received datagrams) goes out in one sendmmsg
+      mBatchSendQueue.push_back(SendData(destination, frame, data, bufferStartPos));
+      postBatchSend();
+      return true;
+   }
+#endif
+   if(!mNonBlocking)
+   {
+      return false;
+   }
+
+   // UDP gathers both buffers into one datagram
+   boost::array<asio::const_buffer, 2> buffers = { { frame.get() ? asio::const_buffer(frame->data(), frame->size()) : asio::const_buffer(),
+                                                     asio::const_buffer(data->data()+bufferStartPos, data->size()-bufferStartPos) } };
+   asio::error_code errorCode;
+   mSocket.send_to(buffers, asio::ip::udp::endpoint(destination.getAddress(), destination.getPort()), 0, errorCode);
+   if(errorCode == asio::error::would_block || errorCode == asio::error::try_again)
+   {
+      return false;  // socket buffer is full - queue it and let the ioService tell us when there is room
+   }
+   if(!errorCode)
+   {
+      onSendSuccess();
+   }
+   else
+   {
+      onSendFailure(errorCode);
+   }
+   return true;
 }
 
 void 
 AsyncUdpSocketBase::transportReceive()
 {
+#ifdef RETURN_BATCH_IO_SUPPORTED
+   if(mBatchIo)
+   {
+      if(mDispatchingBatch)
+      {
+         mBatchReceiveRequested = true;  // hand over the next datagram of the batch, or wait for more once it is done
+      }
+      else if(mBatchReceiveNext < mBatchReceiveCount)
+      {
+         // Datagrams of the last batch are still queued - hand them over from the io_service, not from within doReceive
+         if(mBatchReceiveResumePending)
+         {
+            return;
+         }
+         mBatchReceiveResumePending = true;
+         mIOService.post(makeAllocatedHandler(mReceiveHandlerAllocator, 
+                            boost::bind(&AsyncUdpSocketBase::resumeBatchReceive, boost::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()))));
+      }
+      else
+      {
+         startBatchReceive();
+      }
+      return;
+   }
+#endif
    mSocket.async_receive_from(asio::buffer((void*)mReceiveBuffer->data(), RECEIVE_BUFFER_SIZE), mSenderEndpoint,
-               boost::bind(&AsyncUdpSocketBase::handleReceive, shared_from_this(), asio::placeholders::error, asio::placeholders::bytes_transferred));
+               makeAllocatedHandler(mReceiveHandlerAllocator, 
+                  boost::bind(&AsyncUdpSocketBase::handleReceive, shared_from_this(), asio::placeholders::error, asio::placeholders::bytes_transferred)));
 }
 
 void 
@@ -115,6 +235,284 @@ AsyncUdpSocketBase::transportClose()
    mSocket.close();
 }
 
+#ifdef RETURN_BATCH_IO_SUPPORTED
+void 
+AsyncUdpSocketBase::startBatchReceive()
+{
+   // Wait for the socket to become readable, then read everything that is there with recvmmsg
+   mSocket.async_receive(asio::null_buffers(), 
+                         makeAllocatedHandler(mReceiveHandlerAllocator, 
+                            boost::bind(&AsyncUdpSocketBase::handleBatchReceiveReady, boost::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()), asio::placeholders::error)));
+}
+
+void 
+AsyncUdpSocketBase::handleBatchReceiveReady(const asio::error_code& e)
+{
+   if(e)
+   {
+      handleReceive(e, 0);
+      return;
+   }
+
+   for(unsigned int i = 0; i < UDP_BATCH_SIZE; i++)
+   {
+      mBatchReceiveBuffers[i] = allocateReceiveBuffer();
+      mBatchReceiveIovecs[i].iov_base = (void*)mBatchReceiveBuffers[i]->data();
+      mBatchReceiveIovecs[i].iov_len = RECEIVE_BUFFER_SIZE;
+      memset(&mBatchReceiveHeaders[i], 0, sizeof(mmsghdr));
+      mBatchReceiveHeaders[i].msg_hdr.msg_name = &mBatchReceiveAddresses[i];
+      mBatchReceiveHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+      mBatchReceiveHeaders[i].msg_hdr.msg_iov = &mBatchReceiveIovecs[i];
+      mBatchReceiveHeaders[i].msg_hdr.msg_iovlen = 1;
+   }
+
+   int numReceived = recvmmsg(mSocket.native(), mBatchReceiveHeaders, UDP_BATCH_SIZE, MSG_DONTWAIT, 0);
+   int error = numReceived < 0 ? errno : 0;
+   if(numReceived < 0)
+   {
+      numReceived = 0;
+   }
+
+   for(int i = numReceived; i < UDP_BATCH_SIZE; i++)
+   {
+      mBatchReceiveBuffers[i].reset();  // unused buffers go back to the pool
+   }
+   mBatchReceiveCount = numReceived;
+   mBatchReceiveNext = 0;
+   dispatchBatchReceive();
+
+   if(error == 0 || error == EAGAIN || error == EWOULDBLOCK || error == EINTR)
+   {
+      if(mBatchReceiveRequested)
+      {
+         startBatchReceive();
+      }
+   }
+   else if(error == ENOSYS)
+   {
+      WarningLog(<< "AsyncUdpSocketBase: recvmmsg is not supported, falling back to one operation per datagram.");
+      mBatchIo = false;
+      mReceiveBuffer = allocateReceiveBuffer();
+      transportReceive();
+   }
+   else
+   {
+      handleReceive(asio::error_code(error, asio::error::get_system_category()), 0);
+   }
+}
+
+void 
+AsyncUdpSocketBase::dispatchBatchReceive()
+{
+   // Hand the datagrams over one at a time - the application asks for the next one by calling doReceive, as it
+   // would when receiving one datagram per operation.  Whatever it has not asked for stays queued for the next doReceive.
+   mDispatchingBatch = true;
+   mBatchReceiveRequested = true;
+   while(mBatchReceiveNext < mBatchReceiveCount && mBatchReceiveRequested)
+   {
+      unsigned int i = mBatchReceiveNext++;
+      mBatchReceiveRequested = false;
+      mReceiveBuffer = mBatchReceiveBuffers[i];
+      mBatchReceiveBuffers[i].reset();
+      memcpy(mSenderEndpoint.data(), &mBatchReceiveAddresses[i], mBatchReceiveHeaders[i].msg_hdr.msg_namelen);
+      mSenderEndpoint.resize(mBatchReceiveHeaders[i].msg_hdr.msg_namelen);
+      handleReceive(asio::error_code(), mBatchReceiveHeaders[i].msg_len);
+   }
+   mDispatchingBatch = false;
+}
+
+void 
+AsyncUdpSocketBase::resumeBatchReceive()
+{
+   mBatchReceiveResumePending = false;
+   dispatchBatchReceive();
+   if(mBatchReceiveRequested && mBatchReceiveNext == mBatchReceiveCount)
+   {
+      startBatchReceive();
+   }
+}
+
+void 
+AsyncUdpSocketBase::postBatchSend()
+{
+   if(!mBatchSendPending)
+   {
+      mBatchSendPending = true;
+      mIOService.post(makeAllocatedHandler(mSendHandlerAllocator, 
+                         boost::bind(&AsyncUdpSocketBase::batchSend, boost::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()))));
+   }
+}
+
+void 
+AsyncUdpSocketBase::handleBatchSendReady(const asio::error_code& e)
+{
+   if(e)
+   {
+      // Socket is unusable (ie. closed) - fail everything that is queued
+      mBatchSendPending = false;
+      completeBatchSend((unsigned int)mBatchSendQueue.size() - mBatchSendQueueHead, e);
+      return;
+   }
+   batchSend();
+}
+
+void 
+AsyncUdpSocketBase::completeBatchSend(unsigned int numSegments, const asio::error_code& e)
+{
+   for(unsigned int i = 0; i < numSegments; i++)
+   {
+      // Release the buffers right away, so receive buffers can be reused
+      mBatchSendQueue[mBatchSendQueueHead].mFrameData.reset();
+      mBatchSendQueue[mBatchSendQueueHead].mData.reset();
+      if(++mBatchSendQueueHead == mBatchSendQueue.size())
+      {
+         mBatchSendQueue.clear();
+         mBatchSendQueueHead = 0;
+      }
+      if(!e)
+      {
+         onSendSuccess();
+      }
+      else
+      {
+         onSendFailure(e);
+      }
+   }
+}
+
+void 
+AsyncUdpSocketBase::batchSend()
+{
+   mBatchSendPending = false;
+   if(mBatchSendQueue.empty())
+   {
+      return;
+   }
+
+   // Build one message per queued datagram, or per run of datagrams to the same destination if using GSO
+   unsigned int numMessages = 0;
+   unsigned int numIovecs = 0;
+   std::vector<SendData>::iterator it = mBatchSendQueue.begin() + mBatchSendQueueHead;
+   while(it != mBatchSendQueue.end() && numMessages < UDP_BATCH_SIZE && numIovecs + 2 <= UDP_BATCH_MAX_IOVECS)
+   {
+      mmsghdr& message = mBatchSendHeaders[numMessages];
+      memset(&message, 0, sizeof(mmsghdr));
+      asio::ip::udp::endpoint destination(it->mDestination.getAddress(), it->mDestination.getPort());
+      memcpy(&mBatchSendAddresses[numMessages], destination.data(), destination.size());
+      message.msg_hdr.msg_name = &mBatchSendAddresses[numMessages];
+      message.msg_hdr.msg_namelen = destination.size();
+      message.msg_hdr.msg_iov = &mBatchSendIovecs[numIovecs];
+
+      const StunTuple& firstDestination = it->mDestination;
+      size_t segmentSize = 0;
+      size_t totalSize = 0;
+      unsigned int numSegments = 0;
+      while(it != mBatchSendQueue.end() && numIovecs + 2 <= UDP_BATCH_MAX_IOVECS)
+      {
+         size_t size = (it->mFrameData.get() ? it->mFrameData->size() : 0) + it->mData->size() - it->mBufferStartPos;
+         if(numSegments > 0)
+         {
+            // The kernel splits a GSO message into segmentSize datagrams - only the last one may be shorter.  Empty
+            // datagrams can't be segments: they would vanish into the byte stream.
+            if(!mGso || segmentSize == 0 || size == 0 || numSegments >= UDP_GSO_MAX_SEGMENTS || size > segmentSize || 
+               totalSize + size > UDP_GSO_MAX_BYTES || totalSize % segmentSize != 0 || !(it->mDestination == firstDestination))
+            {
+               break;
+            }
+         }
+         else
+         {
+            segmentSize = size;
+         }
+         if(it->mFrameData.get())
+         {
+            mBatchSendIovecs[numIovecs].iov_base = (void*)it->mFrameData->data();
+            mBatchSendIovecs[numIovecs++].iov_len = it->mFrameData->size();
+         }
+         mBatchSendIovecs[numIovecs].iov_base = (void*)(it->mData->data() + it->mBufferStartPos);
+         mBatchSendIovecs[numIovecs++].iov_len = it->mData->size() - it->mBufferStartPos;
+         totalSize += size;
+         numSegments++;
+         it++;
+      }
+      message.msg_hdr.msg_iovlen = &mBatchSendIovecs[numIovecs] - message.msg_hdr.msg_iov;
+      if(numSegments > 1)
+      {
+         message.msg_hdr.msg_control = mBatchSendControl[numMessages];
+         message.msg_hdr.msg_controllen = sizeof(mBatchSendControl[numMessages]);
+         cmsghdr* cmsg = CMSG_FIRSTHDR(&message.msg_hdr);
+         cmsg->cmsg_level = SOL_UDP;
+         cmsg->cmsg_type = UDP_SEGMENT;
+         cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+         uint16_t gsoSize = (uint16_t)segmentSize;
+         memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+      }
+      mBatchSendSegments[numMessages++] = numSegments;
+   }
+
+   int numSent = sendmmsg(mSocket.native(), mBatchSendHeaders, numMessages, MSG_DONTWAIT);
+   if(numSent < 0)
+   {
+      int error = errno;
+      if(error == EAGAIN || error == EWOULDBLOCK)
+      {
+         // Socket buffer is full - send the rest once there is room
+         mBatchSendPending = true;
+         mSocket.async_send(asio::null_buffers(), 
+                            makeAllocatedHandler(mSendHandlerAllocator, 
+                               boost::bind(&AsyncUdpSocketBase::handleBatchSendReady, boost::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()), asio::placeholders::error)));
+         return;
+      }
+      if(error == ENOSYS)
+      {
+         WarningLog(<< "AsyncUdpSocketBase: sendmmsg is not supported, falling back to one operation per datagram.");
+         fallbackToSendDataQueue();
+         return;
+      }
+      if(error == EIO && mBatchSendSegments[0] > 1)
+      {
+         // Device can't do segmentation offload - retry without GSO
+         WarningLog(<< "AsyncUdpSocketBase: UDP GSO send failed, disabling GSO.");
+         mGso = false;
+      }
+      else if(error != EINTR)
+      {
+         // First message failed - drop it and carry on with the rest
+         completeBatchSend(mBatchSendSegments[0], asio::error_code(error, asio::error::get_system_category()));
+      }
+   }
+   else
+   {
+      for(int i = 0; i < numSent; i++)
+      {
+         completeBatchSend(mBatchSendSegments[i], asio::error_code());
+      }
+   }
+
+   if(!mBatchSendQueue.empty())
+   {
+      postBatchSend();
+   }
+}
+
+void 
+AsyncUdpSocketBase::fallbackToSendDataQueue()
+{
+   mBatchIo = false;
+   bool writeInProgress = !mSendDataQueue.empty();
+   for(unsigned int i = mBatchSendQueueHead; i < mBatchSendQueue.size(); i++)
+   {
+      mSendDataQueue.push_back(mBatchSendQueue[i]);
+   }
+   mBatchSendQueue.clear();
+   mBatchSendQueueHead = 0;
+   if(!writeInProgress && !mSendDataQueue.empty())
+   {
+      sendFirstQueuedData();
+   }
+}
+#endif
+
 }
 
 
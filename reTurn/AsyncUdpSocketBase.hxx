@@ -6,6 +6,19 @@
 
 #include "AsyncSocketBase.hxx"
 
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#if defined(MSG_WAITFORONE)   // recvmmsg/sendmmsg are available (Linux 2.6.33+ / glibc 2.12+)
+#define RETURN_BATCH_IO_SUPPORTED
+#endif
+#endif
+
+#define UDP_BATCH_SIZE 16              // max datagrams read or written per recvmmsg/sendmmsg call
+#define UDP_BATCH_MAX_IOVECS 64        // max buffers gathered by one sendmmsg call (frame + data per datagram)
+#define UDP_GSO_MAX_SEGMENTS 32        // max datagrams coalesced into one GSO send
+#define UDP_GSO_MAX_BYTES 65000        // GSO sends are limited to one (maximum size) UDP datagram
+
 namespace reTurn {
 
 class AsyncUdpSocketBase : public AsyncSocketBase
@@ -17,11 +30,19 @@ public:
    virtual unsigned int getSocketDescriptor();
 
    virtual asio::error_code bind(const asio::ip::address& address, unsigned short port);
+   /// Must be called before bind - see reuse_port
+   void setReusePort(bool reusePort) { mReusePort = reusePort; }
+   /// Linux only - reads up to UDP_BATCH_SIZE datagrams per readiness event with recvmmsg, and writes everything 
+   /// queued while handling them with one sendmmsg call, sending runs of datagrams of the same size to the same 
+   /// destination as one UDP GSO message if the kernel supports it.  Has no effect on other platforms, and falls
+   /// back to one asio operation per datagram if the system calls are not available.  Call after bind, before start.
+   void setBatchIo(bool batchIo);
    virtual void connect(const std::string& address, unsigned short port);  
 
    virtual void transportReceive();
    virtual void transportFramedReceive();
    virtual void transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers);
+   virtual bool transportSendImmediate(const StunTuple& destination, boost::shared_ptr<DataBuffer>& frame, boost::shared_ptr<DataBuffer>& data, unsigned int bufferStartPos);
    virtual void transportClose();
 
    virtual const asio::ip::address getSenderEndpointAddress();
@@ -34,11 +55,49 @@ protected:
    /// Endpoint info for current sender
    asio::ip::udp::endpoint mSenderEndpoint;
 
+   bool mReusePort;
+   bool mNonBlocking;
+
    virtual void handleUdpResolve(const asio::error_code& ec,
                                  asio::ip::udp::resolver::iterator endpoint_iterator);
 
 private:
-
+#ifdef RETURN_BATCH_IO_SUPPORTED
+   void startBatchReceive();
+   void handleBatchReceiveReady(const asio::error_code& e);
+   void dispatchBatchReceive();
+   void resumeBatchReceive();
+   void handleBatchSendReady(const asio::error_code& e);
+   void postBatchSend();
+   void batchSend();
+   void completeBatchSend(unsigned int numSegments, const asio::error_code& e);
+   void fallbackToSendDataQueue();
+
+   bool mBatchIo;
+   bool mGso;
+   bool mBatchSendPending;         // a batchSend is posted, or waiting for the socket to become writable
+   /// Data waiting for batchSend, from mBatchSendQueueHead on - a vector, rather than mSendDataQueue, so that its
+   /// storage is reused
+   std::vector<SendData> mBatchSendQueue;
+   unsigned int mBatchSendQueueHead;
+   bool mDispatchingBatch;         // handing received datagrams to onReceiveSuccess
+   bool mBatchReceiveRequested;    // doReceive was called while dispatching
+   /// Datagrams of the last recvmmsg, from mBatchReceiveNext on, are still to be handed over
+   unsigned int mBatchReceiveCount;
+   unsigned int mBatchReceiveNext;
+   bool mBatchReceiveResumePending;   // a resumeBatchReceive is posted
+
+   boost::shared_ptr<DataBuffer> mBatchReceiveBuffers[UDP_BATCH_SIZE];
+   mmsghdr mBatchReceiveHeaders[UDP_BATCH_SIZE];
+   iovec mBatchReceiveIovecs[UDP_BATCH_SIZE];
+   sockaddr_storage mBatchReceiveAddresses[UDP_BATCH_SIZE];
+
+   mmsghdr mBatchSendHeaders[UDP_BATCH_SIZE];
+   iovec mBatchSendIovecs[UDP_BATCH_MAX_IOVECS];
+   sockaddr_storage mBatchSendAddresses[UDP_BATCH_SIZE];
+   unsigned int mBatchSendSegments[UDP_BATCH_SIZE];   // number of queued datagrams in each message
+   char mBatchSendControl[UDP_BATCH_SIZE][CMSG_SPACE(sizeof(uint16_t))];
+#endif
 };
 
 }
@@ -12,7 +12,17 @@ using namespace std;
 
 namespace reTurn {
 
-ChannelManager::ChannelManager()
+// Marks a slot whose RemotePeer was removed - lookups must probe past it
+static char deletedSlotMarker;
+#define DELETED_SLOT reinterpret_cast<RemotePeer*>(&deletedSlotMarker)
+#define NO_SLOT ((size_t)-1)
+#define INITIAL_TABLE_SIZE 8  // must be a power of 2
+
+ChannelManager::ChannelManager() :
+   mChannelTable(INITIAL_TABLE_SIZE, (RemotePeer*)0),
+   mTupleTable(INITIAL_TABLE_SIZE, (RemotePeer*)0),
+   mNumRemotePeers(0),
+   mNumUsedSlots(0)
 {
    // make starting channel number random
    int randInt = resip::Random::getRandom();
@@ -22,10 +32,17 @@ ChannelManager::ChannelManager()
 ChannelManager::~ChannelManager()
 {
    // Cleanup RemotePeer Memory
-   TupleRemotePeerMap::iterator it;   
-   for(it = mTupleRemotePeerMap.begin(); it != mTupleRemotePeerMap.end(); it++)
+   RemotePeerTable::iterator it;   
+   for(it = mChannelTable.begin(); it != mChannelTable.end(); it++)
+   {
+      if(*it != 0 && *it != DELETED_SLOT)
+      {
+         delete *it;
+      }
+   }
+   for(it = mExpiredRemotePeers.begin(); it != mExpiredRemotePeers.end(); it++)
    {
-      delete it->second;
+      delete *it;
    }
 }
 
@@ -57,27 +74,26 @@ ChannelManager::createChannelBinding(const StunTuple& peerTuple, unsigned short
    // Create New RemotePeer
    RemotePeer* remotePeer = new RemotePeer(peerTuple, channel, TURN_CHANNEL_BINDING_LIFETIME_SECONDS);
 
-   // Add RemoteAddress to the appropriate maps
-   mTupleRemotePeerMap[peerTuple] = remotePeer;
-   mChannelRemotePeerMap[channel] = remotePeer;
+   // Add RemoteAddress to the appropriate tables
+   insertRemotePeer(remotePeer);
    return remotePeer;
 }
 
 RemotePeer* 
 ChannelManager::findRemotePeerByChannel(unsigned short channelNumber)
 {
-   ChannelRemotePeerMap::iterator it = mChannelRemotePeerMap.find(channelNumber);
-   if(it != mChannelRemotePeerMap.end())
+   size_t slot = findChannelSlot(channelNumber);
+   if(slot != NO_SLOT)
    {
-      if(!it->second->isExpired())
+      RemotePeer* remotePeer = mChannelTable[slot];
+      if(!remotePeer->isExpired())
       {
-         return it->second;
+         return remotePeer;
       }
       else
       {
          // cleanup expired channel binding
-         mTupleRemotePeerMap.erase(it->second->getPeerTuple());
-         mChannelRemotePeerMap.erase(it);
+         removeExpiredRemotePeer(remotePeer);
       }
    }
    return 0;
@@ -87,23 +103,120 @@ RemotePeer*
 ChannelManager::findRemotePeerByPeerAddress(const StunTuple& peerAddress)
 {
    // Find RemotePeer
-   TupleRemotePeerMap::iterator it = mTupleRemotePeerMap.find(peerAddress);
-   if(it != mTupleRemotePeerMap.end())
+   size_t slot = findTupleSlot(peerAddress);
+   if(slot != NO_SLOT)
    {
-      if(!it->second->isExpired())
+      RemotePeer* remotePeer = mTupleTable[slot];
+      if(!remotePeer->isExpired())
       {
-         return it->second;
+         return remotePeer;
       }
       else
       {
          // cleanup expired channel binding
-         mChannelRemotePeerMap.erase(it->second->getChannel());
-         mTupleRemotePeerMap.erase(it);
+         removeExpiredRemotePeer(remotePeer);
       }
    }
    return 0;
 }
 
+size_t 
+ChannelManager::hashChannel(unsigned short channel)
+{
+   return (size_t)channel * 2654435761U;  // Knuth's multiplicative hash
+}
+
+size_t 
+ChannelManager::findChannelSlot(unsigned short channel) const
+{
+   size_t mask = mChannelTable.size() - 1;
+   for(size_t slot = hashChannel(channel) & mask;; slot = (slot + 1) & mask)
+   {
+      RemotePeer* remotePeer = mChannelTable[slot];
+      if(remotePeer == 0)
+      {
+         return NO_SLOT;  // tables are never full, so we always end on an empty slot
+      }
+      if(remotePeer != DELETED_SLOT && remotePeer->getChannel() == channel)
+      {
+         return slot;
+      }
+   }
+}
+
+size_t 
+ChannelManager::findTupleSlot(const StunTuple& tuple) const
+{
+   size_t mask = mTupleTable.size() - 1;
+   for(size_t slot = tuple.hash() & mask;; slot = (slot + 1) & mask)
+   {
+      RemotePeer* remotePeer = mTupleTable[slot];
+      if(remotePeer == 0)
+      {
+         return NO_SLOT;
+      }
+      if(remotePeer != DELETED_SLOT && remotePeer->getPeerTuple() == tuple)
+      {
+         return slot;
+      }
+   }
+}
+
+void 
+ChannelManager::insertRemotePeer(RemotePeer* remotePeer)
+{
+   if((mNumUsedSlots + 1) * 2 > mChannelTable.size())
+   {
+      // Grow if needed, otherwise this just clears out deleted slots
+      size_t tableSize = INITIAL_TABLE_SIZE;
+      while((mNumRemotePeers + 1) * 4 > tableSize)
+      {
+         tableSize *= 2;
+      }
+      rehash(tableSize);
+   }
+
+   // Always use empty slots (not deleted ones), so that both tables stay in step with mNumUsedSlots
+   size_t mask = mChannelTable.size() - 1;
+   size_t slot;
+   for(slot = hashChannel(remotePeer->getChannel()) & mask; mChannelTable[slot] != 0; slot = (slot + 1) & mask);
+   mChannelTable[slot] = remotePeer;
+   for(slot = remotePeer->getPeerTuple().hash() & mask; mTupleTable[slot] != 0; slot = (slot + 1) & mask);
+   mTupleTable[slot] = remotePeer;
+
+   mNumRemotePeers++;
+   mNumUsedSlots++;
+}
+
+void 
+ChannelManager::removeExpiredRemotePeer(RemotePeer* remotePeer)
+{
+   size_t channelSlot = findChannelSlot(remotePeer->getChannel());
+   size_t tupleSlot = findTupleSlot(remotePeer->getPeerTuple());
+   assert(channelSlot != NO_SLOT && tupleSlot != NO_SLOT);
+   mChannelTable[channelSlot] = DELETED_SLOT;
+   mTupleTable[tupleSlot] = DELETED_SLOT;
+   mNumRemotePeers--;
+   mExpiredRemotePeers.push_back(remotePeer);
+}
+
+void 
+ChannelManager::rehash(size_t tableSize)
+{
+   RemotePeerTable oldTable(tableSize, (RemotePeer*)0);
+   oldTable.swap(mChannelTable);
+   mTupleTable.assign(tableSize, (RemotePeer*)0);
+   mNumRemotePeers = 0;
+   mNumUsedSlots = 0;
+   for(RemotePeerTable::iterator it = oldTable.begin(); it != oldTable.end(); it++)
+   {
+      if(*it != 0 && *it != DELETED_SLOT)
+      {
+         insertRemotePeer(*it);
+      }
+   }
+}
+
 } // namespace
 
 
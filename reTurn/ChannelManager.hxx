@@ -2,6 +2,7 @@
 #define CHANNELMANAGER_HXX
 
 #include <asio.hpp>
+#include <vector>
 
 #include "RemotePeer.hxx"
 
@@ -23,10 +24,25 @@ public:
    RemotePeer* findRemotePeerByPeerAddress(const StunTuple& peerAddress);
 
 private:
-   typedef std::map<unsigned short,RemotePeer*> ChannelRemotePeerMap;
-   typedef std::map<StunTuple,RemotePeer*> TupleRemotePeerMap;
-   ChannelRemotePeerMap mChannelRemotePeerMap;
-   TupleRemotePeerMap mTupleRemotePeerMap;
+   // RemotePeers are kept in two open addressing (linear probing) hash tables - one keyed by channel number and 
+   // one by peer tuple - since one of them is searched for every relayed packet.  Both tables always hold the same 
+   // RemotePeers, so they share a size (a power of 2) and the load counters, and are kept at most half full.
+   typedef std::vector<RemotePeer*> RemotePeerTable;
+   RemotePeerTable mChannelTable;
+   RemotePeerTable mTupleTable;
+   unsigned int mNumRemotePeers;  // entries in use
+   unsigned int mNumUsedSlots;    // entries in use plus deleted entries (cleared by rehash)
+
+   // Expired RemotePeers are removed from the tables, but not deleted until the ChannelManager is, since users 
+   // (ie. a client's active destination) may still hold a pointer to them
+   std::vector<RemotePeer*> mExpiredRemotePeers;
+
+   static size_t hashChannel(unsigned short channel);
+   size_t findChannelSlot(unsigned short channel) const;
+   size_t findTupleSlot(const StunTuple& tuple) const;
+   void insertRemotePeer(RemotePeer* remotePeer);
+   void removeExpiredRemotePeer(RemotePeer* remotePeer);
+   void rehash(size_t tableSize);
 
    unsigned short getNextChannelNumber();
    unsigned short mNextChannelNumber;
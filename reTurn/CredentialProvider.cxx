@@ -0,0 +1,216 @@
+#include <fstream>
+#include <sstream>
+
+#include "CredentialProvider.hxx"
+#include "StunMessage.hxx"
+#include <rutil/Lock.hxx>
+#include <rutil/Logger.hxx>
+#include "ReTurnSubsystem.hxx"
+
+#define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
+
+using namespace std;
+using namespace resip;
+
+namespace reTurn {
+
+CredentialCache::CredentialCache(const Data& realm) :
+   mRealm(realm)
+{
+}
+
+CredentialCache::CredentialCache(const Data& realm, const std::map<Data,Data>& credentials) :
+   mRealm(realm)
+{
+   setCredentials(credentials);
+}
+
+CredentialCache::~CredentialCache()
+{
+}
+
+bool 
+CredentialCache::isUserNameValid(const Data& username)
+{
+   Lock lock(mMutex);
+   return mCredentials.find(username) != mCredentials.end();
+}
+
+bool 
+CredentialCache::getLongTermKey(const Data& username, const Data& realm, Data& hmacKey)
+{
+   Data password;
+   {
+      Lock lock(mMutex);
+      CredentialMap::const_iterator it = mCredentials.find(username);
+      if(it == mCredentials.end())
+      {
+         return false;
+      }
+      if(realm == mRealm)
+      {
+         hmacKey = it->second.mLongTermKey;
+         return true;
+      }
+      if(it->second.mPassword.empty())
+      {
+         // Only the key for our own realm was provisioned
+         return false;
+      }
+      password = it->second.mPassword;
+   }
+   StunMessage::calculateHmacKey(hmacKey, username, realm, password);
+   return true;
+}
+
+void 
+CredentialCache::setCredentials(const std::map<Data,Data>& credentials)
+{
+   CredentialMap newCredentials;
+   for(std::map<Data,Data>::const_iterator it = credentials.begin(); it != credentials.end(); it++)
+   {
+      newCredentials[it->first] = makeCredential(it->first, it->second);
+   }
+   setCredentials(newCredentials);
+}
+
+void 
+CredentialCache::setCredentials(CredentialMap& credentials)
+{
+   {
+      Lock lock(mMutex);
+      mCredentials.swap(credentials);
+   }
+   mGeneration.increment();
+}
+
+CredentialCache::Credential 
+CredentialCache::makeCredential(const Data& username, const Data& password) const
+{
+   Credential credential;
+   credential.mPassword = password;
+   StunMessage::calculateHmacKey(credential.mLongTermKey, username, mRealm, password);
+   return credential;
+}
+
+FileCredentialProvider::FileCredentialProvider(const Data& realm, const Data& filename) :
+   CredentialCache(realm),
+   mFilename(filename)
+{
+   reload();
+}
+
+static bool
+decodeHexKey(const Data& hex, Data& key)
+{
+   // MD5 - 16 bytes
+   if(hex.size() != 32)
+   {
+      return false;
+   }
+   key.clear();
+   for(Data::size_type i = 0; i < hex.size(); i += 2)
+   {
+      unsigned char byte = 0;
+      for(int j = 0; j < 2; j++)
+      {
+         char c = hex[i+j];
+         byte <<= 4;
+         if(c >= '0' && c <= '9') byte |= c - '0';
+         else if(c >= 'a' && c <= 'f') byte |= c - 'a' + 10;
+         else if(c >= 'A' && c <= 'F') byte |= c - 'A' + 10;
+         else return false;
+      }
+      key += (char)byte;
+   }
+   return true;
+}
+
+bool 
+FileCredentialProvider::reload()
+{
+   ifstream file(mFilename.c_str());
+   if(!file)
+   {
+      ErrLog(<< "FileCredentialProvider: unable to open " << mFilename << ", keeping current credentials");
+      return false;
+   }
+
+   CredentialMap credentials;
+   string line;
+   unsigned int lineNumber = 0;
+   while(getline(file, line))
+   {
+      lineNumber++;
+      istringstream fields(line);
+      string usernameField;
+      string secretField;
+      if(!(fields >> usernameField) || usernameField[0] == '#')
+      {
+         continue;
+      }
+      if(!(fields >> secretField))
+      {
+         WarningLog(<< "FileCredentialProvider: " << mFilename << ":" << lineNumber << " has no password, ignoring");
+         continue;
+      }
+
+      Data username(usernameField);
+      Data secret(secretField);
+      if(secret.prefix("0x"))
+      {
+         Credential credential;
+         if(!decodeHexKey(secret.substr(2), credential.mLongTermKey))
+         {
+            WarningLog(<< "FileCredentialProvider: " << mFilename << ":" << lineNumber << " has a malformed key, ignoring");
+            continue;
+         }
+         credentials[username] = credential;
+      }
+      else
+      {
+         credentials[username] = makeCredential(username, secret);
+      }
+   }
+
+   InfoLog(<< "FileCredentialProvider: " << credentials.size() << " user(s) loaded from " << mFilename);
+   setCredentials(credentials);
+   return true;
+}
+
+} // namespace
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
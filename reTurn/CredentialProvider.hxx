@@ -0,0 +1,123 @@
+#ifndef CREDENTIALPROVIDER_HXX
+#define CREDENTIALPROVIDER_HXX
+
+#include <map>
+#include <rutil/Data.hxx>
+#include <rutil/HashMap.hxx>
+#include <rutil/Mutex.hxx>
+#include <rutil/AtomicCounter.hxx>
+
+namespace reTurn {
+
+/// Source of the long term credentials used to authenticate TURN requests.  One provider is 
+/// shared by the RequestHandlers of all ioService shards, so implementations must be thread safe.
+class CredentialProvider
+{
+public:
+   virtual ~CredentialProvider() {}
+
+   virtual bool isUserNameValid(const resip::Data& username) = 0;
+
+   /// Fills in the long term HMAC key for the user - the MD5 of username:realm:password.  
+   /// Returns false if the user is not known.
+   virtual bool getLongTermKey(const resip::Data& username, const resip::Data& realm, resip::Data& hmacKey) = 0;
+
+   /// Changes every time the credentials change, so that users of the provider can tell when 
+   /// keys they have derived from it are stale
+   virtual long getGeneration() const = 0;
+
+   /// Re-reads the credentials from their source, if any.  Returns false on failure, in which 
+   /// case the current credentials are kept.
+   virtual bool reload() { return true; }
+};
+
+/// A hashed in-memory table of users and their precomputed long term keys
+class CredentialCache : public CredentialProvider
+{
+public:
+   explicit CredentialCache(const resip::Data& realm);
+   CredentialCache(const resip::Data& realm, const std::map<resip::Data,resip::Data>& credentials);
+   virtual ~CredentialCache();
+
+   virtual bool isUserNameValid(const resip::Data& username);
+   virtual bool getLongTermKey(const resip::Data& username, const resip::Data& realm, resip::Data& hmacKey);
+   virtual long getGeneration() const { return mGeneration.value(); }
+
+   /// Replaces all of the credentials with username/password pairs
+   void setCredentials(const std::map<resip::Data,resip::Data>& credentials);
+
+protected:
+   class Credential
+   {
+   public:
+      resip::Data mPassword;     // empty if the key was provisioned precomputed
+      resip::Data mLongTermKey;  // for mRealm
+   };
+   typedef HashMap<resip::Data, Credential> CredentialMap;
+
+   /// Swaps in a new table of credentials (computed without holding the lock)
+   void setCredentials(CredentialMap& credentials);
+   Credential makeCredential(const resip::Data& username, const resip::Data& password) const;
+
+   const resip::Data mRealm;
+
+private:
+   mutable resip::Mutex mMutex;
+   CredentialMap mCredentials;
+   resip::AtomicCounter mGeneration;
+};
+
+/// Loads credentials from a file, one user per line:
+///   username password
+///   username 0x<hex MD5 of username:realm:password>
+/// Blank lines and lines starting with # are ignored.  Call reload() (ie. on SIGHUP) to pick up 
+/// changes to the file without restarting the server.
+class FileCredentialProvider : public CredentialCache
+{
+public:
+   FileCredentialProvider(const resip::Data& realm, const resip::Data& filename);
+
+   virtual bool reload();
+
+private:
+   const resip::Data mFilename;
+};
+
+} 
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -6,19 +6,25 @@
 namespace reTurn {
 
 DataBuffer::DataBuffer(const char* data, unsigned int size) : 
-mBuffer(size != 0 ? new char[size] : 0), mSize(size), mStart(mBuffer) 
+mBuffer(size != 0 ? new char[size] : 0), mSize(size), mStart(mBuffer), mCapacity(size), mInitialHeadroom(0), mInitialSize(size) 
 {
    memcpy(mBuffer, data, size);
 }
 
 DataBuffer::DataBuffer(unsigned int size) : 
-mBuffer(size != 0 ? new char[size] : 0), mSize(size), mStart(mBuffer) 
+mBuffer(size != 0 ? new char[size] : 0), mSize(size), mStart(mBuffer), mCapacity(size), mInitialHeadroom(0), mInitialSize(size) 
+{
+}
+
+DataBuffer::DataBuffer(unsigned int size, unsigned int headroom, unsigned int tailroom) : 
+mBuffer(size+headroom+tailroom != 0 ? new char[size+headroom+tailroom] : 0), mSize(size), mStart(mBuffer+headroom), 
+mCapacity(size+headroom+tailroom), mInitialHeadroom(headroom), mInitialSize(size) 
 {
 }
 
 DataBuffer::~DataBuffer() 
 { 
-   delete mBuffer; 
+   delete [] mBuffer; 
 }
 
 const char* 
@@ -37,14 +43,14 @@ char&
 DataBuffer::operator[](unsigned int p) 
 { 
    assert(p < mSize); 
-   return mBuffer[p]; 
+   return mStart[p]; 
 }
 
 char 
 DataBuffer::operator[](unsigned int p) const 
 { 
    assert(p < mSize); 
-   return mBuffer[p]; 
+   return mStart[p]; 
 }
 
 unsigned int 
@@ -64,6 +70,30 @@ DataBuffer::offset(unsigned int bytes)
    return mSize;
 }
 
+char* 
+DataBuffer::prepend(unsigned int bytes) 
+{ 
+   assert(bytes <= headroom()); 
+   mStart = mStart-bytes; 
+   mSize = mSize+bytes; 
+   return mStart;
+}
+
+unsigned int 
+DataBuffer::extend(unsigned int bytes) 
+{ 
+   assert(bytes <= tailroom()); 
+   mSize = mSize+bytes; 
+   return mSize;
+}
+
+void 
+DataBuffer::reset() 
+{ 
+   mStart = mBuffer+mInitialHeadroom; 
+   mSize = mInitialSize; 
+}
+
 } // namespace
 
 
@@ -8,6 +8,9 @@ class DataBuffer
 public:
    DataBuffer(const char* data, unsigned int size);  
    DataBuffer(unsigned int size);  
+   /// Reserves headroom bytes in front of and tailroom bytes behind the data, so that
+   /// protocol headers (ie. ChannelData framing or a Data indication) can be added in place
+   DataBuffer(unsigned int size, unsigned int headroom, unsigned int tailroom);  
    ~DataBuffer();
 
    const char* data();
@@ -18,10 +21,22 @@ public:
    unsigned int truncate(unsigned int newSize);
    unsigned int offset(unsigned int bytes);
 
+   unsigned int headroom() const { return (unsigned int)(mStart - mBuffer); }
+   unsigned int tailroom() const { return mCapacity - headroom() - mSize; }
+   /// Moves the start of the buffer back by bytes (must be <= headroom) and returns the new start
+   char* prepend(unsigned int bytes);
+   /// Grows the buffer by bytes at the end (must be <= tailroom) and returns the new size
+   unsigned int extend(unsigned int bytes);
+   /// Restores the start and size the buffer was constructed with - used when recycling receive buffers
+   void reset();
+
 private:
    char* mBuffer;
    unsigned int mSize;
    char* mStart;
+   unsigned int mCapacity;
+   unsigned int mInitialHeadroom;
+   unsigned int mInitialSize;
 };
 
 }
@@ -0,0 +1,261 @@
+#include "QuotaManager.hxx"
+#include "ReTurnConfig.hxx"
+#include <rutil/Lock.hxx>
+#include <rutil/Timer.hxx>
+#include <rutil/Logger.hxx>
+#include "ReTurnSubsystem.hxx"
+
+#define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
+
+using namespace std;
+using namespace resip;
+
+namespace reTurn {
+
+TokenBucket::TokenBucket(unsigned long rate, unsigned long burst) :
+   mRate(rate),
+   mBurst((UInt64)burst * 1000),
+   mStart(Timer::getTimeMs()),
+   mFullAt(0)  // full
+{
+}
+
+UInt64 
+TokenBucket::load() const
+{
+   // a plain read of a 64 bit value is not atomic on 32 bit platforms
+#if defined(WIN32)
+   return (UInt64)InterlockedCompareExchange64((volatile LONGLONG*)&mFullAt, 0, 0);
+#elif defined(__GNUC__)
+   return __sync_val_compare_and_swap(const_cast<volatile UInt64*>(&mFullAt), 0, 0);
+#else
+   Lock lock(mMutex);
+   return mFullAt;
+#endif
+}
+
+bool 
+TokenBucket::compareAndSwap(UInt64 expected, UInt64 desired)
+{
+#if defined(WIN32)
+   return (UInt64)InterlockedCompareExchange64((volatile LONGLONG*)&mFullAt, (LONGLONG)desired, (LONGLONG)expected) == expected;
+#elif defined(__GNUC__)
+   return __sync_bool_compare_and_swap(&mFullAt, expected, desired);
+#else
+   Lock lock(mMutex);
+   if(mFullAt != expected)
+   {
+      return false;
+   }
+   mFullAt = desired;
+   return true;
+#endif
+}
+
+bool 
+TokenBucket::consume(unsigned int bytes)
+{
+   return consume(bytes, Timer::getTimeMs());
+}
+
+bool 
+TokenBucket::consume(unsigned int bytes, UInt64 nowMs)
+{
+   const UInt64 cost = (UInt64)bytes * 1000;
+   const UInt64 now = (nowMs - mStart) * mRate;
+   for(;;)
+   {
+      const UInt64 fullAt = load();
+      // a bucket that filled up before now has been full since
+      const UInt64 from = fullAt - now < ((UInt64)1 << 63) ? fullAt : now;
+      // taking cost leaves the bucket (from + cost - now) short of full
+      if(from - now + cost > mBurst)
+      {
+         return false;
+      }
+      if(compareAndSwap(fullAt, from + cost))
+      {
+         return true;
+      }
+   }
+}
+
+void 
+TokenBucket::refund(unsigned int bytes)
+{
+   const UInt64 cost = (UInt64)bytes * 1000;
+   for(;;)
+   {
+      // if the bucket has filled up since, this leaves it full
+      const UInt64 fullAt = load();
+      if(compareAndSwap(fullAt, fullAt - cost))
+      {
+         return;
+      }
+   }
+}
+
+class QuotaManager::Usage
+{
+public:
+   Usage(const Data& key, unsigned long bandwidth) : 
+      mKey(key), 
+      mAllocations(0), 
+      mBandwidth(bandwidth ? new TokenBucket(bandwidth, bandwidth /* one second worth of burst */) : 0) {}
+   ~Usage() { delete mBandwidth; }
+
+   const Data mKey;
+   unsigned long mAllocations;
+   TokenBucket* mBandwidth;  // 0 if unlimited
+};
+
+QuotaManager::QuotaManager(const ReTurnConfig& config) :
+   mConfig(config)
+{
+}
+
+QuotaManager::~QuotaManager()
+{
+   // Any reservations still held by allocations are gone with their TurnManagers by now
+   for(UsageMap::iterator it = mUserUsage.begin(); it != mUserUsage.end(); it++)
+   {
+      delete it->second;
+   }
+   for(UsageMap::iterator it = mAddressUsage.begin(); it != mAddressUsage.end(); it++)
+   {
+      delete it->second;
+   }
+}
+
+QuotaManager::Reservation* 
+QuotaManager::reserveAllocation(const Data& username, const asio::ip::address& address)
+{
+   Data addressKey(address.to_string());
+
+   Lock lock(mMutex);
+   Usage* userUsage = acquireUsage(mUserUsage, username, mConfig.mMaxAllocationsPerUser, mConfig.mMaxBandwidthPerUser);
+   if(!userUsage)
+   {
+      InfoLog(<< "QuotaManager: allocation quota reached for user " << username);
+      return 0;
+   }
+   Usage* addressUsage = acquireUsage(mAddressUsage, addressKey, mConfig.mMaxAllocationsPerAddress, mConfig.mMaxBandwidthPerAddress);
+   if(!addressUsage)
+   {
+      InfoLog(<< "QuotaManager: allocation quota reached for address " << addressKey);
+      releaseUsage(mUserUsage, userUsage);
+      return 0;
+   }
+   return new Reservation(*this, userUsage, addressUsage);
+}
+
+QuotaManager::Usage* 
+QuotaManager::acquireUsage(UsageMap& usageMap, const Data& key, unsigned long maxAllocations, unsigned long bandwidth)
+{
+   Usage* usage;
+   UsageMap::iterator it = usageMap.find(key);
+   if(it != usageMap.end())
+   {
+      usage = it->second;
+      if(maxAllocations != 0 && usage->mAllocations >= maxAllocations)
+      {
+         return 0;
+      }
+   }
+   else
+   {
+      usage = new Usage(key, bandwidth);
+      usageMap[key] = usage;
+   }
+   usage->mAllocations++;
+   return usage;
+}
+
+void 
+QuotaManager::releaseUsage(UsageMap& usageMap, Usage* usage)
+{
+   assert(usage->mAllocations > 0);
+   if(--usage->mAllocations == 0)
+   {
+      usageMap.erase(usage->mKey);
+      delete usage;
+   }
+}
+
+void 
+QuotaManager::release(Reservation& reservation)
+{
+   Lock lock(mMutex);
+   releaseUsage(mUserUsage, reservation.mUserUsage);
+   releaseUsage(mAddressUsage, reservation.mAddressUsage);
+}
+
+QuotaManager::Reservation::Reservation(QuotaManager& quotaManager, Usage* userUsage, Usage* addressUsage) :
+   mQuotaManager(quotaManager),
+   mUserUsage(userUsage),
+   mAddressUsage(addressUsage)
+{
+}
+
+QuotaManager::Reservation::~Reservation()
+{
+   mQuotaManager.release(*this);
+}
+
+bool 
+QuotaManager::Reservation::consumeBandwidth(unsigned int bytes)
+{
+   // Usages (and their buckets) live as long as any reservation referring to them, so no need for the QuotaManager lock here
+   if(mUserUsage->mBandwidth && !mUserUsage->mBandwidth->consume(bytes))
+   {
+      return false;
+   }
+   if(mAddressUsage->mBandwidth && !mAddressUsage->mBandwidth->consume(bytes))
+   {
+      // the packet is dropped, so the user's quota is not charged for it - otherwise one source
+      // address over its quota would use up the bandwidth of the user's other addresses
+      if(mUserUsage->mBandwidth)
+      {
+         mUserUsage->mBandwidth->refund(bytes);
+      }
+      return false;
+   }
+   return true;
+}
+
+} // namespace
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
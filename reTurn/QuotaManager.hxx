@@ -0,0 +1,129 @@
+#ifndef QUOTAMANAGER_HXX
+#define QUOTAMANAGER_HXX
+
+#include <boost/noncopyable.hpp>
+#include <asio.hpp>
+#include <rutil/Data.hxx>
+#include <rutil/HashMap.hxx>
+#include <rutil/Mutex.hxx>
+
+namespace reTurn {
+
+class ReTurnConfig;
+
+/// Rate limiter:  holds up to burst bytes worth of tokens, refilled at rate bytes per second.
+/// Lock free, since buckets are shared by the relays of all ioService shards.
+class TokenBucket : private boost::noncopyable
+{
+public:
+   TokenBucket(unsigned long rate, unsigned long burst);
+
+   /// Takes bytes worth of tokens - returns false (and takes nothing) if there aren't enough
+   bool consume(unsigned int bytes);
+   /// As above, at time nowMs (from Timer::getTimeMs)
+   bool consume(unsigned int bytes, UInt64 nowMs);
+   /// Gives back tokens taken by consume, ie. for a packet that ends up being dropped
+   void refund(unsigned int bytes);
+
+private:
+   UInt64 load() const;
+   bool compareAndSwap(UInt64 expected, UInt64 desired);
+
+   // Instead of a token count and the time of the last refill, the bucket keeps the one value 
+   // they determine:  the time at which it will be full again.  Tokens are counted in thousandths
+   // of a byte and time in units of one such token's refill time (1/mRate ms), so no fraction is
+   // lost however often consume is called.  Times are relative to mStart and compared modulo 2^64.
+   const UInt64 mRate;
+   const UInt64 mBurst;
+   const UInt64 mStart;  // ms
+   volatile UInt64 mFullAt;
+#if !defined(WIN32) && !defined(__GNUC__)
+   mutable resip::Mutex mMutex;
+#endif
+};
+
+/// Per user and per client address allocation and relay bandwidth quotas.  One QuotaManager is
+/// shared by all ioService shards, since a user's allocations (and a client address's) may be 
+/// spread across shards.
+class QuotaManager : private boost::noncopyable
+{
+public:
+   explicit QuotaManager(const ReTurnConfig& config);
+   ~QuotaManager();
+
+   class Usage;
+
+   /// Held by a TurnAllocation for its lifetime - the allocation is counted against the quotas 
+   /// until the Reservation is deleted.
+   class Reservation : private boost::noncopyable
+   {
+   public:
+      ~Reservation();
+
+      /// Called for each packet relayed by the allocation (in either direction) - returns false
+      /// if the user or client address is over its bandwidth quota and the packet must be dropped
+      bool consumeBandwidth(unsigned int bytes);
+
+   private:
+      friend class QuotaManager;
+      Reservation(QuotaManager& quotaManager, Usage* userUsage, Usage* addressUsage);
+
+      QuotaManager& mQuotaManager;
+      Usage* mUserUsage;
+      Usage* mAddressUsage;
+   };
+
+   /// Returns 0 if the user or the client address already has the maximum number of allocations
+   Reservation* reserveAllocation(const resip::Data& username, const asio::ip::address& address);
+
+private:
+   typedef HashMap<resip::Data, Usage*> UsageMap;
+
+   Usage* acquireUsage(UsageMap& usageMap, const resip::Data& key, unsigned long maxAllocations, unsigned long bandwidth);
+   void releaseUsage(UsageMap& usageMap, Usage* usage);
+   void release(Reservation& reservation);
+
+   const ReTurnConfig& mConfig;
+   resip::Mutex mMutex;
+   UsageMap mUserUsage;
+   UsageMap mAddressUsage;
+};
+
+} 
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -23,6 +23,11 @@ ReTurnConfig::ReTurnConfig() :
    mDefaultAllocationLifetime(600), // 10 minutes
    mMaxAllocationLifetime(3600),    // 1 hour
    mMaxAllocationsPerUser(0),       // 0 - no max
+   mMaxAllocationsPerAddress(0),    // 0 - no max
+   mMaxBandwidthPerUser(0),         // 0 - no max
+   mMaxBandwidthPerAddress(0),      // 0 - no max
+   mNumThreads(1),                  // 1 - the one and only ioService
+   mUdpBatchIo(true),               // falls back to one operation per datagram where not supported
    mTlsServerCertificateFilename("server.pem"),
    mTlsTempDhFilename("dh512.pem"),
    mTlsPrivateKeyPassword("password"),
@@ -29,13 +29,19 @@ public:
    AuthenticationMode mAuthenticationMode;
    resip::Data mAuthenticationRealm;
    std::map<resip::Data,resip::Data> mAuthenticationCredentials;
+   resip::Data mAuthenticationCredentialsFilename;  // if set, credentials are loaded from this file (see FileCredentialProvider) instead of mAuthenticationCredentials
    unsigned long mNonceLifetime;
 
    unsigned short mAllocationPortRangeMin;
    unsigned short mAllocationPortRangeMax;
    unsigned long mDefaultAllocationLifetime;
    unsigned long mMaxAllocationLifetime;
-   unsigned long mMaxAllocationsPerUser;  // TODO - enforcement needs to be implemented
+   unsigned long mMaxAllocationsPerUser;      // 0 - no max
+   unsigned long mMaxAllocationsPerAddress;   // per client IP address, 0 - no max
+   unsigned long mMaxBandwidthPerUser;        // bytes per second relayed (both directions) for all of a user's allocations, 0 - no max
+   unsigned long mMaxBandwidthPerAddress;     // bytes per second relayed (both directions) for all of a client IP address's allocations, 0 - no max
+   unsigned int mNumThreads;  // number of io_service shards - each shard owns its own listeners (SO_REUSEPORT), allocations and relay port range
+   bool mUdpBatchIo;  // Linux only - recvmmsg/sendmmsg (and UDP GSO) on the UDP turn listener and relay sockets
 
    resip::Data mTlsServerCertificateFilename;
    resip::Data mTlsTempDhFilename;
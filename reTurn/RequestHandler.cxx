@@ -27,8 +27,11 @@ namespace reTurn {
 RequestHandler::RequestHandler(TurnManager& turnManager,
                                const asio::ip::address* prim3489Address, unsigned short* prim3489Port,
                                const asio::ip::address* alt3489Address, unsigned short* alt3489Port) 
- : mTurnManager(turnManager)
+ : mTurnManager(turnManager),
+   mDefaultCredentialProvider(new CredentialCache(turnManager.getConfig().mAuthenticationRealm, turnManager.getConfig().mAuthenticationCredentials)),
+   mQuotaManager(0)
 {
+   mCredentialProvider = mDefaultCredentialProvider.get();
    if(prim3489Address && prim3489Port && alt3489Address && alt3489Port)
    {
       mRFC3489SupportEnabled = true;
@@ -44,6 +47,27 @@ RequestHandler::RequestHandler(TurnManager& turnManager,
    mPrivateNonceKey = Random::getRandomHex(24);
 }
 
+RequestHandler::~RequestHandler()
+{
+   for(AuthCache::iterator it = mAuthCache.begin(); it != mAuthCache.end(); it++)
+   {
+      delete it->second;
+   }
+}
+
+void 
+RequestHandler::setCredentialProvider(CredentialProvider* credentialProvider)
+{
+   mCredentialProvider = credentialProvider;
+
+   // Cached keys are tied to the previous provider's generations
+   for(AuthCache::iterator it = mAuthCache.begin(); it != mAuthCache.end(); it++)
+   {
+      delete it->second;
+   }
+   mAuthCache.clear();
+}
+
 RequestHandler::ProcessResult 
 RequestHandler::processStunMessage(AsyncSocketBase* turnSocket, StunMessage& request, StunMessage& response, bool isRFC3489BackwardsCompatServer)
 {
@@ -51,6 +75,12 @@ RequestHandler::processStunMessage(AsyncSocketBase* turnSocket, StunMessage& req
 
    response.mRemoteTuple = request.mRemoteTuple; // Default to send response back to sender
 
+   if(request.mHasFingerprint && !request.checkFingerprint())
+   {
+      WarningLog(<< "Received message with bad Fingerprint.  Dropping.");
+      return NoResponseToSend;
+   }
+
    if(handleAuthentication(request, response))  
    {
       // Check if there were unknown require attributes
@@ -316,7 +346,7 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
 
       // !slg! need to determine whether the USERNAME contains a known entity, and in the case of a long-term
       //       credential, known within the realm of the REALM attribute of the request
-      if (getConfig().mAuthenticationMode == ReTurnConfig::LongTermPassword && !getConfig().isUserNameValid(*request.mUsername))
+      if (getConfig().mAuthenticationMode == ReTurnConfig::LongTermPassword && !mCredentialProvider->isUserNameValid(*request.mUsername))
       {
          WarningLog(<< "Invalid username: " << *request.mUsername << ". Sending 401.");
          buildErrorResponse(response, 401, "Unathorized", getConfig().mAuthenticationMode == ReTurnConfig::LongTermPassword ? getConfig().mAuthenticationRealm.c_str() : 0);
@@ -327,15 +357,14 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
 
       // Need to calculate HMAC across entire message - for ShortTermAuthentication we use the password
       // as the key - for LongTermAuthentication we use username:realm:password string as the key
-      Data hmacKey;
       assert(request.mHasUsername);
-
+      const StunAuth* clientAuth = 0;
       if(getConfig().mAuthenticationMode != ReTurnConfig::NoAuthentication)
       {
-         request.calculateHmacKey(hmacKey, getConfig().getPasswordForUsername(*request.mUsername));
+         clientAuth = &getClientAuth(request);
       }
       
-      if(!request.checkMessageIntegrity(hmacKey))
+      if(!(clientAuth ? request.checkMessageIntegrity(clientAuth->getHmacKeySchedule()) : request.checkMessageIntegrity(Data())))
       {
          WarningLog(<< "MessageIntegrity is bad. Sending 401.");
          buildErrorResponse(response, 401, "Unauthorized", getConfig().mAuthenticationMode == ReTurnConfig::LongTermPassword ? getConfig().mAuthenticationRealm.c_str() : 0);
@@ -344,9 +373,74 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
 
       // need to compute this later after message is filled in
       response.mHasMessageIntegrity = true;
-      response.mHmacKey = hmacKey;  // Used to later calculate Message Integrity during encoding
+      if(clientAuth)
+      {
+         response.mHmacKey = clientAuth->getClientSharedSecret();  // Used to later calculate Message Integrity during encoding
+         response.mHmacKeySchedule = clientAuth->getHmacKeySchedule();
+      }
+   }
+
+   return true;
+}
+
+const StunAuth& 
+RequestHandler::getClientAuth(StunMessage& request)
+{
+   assert(request.mHasUsername);
+   if(!request.mHasRealm)
+   {
+      Data hmacKey;
+      request.calculateHmacKey(hmacKey, Data::Empty);  // short term password
+      mUncachedAuth.reset(new StunAuth(*request.mUsername, hmacKey));
+      return *mUncachedAuth;
+   }
+
+   long generation = mCredentialProvider->getGeneration();
+   AuthCache::iterator it = mAuthCache.find(*request.mUsername);
+   if(it != mAuthCache.end())
+   {
+      if(it->second->mRealm == *request.mRealm && it->second->mGeneration == generation)
+      {
+         return it->second->mAuth;
+      }
+      delete it->second;
+      mAuthCache.erase(it);
+   }
+   Data hmacKey;
+   if(!mCredentialProvider->getLongTermKey(*request.mUsername, *request.mRealm, hmacKey))
+   {
+      // Unknown user - use an empty password, and don't let unknown usernames fill the cache
+      StunMessage::calculateHmacKey(hmacKey, *request.mUsername, *request.mRealm, Data::Empty);
+      mUncachedAuth.reset(new StunAuth(*request.mUsername, hmacKey));
+      return *mUncachedAuth;
+   }
+   CachedAuth* cachedAuth = new CachedAuth(*request.mRealm, generation, StunAuth(*request.mUsername, hmacKey));
+   mAuthCache[*request.mUsername] = cachedAuth;
+   return cachedAuth->mAuth;
+}
+
+bool 
+RequestHandler::processStunBindingRequest(const StunTuple& remoteTuple, DataBuffer& data, bool isRFC3489BackwardsCompatServer)
+{
+   bool hasFingerprint;
+   if((mRFC3489SupportEnabled && isRFC3489BackwardsCompatServer) ||
+      data.size() + data.tailroom() < StunMessage::StunBindingResponseMaxSize ||
+      !StunMessage::decodeStunBindingRequest(data.data(), data.size(), hasFingerprint))
+   {
+      return false;
    }
 
+   UInt128 magicCookieAndTid;
+   memcpy(&magicCookieAndTid, data.data() + 4, sizeof(UInt128));
+   unsigned int responseSize = StunMessage::encodeStunBindingResponse((char*)data.data(), magicCookieAndTid, remoteTuple, SOFTWARE_STRING, hasFingerprint);
+   if(responseSize > data.size())
+   {
+      data.extend(responseSize - data.size());
+   }
+   else
+   {
+      data.truncate(responseSize);
+   }
    return true;
 }
 
@@ -482,9 +576,8 @@ RequestHandler::processTurnAllocateRequest(AsyncSocketBase* turnSocket, StunMess
       return RespondFromReceiving;
    }
 
-   Data hmacKey;
    assert(request.mHasUsername);
-   request.calculateHmacKey(hmacKey, getConfig().getPasswordForUsername(*request.mUsername));
+   const StunAuth& clientAuth = getClientAuth(request);
 
    DebugLog(<< "Allocation request received: localTuple=" << request.mLocalTuple << ", remoteTuple=" << request.mRemoteTuple);
 
@@ -498,8 +591,19 @@ RequestHandler::processTurnAllocateRequest(AsyncSocketBase* turnSocket, StunMess
       return RespondFromReceiving;
    }
 
-   // TODO - add a check that a per-user quota for number of allowed TurnAllocations 
-   // has not been exceeded - if so send 486 (Allocation Quota Reached)
+   // Check that the per-user and per-client address quotas for number of allowed TurnAllocations 
+   // have not been exceeded - if so send 486 (Allocation Quota Reached)
+   std::auto_ptr<QuotaManager::Reservation> quotaReservation;
+   if(mQuotaManager)
+   {
+      quotaReservation.reset(mQuotaManager->reserveAllocation(*request.mUsername, request.mRemoteTuple.getAddress()));
+      if(!quotaReservation.get())
+      {
+         WarningLog(<< "Allocation quota reached.  Sending 486.");
+         buildErrorResponse(response, 486, "Allocation Quota Reached");  
+         return RespondFromReceiving;
+      }
+   }
 
    // Build the Allocation Tuple
    StunTuple allocationTuple(request.mLocalTuple.getTransportType(), // Default to receiving transport
@@ -618,9 +722,10 @@ RequestHandler::processTurnAllocateRequest(AsyncSocketBase* turnSocket, StunMess
                                       turnSocket, 
                                       request.mLocalTuple, 
                                       request.mRemoteTuple, 
-                                      StunAuth(*request.mUsername, hmacKey), 
+                                      clientAuth, 
                                       allocationTuple, 
-                                      lifetime);
+                                      lifetime,
+                                      quotaReservation.release());
    }
    catch(asio::system_error e)
    {
@@ -665,9 +770,9 @@ RequestHandler::processTurnRefreshRequest(StunMessage& request, StunMessage& res
       return RespondFromReceiving;
    }
 
-   Data hmacKey;
    assert(request.mHasUsername);
-   request.calculateHmacKey(hmacKey, getConfig().getPasswordForUsername(*request.mUsername));
+   const StunAuth& clientAuth = getClientAuth(request);
+   const Data& hmacKey = clientAuth.getClientSharedSecret();
 
    TurnAllocation* allocation = mTurnManager.findTurnAllocation(TurnAllocationKey(request.mLocalTuple, request.mRemoteTuple));
 
@@ -754,9 +859,9 @@ RequestHandler::processTurnCreatePermissionRequest(StunMessage& request, StunMes
       return RespondFromReceiving;
    }
 
-   Data hmacKey;
    assert(request.mHasUsername);
-   request.calculateHmacKey(hmacKey, getConfig().getPasswordForUsername(*request.mUsername));
+   const StunAuth& clientAuth = getClientAuth(request);
+   const Data& hmacKey = clientAuth.getClientSharedSecret();
 
    TurnAllocation* allocation = mTurnManager.findTurnAllocation(TurnAllocationKey(request.mLocalTuple, request.mRemoteTuple));
 
@@ -816,9 +921,9 @@ RequestHandler::processTurnChannelBindRequest(StunMessage& request, StunMessage&
       return RespondFromReceiving;
    }
 
-   Data hmacKey;
    assert(request.mHasUsername);
-   request.calculateHmacKey(hmacKey, getConfig().getPasswordForUsername(*request.mUsername));
+   const StunAuth& clientAuth = getClientAuth(request);
+   const Data& hmacKey = clientAuth.getClientSharedSecret();
 
    TurnAllocation* allocation = mTurnManager.findTurnAllocation(TurnAllocationKey(request.mLocalTuple, request.mRemoteTuple));
 
@@ -922,6 +1027,29 @@ RequestHandler::processTurnSendIndication(StunMessage& request)
    allocation->sendDataToPeer(remoteAddress, data, false /* isFramed? */);
 }
 
+void 
+RequestHandler::processTurnSendIndication(const StunTuple& localTuple, const StunTuple& remoteTuple, StunTuple& peerAddress, boost::shared_ptr<DataBuffer>& data)
+{
+   TurnAllocation* allocation = mTurnManager.findTurnAllocation(TurnAllocationKey(localTuple, remoteTuple));
+
+   if(!allocation)
+   {
+      WarningLog(<< "Turn send indication for non-existing allocation.  Dropping.");
+      return;
+   }
+
+   peerAddress.setTransportType(allocation->getRequestedTuple().getTransportType());
+
+   // Check if permission exists, if not then drop
+   if(!allocation->existsPermission(peerAddress.getAddress()))
+   {
+      WarningLog(<< "Turn send indication for destination=" << peerAddress << ", but no permission installed.  Dropping.");
+      return;
+   }
+
+   allocation->sendDataToPeer(peerAddress, data, false /* isFramed? */);
+}
+
 void 
 RequestHandler::processTurnData(unsigned short channelNumber, const StunTuple& localTuple, const StunTuple& remoteTuple, boost::shared_ptr<DataBuffer>& data)
 {
@@ -2,11 +2,17 @@
 #define REQUEST_HANDLER_HXX
 
 #include <string>
+#include <memory>
 #include <boost/noncopyable.hpp>
 
+#include <rutil/HashMap.hxx>
+
 #include "DataBuffer.hxx"
 #include "StunMessage.hxx"
+#include "StunAuth.hxx"
 #include "TurnManager.hxx"
+#include "CredentialProvider.hxx"
+#include "QuotaManager.hxx"
 
 namespace reTurn {
 
@@ -20,6 +26,7 @@ public:
    explicit RequestHandler(TurnManager& turnManager, 
                            const asio::ip::address* prim3489Address = 0, unsigned short* prim3489Port = 0,
                            const asio::ip::address* alt3489Address = 0, unsigned short* alt3489Port = 0);
+   ~RequestHandler();
 
    typedef enum
    {
@@ -34,9 +41,28 @@ public:
    /// Returns true if the response message is to be sent
    ProcessResult processStunMessage(AsyncSocketBase* turnSocket, StunMessage& request, StunMessage& response, bool isRFC3489BackwardsCompatServer=false);
    void processTurnData(unsigned short channelNumber, const StunTuple& localTuple, const StunTuple& remoteTuple, boost::shared_ptr<DataBuffer>& data);
+   /// Relays the data of a Send indication that was decoded in place (see StunMessage::decodeTurnSendIndication)
+   void processTurnSendIndication(const StunTuple& localTuple, const StunTuple& remoteTuple, StunTuple& peerAddress, boost::shared_ptr<DataBuffer>& data);
+   /// Answers a Binding request straight from the wire format (see StunMessage::decodeStunBindingRequest), writing the 
+   /// response over the request in data.  Returns false, leaving data untouched, if the request must be parsed and 
+   /// handed to processStunMessage instead.
+   bool processStunBindingRequest(const StunTuple& remoteTuple, DataBuffer& data, bool isRFC3489BackwardsCompatServer=false);
 
    const ReTurnConfig& getConfig() { return mTurnManager.getConfig(); }
 
+   /// When running several ioService shards, all RequestHandlers must use the same key, so that a nonce
+   /// issued by one shard is accepted by another (ie. a TCP client that reconnects to a different listener)
+   const resip::Data& getPrivateNonceKey() const { return mPrivateNonceKey; }
+   void setPrivateNonceKey(const resip::Data& privateNonceKey) { mPrivateNonceKey = privateNonceKey; }
+
+   /// Long term credentials come from the config's mAuthenticationCredentials, unless a provider is set.  The
+   /// provider is not owned, and may be shared by all RequestHandlers.
+   void setCredentialProvider(CredentialProvider* credentialProvider);
+
+   /// Allocation and bandwidth quotas are only enforced if a QuotaManager is set.  It is not owned, and must be
+   /// shared by all RequestHandlers (and outlive all allocations).
+   void setQuotaManager(QuotaManager* quotaManager) { mQuotaManager = quotaManager; }
+
 private:
 
    TurnManager& mTurnManager;
@@ -50,8 +76,30 @@ private:
 
    resip::Data mPrivateNonceKey;
 
+   CredentialProvider* mCredentialProvider;
+   std::auto_ptr<CredentialProvider> mDefaultCredentialProvider;
+   QuotaManager* mQuotaManager;
+
+   // Long term credentials by username - the HMAC key schedule is only calculated again if the realm 
+   // changes or the credential provider's credentials change
+   class CachedAuth
+   {
+   public:
+      CachedAuth(const resip::Data& realm, long generation, const StunAuth& auth) : 
+         mRealm(realm), mGeneration(generation), mAuth(auth) {}
+      resip::Data mRealm;
+      long mGeneration;
+      StunAuth mAuth;
+   };
+   typedef HashMap<resip::Data, CachedAuth*> AuthCache;
+   AuthCache mAuthCache;
+   std::auto_ptr<StunAuth> mUncachedAuth;
+
    // Authentication handler
    bool handleAuthentication(StunMessage& request, StunMessage& response);
+   /// Returns the username and HMAC key for the credentials in request (which must have a Username).  Long term 
+   /// credentials of known users come from mAuthCache, others (ie. short term ones) are only valid until the next call.
+   const StunAuth& getClientAuth(StunMessage& request);
 
    // Specific request processors
    ProcessResult processStunBindingRequest(StunMessage& request, StunMessage& response, bool isRFC3489BackwardsCompatServer);
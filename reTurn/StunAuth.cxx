@@ -8,7 +8,8 @@ namespace reTurn {
 StunAuth::StunAuth(const Data& clientUsername,
                    const Data& clientSharedSecret) :
    mClientUsername(clientUsername),
-   mClientSharedSecret(clientSharedSecret)
+   mClientSharedSecret(clientSharedSecret),
+   mHmacKeySchedule(clientSharedSecret)
 {
 }
 
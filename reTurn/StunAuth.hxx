@@ -2,6 +2,7 @@
 #define STUNAUTH_HXX
 
 #include <rutil/Data.hxx>
+#include "StunMessage.hxx"
 
 namespace reTurn {
 
@@ -13,10 +14,13 @@ public:
 
    const resip::Data& getClientUsername() const { return mClientUsername; }
    const resip::Data& getClientSharedSecret() const { return mClientSharedSecret; }
+   /// The shared secret as an HMAC key - for checking and adding MessageIntegrity
+   const HmacKeySchedule& getHmacKeySchedule() const { return mHmacKeySchedule; }
 
 private:
    resip::Data mClientUsername;
    resip::Data mClientSharedSecret;
+   HmacKeySchedule mHmacKeySchedule;
 };
 
 } 
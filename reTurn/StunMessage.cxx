@@ -4,7 +4,6 @@
 #include <rutil/Random.hxx>
 #include <rutil/DataStream.hxx>
 #include <rutil/MD5Stream.hxx>
-#include <boost/crc.hpp>
 #include <rutil/WinLeakCheck.hxx>
 #include <rutil/Logger.hxx>
 #include "ReTurnSubsystem.hxx"
@@ -33,6 +32,100 @@ static const Data PASSWORD_KEY("stunServerPasswordKey");
 
 namespace reTurn {
 
+// CRC-32 lookup tables for slicing-by-8:  mTable[0] is the usual byte at a time table, and mTable[k][b] is the CRC
+// of byte b followed by k zero bytes - so 8 input bytes can be folded into the CRC with 8 independent lookups
+class Crc32Tables
+{
+public:
+   Crc32Tables()
+   {
+      for(UInt32 i = 0; i < 256; i++)
+      {
+         UInt32 crc = i;
+         for(int j = 0; j < 8; j++)
+         {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));  // reflected polynomial 0x04C11DB7
+         }
+         mTable[0][i] = crc;
+      }
+      for(UInt32 i = 0; i < 256; i++)
+      {
+         for(int k = 1; k < 8; k++)
+         {
+            mTable[k][i] = (mTable[k-1][i] >> 8) ^ mTable[0][mTable[k-1][i] & 0xFF];
+         }
+      }
+   }
+   UInt32 mTable[8][256];
+};
+static const Crc32Tables crc32Tables;
+
+HmacKeySchedule::HmacKeySchedule() : mIsSet(false)
+{
+}
+
+HmacKeySchedule::HmacKeySchedule(const Data& key) : mIsSet(false)
+{
+   setKey(key.data(), (unsigned int)key.size());
+}
+
+#ifndef USE_SSL
+void 
+HmacKeySchedule::setKey(const char* key, unsigned int keyLen)
+{
+   mIsSet = true;
+}
+
+void 
+HmacKeySchedule::compute(char* hmac, const char* input, unsigned int length) const
+{
+   strncpy(hmac,"hmac-not-implemented",20);
+}
+#else
+void 
+HmacKeySchedule::setKey(const char* key, unsigned int keyLen)
+{
+   unsigned char keyBlock[SHA_CBLOCK];
+   memset(keyBlock, 0, sizeof(keyBlock));
+   if(keyLen > SHA_CBLOCK)
+   {
+      SHA1(reinterpret_cast<const unsigned char*>(key), keyLen, keyBlock);  // long keys are hashed first
+   }
+   else
+   {
+      memcpy(keyBlock, key, keyLen);
+   }
+
+   unsigned char pad[SHA_CBLOCK];
+   for(int i = 0; i < SHA_CBLOCK; i++)
+   {
+      pad[i] = keyBlock[i] ^ 0x36;
+   }
+   SHA1_Init(&mInner);
+   SHA1_Update(&mInner, pad, SHA_CBLOCK);
+   for(int i = 0; i < SHA_CBLOCK; i++)
+   {
+      pad[i] = keyBlock[i] ^ 0x5c;
+   }
+   SHA1_Init(&mOuter);
+   SHA1_Update(&mOuter, pad, SHA_CBLOCK);
+   mIsSet = true;
+}
+
+void 
+HmacKeySchedule::compute(char* hmac, const char* input, unsigned int length) const
+{
+   assert(mIsSet);
+   unsigned char innerDigest[SHA_DIGEST_LENGTH];
+   SHA_CTX context = mInner;
+   SHA1_Update(&context, input, length);
+   SHA1_Final(innerDigest, &context);
+   context = mOuter;
+   SHA1_Update(&context, innerDigest, SHA_DIGEST_LENGTH);
+   SHA1_Final(reinterpret_cast<unsigned char*>(hmac), &context);
+}
+#endif
+
 bool operator<(const UInt128& lhs, const UInt128& rhs)
 {
    if(lhs.longpart[0] != rhs.longpart[0])
@@ -324,6 +417,317 @@ StunMessage::setTupleFromStunAtrAddress(StunTuple& tuple, const StunAtrAddress&
    }
 }
 
+unsigned int 
+StunMessage::turnDataIndicationHeaderSize(const StunTuple& peerAddress)
+{
+   return 20 /* Stun Header */ + (peerAddress.getAddress().is_v6() ? 24 : 12) /* XorPeerAddress */ + 4 /* Data attribute header */;
+}
+
+unsigned int 
+StunMessage::encodeTurnDataIndicationHeader(char* buf, const StunTuple& peerAddress, unsigned int dataSize)
+{
+   unsigned int headerSize = turnDataIndicationHeaderSize(peerAddress);
+   UInt16 padsize = dataSize % 4 == 0 ? 0 : 4 - (dataSize % 4);
+
+   // Stun header - a tid for indications does not need to be cryptographically random
+   char* ptr = encode16(buf, StunClassIndication | TurnDataMethod);
+   ptr = encode16(ptr, (UInt16)(headerSize - 20 + dataSize + padsize));
+   char* magicCookieAndTid = ptr;
+   ptr = encode32(ptr, StunMagicCookie);
+   for(int i = 0; i < 3; i++)
+   {
+      UInt32 random = (UInt32)Random::getRandom();
+      memcpy(ptr, &random, sizeof(random));
+      ptr += sizeof(random);
+   }
+
+   // XorPeerAddress
+   bool isV6 = peerAddress.getAddress().is_v6();
+   ptr = encode16(ptr, TurnXorPeerAddress);
+   ptr = encode16(ptr, isV6 ? 20 : 8);
+   *ptr++ = (UInt8)0;  // pad
+   *ptr++ = isV6 ? IPv6Family : IPv4Family;
+   ptr = encode16(ptr, peerAddress.getPort()^(StunMagicCookie>>16));
+   if(isV6)
+   {
+      asio::ip::address_v6::bytes_type bytes = peerAddress.getAddress().to_v6().to_bytes();
+      for(int i = 0; i < 16; i++)
+      {
+         *ptr++ = bytes[i]^magicCookieAndTid[i];
+      }
+   }
+   else
+   {
+      ptr = encode32(ptr, (UInt32)peerAddress.getAddress().to_v4().to_ulong()^StunMagicCookie);
+   }
+
+   // Data attribute header
+   ptr = encode16(ptr, TurnData);
+   ptr = encode16(ptr, (UInt16)dataSize);
+   assert((unsigned int)(ptr - buf) == headerSize);
+   return headerSize;
+}
+
+bool 
+StunMessage::decodeTurnSendIndication(const char* buf, unsigned int bufLen, StunTuple& peerAddress, unsigned int& dataOffset, unsigned int& dataSize)
+{
+   if(bufLen < sizeof(StunMsgHdr))
+   {
+      return false;
+   }
+   UInt16 msgType;
+   UInt16 msgLength;
+   UInt32 magicCookie;
+   memcpy(&msgType, buf, 2);
+   memcpy(&msgLength, buf+2, 2);
+   memcpy(&magicCookie, buf+4, 4);
+   if(ntohs(msgType) != (StunClassIndication | TurnSendMethod) ||
+      ntohs(msgLength) + sizeof(StunMsgHdr) != bufLen ||
+      ntohl(magicCookie) != StunMagicCookie)
+   {
+      return false;
+   }
+
+   bool hasPeerAddress = false;
+   bool hasData = false;
+   unsigned int pos = sizeof(StunMsgHdr);
+   while(pos + 4 <= bufLen)
+   {
+      UInt16 attrType;
+      UInt16 attrLen;
+      memcpy(&attrType, buf+pos, 2);
+      memcpy(&attrLen, buf+pos+2, 2);
+      attrType = ntohs(attrType);
+      attrLen = ntohs(attrLen);
+      const char* body = buf+pos+4;
+      if(pos + 4 + attrLen > bufLen)
+      {
+         return false;
+      }
+      switch(attrType)
+      {
+      case TurnXorPeerAddress:
+      {
+         if(hasPeerAddress || (attrLen != 8 && attrLen != 20))
+         {
+            return false;
+         }
+         UInt16 port;
+         memcpy(&port, body+2, 2);
+         peerAddress.setPort(ntohs(port)^(StunMagicCookie>>16));
+         if(body[1] == IPv4Family && attrLen == 8)
+         {
+            UInt32 addr;
+            memcpy(&addr, body+4, 4);
+            peerAddress.setAddress(asio::ip::address_v4(ntohl(addr)^StunMagicCookie));
+         }
+         else if(body[1] == IPv6Family && attrLen == 20)
+         {
+            asio::ip::address_v6::bytes_type bytes;
+            for(int i = 0; i < 16; i++)
+            {
+               bytes[i] = body[4+i]^buf[4+i];  // Xor with magic cookie and tid
+            }
+            peerAddress.setAddress(asio::ip::address_v6(bytes));
+         }
+         else
+         {
+            return false;
+         }
+         hasPeerAddress = true;
+         break;
+      }
+      case TurnData:
+         if(hasData)
+         {
+            return false;
+         }
+         dataOffset = pos + 4;
+         dataSize = attrLen;
+         hasData = true;
+         break;
+      case Software:
+         break;
+      case Fingerprint:
+         if(attrLen != 4 || !checkFingerprint(buf, bufLen, pos))
+         {
+            return false;
+         }
+         break;
+      default:
+         return false;
+      }
+      pos += 4 + attrLen + (attrLen % 4 == 0 ? 0 : 4 - (attrLen % 4));
+   }
+   return hasPeerAddress && hasData;
+}
+
+bool 
+StunMessage::decodeStunBindingRequest(const char* buf, unsigned int bufLen, bool& hasFingerprint)
+{
+   if(bufLen < sizeof(StunMsgHdr))
+   {
+      return false;
+   }
+   UInt16 msgType;
+   UInt16 msgLength;
+   UInt32 magicCookie;
+   memcpy(&msgType, buf, 2);
+   memcpy(&msgLength, buf+2, 2);
+   memcpy(&magicCookie, buf+4, 4);
+   if(ntohs(msgType) != (StunClassRequest | BindMethod) ||
+      ntohs(msgLength) + sizeof(StunMsgHdr) != bufLen ||
+      ntohl(magicCookie) != StunMagicCookie)
+   {
+      return false;
+   }
+
+   hasFingerprint = false;
+   unsigned int pos = sizeof(StunMsgHdr);
+   while(pos + 4 <= bufLen)
+   {
+      UInt16 attrType;
+      UInt16 attrLen;
+      memcpy(&attrType, buf+pos, 2);
+      memcpy(&attrLen, buf+pos+2, 2);
+      attrType = ntohs(attrType);
+      attrLen = ntohs(attrLen);
+      unsigned int attrLenPad = attrLen % 4 == 0 ? 0 : 4 - (attrLen % 4);
+      if(pos + 4 + attrLen + attrLenPad > bufLen || hasFingerprint /* Fingerprint must be last */)
+      {
+         return false;
+      }
+      switch(attrType)
+      {
+      case Fingerprint:
+         if(attrLen != 4 || !checkFingerprint(buf, bufLen, pos))
+         {
+            return false;
+         }
+         hasFingerprint = true;
+         break;
+      case Username:
+         if(attrLen > MAX_USERNAME_BYTES)
+         {
+            return false;
+         }
+         break;
+      case MessageIntegrity:  // Binding requests are not authenticated
+         if(attrLen != 20)
+         {
+            return false;
+         }
+         break;
+      case Software:
+         break;
+      default:
+         if(attrType <= 0x7FFF)
+         {
+            return false;  // comprehension-required attributes need a 420, or change the response (RFC3489)
+         }
+         break;
+      }
+      pos += 4 + attrLen + attrLenPad;
+   }
+   return pos == bufLen;
+}
+
+unsigned int 
+StunMessage::encodeStunBindingResponse(char* buf, const UInt128& magicCookieAndTid, const StunTuple& mappedAddress, 
+                                       const char* software, bool addFingerprint)
+{
+   bool isV6 = mappedAddress.getAddress().is_v6();
+   unsigned int softwareSize = software ? (unsigned int)strlen(software) : 0;
+   if(softwareSize > 64) softwareSize = 64;
+   UInt16 softwarePad = softwareSize % 4 == 0 ? 0 : 4 - (softwareSize % 4);
+
+   char* ptr = encode16(buf, StunClassSuccessResponse | BindMethod);
+   char* lengthp = ptr;
+   ptr = encode16(ptr, 0);
+   const char* cookieAndTid = ptr;
+   memcpy(ptr, &magicCookieAndTid, sizeof(UInt128));
+   ptr += sizeof(UInt128);
+
+   // XorMappedAddress
+   ptr = encode16(ptr, XorMappedAddress);
+   ptr = encode16(ptr, isV6 ? 20 : 8);
+   *ptr++ = (UInt8)0;  // pad
+   *ptr++ = isV6 ? IPv6Family : IPv4Family;
+   ptr = encode16(ptr, mappedAddress.getPort()^(StunMagicCookie>>16));
+   if(isV6)
+   {
+      asio::ip::address_v6::bytes_type bytes = mappedAddress.getAddress().to_v6().to_bytes();
+      for(int i = 0; i < 16; i++)
+      {
+         *ptr++ = bytes[i]^cookieAndTid[i];
+      }
+   }
+   else
+   {
+      ptr = encode32(ptr, (UInt32)mappedAddress.getAddress().to_v4().to_ulong()^StunMagicCookie);
+   }
+
+   if(softwareSize > 0)
+   {
+      ptr = encode16(ptr, Software);
+      ptr = encode16(ptr, (UInt16)softwareSize);
+      memcpy(ptr, software, softwareSize);
+      ptr += softwareSize;
+      memset(ptr, 0, softwarePad);
+      ptr += softwarePad;
+   }
+
+   if(addFingerprint)
+   {
+      encode16(lengthp, (UInt16)(ptr - buf - sizeof(StunMsgHdr) + 8));
+      UInt32 fingerprint = calculateCrc32(buf, ptr-buf) ^ STUN_CRC_FINAL_XOR;
+      ptr = encode16(ptr, Fingerprint);
+      ptr = encode16(ptr, 4);
+      ptr = encode32(ptr, fingerprint);
+   }
+   else
+   {
+      encode16(lengthp, (UInt16)(ptr - buf - sizeof(StunMsgHdr)));
+   }
+   assert((unsigned int)(ptr - buf) <= StunBindingResponseMaxSize);
+   return (unsigned int)(ptr - buf);
+}
+
+UInt32 
+StunMessage::calculateCrc32(const char* buf, unsigned int bufLen)
+{
+   const unsigned char* ptr = reinterpret_cast<const unsigned char*>(buf);
+   const UInt32 (&table)[8][256] = crc32Tables.mTable;
+   UInt32 crc = 0xFFFFFFFF;
+   while(bufLen >= 8)
+   {
+      // Assembled byte by byte, so it works on any byte order (compilers turn this into plain loads on little endian)
+      UInt32 one = crc ^ (ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((UInt32)ptr[3] << 24));
+      UInt32 two = ptr[4] | (ptr[5] << 8) | (ptr[6] << 16) | ((UInt32)ptr[7] << 24);
+      crc = table[7][one & 0xFF] ^ table[6][(one >> 8) & 0xFF] ^ table[5][(one >> 16) & 0xFF] ^ table[4][one >> 24] ^
+            table[3][two & 0xFF] ^ table[2][(two >> 8) & 0xFF] ^ table[1][(two >> 16) & 0xFF] ^ table[0][two >> 24];
+      ptr += 8;
+      bufLen -= 8;
+   }
+   while(bufLen-- > 0)
+   {
+      crc = (crc >> 8) ^ table[0][(crc ^ *ptr++) & 0xFF];
+   }
+   return crc ^ 0xFFFFFFFF;
+}
+
+bool 
+StunMessage::checkFingerprint(const char* buf, unsigned int bufLen, unsigned int fingerprintPos)
+{
+   if(fingerprintPos + 8 != bufLen)
+   {
+      return false;
+   }
+   UInt32 fingerprint;
+   memcpy(&fingerprint, buf + fingerprintPos + 4, 4);
+   return (calculateCrc32(buf, fingerprintPos) ^ STUN_CRC_FINAL_XOR) == ntohl(fingerprint);
+}
+
 bool
 StunMessage::stunParseAtrXorAddress( char* body, unsigned int hdrLen, StunAtrAddress& result )
 {
@@ -1491,7 +1895,14 @@ StunMessage::stunEncodeMessage(char* buf, unsigned int bufLen)
       int len = ptr - buf;
       StackLog(<< "Adding message integrity: buffer size=" << len << ", hmacKey=" << mHmacKey);
       StunAtrIntegrity integrity;
-      computeHmac(integrity.hash, buf, len, mHmacKey.c_str(), (int)mHmacKey.size());
+      if(mHmacKeySchedule.isSet())
+      {
+         mHmacKeySchedule.compute(integrity.hash, buf, len);
+      }
+      else
+      {
+         computeHmac(integrity.hash, buf, len, mHmacKey.c_str(), (int)mHmacKey.size());
+      }
 	   ptr = encodeAtrIntegrity(ptr, integrity);
    }
 
@@ -1503,9 +1914,7 @@ StunMessage::stunEncodeMessage(char* buf, unsigned int bufLen)
    if (mHasFingerprint)
    {
       StackLog(<< "Calculating fingerprint for data of size " << ptr-buf);
-      boost::crc_32_type stun_crc;
-      stun_crc.process_bytes(buf, ptr-buf); // Calculate CRC across entire message, except the fingerprint attribute
-      UInt32 fingerprint = stun_crc.checksum() ^ STUN_CRC_FINAL_XOR;
+      UInt32 fingerprint = calculateCrc32(buf, ptr-buf) ^ STUN_CRC_FINAL_XOR; // Calculate CRC across entire message, except the fingerprint attribute
       ptr = encodeAtrUInt32(ptr, Fingerprint, fingerprint);
    }
 
@@ -1666,6 +2075,12 @@ StunMessage::calculateHmacKey(Data& hmacKey, const Data& username, const Data& r
 
 bool 
 StunMessage::checkMessageIntegrity(const Data& hmacKey)
+{
+   return checkMessageIntegrity(HmacKeySchedule(hmacKey));
+}
+
+bool 
+StunMessage::checkMessageIntegrity(const HmacKeySchedule& hmacKey)
 {
    if(mHasMessageIntegrity)
    {
@@ -1682,8 +2097,8 @@ StunMessage::checkMessageIntegrity(const Data& hmacKey)
 
       // Calculate HMAC
       int iHMACBufferSize = mMessageIntegrityMsgLength - 24 /* MessageIntegrity size */ + sizeof(StunMsgHdr); // The entire message proceeding the message integrity attribute
-      StackLog(<< "Checking message integrity: length=" << mMessageIntegrityMsgLength << ", size=" << iHMACBufferSize << ", hmacKey=" << hmacKey);
-      computeHmac((char*)hmac, mBuffer.data(), iHMACBufferSize, hmacKey.c_str(), hmacKey.size());
+      StackLog(<< "Checking message integrity: length=" << mMessageIntegrityMsgLength << ", size=" << iHMACBufferSize);
+      hmacKey.compute((char*)hmac, mBuffer.data(), iHMACBufferSize);
 
       // Restore original stun message length in mBuffer
       memcpy(lengthposition, &originalLength, 2);
@@ -1710,17 +2125,14 @@ StunMessage::checkFingerprint()
    if(mHasFingerprint)
    {
       StackLog(<< "Calculating fingerprint to check for data of size " << mBuffer.size() - 8);
-      boost::crc_32_type stun_crc;
-      stun_crc.process_bytes(mBuffer.data(), mBuffer.size()-8); // Calculate CRC across entire message, except the fingerprint attribute
-
-      unsigned long crc = stun_crc.checksum() ^ STUN_CRC_FINAL_XOR;
-      if(crc == mFingerprint)
+      UInt32 crc = calculateCrc32(mBuffer.data(), mBuffer.size()-8); // Calculate CRC across entire message, except the fingerprint attribute
+      if((crc ^ STUN_CRC_FINAL_XOR) == mFingerprint)
       {
          return true;
       }
       else
       {
-         WarningLog(<< "Fingerprint=" << mFingerprint << " does not match CRC=" << stun_crc.checksum());
+         WarningLog(<< "Fingerprint=" << mFingerprint << " does not match CRC=" << crc);
          return false;
       }
    }
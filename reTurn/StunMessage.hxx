@@ -8,6 +8,10 @@
 
 #include "StunTuple.hxx"
 
+#ifdef USE_SSL
+#include <openssl/sha.h>
+#endif
+
 #define STUN_MAX_UNKNOWN_ATTRIBUTES 8
 
 namespace reTurn
@@ -21,6 +25,29 @@ bool operator<(const UInt128&, const UInt128&);
 bool operator==(const UInt128&, const UInt128&);
 #endif
 
+/// HMAC-SHA1 with the key already applied:  keeps the SHA1 states after hashing the inner and outer padded key, 
+/// so computing an HMAC only hashes the message (and the inner digest).  Build one per key and keep it (ie. in 
+/// StunAuth), rather than handing the key to every HMAC calculation.
+class HmacKeySchedule
+{
+public:
+   HmacKeySchedule();
+   explicit HmacKeySchedule(const resip::Data& key);
+
+   void setKey(const char* key, unsigned int keyLen);
+   bool isSet() const { return mIsSet; }
+
+   /// Writes the 20 byte HMAC of input to hmac
+   void compute(char* hmac, const char* input, unsigned int length) const;
+
+private:
+   bool mIsSet;
+#ifdef USE_SSL
+   SHA_CTX mInner;
+   SHA_CTX mOuter;
+#endif
+};
+
 class StunMessage
 {
 public:
@@ -53,8 +80,9 @@ public:
    void generateShortTermPasswordForUsername(resip::Data& password);  // Ensure username is set first
    void getTupleFromUsername(StunTuple& tuple);   // note: does not set transport type
    void calculateHmacKey(resip::Data& hmacKey, const resip::Data& longtermAuthenticationPassword);
-   void calculateHmacKey(resip::Data& hmacKey, const resip::Data& username, const resip::Data& realm, const resip::Data& longtermAuthenticationPassword);
+   static void calculateHmacKey(resip::Data& hmacKey, const resip::Data& username, const resip::Data& realm, const resip::Data& longtermAuthenticationPassword);
    bool checkMessageIntegrity(const resip::Data& hmacKey);
+   bool checkMessageIntegrity(const HmacKeySchedule& hmacKey);
    bool checkFingerprint();
 
    /// define stun address families
@@ -221,6 +249,7 @@ public:
    StunTuple mRemoteTuple; // Remote address and port that send stun message
    resip::Data mBuffer;
    resip::Data mHmacKey;
+   HmacKeySchedule mHmacKeySchedule;  // if set, used instead of mHmacKey to calculate MessageIntegrity when encoding
 
    UInt16 mMessageIntegrityMsgLength;
 
@@ -321,6 +350,36 @@ public:
    static void setStunAtrAddressFromTuple(StunAtrAddress& address, const StunTuple& tuple);
    static void setTupleFromStunAtrAddress(StunTuple& tuple, const StunAtrAddress& address);  // Note:  does not set transport type
 
+   // Relay fast path APIs - these work directly on the wire format, without building a StunMessage
+   const static unsigned int TurnDataIndicationMaxHeaderSize = 48;  // Stun header + XorPeerAddress (v6) + Data attribute header
+   /// Writes the header of a Data indication (Stun header, XorPeerAddress and Data attribute header) carrying dataSize 
+   /// bytes into buf and returns the header size.  The data must immediately follow the header, padded to a multiple of 4.
+   static unsigned int encodeTurnDataIndicationHeader(char* buf, const StunTuple& peerAddress, unsigned int dataSize);
+   /// Returns the size of the header encodeTurnDataIndicationHeader will write for peerAddress
+   static unsigned int turnDataIndicationHeaderSize(const StunTuple& peerAddress);
+   /// Checks if buf holds a Send indication with only XorPeerAddress, Data, Software and Fingerprint attributes, and if 
+   /// so returns the peer address and where the data is in buf.  Anything else (ie. Don't Fragment) returns false, and
+   /// must be handled by fully parsing the message.
+   static bool decodeTurnSendIndication(const char* buf, unsigned int bufLen, StunTuple& peerAddress, unsigned int& dataOffset, unsigned int& dataSize);
+
+   // Binding fast path APIs - for answering RFC5389 Binding requests (ie. keepalives and connectivity checks) without 
+   // building StunMessages
+   const static unsigned int StunBindingResponseMaxSize = 20 + 24 + 4 + 64 + 8;  // Stun header + XorMappedAddress (v6) + Software (max 64 bytes) + Fingerprint
+   /// Checks if buf holds an RFC5389 Binding request with only attributes that don't change the response (Software,
+   /// Fingerprint and comprehension-optional attributes), and a correct fingerprint if it has one.  Only the attribute
+   /// headers are looked at.  Anything else returns false, and must be handled by fully parsing the message.
+   static bool decodeStunBindingRequest(const char* buf, unsigned int bufLen, bool& hasFingerprint);
+   /// Writes a Binding success response for the request with magicCookieAndTid into buf, with an XorMappedAddress 
+   /// for mappedAddress, a Software attribute (software is padded to a multiple of 4, and truncated to 64 bytes)
+   /// and optionally a Fingerprint.  buf must hold StunBindingResponseMaxSize bytes.  Returns the size written.
+   static unsigned int encodeStunBindingResponse(char* buf, const UInt128& magicCookieAndTid, const StunTuple& mappedAddress, 
+                                                 const char* software, bool addFingerprint);
+
+   /// CRC-32 (as used by the Fingerprint attribute, before the Stun XOR)
+   static UInt32 calculateCrc32(const char* buf, unsigned int bufLen);
+   /// Checks the Fingerprint attribute at fingerprintPos (must be the last attribute) of the bufLen byte message in buf
+   static bool checkFingerprint(const char* buf, unsigned int bufLen, unsigned int fingerprintPos);
+
 protected:
 
 private:
@@ -337,8 +396,8 @@ private:
 
    bool stunParseMessage( char* buf, unsigned int bufLen);
 
-   char* encode16(char* buf, UInt16 data);
-   char* encode32(char* buf, UInt32 data);
+   static char* encode16(char* buf, UInt16 data);
+   static char* encode32(char* buf, UInt32 data);
    char* encode(char* buf, const char* data, unsigned int length);
    char* encodeTurnData(char *ptr, const resip::Data* td);
    char* encodeAtrUInt32(char* ptr, UInt16 type, UInt32 value);
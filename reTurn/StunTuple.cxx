@@ -56,6 +56,33 @@ StunTuple::operator<(const StunTuple& rhs) const
    return false;
 }
 
+size_t 
+StunTuple::hash() const
+{
+   size_t hash = hashAddress(mAddress) ^ (mPort << 8) ^ mTransport;
+   // mix so that tuples differing only in port spread over the buckets
+   hash ^= hash >> 16;
+   hash *= 0x45d9f3b;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+size_t 
+StunTuple::hashAddress(const asio::ip::address& address)
+{
+   if(address.is_v6())
+   {
+      size_t hash = 0;
+      asio::ip::address_v6::bytes_type bytes = address.to_v6().to_bytes();
+      for(unsigned int i = 0; i < bytes.size(); i++)
+      {
+         hash = hash * 31 + bytes[i];
+      }
+      return hash;
+   }
+   return (size_t)address.to_v4().to_ulong() * 2654435761U;
+}
+
 EncodeStream&
 operator<<(EncodeStream& strm, const StunTuple& tuple)
 {
@@ -80,6 +107,9 @@ operator<<(EncodeStream& strm, const StunTuple& tuple)
 
 } // namespace
 
+HashValueImp(reTurn::StunTuple, data.hash());
+HashValueImp(asio::ip::address, reTurn::StunTuple::hashAddress(data));
+
 
 /* ====================================================================
 
@@ -3,6 +3,7 @@
 
 #include <asio.hpp>
 #include <rutil/resipfaststreams.hxx>
+#include <rutil/HashMap.hxx>
 
 namespace reTurn {
 
@@ -23,6 +24,8 @@ public:
    bool operator==(const StunTuple& rhs) const;
    bool operator!=(const StunTuple& rhs) const;
    bool operator<(const StunTuple& rhs) const;
+   size_t hash() const;
+   static size_t hashAddress(const asio::ip::address& address);
 
    TransportType getTransportType() const { return mTransport; }
    void setTransportType(TransportType transport) { mTransport = transport; }
@@ -45,6 +48,9 @@ EncodeStream& operator<<(EncodeStream& strm, const StunTuple& tuple);
 
 } 
 
+HashValue(reTurn::StunTuple);
+HashValue(asio::ip::address);
+
 #endif
 
 
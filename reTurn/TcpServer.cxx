@@ -8,7 +8,7 @@
 
 namespace reTurn {
 
-TcpServer::TcpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+TcpServer::TcpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort)
 : mIOService(ioService),
   mAcceptor(ioService),
   mConnectionManager(),
@@ -20,6 +20,12 @@ TcpServer::TcpServer(asio::io_service& ioService, RequestHandler& requestHandler
 
    mAcceptor.open(endpoint.protocol());
    mAcceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef RETURN_REUSE_PORT_SUPPORTED
+   if(reusePort)
+   {
+      mAcceptor.set_option(reuse_port(true));
+   }
+#endif
    mAcceptor.bind(endpoint);
    mAcceptor.listen();
 
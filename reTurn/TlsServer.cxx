@@ -8,7 +8,7 @@
 
 namespace reTurn {
 
-TlsServer::TlsServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+TlsServer::TlsServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort)
 : mIOService(ioService),
   mAcceptor(ioService),
   mContext(ioService, asio::ssl::context::tlsv1),  // TLSv1.0
@@ -49,6 +49,12 @@ TlsServer::TlsServer(asio::io_service& ioService, RequestHandler& requestHandler
 
    mAcceptor.open(endpoint.protocol());
    mAcceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef RETURN_REUSE_PORT_SUPPORTED
+   if(reusePort)
+   {
+      mAcceptor.set_option(reuse_port(true));
+   }
+#endif
    mAcceptor.bind(endpoint);
    mAcceptor.listen();
 
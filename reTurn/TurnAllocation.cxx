@@ -26,10 +26,12 @@ TurnAllocation::TurnAllocation(TurnManager& turnManager,
                                const StunTuple& clientRemoteTuple,
                                const StunAuth& clientAuth, 
                                const StunTuple& requestedTuple, 
-                               unsigned int lifetime) :
+                               unsigned int lifetime,
+                               QuotaManager::Reservation* quotaReservation) :
    mKey(clientLocalTuple, clientRemoteTuple),
    mClientAuth(clientAuth),
    mRequestedTuple(requestedTuple),
+   mQuotaReservation(quotaReservation),
    mTurnManager(turnManager),
    mAllocationTimer(turnManager.getIOService()),
    mLocalTurnSocket(localTurnSocket)
@@ -42,6 +44,7 @@ TurnAllocation::TurnAllocation(TurnManager& turnManager,
    if(mRequestedTuple.getTransportType() == StunTuple::UDP)
    {
       mUdpRelayServer.reset(new UdpRelayServer(turnManager.getIOService(), *this));
+      mUdpRelayServer->setBatchIo(turnManager.getConfig().mUdpBatchIo);
       mUdpRelayServer->start();
    }
    else
@@ -156,6 +159,13 @@ TurnAllocation::sendDataToPeer(unsigned short channelNumber, boost::shared_ptr<D
 void 
 TurnAllocation::sendDataToPeer(const StunTuple& peerAddress, boost::shared_ptr<DataBuffer>& data, bool isFramed)
 {
+   if(mQuotaReservation.get() && !mQuotaReservation->consumeBandwidth((unsigned int)data->size()))
+   {
+      DebugLog(<< "TurnAllocation sendDataToPeer: bandwidth quota exceeded, dropping: clientLocal=" << mKey.getClientLocalTuple() << " clientRemote=" << 
+              mKey.getClientRemoteTuple() << " allocation=" << mRequestedTuple);
+      return;
+   }
+
    DebugLog(<< "TurnAllocation sendDataToPeer: clientLocal=" << mKey.getClientLocalTuple() << " clientRemote=" << 
            mKey.getClientRemoteTuple() << " allocation=" << mRequestedTuple << " peerAddress=" << peerAddress);
 
@@ -179,6 +189,13 @@ TurnAllocation::sendDataToPeer(const StunTuple& peerAddress, boost::shared_ptr<D
 void 
 TurnAllocation::sendDataToClient(const StunTuple& peerAddress, boost::shared_ptr<DataBuffer>& data)
 {
+   if(mQuotaReservation.get() && !mQuotaReservation->consumeBandwidth((unsigned int)data->size()))
+   {
+      DebugLog(<< "TurnAllocation sendDataToClient: bandwidth quota exceeded, dropping: clientLocal=" << mKey.getClientLocalTuple() << " clientRemote=" << 
+              mKey.getClientRemoteTuple() << " allocation=" << mRequestedTuple << " peer=" << peerAddress);
+      return;
+   }
+
    // See if a channel binding exists - if so, use it
    RemotePeer* remotePeer = mChannelManager.findRemotePeerByPeerAddress(peerAddress);
    if(remotePeer)
@@ -190,6 +207,26 @@ TurnAllocation::sendDataToClient(const StunTuple& peerAddress, boost::shared_ptr
                   mKey.getClientRemoteTuple() << " allocation=" << mRequestedTuple << " peer=" << peerAddress << 
                   " channelNumber=" << (int)remotePeer->getChannel());
    }
+   else if(data->headroom() >= StunMessage::turnDataIndicationHeaderSize(peerAddress) && data->tailroom() >= 3)
+   {
+      // No Channel Binding - use DataInd, built around the data in place (ie. in the relay's receive buffer)
+      unsigned int dataSize = data->size();
+      unsigned int padSize = dataSize % 4 == 0 ? 0 : 4 - (dataSize % 4);
+      StunMessage::encodeTurnDataIndicationHeader(data->prepend(StunMessage::turnDataIndicationHeaderSize(peerAddress)), peerAddress, dataSize);
+      if(padSize)
+      {
+         unsigned int size = data->size();
+         data->extend(padSize);
+         memset(&(*data)[size], 0, padSize);
+      }
+
+      // send DataInd to local client
+      mLocalTurnSocket->doSend(mKey.getClientRemoteTuple(), data);
+
+      DebugLog(<< "TurnAllocation sendDataToClient: clientLocal=" << mKey.getClientLocalTuple() << " clientRemote=" << 
+                  mKey.getClientRemoteTuple() << " allocation=" << mRequestedTuple << " peer=" << peerAddress << 
+                  " using DataInd.");
+   }
    else
    {
       // No Channel Binding - use DataInd
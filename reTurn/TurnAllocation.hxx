@@ -2,6 +2,7 @@
 #define TURNALLOCATION_HXX
 
 #include <map>
+#include <memory>
 #include <boost/noncopyable.hpp>
 #include <asio.hpp>
 
@@ -11,6 +12,7 @@
 #include "AsyncSocketBaseHandler.hxx"
 #include "DataBuffer.hxx"
 #include "ChannelManager.hxx"
+#include "QuotaManager.hxx"
 
 namespace reTurn {
 
@@ -30,7 +32,8 @@ public:
                            const StunTuple& clientRemoteTuple,
                            const StunAuth& clientAuth, 
                            const StunTuple& requestedTuple, 
-                           unsigned int lifetime);
+                           unsigned int lifetime,
+                           QuotaManager::Reservation* quotaReservation = 0);  // takes ownership
    ~TurnAllocation();
 
    const TurnAllocationKey& getKey() { return mKey; }
@@ -68,8 +71,9 @@ private:
 
    time_t    mExpires;
    //unsigned int mBandwidth; // future use
+   std::auto_ptr<QuotaManager::Reservation> mQuotaReservation;  // 0 if quotas are not enforced
 
-   typedef std::map<asio::ip::address,TurnPermission*> TurnPermissionMap;
+   typedef HashMap<asio::ip::address,TurnPermission*> TurnPermissionMap;
    TurnPermissionMap mTurnPermissionMap;
 
    TurnManager& mTurnManager;
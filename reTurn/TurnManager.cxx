@@ -1,4 +1,5 @@
 #include <rutil/Lock.hxx>
+#include <rutil/Random.hxx>
 
 #include "TurnManager.hxx"
 #include "TurnAllocation.hxx"
@@ -11,18 +12,30 @@ using namespace std;
 
 namespace reTurn {
 
-TurnManager::TurnManager(asio::io_service& ioService, const ReTurnConfig& config) : 
-   mLastAllocatedUdpPort(config.mAllocationPortRangeMin-1),
-   mLastAllocatedTcpPort(config.mAllocationPortRangeMin-1),
+TurnManager::TurnManager(asio::io_service& ioService, const ReTurnConfig& config, unsigned int shardIndex, unsigned int numShards) : 
+   mAllocationPortRangeMin(config.mAllocationPortRangeMin),
+   mAllocationPortRangeMax(config.mAllocationPortRangeMax),
    mIOService(ioService),
    mConfig(config)
 {
-   // Initialize Allocation Ports
-   for(unsigned short i = config.mAllocationPortRangeMin; i <= config.mAllocationPortRangeMax && i != 0; i++) // i != 0 catches case where we increment 65535 (as an unsigned short)
+   assert(numShards > 0 && shardIndex < numShards);
+   if(numShards > 1)
    {
-      mUdpAllocationPorts[i] = PortStateUnallocated;
-      mTcpAllocationPorts[i] = PortStateUnallocated;
+      // Split the range into even sized (and even aligned, so that even port pairs never straddle two shards) slices - 
+      // the last shard picks up any remainder
+      unsigned int rangeSize = (unsigned int)config.mAllocationPortRangeMax - config.mAllocationPortRangeMin + 1;
+      unsigned int sliceSize = (rangeSize / numShards) & ~1;
+      mAllocationPortRangeMin = (unsigned short)(config.mAllocationPortRangeMin + shardIndex * sliceSize);
+      if(shardIndex != numShards - 1)
+      {
+         mAllocationPortRangeMax = (unsigned short)(mAllocationPortRangeMin + sliceSize - 1);
+      }
+      InfoLog(<< "Turn Manager shard " << shardIndex << " of " << numShards << " using relay ports " << mAllocationPortRangeMin << "-" << mAllocationPortRangeMax);
    }
+
+   // Initialize Allocation Ports
+   mUdpPortAllocator.init(mAllocationPortRangeMin, mAllocationPortRangeMax);
+   mTcpPortAllocator.init(mAllocationPortRangeMin, mAllocationPortRangeMax);
 }
 
 TurnManager::~TurnManager()
@@ -102,160 +115,222 @@ TurnManager::allocationExpired(const asio::error_code& e, const TurnAllocationKe
 unsigned short 
 TurnManager::allocateAnyPort(StunTuple::TransportType transport)
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
-   {
-      portToCheck = advanceLastAllocatedPort(transport);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
-   }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
+   return getPortAllocator(transport).allocateAnyPort();
 }
 
 unsigned short 
 TurnManager::allocateEvenPort(StunTuple::TransportType transport)
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is even
-   if(startPortToCheck % 2 != 0)
-   {
-      startPortToCheck = advanceLastAllocatedPort(transport);
-   }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
-   {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
-   }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
+   return getPortAllocator(transport).allocateEvenPort();
 }
 
 // Note:  This is not used, since requesting an odd port was removed
 unsigned short 
 TurnManager::allocateOddPort(StunTuple::TransportType transport)
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is odd
-   if(startPortToCheck % 2 != 1)
+   return getPortAllocator(transport).allocateOddPort();
+}
+
+unsigned short 
+TurnManager::allocateEvenPortPair(StunTuple::TransportType transport)
+{
+   return getPortAllocator(transport).allocateEvenPortPair();
+}
+
+bool 
+TurnManager::allocatePort(StunTuple::TransportType transport, unsigned short port, bool reserved)
+{
+   return getPortAllocator(transport).allocatePort(port, reserved);
+}
+
+void 
+TurnManager::deallocatePort(StunTuple::TransportType transport, unsigned short port)
+{
+   getPortAllocator(transport).deallocatePort(port);
+}
+
+TurnManager::PortAllocator& 
+TurnManager::getPortAllocator(StunTuple::TransportType transport)
+{
+   switch(transport)
    {
-      startPortToCheck = advanceLastAllocatedPort(transport);
+   case StunTuple::TCP:
+   case StunTuple::TLS:
+      return mTcpPortAllocator;
+   case StunTuple::UDP:
+   default:
+      return mUdpPortAllocator;
    }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
+}
+
+TurnManager::PortAllocator::PortAllocator() :
+   mRangeMin(1),
+   mRangeMax(0)
+{
+}
+
+void
+TurnManager::PortAllocator::init(unsigned short rangeMin, unsigned short rangeMax)
+{
+   mRangeMin = rangeMin;
+   mRangeMax = rangeMax;
+   unsigned int rangeSize = rangeMax >= rangeMin ? rangeMax - rangeMin + 1 : 0;
+   mStates.assign(rangeSize, (unsigned char)PortStateAllocated);
+   mUnallocatedEvenPorts.init(mRangeMin, rangeSize);
+   mUnallocatedOddPorts.init(mRangeMin, rangeSize);
+   mUnallocatedEvenPortPairs.init(mRangeMin, rangeSize);
+   for(unsigned int port = mRangeMin; port <= mRangeMax; port++)
    {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
+      setState((unsigned short)port, PortStateUnallocated);
    }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
 }
 
 unsigned short 
-TurnManager::allocateEvenPortPair(StunTuple::TransportType transport)
+TurnManager::PortAllocator::allocateAnyPort()
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is even
-   if(startPortToCheck % 2 != 0)
+   unsigned int numUnallocated = mUnallocatedEvenPorts.size() + mUnallocatedOddPorts.size();
+   if(numUnallocated == 0) return 0;  // no ports available
+   unsigned short port;
+   if((unsigned int)resip::Random::getRandom() % numUnallocated < mUnallocatedEvenPorts.size())
    {
-      startPortToCheck = advanceLastAllocatedPort(transport);
+      port = mUnallocatedEvenPorts.random();
    }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated || portAllocationMap[portToCheck+1] != PortStateUnallocated)
+   else
    {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
+      port = mUnallocatedOddPorts.random();
    }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   portAllocationMap[portToCheck+1] = PortStateReserved;
-   return portToCheck;
+   setState(port, PortStateAllocated);
+   return port;
+}
+
+unsigned short 
+TurnManager::PortAllocator::allocateEvenPort()
+{
+   if(mUnallocatedEvenPorts.size() == 0) return 0;  // no ports available
+   unsigned short port = mUnallocatedEvenPorts.random();
+   setState(port, PortStateAllocated);
+   return port;
+}
+
+unsigned short 
+TurnManager::PortAllocator::allocateOddPort()
+{
+   if(mUnallocatedOddPorts.size() == 0) return 0;  // no ports available
+   unsigned short port = mUnallocatedOddPorts.random();
+   setState(port, PortStateAllocated);
+   return port;
+}
+
+unsigned short 
+TurnManager::PortAllocator::allocateEvenPortPair()
+{
+   if(mUnallocatedEvenPortPairs.size() == 0) return 0;  // no port pairs available
+   unsigned short port = mUnallocatedEvenPortPairs.random();
+   setState(port, PortStateAllocated);
+   setState(port+1, PortStateReserved);
+   return port;
 }
 
 bool 
-TurnManager::allocatePort(StunTuple::TransportType transport, unsigned short port, bool reserved)
+TurnManager::PortAllocator::allocatePort(unsigned short port, bool reserved)
 {
-   if(port >= mConfig.mAllocationPortRangeMin && port <= mConfig.mAllocationPortRangeMax)
+   if(isInRange(port) && getState(port) == (reserved ? PortStateReserved : PortStateUnallocated))
    {
-      PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-      if(reserved)
-      {
-         if(portAllocationMap[port] == PortStateReserved)
-         {
-            portAllocationMap[port] = PortStateAllocated;
-            return true;
-         }
-      }
-      else
-      {
-         if(portAllocationMap[port] == PortStateUnallocated)  
-         {
-            portAllocationMap[port] = PortStateAllocated;
-            return true;
-         }
-      }
+      setState(port, PortStateAllocated);
+      return true;
    }
    return false;
 }
 
 void 
-TurnManager::deallocatePort(StunTuple::TransportType transport, unsigned short port)
+TurnManager::PortAllocator::deallocatePort(unsigned short port)
 {
-   if(port >= mConfig.mAllocationPortRangeMin && port <= mConfig.mAllocationPortRangeMax)
+   if(isInRange(port))
    {
-      PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-      portAllocationMap[port] = PortStateUnallocated;
+      setState(port, PortStateUnallocated);
 
       // If port is even - check if next higher port is reserved - if so unallocate it
-      if(port % 2 == 0 && portAllocationMap[port+1] == PortStateReserved)
+      if(port % 2 == 0 && isInRange(port+1) && getState(port+1) == PortStateReserved)
       {
-         portAllocationMap[port+1] = PortStateUnallocated;
+         setState(port+1, PortStateUnallocated);
       }
    }
 }
 
-TurnManager::PortAllocationMap& 
-TurnManager::getPortAllocationMap(StunTuple::TransportType transport)
+void 
+TurnManager::PortAllocator::setState(unsigned short port, PortState state)
 {
-   switch(transport)
+   assert(isInRange(port));
+   mStates[port - mRangeMin] = (unsigned char)state;
+   PortSet& unallocatedPorts = port % 2 == 0 ? mUnallocatedEvenPorts : mUnallocatedOddPorts;
+   if(state == PortStateUnallocated)
    {
-   case StunTuple::TCP:
-   case StunTuple::TLS:
-      return mTcpAllocationPorts;
-   case StunTuple::UDP:
-   default:
-      return mUdpAllocationPorts;
+      unallocatedPorts.insert(port);
+   }
+   else
+   {
+      unallocatedPorts.erase(port);
    }
-}
 
-unsigned short 
-TurnManager::advanceLastAllocatedPort(StunTuple::TransportType transport, unsigned int numToAdvance)
-{
-   switch(transport)
+   // Update the pair this port belongs to
+   unsigned int evenPort = port & ~1;
+   if(isInRange(evenPort) && isInRange(evenPort+1))
    {
-   case StunTuple::TCP:
-   case StunTuple::TLS:
-      mLastAllocatedTcpPort+=numToAdvance;
-      if(mLastAllocatedTcpPort > mConfig.mAllocationPortRangeMax) 
+      if(getState(evenPort) == PortStateUnallocated && getState(evenPort+1) == PortStateUnallocated)
       {
-         mLastAllocatedTcpPort = mConfig.mAllocationPortRangeMin+(mLastAllocatedTcpPort-mConfig.mAllocationPortRangeMax-1);
+         mUnallocatedEvenPortPairs.insert((unsigned short)evenPort);
       }
-      return mLastAllocatedTcpPort;
-   case StunTuple::UDP:
-   default:
-      mLastAllocatedUdpPort+=numToAdvance;
-      if(mLastAllocatedUdpPort > mConfig.mAllocationPortRangeMax) 
+      else
       {
-         mLastAllocatedUdpPort = mConfig.mAllocationPortRangeMin+(mLastAllocatedUdpPort-mConfig.mAllocationPortRangeMax-1);
+         mUnallocatedEvenPortPairs.erase((unsigned short)evenPort);
       }
-      return mLastAllocatedUdpPort;
    }
 }
 
+#define NOT_IN_SET ((unsigned int)-1)
+
+void 
+TurnManager::PortAllocator::PortSet::init(unsigned int rangeMin, unsigned int rangeSize)
+{
+   mRangeMin = rangeMin;
+   mPorts.clear();
+   mPorts.reserve(rangeSize);
+   mPositions.assign(rangeSize, NOT_IN_SET);
+}
+
+void 
+TurnManager::PortAllocator::PortSet::insert(unsigned short port)
+{
+   unsigned int& position = mPositions[port - mRangeMin];
+   if(position == NOT_IN_SET)
+   {
+      position = (unsigned int)mPorts.size();
+      mPorts.push_back(port);
+   }
+}
+
+void 
+TurnManager::PortAllocator::PortSet::erase(unsigned short port)
+{
+   unsigned int& position = mPositions[port - mRangeMin];
+   if(position != NOT_IN_SET)
+   {
+      // Move the last port into the hole
+      unsigned short lastPort = mPorts.back();
+      mPorts[position] = lastPort;
+      mPositions[lastPort - mRangeMin] = position;
+      mPorts.pop_back();
+      position = NOT_IN_SET;
+   }
+}
+
+unsigned short 
+TurnManager::PortAllocator::PortSet::random() const
+{
+   assert(!mPorts.empty());
+   return mPorts[(unsigned int)resip::Random::getRandom() % mPorts.size()];
+}
+
 } // namespace
 
 
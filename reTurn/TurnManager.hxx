@@ -1,7 +1,8 @@
 #ifndef TURNMANAGER_HXX
 #define TURNMANAGER_HXX
 
-#include <map>
+#include <vector>
+#include <rutil/HashMap.hxx>
 #include <asio.hpp>
 #include "TurnAllocationKey.hxx"
 #include "ReTurnConfig.hxx"
@@ -14,7 +15,10 @@ class TurnAllocation;
 class TurnManager
 {
 public:
-   explicit TurnManager(asio::io_service& ioService, const ReTurnConfig& config);  // ioService used to start timers
+   // ioService used to start timers.  When the server runs several ioService shards, each shard has its own
+   // TurnManager and only ever touches it from its own thread; shardIndex/numShards select the disjoint slice
+   // of the configured relay port range this manager hands out, so shards never need to coordinate
+   explicit TurnManager(asio::io_service& ioService, const ReTurnConfig& config, unsigned int shardIndex = 0, unsigned int numShards = 1);
    ~TurnManager();
 
    void addTurnAllocation(TurnAllocation* turnAllocation);
@@ -39,7 +43,7 @@ public:
    const ReTurnConfig& getConfig() { return mConfig; }
 
 private:
-   typedef std::map<TurnAllocationKey, TurnAllocation*> TurnAllocationMap;  // .slg. consider using hash table
+   typedef HashMap<TurnAllocationKey, TurnAllocation*> TurnAllocationMap;
    TurnAllocationMap mTurnAllocationMap;
  
    typedef enum
@@ -48,13 +52,56 @@ private:
       PortStateAllocated,
       PortStateReserved
    } PortState;
-   typedef std::map<unsigned short, PortState> PortAllocationMap;
-   PortAllocationMap mUdpAllocationPorts;  // .slg. expand to be a map/hash table per ip address/interface
-   PortAllocationMap mTcpAllocationPorts;
-   unsigned short mLastAllocatedUdpPort;
-   unsigned short mLastAllocatedTcpPort;
-   PortAllocationMap& getPortAllocationMap(StunTuple::TransportType transport);
-   unsigned short advanceLastAllocatedPort(StunTuple::TransportType transport, unsigned int numToAdvance = 1);
+
+   // Tracks the state of each port of the relay port range.  Unallocated ports are also kept in three index sets -
+   // even ports, odd ports, and even ports whose odd neighbour is unallocated too (ie. for RTP/RTCP pairs) - so 
+   // that each allocation picks a random port of the requested kind in constant time.
+   class PortAllocator
+   {
+   public:
+      PortAllocator();
+      void init(unsigned short rangeMin, unsigned short rangeMax);
+
+      unsigned short allocateAnyPort();
+      unsigned short allocateEvenPort();
+      unsigned short allocateOddPort();
+      unsigned short allocateEvenPortPair();
+      bool allocatePort(unsigned short port, bool reserved);
+      void deallocatePort(unsigned short port);
+
+   private:
+      // Set of ports with constant time insert, erase and random pick
+      class PortSet
+      {
+      public:
+         void init(unsigned int rangeMin, unsigned int rangeSize);
+         void insert(unsigned short port);
+         void erase(unsigned short port);
+         unsigned int size() const { return (unsigned int)mPorts.size(); }
+         unsigned short random() const;
+      private:
+         unsigned int mRangeMin;
+         std::vector<unsigned short> mPorts;
+         std::vector<unsigned int> mPositions;  // position in mPorts of each port of the range
+      };
+
+      PortState getState(unsigned int port) const { return (PortState)mStates[port - mRangeMin]; }
+      void setState(unsigned short port, PortState state);
+      bool isInRange(unsigned int port) const { return port >= mRangeMin && port <= mRangeMax; }
+
+      unsigned int mRangeMin;
+      unsigned int mRangeMax;
+      std::vector<unsigned char> mStates;
+      PortSet mUnallocatedEvenPorts;
+      PortSet mUnallocatedOddPorts;
+      PortSet mUnallocatedEvenPortPairs;  // holds the even port of each pair
+   };
+   PortAllocator mUdpPortAllocator;  // .slg. expand to be a map/hash table per ip address/interface
+   PortAllocator mTcpPortAllocator;
+   unsigned short mAllocationPortRangeMin;  // slice of the configured range owned by this manager
+   unsigned short mAllocationPortRangeMax;
+
+   PortAllocator& getPortAllocator(StunTuple::TransportType transport);
 
    asio::io_service& mIOService;
    const ReTurnConfig& mConfig;
@@ -12,7 +12,7 @@ using namespace resip;
 
 namespace reTurn {
 
-UdpServer::UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+UdpServer::UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort)
 : AsyncUdpSocketBase(ioService),
   mRequestHandler(requestHandler),
   mAlternatePortUdpServer(0),
@@ -21,7 +21,12 @@ UdpServer::UdpServer(asio::io_service& ioService, RequestHandler& requestHandler
 {
    InfoLog(<< "UdpServer started.  Listening on " << address.to_string() << ":" << port);
 
+   setReusePort(reusePort);
    bind(address, port);
+
+   asio::error_code ec;
+   asio::ip::udp::endpoint localEndpoint = mSocket.local_endpoint(ec);
+   mLocalTuple = StunTuple(StunTuple::UDP, localEndpoint.address(), localEndpoint.port());
 }
 
 UdpServer::~UdpServer()
@@ -80,8 +85,30 @@ UdpServer::onReceiveSuccess(const asio::ip::address& address, unsigned short por
 
       if(((*data)[0] & 0xC0) == 0)  // Stun/Turn Messages always have bits 0 and 1 as 00 - otherwise ChannelData message
       {
+         StunTuple peerAddress;
+         unsigned int dataOffset;
+         unsigned int dataSize;
+         if(StunMessage::decodeTurnSendIndication(data->data(), data->size(), peerAddress, dataOffset, dataSize) && dataSize > 0)
+         {
+            // Send indication - relay the data straight out of the receive buffer, without parsing the full message or copying it
+            data->offset(dataOffset);
+            data->truncate(dataSize);
+            mRequestHandler.processTurnSendIndication(mLocalTuple, StunTuple(StunTuple::UDP, address, port), peerAddress, data);
+            doReceive();
+            return;
+         }
+
+         // Binding request - build the response in place in the receive buffer, without parsing the full message
+         StunTuple remoteTuple(StunTuple::UDP, address, port);
+         if(mRequestHandler.processStunBindingRequest(remoteTuple, *data, isRFC3489BackwardsCompatServer()))
+         {
+            doSend(remoteTuple, data);
+            doReceive();
+            return;
+         }
+
          // Try to parse stun message
-         StunMessage request(StunTuple(StunTuple::UDP, mSocket.local_endpoint().address(), mSocket.local_endpoint().port()),
+         StunMessage request(mLocalTuple,
                              StunTuple(StunTuple::UDP, address, port),
                              (char*)&(*data)[0], data->size());
          if(request.isValid())
@@ -152,8 +179,9 @@ UdpServer::onReceiveSuccess(const asio::ip::address& address, unsigned short por
          }
          else
          {
+            data->truncate(dataLen + 4);  // strip any padding - only the data is relayed
             mRequestHandler.processTurnData(channelNumber,
-                                          StunTuple(StunTuple::UDP, mSocket.local_endpoint().address(), mSocket.local_endpoint().port()),
+                                          mLocalTuple,
                                           StunTuple(StunTuple::UDP, address, port),
                                           data);
          }
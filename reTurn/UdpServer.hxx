@@ -17,7 +17,7 @@ class UdpServer
 {
 public:
    /// Create the server to listen on the specified UDP address and port
-   explicit UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port);
+   explicit UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort = false);
    ~UdpServer();
 
    void start();
@@ -43,6 +43,9 @@ private:
    /// The handler for all incoming requests.
    RequestHandler& mRequestHandler;
 
+   /// Address and port this server is bound to - saves a local_endpoint() call for each packet
+   StunTuple mLocalTuple;
+
    /// The RFC3489 Alternate Server
    UdpServer* mAlternatePortUdpServer;
    UdpServer* mAlternateIpUdpServer;
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
@@ -11,6 +12,8 @@
 #include "ReTurnConfig.hxx"
 #include "RequestHandler.hxx"
 #include "TurnManager.hxx"
+#include "CredentialProvider.hxx"
+#include "QuotaManager.hxx"
 #include <rutil/WinLeakCheck.hxx>
 #include <rutil/Log.hxx>
 #include <rutil/Logger.hxx>
@@ -18,8 +21,87 @@
 
 #define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
 
-#if defined(_WIN32)
+// Everything owned by one ioService shard.  The shard's listeners, TurnManager (allocations, relay sockets and
+// relay port range) and RequestHandler are only ever touched by the one thread running the shard's ioService.
+// Listeners of all shards share the same address and port via SO_REUSEPORT, so the kernel picks the shard for
+// each client by 5-tuple hash and all of a client's traffic (and its allocation) stays on that shard.
+class ReTurnServerShard
+{
+public:
+   ReTurnServerShard(reTurn::ReTurnConfig& reTurnConfig, unsigned int shardIndex, unsigned int numShards, const resip::Data* privateNonceKey,
+                     reTurn::CredentialProvider& credentialProvider, reTurn::QuotaManager& quotaManager) :
+      mTurnManager(mIOService, reTurnConfig, shardIndex, numShards),
+      // if altStunPort is non-zero, then assume RFC3489 support is enabled and pass settings to request handler
+      mRequestHandler(mTurnManager,
+                      reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mTurnAddress : 0,
+                      reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mTurnPort : 0,
+                      reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunAddress : 0,
+                      reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunPort : 0)
+   {
+      if(privateNonceKey)
+      {
+         mRequestHandler.setPrivateNonceKey(*privateNonceKey);
+      }
+      mRequestHandler.setCredentialProvider(&credentialProvider);
+      mRequestHandler.setQuotaManager(&quotaManager);
+
+      bool reusePort = numShards > 1;
+      mUdpTurnServer.reset(new reTurn::UdpServer(mIOService, mRequestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort, reusePort));
+      mUdpTurnServer->setBatchIo(reTurnConfig.mUdpBatchIo);
+      mTcpTurnServer.reset(new reTurn::TcpServer(mIOService, mRequestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort, reusePort));
+      mTlsTurnServer.reset(new reTurn::TlsServer(mIOService, mRequestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTlsTurnPort, reusePort));
+
+      if(reTurnConfig.mAltStunPort != 0) // if alt stun port is non-zero, then RFC3489 support is enabled
+      {
+         mA1p2StunUdpServer.reset(new reTurn::UdpServer(mIOService, mRequestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mAltStunPort, reusePort));
+         mA2p1StunUdpServer.reset(new reTurn::UdpServer(mIOService, mRequestHandler, reTurnConfig.mAltStunAddress, reTurnConfig.mTurnPort, reusePort));
+         mA2p2StunUdpServer.reset(new reTurn::UdpServer(mIOService, mRequestHandler, reTurnConfig.mAltStunAddress, reTurnConfig.mAltStunPort, reusePort));
+         mUdpTurnServer->setAlternateUdpServers(mA1p2StunUdpServer.get(), mA2p1StunUdpServer.get(), mA2p2StunUdpServer.get());
+         mA1p2StunUdpServer->setAlternateUdpServers(mUdpTurnServer.get(), mA2p2StunUdpServer.get(), mA2p1StunUdpServer.get());
+         mA2p1StunUdpServer->setAlternateUdpServers(mA2p2StunUdpServer.get(), mUdpTurnServer.get(), mA1p2StunUdpServer.get());
+         mA2p2StunUdpServer->setAlternateUdpServers(mA2p1StunUdpServer.get(), mA1p2StunUdpServer.get(), mUdpTurnServer.get());
+      }
+   }
+
+   void start()
+   {
+      if(mA1p2StunUdpServer)
+      {
+         mA1p2StunUdpServer->start();
+         mA2p1StunUdpServer->start();
+         mA2p2StunUdpServer->start();
+      }
+      mUdpTurnServer->start();
+      mTcpTurnServer->start();
+      mTlsTurnServer->start();
+   }
+
+   asio::io_service& getIOService() { return mIOService; }
+   reTurn::RequestHandler& getRequestHandler() { return mRequestHandler; }
+
+private:
+   asio::io_service mIOService;
+   reTurn::TurnManager mTurnManager;
+   reTurn::RequestHandler mRequestHandler;
+
+   boost::shared_ptr<reTurn::UdpServer> mUdpTurnServer;  // also a1p1StunUdpServer
+   boost::shared_ptr<reTurn::TcpServer> mTcpTurnServer;
+   boost::shared_ptr<reTurn::TlsServer> mTlsTurnServer;
+   boost::shared_ptr<reTurn::UdpServer> mA1p2StunUdpServer;
+   boost::shared_ptr<reTurn::UdpServer> mA2p1StunUdpServer;
+   boost::shared_ptr<reTurn::UdpServer> mA2p2StunUdpServer;
+};
+typedef std::vector<boost::shared_ptr<ReTurnServerShard> > ReTurnServerShardList;
+
+static void stopShards(ReTurnServerShardList& shards)
+{
+   for(ReTurnServerShardList::iterator it = shards.begin(); it != shards.end(); it++)
+   {
+      (*it)->getIOService().stop();
+   }
+}
 
+#if defined(_WIN32)
 boost::function0<void> console_ctrl_function;
 
 BOOL WINAPI console_ctrl_handler(DWORD ctrl_type)
@@ -40,7 +122,7 @@ BOOL WINAPI console_ctrl_handler(DWORD ctrl_type)
 
 int main(int argc, char* argv[])
 {
-#if defined(WIN32) && defined(_DEBUG) && defined(LEAK_CHECK) 
+#if defined(WIN32) && defined(_DEBUG) && defined(LEAK_CHECK)
    resip::FindMemoryLeaks fml;
 #endif
 
@@ -49,10 +131,10 @@ int main(int argc, char* argv[])
    try
    {
       // Check command line arguments.
-      if (argc != 1 && argc != 6)
+      if (argc != 1 && argc != 6 && argc != 7)
       {
          std::cerr << "Usage: reTurnServer <address> <turnPort> <tlsPort> <altAddress> \n";
-         std::cerr << "                    <altPort>\n";
+         std::cerr << "                    <altPort> [<numThreads>]\n";
          std::cerr << "  IPv4 Example (with RFC3489 support):\n";
          std::cerr << "    reTurnServer 192.168.1.10 3478 5349 192.168.1.11 3479\n\n";
          std::cerr << "  IPv6 Example (with RFC3489 support):\n";
@@ -61,7 +143,10 @@ int main(int argc, char* argv[])
          std::cerr << "  Note:  For RFC3489 legacy support define altPort as non-zero and\n";
          std::cerr << "         ensure you don't use INADDR_ANY for the IP addresses.\n";
          std::cerr << "         Both addresses should terminate on the machine running\n";
-         std::cerr << "         reTurn.";
+         std::cerr << "         reTurn.\n";
+         std::cerr << "  Note:  numThreads > 1 runs one ioService per thread, each with\n";
+         std::cerr << "         its own listeners (SO_REUSEPORT), allocations and slice\n";
+         std::cerr << "         of the relay port range.";
          return 1;
       }
 
@@ -69,11 +154,7 @@ int main(int argc, char* argv[])
       resip::Log::initialize(reTurnConfig.mLoggingType, reTurnConfig.mLoggingLevel, "reTurnServer", reTurnConfig.mLoggingFilename.c_str());
       resip::GenericLogImpl::MaxLineCount = reTurnConfig.mLoggingFileMaxLineCount;
 
-      // Initialize server.
-      asio::io_service ioService;                                // The one and only ioService for the stunServer
-      reTurn::TurnManager turnManager(ioService, reTurnConfig);  // The one and only Turn Manager
-
-      if(argc == 6)
+      if(argc >= 6)
       {
          reTurnConfig.mTurnPort = (unsigned short)resip::Data(argv[2]).convertUnsignedLong();
          reTurnConfig.mTlsTurnPort = (unsigned short)resip::Data(argv[3]).convertUnsignedLong();
@@ -81,46 +162,47 @@ int main(int argc, char* argv[])
          reTurnConfig.mTurnAddress = asio::ip::address::from_string(argv[1]);
          reTurnConfig.mAltStunAddress = asio::ip::address::from_string(argv[4]);
       }
+      if(argc == 7)
+      {
+         reTurnConfig.mNumThreads = (unsigned int)resip::Data(argv[6]).convertUnsignedLong();
+      }
 
-      boost::shared_ptr<reTurn::UdpServer> udpTurnServer;  // also a1p1StunUdpServer
-      boost::shared_ptr<reTurn::TcpServer> tcpTurnServer;
-      boost::shared_ptr<reTurn::TlsServer> tlsTurnServer;
-      boost::shared_ptr<reTurn::UdpServer> a1p2StunUdpServer;
-      boost::shared_ptr<reTurn::UdpServer> a2p1StunUdpServer;
-      boost::shared_ptr<reTurn::UdpServer> a2p2StunUdpServer;
-
-      // The one and only RequestHandler - if altStunPort is non-zero, then assume RFC3489 support is enabled and pass settings to request handler
-      reTurn::RequestHandler requestHandler(turnManager, 
-         reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mTurnAddress : 0, 
-         reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mTurnPort : 0, 
-         reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunAddress : 0, 
-         reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunPort : 0); 
-
-      udpTurnServer.reset(new reTurn::UdpServer(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort));
-      tcpTurnServer.reset(new reTurn::TcpServer(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort));
-      tlsTurnServer.reset(new reTurn::TlsServer(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTlsTurnPort));
+      unsigned int numThreads = reTurnConfig.mNumThreads > 0 ? reTurnConfig.mNumThreads : 1;
+#ifndef RETURN_REUSE_PORT_SUPPORTED
+      if(numThreads > 1)
+      {
+         WarningLog(<< "SO_REUSEPORT is not supported on this platform, ignoring numThreads=" << numThreads << " and running a single ioService.");
+         numThreads = 1;
+      }
+#endif
 
-      if(reTurnConfig.mAltStunPort != 0) // if alt stun port is non-zero, then RFC3489 support is enabled
+      // Credentials and quotas are shared by all shards
+      std::auto_ptr<reTurn::CredentialProvider> credentialProvider;
+      if(reTurnConfig.mAuthenticationCredentialsFilename.empty())
+      {
+         credentialProvider.reset(new reTurn::CredentialCache(reTurnConfig.mAuthenticationRealm, reTurnConfig.mAuthenticationCredentials));
+      }
+      else
       {
-         a1p2StunUdpServer.reset(new reTurn::UdpServer(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mAltStunPort));
-         a2p1StunUdpServer.reset(new reTurn::UdpServer(ioService, requestHandler, reTurnConfig.mAltStunAddress, reTurnConfig.mTurnPort));
-         a2p2StunUdpServer.reset(new reTurn::UdpServer(ioService, requestHandler, reTurnConfig.mAltStunAddress, reTurnConfig.mAltStunPort));
-         udpTurnServer->setAlternateUdpServers(a1p2StunUdpServer.get(), a2p1StunUdpServer.get(), a2p2StunUdpServer.get());
-         a1p2StunUdpServer->setAlternateUdpServers(udpTurnServer.get(), a2p2StunUdpServer.get(), a2p1StunUdpServer.get());
-         a2p1StunUdpServer->setAlternateUdpServers(a2p2StunUdpServer.get(), udpTurnServer.get(), a1p2StunUdpServer.get());
-         a2p2StunUdpServer->setAlternateUdpServers(a2p1StunUdpServer.get(), a1p2StunUdpServer.get(), udpTurnServer.get());
-         a1p2StunUdpServer->start();
-         a2p1StunUdpServer->start();
-         a2p2StunUdpServer->start();
+         credentialProvider.reset(new reTurn::FileCredentialProvider(reTurnConfig.mAuthenticationRealm, reTurnConfig.mAuthenticationCredentialsFilename));
       }
+      reTurn::QuotaManager quotaManager(reTurnConfig);
 
-      udpTurnServer->start();
-      tcpTurnServer->start();
-      tlsTurnServer->start();
+      // Initialize server - one ioService shard per thread
+      ReTurnServerShardList shards;
+      for(unsigned int i = 0; i < numThreads; i++)
+      {
+         shards.push_back(boost::shared_ptr<ReTurnServerShard>(new ReTurnServerShard(reTurnConfig, i, numThreads,
+            i == 0 ? 0 : &shards[0]->getRequestHandler().getPrivateNonceKey(), *credentialProvider, quotaManager)));
+      }
+      for(unsigned int i = 0; i < numThreads; i++)
+      {
+         shards[i]->start();
+      }
 
 #ifdef _WIN32
       // Set console control handler to allow server to be stopped.
-      console_ctrl_function = boost::bind(&asio::io_service::stop, &ioService);
+      console_ctrl_function = boost::bind(&stopShards, boost::ref(shards));
       SetConsoleCtrlHandler(console_ctrl_handler, TRUE);
 #else
       // Block all signals for background thread.
@@ -130,29 +212,42 @@ int main(int argc, char* argv[])
       pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
 #endif
 
-      // Run the ioService until stopped.
-      // Create a pool of threads to run all of the io_services.
-      boost::shared_ptr<asio::thread> thread(new asio::thread(
-         boost::bind(&asio::io_service::run, &ioService)));
+      // Run the ioServices until stopped.
+      // Create a pool of threads to run all of the io_services - one thread per shard.
+      std::vector<boost::shared_ptr<asio::thread> > threads;
+      for(unsigned int i = 0; i < numThreads; i++)
+      {
+         threads.push_back(boost::shared_ptr<asio::thread>(new asio::thread(
+            boost::bind(&asio::io_service::run, &shards[i]->getIOService()))));
+      }
+      InfoLog(<< "reTurnServer running with " << numThreads << " ioService thread(s).");
 
 #ifndef _WIN32
       // Restore previous signals.
       pthread_sigmask(SIG_SETMASK, &old_mask, 0);
 
-      // Wait for signal indicating time to shut down.
+      // Wait for signal indicating time to shut down - SIGHUP reloads the credentials
       sigset_t wait_mask;
       sigemptyset(&wait_mask);
       sigaddset(&wait_mask, SIGINT);
       sigaddset(&wait_mask, SIGQUIT);
       sigaddset(&wait_mask, SIGTERM);
+      sigaddset(&wait_mask, SIGHUP);
       pthread_sigmask(SIG_BLOCK, &wait_mask, 0);
       int sig = 0;
-      sigwait(&wait_mask, &sig);
-      ioService.stop();
+      while(sigwait(&wait_mask, &sig) == 0 && sig == SIGHUP)
+      {
+         InfoLog(<< "SIGHUP received, reloading credentials.");
+         credentialProvider->reload();
+      }
+      stopShards(shards);
 #endif
 
-      // Wait for thread to exit
-      thread->join();
+      // Wait for threads to exit
+      for(unsigned int i = 0; i < numThreads; i++)
+      {
+         threads[i]->join();
+      }
    }
    catch (std::exception& e)
    {
@@ -162,7 +257,6 @@ int main(int argc, char* argv[])
    return 0;
 }
 
-
 /* ====================================================================
 
  Copyright (c) 2007-2008, Plantronics, Inc.
@@ -0,0 +1,283 @@
+// Unit tests for the server's quota and credential bookkeeping:
+//   - TokenBucket refill, burst limit, rejection and refund
+//   - QuotaManager per user and per client address allocation limits, and bandwidth limits
+//   - FileCredentialProvider loading and reloading its file
+
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <asio.hpp>
+
+#include "../QuotaManager.hxx"
+#include "../ReTurnConfig.hxx"
+#include "../CredentialProvider.hxx"
+#include "../StunMessage.hxx"
+#include <rutil/Logger.hxx>
+#include <rutil/Timer.hxx>
+
+using namespace reTurn;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::TEST
+
+static void
+testTokenBucket()
+{
+   // 1000 bytes per second, up to 2000 bytes of burst - the bucket starts out full
+   UInt64 now = resip::Timer::getTimeMs();
+   TokenBucket bucket(1000, 2000);
+   // not before the bucket was made
+   now += 10;
+
+   assert(bucket.consume(2000, now));
+   assert(!bucket.consume(1, now));    // empty
+   assert(!bucket.consume(5000, now)); // more than the burst can never be taken
+
+   // 100ms refills 100 bytes
+   now += 100;
+   assert(bucket.consume(60, now));
+   assert(!bucket.consume(60, now));   // rejection takes nothing...
+   assert(bucket.consume(40, now));    // ...so the remaining 40 are still there
+   assert(!bucket.consume(1, now));
+
+   // refill is exact however often the bucket is used:  1ms at a time, 1 byte per ms
+   for(int i = 0; i < 1000; i++)
+   {
+      now++;
+      assert(bucket.consume(1, now));
+   }
+   assert(!bucket.consume(1, now));
+
+   // refill stops at the burst size
+   now += 60000;
+   assert(bucket.consume(2000, now));
+   assert(!bucket.consume(1, now));
+
+   // refunded tokens can be taken again, but never beyond the burst size
+   bucket.refund(500);
+   assert(bucket.consume(500, now));
+   assert(!bucket.consume(1, now));
+   now += 60000;
+   bucket.refund(500);
+   assert(!bucket.consume(2001, now));
+   assert(bucket.consume(2000, now));
+
+   cout << "TokenBucket OK" << endl;
+}
+
+static void
+testAllocationQuotas()
+{
+   ReTurnConfig config;
+   config.mMaxAllocationsPerUser = 2;
+   config.mMaxAllocationsPerAddress = 3;
+   QuotaManager quotaManager(config);
+
+   asio::ip::address address1 = asio::ip::address::from_string("192.0.2.1");
+   asio::ip::address address2 = asio::ip::address::from_string("192.0.2.2");
+
+   // per user
+   QuotaManager::Reservation* alice1 = quotaManager.reserveAllocation("alice", address1);
+   QuotaManager::Reservation* alice2 = quotaManager.reserveAllocation("alice", address2);
+   assert(alice1 && alice2);
+   assert(quotaManager.reserveAllocation("alice", address2) == 0);
+
+   // per address - the rejected alice allocation above was not counted against address2
+   QuotaManager::Reservation* bob1 = quotaManager.reserveAllocation("bob", address2);
+   QuotaManager::Reservation* carol1 = quotaManager.reserveAllocation("carol", address2);
+   assert(bob1 && carol1);
+   assert(quotaManager.reserveAllocation("dave", address2) == 0);
+   // ...and the rejected dave allocation was not counted against dave
+   QuotaManager::Reservation* dave1 = quotaManager.reserveAllocation("dave", address1);
+   QuotaManager::Reservation* dave2 = quotaManager.reserveAllocation("dave", address1);
+   assert(dave1 && dave2);
+
+   // releasing an allocation frees up both its user's and its address's quota
+   delete alice2;
+   QuotaManager::Reservation* alice3 = quotaManager.reserveAllocation("alice", address2);
+   assert(alice3);
+   assert(quotaManager.reserveAllocation("alice", address1) == 0);
+
+   delete alice1;
+   delete alice3;
+   delete bob1;
+   delete carol1;
+   delete dave1;
+   delete dave2;
+
+   // no limits configured
+   ReTurnConfig unlimitedConfig;
+   QuotaManager unlimited(unlimitedConfig);
+   QuotaManager::Reservation* reservations[50];
+   for(int i = 0; i < 50; i++)
+   {
+      reservations[i] = unlimited.reserveAllocation("alice", address1);
+      assert(reservations[i]);
+      assert(reservations[i]->consumeBandwidth(100000));
+   }
+   for(int i = 0; i < 50; i++)
+   {
+      delete reservations[i];
+   }
+
+   cout << "Allocation quotas OK" << endl;
+}
+
+static void
+testBandwidthQuotas()
+{
+   ReTurnConfig config;
+   config.mMaxBandwidthPerUser = 10000;
+   config.mMaxBandwidthPerAddress = 4000;
+   QuotaManager quotaManager(config);
+
+   asio::ip::address address1 = asio::ip::address::from_string("192.0.2.1");
+   asio::ip::address address2 = asio::ip::address::from_string("192.0.2.2");
+
+   QuotaManager::Reservation* fromAddress1 = quotaManager.reserveAllocation("alice", address1);
+   QuotaManager::Reservation* fromAddress2 = quotaManager.reserveAllocation("alice", address2);
+   assert(fromAddress1 && fromAddress2);
+
+   // address1 uses up its own quota, and keeps sending
+   assert(fromAddress1->consumeBandwidth(4000));
+   for(int i = 0; i < 100; i++)
+   {
+      assert(!fromAddress1->consumeBandwidth(1000));
+   }
+   // the dropped packets did not use up alice's quota:  6000 are left for address2, which is
+   // limited to 4000 itself
+   assert(fromAddress2->consumeBandwidth(4000));
+   assert(!fromAddress2->consumeBandwidth(100));
+
+   // a third address gets the 2000 alice has left
+   asio::ip::address address3 = asio::ip::address::from_string("192.0.2.3");
+   QuotaManager::Reservation* fromAddress3 = quotaManager.reserveAllocation("alice", address3);
+   assert(fromAddress3);
+   assert(fromAddress3->consumeBandwidth(1900));
+   assert(!fromAddress3->consumeBandwidth(200));
+
+   delete fromAddress1;
+   delete fromAddress2;
+   delete fromAddress3;
+
+   cout << "Bandwidth quotas OK" << endl;
+}
+
+static void
+writeFile(const char* filename, const char* contents)
+{
+   ofstream file(filename);
+   file << contents;
+}
+
+static void
+testFileCredentialProvider()
+{
+   const char* filename = "quotaTests-users.txt";
+   const resip::Data realm("example.org");
+
+   resip::Data bobKey;
+   StunMessage::calculateHmacKey(bobKey, "bob", realm, "bobpass");
+   resip::Data bobHex = bobKey.hex();
+
+   writeFile(filename, "# test users\n"
+                       "\n"
+                       "alice secret\n"
+                       "nopassword\n"
+                       "badkey 0x1234\n");
+   FileCredentialProvider provider(realm, filename);
+   long generation = provider.getGeneration();
+
+   assert(provider.isUserNameValid("alice"));
+   assert(!provider.isUserNameValid("bob"));
+   assert(!provider.isUserNameValid("nopassword"));
+   assert(!provider.isUserNameValid("badkey"));
+
+   resip::Data key;
+   resip::Data expected;
+   assert(provider.getLongTermKey("alice", realm, key));
+   StunMessage::calculateHmacKey(expected, "alice", realm, "secret");
+   assert(key == expected);
+   // keys for other realms are derived from the password
+   assert(provider.getLongTermKey("alice", "other.org", key));
+   StunMessage::calculateHmacKey(expected, "alice", "other.org", "secret");
+   assert(key == expected);
+
+   // reload picks up added, removed and changed users
+   writeFile(filename, (resip::Data("alice newsecret\n"
+                                    "bob 0x") + bobHex + "\n").c_str());
+   assert(provider.reload());
+   assert(provider.getGeneration() != generation);
+   generation = provider.getGeneration();
+   assert(provider.getLongTermKey("alice", realm, key));
+   StunMessage::calculateHmacKey(expected, "alice", realm, "newsecret");
+   assert(key == expected);
+   assert(provider.getLongTermKey("bob", realm, key));
+   assert(key == bobKey);
+   // only the key for our own realm was provisioned for bob
+   assert(!provider.getLongTermKey("bob", "other.org", key));
+
+   writeFile(filename, "carol pass\n");
+   assert(provider.reload());
+   assert(!provider.isUserNameValid("alice"));
+   assert(!provider.isUserNameValid("bob"));
+   assert(provider.isUserNameValid("carol"));
+   generation = provider.getGeneration();
+
+   // a file that can't be read keeps the current credentials
+   remove(filename);
+   assert(!provider.reload());
+   assert(provider.isUserNameValid("carol"));
+   assert(provider.getGeneration() == generation);
+
+   cout << "FileCredentialProvider OK" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   resip::Log::initialize(resip::Log::Cout, resip::Log::Warning, "");
+
+   testTokenBucket();
+   testAllocationQuotas();
+   testBandwidthQuotas();
+   testFileCredentialProvider();
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ 3. Neither the name of Plantronics nor the names of its contributors
+    may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
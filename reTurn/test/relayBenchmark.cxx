@@ -0,0 +1,322 @@
+// Packets per second benchmark for the TURN relay data path.
+//
+// Runs a UdpServer on the loopback interface in its own thread, creates an allocation with a channel binding
+// and a plain permission, and measures relayed throughput and heap allocations per relayed packet for:
+//   - ChannelData from the client to a peer
+//   - a Send indication from the client to a peer
+//   - data from a peer to the client as ChannelData
+//   - data from a peer to the client as a Data indication
+//
+// Usage: relayBenchmark [numPackets] [payloadSize] [batchIo (0|1)]
+
+#include <iostream>
+#include <string>
+#include <new>
+#include <stdlib.h>
+#include <asio.hpp>
+#include <boost/bind.hpp>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+#include "../StunTuple.hxx"
+#include "../StunMessage.hxx"
+#include "../ReTurnConfig.hxx"
+#include "../TurnManager.hxx"
+#include "../RequestHandler.hxx"
+#include "../UdpServer.hxx"
+#include <rutil/AtomicCounter.hxx>
+#include <rutil/Timer.hxx>
+#include <rutil/Logger.hxx>
+
+using namespace reTurn;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::TEST
+
+static resip::AtomicCounter allocationCount;
+
+void* operator new(size_t size)
+{
+   allocationCount.increment();
+   void* p = malloc(size ? size : 1);
+   if(!p) throw std::bad_alloc();
+   return p;
+}
+
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void* operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+void operator delete[](void* p) throw()
+{
+   operator delete(p);
+}
+
+static const unsigned short TurnPort = 34780;
+static const unsigned int Window = 32;  // packets in flight per burst
+
+class LoopbackSocket
+{
+public:
+   LoopbackSocket()
+   {
+      mFd = (int)::socket(AF_INET, SOCK_DGRAM, 0);
+      sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      ::bind(mFd, (sockaddr*)&addr, sizeof(addr));
+      socklen_t len = sizeof(addr);
+      getsockname(mFd, (sockaddr*)&addr, &len);
+      mPort = ntohs(addr.sin_port);
+      int rcvbuf = 1024*1024;
+      setsockopt(mFd, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+      timeval tv;
+      tv.tv_sec = 0;
+      tv.tv_usec = 200000;
+      setsockopt(mFd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+   }
+   ~LoopbackSocket() { ::close(mFd); }
+
+   void sendTo(unsigned short port, const char* buf, unsigned int len)
+   {
+      sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(port);
+      ::sendto(mFd, buf, len, 0, (sockaddr*)&addr, sizeof(addr));
+   }
+
+   int receive(char* buf, unsigned int len)
+   {
+      return (int)::recv(mFd, buf, len, 0);
+   }
+
+   StunTuple tuple() const { return StunTuple(StunTuple::UDP, asio::ip::address::from_string("127.0.0.1"), mPort); }
+   unsigned short port() const { return mPort; }
+
+private:
+   int mFd;
+   unsigned short mPort;
+};
+
+class BenchmarkClient
+{
+public:
+   BenchmarkClient() : mServer(StunTuple::UDP, asio::ip::address::from_string("127.0.0.1"), TurnPort) {}
+
+   // Sends request with long term credentials (retrying once after the 401 that provides the nonce)
+   bool request(StunMessage& request, StunMessage*& response)
+   {
+      for(int attempt = 0; attempt < 2; attempt++)
+      {
+         if(!mNonce.empty())
+         {
+            request.setUsername("test");
+            request.setRealm("reTurn");
+            request.setNonce(mNonce.c_str());
+            request.mHasMessageIntegrity = true;
+            request.calculateHmacKey(request.mHmacKey, "test", "reTurn", "1234");
+         }
+         request.createHeader(request.mClass, request.mMethod);  // new tid
+         char buf[1024];
+         unsigned int len = request.stunEncodeMessage(buf, sizeof(buf));
+         mSocket.sendTo(TurnPort, buf, len);
+         int rlen = mSocket.receive(buf, sizeof(buf));
+         if(rlen <= 0) return false;
+         response = new StunMessage(mSocket.tuple(), mServer, buf, rlen);
+         if(response->mHasErrorCode && response->mHasNonce && (response->mErrorCode.errorClass * 100 + response->mErrorCode.number) == 401)
+         {
+            mNonce = *response->mNonce;
+            delete response;
+            continue;
+         }
+         return response->mClass == StunMessage::StunClassSuccessResponse;
+      }
+      return false;
+   }
+
+   LoopbackSocket mSocket;
+   StunTuple mServer;
+   resip::Data mNonce;
+};
+
+static void
+runPhase(const char* name, LoopbackSocket& from, unsigned short toPort, LoopbackSocket& to,
+         const char* packet, unsigned int packetSize, unsigned int expectedSize, unsigned int numPackets)
+{
+   char buf[4096];
+   unsigned int received = 0;
+   unsigned int badSize = 0;
+   long allocationsBefore = allocationCount.value();
+   UInt64 start = resip::Timer::getTimeMicroSec();
+   for(unsigned int sent = 0; sent < numPackets; sent += Window)
+   {
+      for(unsigned int i = 0; i < Window; i++)
+      {
+         from.sendTo(toPort, packet, packetSize);
+      }
+      for(unsigned int i = 0; i < Window; i++)
+      {
+         int len = to.receive(buf, sizeof(buf));
+         if(len < 0) break;  // timed out - lost packets
+         if((unsigned int)len != expectedSize) badSize++;
+         received++;
+      }
+   }
+   UInt64 elapsed = resip::Timer::getTimeMicroSec() - start;
+   long allocations = allocationCount.value() - allocationsBefore;
+   unsigned int sent = ((numPackets + Window - 1) / Window) * Window;
+   cout << name << ": " << received << "/" << sent << " packets relayed in " << elapsed/1000 << " ms = "
+        << (elapsed ? (UInt64)received * 1000000 / elapsed : 0) << " pps, "
+        << (received ? (double)allocations / received : 0.0) << " allocations/packet";
+   if(badSize) cout << ", " << badSize << " with unexpected size";
+   cout << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   unsigned int numPackets = argc > 1 ? atoi(argv[1]) : 100000;
+   unsigned int payloadSize = argc > 2 ? atoi(argv[2]) : 172;  // G.711 20ms RTP packet
+   if(payloadSize > 1400) payloadSize = 1400;
+   bool batchIo = argc > 3 ? atoi(argv[3]) != 0 : true;
+
+   resip::Log::initialize(resip::Log::Cout, resip::Log::Err, argv[0]);
+
+   // Server
+   ReTurnConfig config;
+   config.mAllocationPortRangeMin = 50000;
+   config.mAllocationPortRangeMax = 50999;
+   config.mUdpBatchIo = batchIo;
+   asio::io_service ioService;
+   TurnManager turnManager(ioService, config);
+   RequestHandler requestHandler(turnManager);
+   boost::shared_ptr<UdpServer> udpServer(new UdpServer(ioService, requestHandler, asio::ip::address::from_string("127.0.0.1"), TurnPort));
+   udpServer->setBatchIo(batchIo);
+   udpServer->start();
+   asio::thread serverThread(boost::bind(&asio::io_service::run, &ioService));
+
+   // Client and peers
+   BenchmarkClient client;
+   LoopbackSocket channelPeer;
+   LoopbackSocket indicationPeer;
+
+   StunMessage allocate;
+   allocate.mClass = StunMessage::StunClassRequest;
+   allocate.mMethod = StunMessage::TurnAllocateMethod;
+   allocate.mHasTurnRequestedTransport = true;
+   allocate.mTurnRequestedTransport = StunMessage::RequestedTransportUdp;
+   StunMessage* response = 0;
+   if(!client.request(allocate, response) || !response->mHasTurnXorRelayedAddress)
+   {
+      cerr << "Allocate failed" << endl;
+      return -1;
+   }
+   StunTuple relay;
+   StunMessage::setTupleFromStunAtrAddress(relay, response->mTurnXorRelayedAddress);
+   delete response;
+
+   StunMessage channelBind;
+   channelBind.mClass = StunMessage::StunClassRequest;
+   channelBind.mMethod = StunMessage::TurnChannelBindMethod;
+   channelBind.mHasTurnChannelNumber = true;
+   channelBind.mTurnChannelNumber = 0x4000;
+   channelBind.mHasTurnXorPeerAddress = true;
+   StunMessage::setStunAtrAddressFromTuple(channelBind.mTurnXorPeerAddress, channelPeer.tuple());
+   if(!client.request(channelBind, response))
+   {
+      cerr << "ChannelBind failed" << endl;
+      return -1;
+   }
+   delete response;
+
+   StunMessage createPermission;
+   createPermission.mClass = StunMessage::StunClassRequest;
+   createPermission.mMethod = StunMessage::TurnCreatePermissionMethod;
+   createPermission.mHasTurnXorPeerAddress = true;
+   StunMessage::setStunAtrAddressFromTuple(createPermission.mTurnXorPeerAddress, indicationPeer.tuple());
+   if(!client.request(createPermission, response))
+   {
+      cerr << "CreatePermission failed" << endl;
+      return -1;
+   }
+   delete response;
+
+   cout << "Relaying " << numPackets << " packets of " << payloadSize << " bytes via " << relay << (batchIo ? " (batch io)" : "") << endl;
+
+   char channelData[1500];
+   unsigned short channel = htons(0x4000);
+   unsigned short length = htons((unsigned short)payloadSize);
+   memcpy(&channelData[0], &channel, 2);
+   memcpy(&channelData[2], &length, 2);
+   memset(&channelData[4], 0x55, payloadSize);
+   char payload[1500];
+   memset(payload, 0xAA, payloadSize);
+   StunMessage sendInd;
+   sendInd.createHeader(StunMessage::StunClassIndication, StunMessage::TurnSendMethod);
+   sendInd.mHasTurnXorPeerAddress = true;
+   StunMessage::setStunAtrAddressFromTuple(sendInd.mTurnXorPeerAddress, indicationPeer.tuple());
+   sendInd.setTurnData(payload, payloadSize);
+   char sendIndication[1600];
+   unsigned int sendIndicationSize = sendInd.stunEncodeMessage(sendIndication, sizeof(sendIndication));
+   unsigned int dataIndicationSize = 20 /* header */ + 12 /* XorPeerAddress (v4) */ + 4 + payloadSize + (4 - payloadSize % 4) % 4;
+
+   // warm up
+   runPhase("warmup", client.mSocket, TurnPort, channelPeer, channelData, payloadSize + 4, payloadSize, 10*Window);
+
+   runPhase("ChannelData client->peer", client.mSocket, TurnPort, channelPeer, channelData, payloadSize + 4, payloadSize, numPackets);
+   runPhase("SendInd     client->peer", client.mSocket, TurnPort, indicationPeer, sendIndication, sendIndicationSize, payloadSize, numPackets);
+   runPhase("ChannelData peer->client", channelPeer, (unsigned short)relay.getPort(), client.mSocket, payload, payloadSize, payloadSize + 4, numPackets);
+   runPhase("DataInd     peer->client", indicationPeer, (unsigned short)relay.getPort(), client.mSocket, payload, payloadSize, dataIndicationSize, numPackets);
+
+   ioService.stop();
+   serverThread.join();
+   return 0;
+}
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ 3. Neither the name of Plantronics nor the names of its contributors
+    may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
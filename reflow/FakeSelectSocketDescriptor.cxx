@@ -3,6 +3,7 @@
 #include <WS2TCPIP.H>
 #else
 #include <netinet/in.h>
+#include <sys/select.h>
 #endif
 
 #include <rutil/Log.hxx>
@@ -87,6 +88,38 @@ FakeSelectSocketDescriptor::receive()
 #endif
 }
 
+void 
+FakeSelectSocketDescriptor::receive(unsigned int count)
+{
+#ifdef WIN32
+   // Each send is a separate datagram
+   for(unsigned int i = 0; i < count; i++)
+   {
+      receive();
+   }
+#else
+   char rdBuf[256];
+   while(count > 0)
+   {
+      ssize_t res = ::read(mPipe[0], rdBuf, count < sizeof(rdBuf) ? count : sizeof(rdBuf));
+      if(res <= 0) break;
+      count -= (unsigned int)res;
+   }
+#endif
+}
+
+bool 
+FakeSelectSocketDescriptor::wait(unsigned int timeoutMs)
+{
+   fd_set readSet;
+   FD_ZERO(&readSet);
+   FD_SET(getSocketDescriptor(), &readSet);
+   timeval timeout;
+   timeout.tv_sec = timeoutMs / 1000;
+   timeout.tv_usec = (timeoutMs % 1000) * 1000;
+   return ::select(getSocketDescriptor() + 1, &readSet, 0, 0, &timeout) > 0;
+}
+
 
 /* ====================================================================
 
@@ -30,6 +30,14 @@ public:
 
    void receive();
 
+   // dequeue count items of fake data from the descriptor, in one call
+
+   void receive(unsigned int count);
+
+   // waits up to timeoutMs for the descriptor to signal - returns true if it did
+
+   bool wait(unsigned int timeoutMs);
+
 
 private:
 #ifndef WIN32
@@ -16,8 +16,6 @@ using namespace resip;
 using namespace dtls;
 using namespace std;
 
-#define MAX_RECEIVE_FIFO_DURATION 10 // seconds
-#define MAX_RECEIVE_FIFO_SIZE (100 * MAX_RECEIVE_FIFO_DURATION)  // 1000 = 1 message every 10 ms for 10 seconds - appropriate for RTP
 
 #define RESIPROCATE_SUBSYSTEM FlowManagerSubsystem::FLOWMANAGER
 
@@ -109,7 +107,9 @@ Flow::Flow(asio::io_service& ioService,
            asio::ssl::context& sslContext,
            unsigned int componentId,
            const StunTuple& localBinding, 
-           MediaStream& mediaStream) 
+           MediaStream& mediaStream,
+           unsigned int receiveRingDepth,
+           unsigned int receiveRingMaxPacketSize) 
   : mIOService(ioService),
     mSslContext(sslContext),
     mComponentId(componentId),
@@ -118,7 +118,7 @@ Flow::Flow(asio::io_service& ioService,
     mAllocationProps(StunMessage::PropsNone),
     mReservationToken(0),
     mFlowState(Unconnected),
-    mReceivedDataFifo(MAX_RECEIVE_FIFO_DURATION,MAX_RECEIVE_FIFO_SIZE)
+    mReceiveRing(receiveRingDepth, receiveRingMaxPacketSize)
 {
    InfoLog(<< "Flow: flow created for " << mLocalBinding << "  ComponentId=" << mComponentId);
 
@@ -257,6 +257,31 @@ Flow::sendTo(const asio::ip::address& address, unsigned short port, char* buffer
    }
 }
 
+void
+Flow::sendBatch(SrtpPacket* packets, unsigned int numPackets)
+{
+   assert(mTurnSocket.get());
+   if(isReady())
+   {
+      processSendData(packets, numPackets, mTurnSocket->getConnectedAddress(), mTurnSocket->getConnectedPort());
+      for(unsigned int i = 0; i < numPackets; i++)
+      {
+         if(packets[i].mStatus == err_status_ok)
+         {
+            mTurnSocket->send((char*)packets[i].mData, packets[i].mSize);
+         }
+      }
+   }
+   else
+   {
+      for(unsigned int i = 0; i < numPackets; i++)
+      {
+         packets[i].mStatus = err_status_no_ctx;
+      }
+      onSendFailure(mTurnSocket->getSocketDescriptor(), asio::error_code(flowmanager::InvalidState, asio::error::misc_category));
+   }
+}
+
 // Note: this fn is used to send raw data to the far end, without attempting to SRTP encrypt it - ie. used for sending DTLS traffic
 void
 Flow::rawSendTo(const asio::ip::address& address, unsigned short port, const char* buffer, unsigned int size)
@@ -305,7 +330,73 @@ Flow::processSendData(char* buffer, unsigned int& size, const asio::ip::address&
    return true;
 }
 
+void
+Flow::processSendData(SrtpPacket* packets, unsigned int numPackets, const asio::ip::address& address, unsigned short port)
+{
+   unsigned int numProtected = numPackets;
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      packets[i].mStatus = err_status_ok;
+   }
+
+   if(mMediaStream.mSRTPSessionOutCreated)
+   {
+      numProtected = mMediaStream.srtpProtect(packets, numPackets, mComponentId == RTCP_COMPONENT_ID);
+   }
+   else
+   {
+      Lock lock(mMutex);
+      DtlsSocket* dtlsSocket = getDtlsSocket(StunTuple(mLocalBinding.getTransportType(), address, port));
+      if(dtlsSocket)
+      {
+         if(((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->isSrtpInitialized())
+         {
+            numProtected = ((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->srtpProtect(packets, numPackets, mComponentId == RTCP_COMPONENT_ID);
+         }
+         else
+         {
+            for(unsigned int i = 0; i < numPackets; i++)
+            {
+               packets[i].mStatus = err_status_no_ctx;
+            }
+            onSendFailure(mTurnSocket->getSocketDescriptor(), asio::error_code(flowmanager::InvalidState, asio::error::misc_category));
+            return;
+         }
+      }
+   }
+
+   if(numProtected != numPackets)
+   {
+      for(unsigned int i = 0; i < numPackets; i++)
+      {
+         if(packets[i].mStatus != err_status_ok)
+         {
+            ErrLog(<< "Unable to SRTP protect the packet, error code=" << packets[i].mStatus << "(" << srtp_error_string(packets[i].mStatus) << ")  ComponentId=" << mComponentId);
+            onSendFailure(mTurnSocket->getSocketDescriptor(), asio::error_code(flowmanager::SRTPError, asio::error::misc_category));
+         }
+      }
+   }
+}
+
 // Receive Methods
+FlowReceiveRing::Packet* 
+Flow::getNextReceivedData(unsigned int timeout)
+{
+   FlowReceiveRing::Packet* receivedData = mReceiveRing.front();
+   if(!receivedData && timeout != 0)
+   {
+      // The fake select descriptor is signalled once for each packet in the ring, so we can wait on it
+      UInt64 endTime = Timer::getTimeMs() + timeout;
+      UInt64 now;
+      while(!receivedData && (now = Timer::getTimeMs()) < endTime)
+      {
+         mFakeSelectSocketDescriptor.wait((unsigned int)(endTime - now));
+         receivedData = mReceiveRing.front();
+      }
+   }
+   return receivedData;
+}
+
 asio::error_code 
 Flow::receiveFrom(const asio::ip::address& address, unsigned short port, char* buffer, unsigned int& size, unsigned int timeout)
 {
@@ -316,31 +407,31 @@ Flow::receiveFrom(const asio::ip::address& address, unsigned short port, char* b
    unsigned int recvTimeout;
    while(!done)
    {
-      // We define timeout of 0 differently then TimeLimitFifo - we want 0 to mean no-block at all
-      if(timeout == 0 && mReceivedDataFifo.empty())
+      // A timeout of 0 means no-block at all
+      if(timeout == 0 && mReceiveRing.empty())
       {
          // timeout
          return asio::error_code(flowmanager::ReceiveTimeout, asio::error::misc_category);
       }
 
-      recvTimeout = timeout ? timeout - (Timer::getTimeMs() - startTime) : 0;
-      if(timeout != 0 && recvTimeout <= 0)
+      UInt64 elapsed = Timer::getTimeMs() - startTime;
+      if(timeout != 0 && elapsed >= timeout)
       {
          // timeout
          return asio::error_code(flowmanager::ReceiveTimeout, asio::error::misc_category);
       }
-      ReceivedData* receivedData = mReceivedDataFifo.getNext(recvTimeout);  
+      recvTimeout = timeout ? timeout - (unsigned int)elapsed : 0;
+      FlowReceiveRing::Packet* receivedData = getNextReceivedData(recvTimeout);  
       if(receivedData)
       {
-         mFakeSelectSocketDescriptor.receive();
-
          // discard any data not from address/port requested
          if(address == receivedData->mAddress && port == receivedData->mPort)
          {
             errorCode = processReceivedData(buffer, size, receivedData);
             done = true;
          }
-         delete receivedData;
+         mReceiveRing.pop();
+         mFakeSelectSocketDescriptor.receive();
       }
       else
       {
@@ -358,25 +449,24 @@ Flow::receive(char* buffer, unsigned int& size, unsigned int timeout, asio::ip::
    asio::error_code errorCode;
 
    //InfoLog(<< "Flow::receive called with buffer size=" << size << ", timeout=" << timeout);
-   // We define timeout of 0 differently then TimeLimitFifo - we want 0 to mean no-block at all
-   if(timeout == 0 && mReceivedDataFifo.empty())
+   // A timeout of 0 means no-block at all
+   if(timeout == 0 && mReceiveRing.empty())
    {
       // timeout
       InfoLog(<< "Receive timeout (timeout==0 and fifo empty)!");
       return asio::error_code(flowmanager::ReceiveTimeout, asio::error::misc_category);
    }
-   if(mReceivedDataFifo.empty())
+   if(mReceiveRing.empty())
    {
       WarningLog(<< "Receive called when there is no data available!  ComponentId=" << mComponentId);
    }
 
-   ReceivedData* receivedData = mReceivedDataFifo.getNext(timeout);   
+   FlowReceiveRing::Packet* receivedData = getNextReceivedData(timeout);   
    if(receivedData)
    {
-      mFakeSelectSocketDescriptor.receive();
-
       errorCode = processReceivedData(buffer, size, receivedData, sourceAddress, sourcePort);
-      delete receivedData;
+      mReceiveRing.pop();
+      mFakeSelectSocketDescriptor.receive();
    }
    else
    {
@@ -387,16 +477,91 @@ Flow::receive(char* buffer, unsigned int& size, unsigned int timeout, asio::ip::
    return errorCode;
 }
 
+unsigned int 
+Flow::receiveBatch(SrtpPacket* packets, unsigned int numPackets, asio::ip::address* sourceAddresses, unsigned short* sourcePorts)
+{
+   bool mediaStreamSrtp = mMediaStream.mSRTPSessionInCreated;
+   unsigned int numReceived = 0;
+   unsigned int numPopped = 0;
+
+   FlowReceiveRing::Packet* receivedData;
+   while(numReceived < numPackets && (receivedData = mReceiveRing.front()) != 0)
+   {
+      SrtpPacket& packet = packets[numReceived];
+      if(packet.mSize < receivedData->mSize)
+      {
+         InfoLog(<< "Receive buffer too small for data size=" << receivedData->mSize << "  ComponentId=" << mComponentId);
+         mReceiveRing.pop();
+         numPopped++;
+         continue;
+      }
+      memcpy(packet.mData, receivedData->mData, receivedData->mSize);
+      packet.mSize = receivedData->mSize;
+      packet.mStatus = err_status_ok;
+
+      if(!mediaStreamSrtp)
+      {
+         // Dtls-Srtp sessions are per endpoint - unprotect now, while we know the endpoint
+         Lock lock(mMutex);
+         DtlsSocket* dtlsSocket = getDtlsSocket(StunTuple(mLocalBinding.getTransportType(), receivedData->mAddress, receivedData->mPort));
+         if(dtlsSocket)
+         {
+            if(((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->isSrtpInitialized())
+            {
+               ((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->srtpUnprotect(&packet, 1, mComponentId == RTCP_COMPONENT_ID);
+            }
+            else
+            {
+               // Handshake is not completed yet - discard
+               mReceiveRing.pop();
+               numPopped++;
+               continue;
+            }
+         }
+      }
+
+      if(sourceAddresses)
+      {
+         sourceAddresses[numReceived] = receivedData->mAddress;
+      }
+      if(sourcePorts)
+      {
+         sourcePorts[numReceived] = receivedData->mPort;
+      }
+      mReceiveRing.pop();
+      numPopped++;
+      numReceived++;
+   }
+   if(numPopped > 0)
+   {
+      mFakeSelectSocketDescriptor.receive(numPopped);
+   }
+
+   if(mediaStreamSrtp && numReceived > 0)
+   {
+      mMediaStream.srtpUnprotect(packets, numReceived, mComponentId == RTCP_COMPONENT_ID);
+   }
+
+   for(unsigned int i = 0; i < numReceived; i++)
+   {
+      if(packets[i].mStatus != err_status_ok)
+      {
+         ErrLog(<< "Unable to SRTP unprotect the packet (componentid=" << mComponentId << "), error code=" << packets[i].mStatus << "(" << srtp_error_string(packets[i].mStatus) << ")");
+      }
+   }
+   return numReceived;
+}
+
 asio::error_code 
-Flow::processReceivedData(char* buffer, unsigned int& size, ReceivedData* receivedData, asio::ip::address* sourceAddress, unsigned short* sourcePort)
+Flow::processReceivedData(char* buffer, unsigned int& size, FlowReceiveRing::Packet* receivedData, asio::ip::address* sourceAddress, unsigned short* sourcePort)
 {
    asio::error_code errorCode;
-   unsigned int receivedsize = receivedData->mData->size();
+   unsigned int receivedsize = receivedData->mSize;
 
    // SRTP Unprotect (if required)
    if(mMediaStream.mSRTPSessionInCreated)
    {
-      err_status_t status = mMediaStream.srtpUnprotect((void*)receivedData->mData->data(), (int*)&receivedsize, mComponentId == RTCP_COMPONENT_ID);
+      err_status_t status = mMediaStream.srtpUnprotect((void*)receivedData->mData, (int*)&receivedsize, mComponentId == RTCP_COMPONENT_ID);
       if(status != err_status_ok)
       {
          ErrLog(<< "Unable to SRTP unprotect the packet (componentid=" << mComponentId << "), error code=" << status << "(" << srtp_error_string(status) << ")");
@@ -411,7 +576,7 @@ Flow::processReceivedData(char* buffer, unsigned int& size, ReceivedData* receiv
       {
          if(((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->isSrtpInitialized())
          {
-            err_status_t status = ((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->srtpUnprotect((void*)receivedData->mData->data(), (int*)&receivedsize, mComponentId == RTCP_COMPONENT_ID);
+            err_status_t status = ((FlowDtlsSocketContext*)dtlsSocket->getSocketContext())->srtpUnprotect((void*)receivedData->mData, (int*)&receivedsize, mComponentId == RTCP_COMPONENT_ID);
             if(status != err_status_ok)
             {
                ErrLog(<< "Unable to SRTP unprotect the packet (componentid=" << mComponentId << "), error code=" << status << "(" << srtp_error_string(status) << ")");
@@ -431,7 +596,7 @@ Flow::processReceivedData(char* buffer, unsigned int& size, ReceivedData* receiv
       if(size > receivedsize)
       {
          size = receivedsize;
-         memcpy(buffer, receivedData->mData->data(), size);
+         memcpy(buffer, receivedData->mData, size);
          //InfoLog(<< "Received a buffer of size=" << receivedData->mData.size());
       }
       else
@@ -733,9 +898,11 @@ Flow::onReceiveSuccess(unsigned int socketDesc, const asio::ip::address& address
       return;
    }
 
-   if(!mReceivedDataFifo.add(new ReceivedData(address, port, data), ReceivedDataFifo::EnforceTimeDepth))
+   if(!mReceiveRing.push(address, port, data->data(), data->size()))
    {
-      WarningLog(<< "Flow::onReceiveSuccess: TimeLimitFifo is full - discarding data!  componentId=" << mComponentId);
+      WarningLog(<< "Flow::onReceiveSuccess: receive ring is full or data is too large - discarding data!  size=" << data->size() 
+                 << ", overflowDrops=" << mReceiveRing.getNumOverflowDrops() << ", tooLargeDrops=" << mReceiveRing.getNumTooLargeDrops() 
+                 << ", componentId=" << mComponentId);
    }
    else
    {
@@ -2,7 +2,6 @@
 #define Flow_hxx
 
 #include <map>
-#include <rutil/TimeLimitFifo.hxx>
 #include <rutil/Mutex.hxx>
 
 #include <srtp.h>
@@ -14,6 +13,8 @@
 #include "client/TurnAsyncSocketHandler.hxx"
 #include "StunMessage.hxx"
 #include "FakeSelectSocketDescriptor.hxx"
+#include "FlowReceiveRing.hxx"
+#include "FlowSrtpCrypto.hxx"
 #include "dtls_wrapper/DtlsSocket.hxx"
 
 
@@ -52,7 +53,9 @@ public:
         asio::ssl::context& sslContext,
         unsigned int componentId,
         const StunTuple& localBinding, 
-        MediaStream& mediaStream);
+        MediaStream& mediaStream,
+        unsigned int receiveRingDepth = FlowReceiveRing::DefaultDepth,
+        unsigned int receiveRingMaxPacketSize = FlowReceiveRing::DefaultMaxPacketSize);
    ~Flow();
 
    void activateFlow(UInt8 allocationProps = StunMessage::PropsNone);
@@ -75,10 +78,26 @@ public:
    void send(char* buffer, unsigned int size);
    void sendTo(const asio::ip::address& address, unsigned short port, char* buffer, unsigned int size);
    void rawSendTo(const asio::ip::address& address, unsigned short port, const char* buffer, unsigned int size);
+   /// Sends numPackets packets to the active destination, SRTP protecting them as a batch (a single 
+   /// session lookup and lock for all of them).  Packets that cannot be protected are not sent, and
+   /// have their mStatus set.  The same buffer WARNING as for send applies to each packet.
+   void sendBatch(SrtpPacket* packets, unsigned int numPackets);
 
    /// Receive Methods
+   /// Received data is queued in a ring of receiveRingDepth packets (see FlowReceiveRing) - only one
+   /// thread at a time may call the receive methods.
    asio::error_code receive(char* buffer, unsigned int& size, unsigned int timeout, asio::ip::address* sourceAddress=0, unsigned short* sourcePort=0);
    asio::error_code receiveFrom(const asio::ip::address& address, unsigned short port, char* buffer, unsigned int& size, unsigned int timeout);
+   /// Non-blocking receive of up to numPackets packets - returns the number of packets received.  On input
+   /// each packet's mSize is the size of its buffer; on output it is the size of the received data (SRTP 
+   /// unprotected as a batch, if required), and mStatus is the result of the SRTP unprotection.  Packets
+   /// that do not fit in the buffer are discarded.
+   unsigned int receiveBatch(SrtpPacket* packets, unsigned int numPackets, asio::ip::address* sourceAddresses=0, unsigned short* sourcePorts=0);
+
+   /// Number of received packets discarded because the receive ring was full / because they were larger 
+   /// than receiveRingMaxPacketSize
+   unsigned long getNumReceiveOverflowDrops() const { return mReceiveRing.getNumOverflowDrops(); }
+   unsigned long getNumReceiveTooLargeDrops() const { return mReceiveRing.getNumTooLargeDrops(); }
 
    /// Used to set where this flow should be sending to
    void setActiveDestination(const char* address, unsigned short port);
@@ -140,24 +159,15 @@ private:
    void changeFlowState(FlowState newState);
    char* flowStateToString(FlowState state);
 
-   class ReceivedData
-   {
-   public:
-      ReceivedData(const asio::ip::address& address, unsigned short port, boost::shared_ptr<DataBuffer>& data) :
-         mAddress(address), mPort(port), mData(data) {}
-      ~ReceivedData() {}
-
-      asio::ip::address mAddress;
-      unsigned short mPort;
-      boost::shared_ptr<DataBuffer> mData;
-   };
-   // FIFO for received data
-   typedef resip::TimeLimitFifo<ReceivedData> ReceivedDataFifo;
-   ReceivedDataFifo mReceivedDataFifo; 
+   // Ring for received data - filled by the io service thread, emptied by the receive methods
+   FlowReceiveRing mReceiveRing;
+   // Returns the next received packet, waiting up to timeout ms (0 for no wait) - returns 0 on timeout
+   FlowReceiveRing::Packet* getNextReceivedData(unsigned int timeout);
 
    // Helpers to perform SRTP protection/unprotection
    bool processSendData(char* buffer, unsigned int& size, const asio::ip::address& address, unsigned short port);
-   asio::error_code processReceivedData(char* buffer, unsigned int& size, ReceivedData* receivedData, asio::ip::address* sourceAddress=0, unsigned short* sourcePort=0);
+   void processSendData(SrtpPacket* packets, unsigned int numPackets, const asio::ip::address& address, unsigned short port);
+   asio::error_code processReceivedData(char* buffer, unsigned int& size, FlowReceiveRing::Packet* receivedData, asio::ip::address* sourceAddress=0, unsigned short* sourcePort=0);
 
    FakeSelectSocketDescriptor mFakeSelectSocketDescriptor;
 
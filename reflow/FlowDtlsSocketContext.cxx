@@ -142,6 +142,34 @@ FlowDtlsSocketContext::srtpUnprotect(void* data, int* size, bool rtcp)
    return status;
 }
 
+unsigned int 
+FlowDtlsSocketContext::srtpProtect(SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   if(mSrtpInitialized)
+   {
+      return FlowSrtpCrypto::protect(mSRTPSessionOut, packets, numPackets, rtcp);
+   }
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      packets[i].mStatus = err_status_no_ctx;
+   }
+   return 0;
+}
+
+unsigned int 
+FlowDtlsSocketContext::srtpUnprotect(SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   if(mSrtpInitialized)
+   {
+      return FlowSrtpCrypto::unprotect(mSRTPSessionIn, packets, numPackets, rtcp);
+   }
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      packets[i].mStatus = err_status_no_ctx;
+   }
+   return 0;
+}
+
 
 /* ====================================================================
 
@@ -6,6 +6,7 @@
 
 #include "dtls_wrapper/DtlsSocket.hxx"
 #include "Flow.hxx"
+#include "FlowSrtpCrypto.hxx"
 
 /**
   This class is used during media sessions that use Dtls-Srtp
@@ -37,6 +38,8 @@ public:
 
    err_status_t srtpProtect(void* data, int* size, bool rtcp);
    err_status_t srtpUnprotect(void* data, int* size, bool rtcp);
+   unsigned int srtpProtect(SrtpPacket* packets, unsigned int numPackets, bool rtcp);
+   unsigned int srtpUnprotect(SrtpPacket* packets, unsigned int numPackets, bool rtcp);
 
 private:   
    Flow& mFlow;
@@ -20,6 +20,14 @@ FlowDtlsTimerContext::FlowDtlsTimerContext(asio::io_service& ioService) :
 
 void 
 FlowDtlsTimerContext::addTimer(dtls::DtlsTimer *timer, unsigned int durationMs) 
+{
+   // Runs immediately if called from the io service thread, otherwise is queued to it - so that
+   // mDeadlineTimers is only ever used from that thread
+   mIOService.dispatch(boost::bind(&FlowDtlsTimerContext::doAddTimer, this, timer, durationMs));
+}
+
+void 
+FlowDtlsTimerContext::doAddTimer(dtls::DtlsTimer *timer, unsigned int durationMs) 
 {
    resip::SharedPtr<asio::deadline_timer> deadlineTimer(new asio::deadline_timer(mIOService));
    deadlineTimer->expires_from_now(boost::posix_time::milliseconds(durationMs));
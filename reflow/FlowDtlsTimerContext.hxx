@@ -9,6 +9,11 @@
   This class is used to provide timer logic to the dtls
   wrapper code, so that DTLS messages can be retransmitted.
 
+  Timers are started and fired on the thread running ioService,
+  even if addTimer is called from another thread - so there is
+  one FlowDtlsTimerContext (and DtlsFactory) per FlowManager
+  io service thread.
+
   Author: Scott Godin (sgodin AT SipSpectrum DOT com)
 */
 namespace flowmanager
@@ -22,6 +27,8 @@ class FlowDtlsTimerContext: public dtls::DtlsTimerContext
      void handleTimeout(dtls::DtlsTimer *timer, const asio::error_code& errorCode);
 
    private:
+     void doAddTimer(dtls::DtlsTimer *timer, unsigned int durationMs);
+
      asio::io_service& mIOService;
      std::map<dtls::DtlsTimer*, resip::SharedPtr<asio::deadline_timer> > mDeadlineTimers;  
 };
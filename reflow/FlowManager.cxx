@@ -4,6 +4,7 @@
 #include <rutil/Log.hxx>
 #include <rutil/Logger.hxx>
 #include <rutil/ThreadIf.hxx>
+#include <rutil/Lock.hxx>
 #include <rutil/Random.hxx>
 #include <rutil/SharedPtr.hxx>
 
@@ -15,6 +16,7 @@
 #include "FlowManagerSubsystem.hxx"
 #include "FlowManager.hxx"
 #include "FlowDtlsTimerContext.hxx"
+#include "FlowSrtpCrypto.hxx"
 
 using namespace flowmanager;
 using namespace resip;
@@ -28,28 +30,49 @@ namespace flowmanager
 class IOServiceThread : public ThreadIf
 {
 public:
-   IOServiceThread(asio::io_service& ioService) : mIOService(ioService) {}
+   IOServiceThread() : mDtlsFactory(0) 
+   {
+      mIOServiceWork = new asio::io_service::work(mIOService);
+   }
 
-   virtual ~IOServiceThread() {}
+   virtual ~IOServiceThread() 
+   {
+      delete mIOServiceWork;
+      if(mDtlsFactory) delete mDtlsFactory;
+   }
 
    virtual void thread()
    {
       mIOService.run();
    }
-private:
-   asio::io_service& mIOService;
+
+   // Lets the io service run out of work, so that the thread ends once all outstanding operations are complete
+   void stop()
+   {
+      delete mIOServiceWork;
+      mIOServiceWork = 0;
+   }
+
+   asio::io_service mIOService;
+   asio::io_service::work* mIOServiceWork;
+   dtls::DtlsFactory* mDtlsFactory;
 };
 }
 
-FlowManager::FlowManager() : 
-   mSslContext(mIOService, asio::ssl::context::tlsv1),
+FlowManager::FlowManager(unsigned int numIOServiceThreads) : 
+   mIOServiceThreads(createIOServiceThreads(numIOServiceThreads)),
+   mNextIOServiceThread(0),
+   mSslContext(mIOServiceThreads[0]->mIOService, asio::ssl::context::tlsv1),
+   mReceiveRingDepth(FlowReceiveRing::DefaultDepth),
+   mReceiveRingMaxPacketSize(FlowReceiveRing::DefaultMaxPacketSize),
    mClientCert(0),
    mClientKey(0),
    mDtlsFactory(0)
 {
-   mIOServiceWork = new asio::io_service::work(mIOService);
-   mIOServiceThread = new IOServiceThread(mIOService);
-   mIOServiceThread->run();
+   for(unsigned int i = 0; i < mIOServiceThreads.size(); i++)
+   {
+      mIOServiceThreads[i]->run();
+   }
 
    // Setup SSL context
    asio::error_code ec;
@@ -70,19 +93,36 @@ FlowManager::FlowManager() :
       throw FlowManagerException("Unable to initialize SRTP engine", __FILE__, __LINE__);
    }
    status = srtp_install_event_handler(FlowManager::srtpEventHandler);
+
+   // Use OpenSSL's AES and SHA1 for SRTP, if available - they are much faster than the srtp library's own
+   FlowSrtpCrypto::installOpenSslCrypto();
 }
 
 FlowManager::~FlowManager()
 {
-   delete mIOServiceWork;
-   mIOServiceThread->join();
-   delete mIOServiceThread;
+   unsigned int i;
+   for(i = 0; i < mIOServiceThreads.size(); i++)
+   {
+      mIOServiceThreads[i]->stop();
+   }
+   for(i = 0; i < mIOServiceThreads.size(); i++)
+   {
+      mIOServiceThreads[i]->join();
+      delete mIOServiceThreads[i];  // Note:  deletes the thread's DtlsFactory
+   }
 
-   if(mDtlsFactory) delete mDtlsFactory;
    if(mClientCert) X509_free(mClientCert);
    if(mClientKey) EVP_PKEY_free(mClientKey);
 }
 
+void 
+FlowManager::setReceiveRingSize(unsigned int depth, unsigned int maxPacketSize)
+{
+   Lock lock(mMutex);
+   mReceiveRingDepth = depth;
+   mReceiveRingMaxPacketSize = maxPacketSize;
+}
+
 void 
 FlowManager::initializeDtlsFactory(const char* certAor)
 {
@@ -95,9 +135,14 @@ FlowManager::initializeDtlsFactory(const char* certAor)
    Data aor(certAor);  
    if(createCert(aor, 365 /* expireDays */, 1024 /* keyLen */, mClientCert, mClientKey))
    {
-      FlowDtlsTimerContext* timerContext = new FlowDtlsTimerContext(mIOService);
-      mDtlsFactory = new DtlsFactory(std::auto_ptr<DtlsTimerContext>(timerContext), mClientCert, mClientKey);
-      assert(mDtlsFactory);
+      // Each thread gets its own DtlsFactory, so that DTLS timers fire in the thread doing the dtls processing
+      for(unsigned int i = 0; i < mIOServiceThreads.size(); i++)
+      {
+         FlowDtlsTimerContext* timerContext = new FlowDtlsTimerContext(mIOServiceThreads[i]->mIOService);
+         mIOServiceThreads[i]->mDtlsFactory = new DtlsFactory(std::auto_ptr<DtlsTimerContext>(timerContext), mClientCert, mClientKey);
+         assert(mIOServiceThreads[i]->mDtlsFactory);
+      }
+      mDtlsFactory = mIOServiceThreads[0]->mDtlsFactory;
    }
    else
    {
@@ -136,22 +181,47 @@ FlowManager::createMediaStream(MediaStreamHandler& mediaStreamHandler,
                                const char* stunUsername,
                                const char* stunPassword)
 {
+   // Assign the MediaStream to the next io service thread - it will stay on this thread for its lifetime
+   IOServiceThread* ioServiceThread;
+   unsigned int receiveRingDepth;
+   unsigned int receiveRingMaxPacketSize;
+   {
+      Lock lock(mMutex);
+      ioServiceThread = mIOServiceThreads[mNextIOServiceThread];
+      mNextIOServiceThread = (mNextIOServiceThread + 1) % mIOServiceThreads.size();
+      receiveRingDepth = mReceiveRingDepth;
+      receiveRingMaxPacketSize = mReceiveRingMaxPacketSize;
+   }
+
    MediaStream* newMediaStream = 0;
    if(rtcpEnabled)
    {
       StunTuple localRtcpBinding(localBinding.getTransportType(), localBinding.getAddress(), localBinding.getPort() + 1);
-      newMediaStream = new MediaStream(mIOService, mSslContext, mediaStreamHandler, localBinding, localRtcpBinding, mDtlsFactory,
-                                       natTraversalMode, natTraversalServerHostname, natTraversalServerPort, stunUsername, stunPassword);
+      newMediaStream = new MediaStream(ioServiceThread->mIOService, mSslContext, mediaStreamHandler, localBinding, localRtcpBinding, ioServiceThread->mDtlsFactory,
+                                       natTraversalMode, natTraversalServerHostname, natTraversalServerPort, stunUsername, stunPassword,
+                                       receiveRingDepth, receiveRingMaxPacketSize);
    }
    else
    {
       StunTuple rtcpDisabled;  // Default constructor sets transport type to None - this signals Rtcp is disabled
-      newMediaStream = new MediaStream(mIOService, mSslContext, mediaStreamHandler, localBinding, rtcpDisabled, mDtlsFactory,
-                                       natTraversalMode, natTraversalServerHostname, natTraversalServerPort, stunUsername, stunPassword);
+      newMediaStream = new MediaStream(ioServiceThread->mIOService, mSslContext, mediaStreamHandler, localBinding, rtcpDisabled, ioServiceThread->mDtlsFactory,
+                                       natTraversalMode, natTraversalServerHostname, natTraversalServerPort, stunUsername, stunPassword,
+                                       receiveRingDepth, receiveRingMaxPacketSize);
    }
    return newMediaStream;
 }
 
+std::vector<IOServiceThread*> 
+FlowManager::createIOServiceThreads(unsigned int numIOServiceThreads)
+{
+   std::vector<IOServiceThread*> ioServiceThreads;
+   for(unsigned int i = 0; i < numIOServiceThreads || i == 0; i++)  // always at least one thread
+   {
+      ioServiceThreads.push_back(new IOServiceThread);
+   }
+   return ioServiceThreads;
+}
+
 int 
 FlowManager::createCert(const resip::Data& pAor, int expireDays, int keyLen, X509*& outCert, EVP_PKEY*& outKey )
 {
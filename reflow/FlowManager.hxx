@@ -9,6 +9,8 @@
 #include <openssl/ssl.h>
 
 #include <map>
+#include <vector>
+#include <rutil/Mutex.hxx>
 
 using namespace reTurn;
 
@@ -19,9 +21,13 @@ namespace flowmanager
   This class represents the Flow Manager.  It is responsible for sending/receiving
   media and performing the necessary NAT traversal.  
   
-  Threading Notes:  This class implements a thread
-  to manage the asyncrouns reTurn client library calls.  Essentially all
-  asyncrounous operations for all Flows will be called from this one thread.
+  Threading Notes:  This class implements a pool of threads (one by default),
+  each running its own asio io service, to manage the asyncrouns reTurn client
+  library calls.  Each MediaStream is assigned to one of the threads (round robin)
+  when it is created, and all asyncrounous operations for its Flows, including
+  DTLS timers, will be called from this one thread for the lifetime of the 
+  MediaStream.  Each thread has its own DtlsFactory - they all use the same
+  certificate.
 
   Author: Scott Godin (sgodin AT SipSpectrum DOT com)
 */
@@ -30,7 +36,7 @@ class IOServiceThread;
 class FlowManager
 {
 public:  
-   FlowManager();  // throws FlowManagerException
+   FlowManager(unsigned int numIOServiceThreads = 1);  // throws FlowManagerException
    virtual ~FlowManager();
 
    // This API assumes that RTCP localBinding is always the same as RTP binding but add one to the port number
@@ -44,8 +50,18 @@ public:
                                   const char* stunUsername = 0,
                                   const char* stunPassword = 0);
 
+   // Sets the number of received packets each Flow of the MediaStreams created from now on can queue, and
+   // the largest packet size it can queue (see FlowReceiveRing) - the memory is allocated up front.  Each
+   // Flow takes depth * maxPacketSize bytes, and a MediaStream with RTCP enabled has two Flows:  the
+   // defaults (64 * 1500 bytes) come to 192000 bytes per MediaStream.  Streams that receive large bursts
+   // (e.g. video key frames) need a deeper ring; packets that don't fit are dropped and counted.
+   void setReceiveRingSize(unsigned int depth, unsigned int maxPacketSize);
+
    void initializeDtlsFactory(const char* certAor);
+   // Returns the DtlsFactory of the first io service thread - since all DtlsFactories use the same
+   // certificate, this can be used to get the certificate fingerprint
    dtls::DtlsFactory* getDtlsFactory() { return mDtlsFactory; }
+   unsigned int getNumIOServiceThreads() const { return (unsigned int)mIOServiceThreads.size(); }
 
 protected: 
 
@@ -53,14 +69,18 @@ private:
    static int createCert (const resip::Data& pAor, int expireDays, int keyLen, X509*& outCert, EVP_PKEY*& outKey );
    static void srtpEventHandler(srtp_event_data_t *data);
 
-   // Member variables used to manager asio io service thread
-   asio::io_service mIOService;
-   IOServiceThread* mIOServiceThread;
-   asio::io_service::work* mIOServiceWork;
+   static std::vector<IOServiceThread*> createIOServiceThreads(unsigned int numIOServiceThreads);
+
+   // Member variables used to manager asio io service threads
+   std::vector<IOServiceThread*> mIOServiceThreads;
+   unsigned int mNextIOServiceThread;
+   resip::Mutex mMutex;
    asio::ssl::context mSslContext;
+   unsigned int mReceiveRingDepth;
+   unsigned int mReceiveRingMaxPacketSize;
    X509* mClientCert;
    EVP_PKEY* mClientKey;
-   dtls::DtlsFactory* mDtlsFactory;
+   dtls::DtlsFactory* mDtlsFactory;  // DtlsFactory of the first thread - owned by the thread
 };
 
 }
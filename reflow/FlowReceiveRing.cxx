@@ -0,0 +1,130 @@
+#include <string.h>
+#include <assert.h>
+
+#include "FlowReceiveRing.hxx"
+
+using namespace flowmanager;
+using namespace resip;
+
+FlowReceiveRing::FlowReceiveRing(unsigned int depth, unsigned int maxPacketSize) :
+   mDepth(depth ? depth : 1),
+   mMaxPacketSize(maxPacketSize),
+   mPackets(new Packet[mDepth]),
+   mBuffer(new char[mDepth * mMaxPacketSize]),
+   mProducerTail(0),
+   mProducerCachedHead(0),
+   mConsumerHead(0),
+   mConsumerCachedTail(0)
+{
+   for(unsigned int i = 0; i < mDepth; i++)
+   {
+      mPackets[i].mPort = 0;
+      mPackets[i].mData = &mBuffer[i * mMaxPacketSize];
+      mPackets[i].mSize = 0;
+   }
+}
+
+FlowReceiveRing::~FlowReceiveRing()
+{
+   delete [] mPackets;
+   delete [] mBuffer;
+}
+
+bool 
+FlowReceiveRing::push(const asio::ip::address& address, unsigned short port, const char* data, unsigned int size)
+{
+   if(size > mMaxPacketSize)
+   {
+      mNumTooLargeDrops.increment();
+      return false;
+   }
+   if(mProducerTail - mProducerCachedHead >= mDepth)
+   {
+      // Looks full - see how far the consumer has got
+      mProducerCachedHead = (unsigned long)mHead.value();
+      if(mProducerTail - mProducerCachedHead >= mDepth)
+      {
+         mNumOverflowDrops.increment();
+         return false;
+      }
+   }
+
+   Packet& packet = mPackets[mProducerTail % mDepth];
+   packet.mAddress = address;
+   packet.mPort = port;
+   memcpy(packet.mData, data, size);
+   packet.mSize = size;
+
+   // Publish the packet - the atomic increment is a full memory barrier, so the consumer will see the 
+   // slot contents before it sees the new tail
+   mProducerTail++;
+   mTail.increment();
+   return true;
+}
+
+FlowReceiveRing::Packet* 
+FlowReceiveRing::front()
+{
+   if(mConsumerHead == mConsumerCachedTail)
+   {
+      // Looks empty - see if the producer has added any packets
+      mConsumerCachedTail = (unsigned long)mTail.value();
+      if(mConsumerHead == mConsumerCachedTail)
+      {
+         return 0;
+      }
+   }
+   return &mPackets[mConsumerHead % mDepth];
+}
+
+void 
+FlowReceiveRing::pop()
+{
+   assert(mConsumerHead != mConsumerCachedTail);  // front must have returned a packet
+   // Release the slot back to the producer - after we are done with its contents
+   mConsumerHead++;
+   mHead.increment();
+}
+
+unsigned int 
+FlowReceiveRing::size() const
+{
+   // Read head first, so that the result can never be negative
+   unsigned long head = (unsigned long)mHead.value();
+   return (unsigned int)((unsigned long)mTail.value() - head);
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
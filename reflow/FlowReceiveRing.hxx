@@ -0,0 +1,129 @@
+#if !defined(FlowReceiveRing_hxx)
+#define FlowReceiveRing_hxx
+
+#include <asio.hpp>
+#include <rutil/AtomicCounter.hxx>
+
+namespace flowmanager
+{
+
+/**
+  This class is a lock-free single producer/single consumer ring of received
+  packets, used by Flow to pass data from its io service thread (the producer)
+  to the thread calling receive (the consumer).
+
+  All packet buffers are allocated when the ring is created, so queuing a 
+  packet is a copy into the next free slot - there are no allocations and 
+  no locks.  Packets that arrive when the ring is full, or that are larger
+  than the slots, are discarded and counted.
+
+  Threading Notes:  push may only be called from one thread, and front/pop 
+  may only be called from one (other) thread.  empty, size and the drop
+  counters may be called from any thread.
+*/
+class FlowReceiveRing
+{
+public:
+   // The default ring takes DefaultDepth * DefaultMaxPacketSize = 96000 bytes per Flow
+   enum 
+   { 
+      DefaultDepth = 64,           // 1.28 seconds of 20ms RTP packets, or a burst of 64 video packets
+      DefaultMaxPacketSize = 1500  // an Ethernet MTU - larger RTP/SRTP packets would be fragmented
+   };
+
+   class Packet
+   {
+   public:
+      asio::ip::address mAddress;
+      unsigned short mPort;
+      char* mData;
+      unsigned int mSize;
+   };
+
+   FlowReceiveRing(unsigned int depth = DefaultDepth, unsigned int maxPacketSize = DefaultMaxPacketSize);
+   ~FlowReceiveRing();
+
+   unsigned int getDepth() const { return mDepth; }
+   unsigned int getMaxPacketSize() const { return mMaxPacketSize; }
+
+   /// Producer: copies the packet into the next free slot - returns false if the packet was discarded
+   bool push(const asio::ip::address& address, unsigned short port, const char* data, unsigned int size);
+
+   /// Consumer: returns the oldest packet, or 0 if the ring is empty.  The packet (which may be modified
+   /// in place) remains valid until pop is called.
+   Packet* front();
+   /// Consumer: releases the oldest packet's slot
+   void pop();
+
+   bool empty() const { return size() == 0; }
+   unsigned int size() const;
+
+   /// Number of packets discarded because the ring was full / because they were larger than getMaxPacketSize
+   unsigned long getNumOverflowDrops() const { return (unsigned long)mNumOverflowDrops.value(); }
+   unsigned long getNumTooLargeDrops() const { return (unsigned long)mNumTooLargeDrops.value(); }
+
+private:
+   const unsigned int mDepth;
+   const unsigned int mMaxPacketSize;
+   Packet* mPackets;
+   char* mBuffer;
+
+   // Total number of packets pushed - only written by the producer.  The producer's own copy avoids 
+   // reading it back through a memory barrier.
+   resip::AtomicCounter mTail;
+   unsigned long mProducerTail;
+   unsigned long mProducerCachedHead;  // last value of mHead seen by the producer
+   char mProducerPad[64];              // keep the producer's and consumer's members on separate cache lines
+
+   // Total number of packets popped - only written by the consumer
+   resip::AtomicCounter mHead;
+   unsigned long mConsumerHead;
+   unsigned long mConsumerCachedTail;  // last value of mTail seen by the consumer
+   char mConsumerPad[64];
+
+   resip::AtomicCounter mNumOverflowDrops;
+   resip::AtomicCounter mNumTooLargeDrops;
+
+   // no value semantics
+   FlowReceiveRing(const FlowReceiveRing&);
+   FlowReceiveRing& operator=(const FlowReceiveRing&);
+};
+
+}
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -0,0 +1,453 @@
+// The low level SHA1 functions are deprecated as of OpenSSL 3.0, but (unlike EVP_MD_CTX) their
+// contexts can be copied without allocating - which the per packet HMAC relies on
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/opensslv.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <rutil/Lock.hxx>
+#include <rutil/Mutex.hxx>
+#include <rutil/Log.hxx>
+#include <rutil/Logger.hxx>
+
+#include "FlowSrtpCrypto.hxx"
+#include "FlowManagerSubsystem.hxx"
+
+extern "C"
+{
+#include <aes_icm.h>
+#include <hmac.h>
+#include <alloc.h>
+
+extern cipher_type_t aes_icm;
+extern auth_type_t hmac;
+}
+
+using namespace flowmanager;
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM FlowManagerSubsystem::FLOWMANAGER
+
+#if OPENSSL_VERSION_NUMBER >= 0x10001000L  // EVP_aes_128_ctr was added in OpenSSL 1.0.1
+#define FLOW_SRTP_OPENSSL_CRYPTO
+#endif
+
+#ifdef FLOW_SRTP_OPENSSL_CRYPTO
+
+// AES counter mode on OpenSSL
+//
+// Note:  the srtp library sets the iv of AES counter mode ciphers by calling aes_icm_set_iv on the
+//        cipher state directly, so the state must start with an aes_icm_ctx_t.  The counter in it is
+//        the source of truth - whole blocks are encrypted by OpenSSL from the counter, and the
+//        counter is then advanced as aes_icm would have.  Partial blocks (the tail of a packet, or
+//        continuing a partially used block) are left to aes_icm, using the key it expanded in init.
+typedef struct
+{
+   aes_icm_ctx_t icm;
+   EVP_CIPHER_CTX* evp;
+} openssl_aes_icm_ctx_t;
+
+static err_status_t
+openssl_aes_icm_alloc(cipher_t** c, int key_len)
+{
+   // Salted 128 bit keys only (as aes_icm)
+   if(key_len != 30)
+   {
+      return err_status_bad_param;
+   }
+
+   uint8_t* pointer = (uint8_t*)crypto_alloc(sizeof(cipher_t) + sizeof(openssl_aes_icm_ctx_t));
+   if(pointer == 0)
+   {
+      return err_status_alloc_fail;
+   }
+
+   openssl_aes_icm_ctx_t* state = (openssl_aes_icm_ctx_t*)(pointer + sizeof(cipher_t));
+   state->evp = EVP_CIPHER_CTX_new();
+   if(state->evp == 0)
+   {
+      crypto_free(pointer);
+      return err_status_alloc_fail;
+   }
+
+   *c = (cipher_t*)pointer;
+   (*c)->type = &aes_icm;
+   (*c)->state = state;
+   (*c)->key_len = key_len;
+   aes_icm.ref_count++;
+
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_aes_icm_dealloc(cipher_t* c)
+{
+   EVP_CIPHER_CTX_free(((openssl_aes_icm_ctx_t*)c->state)->evp);
+
+   octet_string_set_to_zero((uint8_t*)c, sizeof(cipher_t) + sizeof(openssl_aes_icm_ctx_t));
+   crypto_free(c);
+   aes_icm.ref_count--;
+
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_aes_icm_init(openssl_aes_icm_ctx_t* c, const uint8_t* key, cipher_direction_t dir)
+{
+   // Key is 16 bytes of AES key followed by the salt - aes_icm derives the counter offset from the salt
+   err_status_t status = aes_icm_context_init(&c->icm, key);
+   if(status != err_status_ok)
+   {
+      return status;
+   }
+   if(!EVP_EncryptInit_ex(c->evp, EVP_aes_128_ctr(), 0, key, 0))
+   {
+      return err_status_init_fail;
+   }
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_aes_icm_encrypt(openssl_aes_icm_ctx_t* c, unsigned char* buf, unsigned int* enc_len)
+{
+   unsigned int blockBytes = *enc_len & ~(sizeof(v128_t) - 1);
+   if(c->icm.bytes_in_buffer != 0 || blockBytes == 0)
+   {
+      return aes_icm_encrypt(&c->icm, buf, enc_len);
+   }
+
+   // Same segment check as aes_icm - this also ensures that OpenSSL's 128 bit counter never carries
+   // out of the 16 bit block index that aes_icm increments
+   if(*enc_len + htons(c->icm.counter.v16[7]) > 0xffff)
+   {
+      return err_status_terminus;
+   }
+
+   int outLen;
+   if(!EVP_EncryptInit_ex(c->evp, 0, 0, 0, c->icm.counter.v8) ||
+      !EVP_EncryptUpdate(c->evp, buf, &outLen, buf, blockBytes))
+   {
+      return err_status_cipher_fail;
+   }
+   c->icm.counter.v16[7] = htons(ntohs(c->icm.counter.v16[7]) + (blockBytes / sizeof(v128_t)));
+
+   unsigned int tailBytes = *enc_len - blockBytes;
+   if(tailBytes)
+   {
+      return aes_icm_encrypt(&c->icm, buf + blockBytes, &tailBytes);
+   }
+   return err_status_ok;
+}
+
+// HMAC-SHA1 on OpenSSL - the inner and outer hash states of the key are computed once in init, so
+// that each packet only costs a copy of each
+typedef struct
+{
+   SHA_CTX inner;
+   SHA_CTX outer;
+   SHA_CTX ctx;
+} openssl_hmac_ctx_t;
+
+static err_status_t
+openssl_hmac_alloc(auth_t** a, int key_len, int out_len)
+{
+   // Keys and tags of up to 20 bytes only (as hmac)
+   if(key_len > 20 || out_len > 20)
+   {
+      return err_status_bad_param;
+   }
+
+   uint8_t* pointer = (uint8_t*)crypto_alloc(sizeof(auth_t) + sizeof(openssl_hmac_ctx_t));
+   if(pointer == 0)
+   {
+      return err_status_alloc_fail;
+   }
+
+   *a = (auth_t*)pointer;
+   (*a)->type = &hmac;
+   (*a)->state = pointer + sizeof(auth_t);
+   (*a)->out_len = out_len;
+   (*a)->key_len = key_len;
+   (*a)->prefix_len = 0;
+   hmac.ref_count++;
+
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_hmac_dealloc(auth_t* a)
+{
+   octet_string_set_to_zero((uint8_t*)a, sizeof(auth_t) + sizeof(openssl_hmac_ctx_t));
+   crypto_free(a);
+   hmac.ref_count--;
+
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_hmac_init(openssl_hmac_ctx_t* state, const uint8_t* key, int key_len)
+{
+   if(key_len > 20)
+   {
+      return err_status_bad_param;
+   }
+
+   uint8_t ipad[64];
+   uint8_t opad[64];
+   int i;
+   for(i = 0; i < key_len; i++)
+   {
+      ipad[i] = key[i] ^ 0x36;
+      opad[i] = key[i] ^ 0x5c;
+   }
+   for(; i < 64; i++)
+   {
+      ipad[i] = 0x36;
+      opad[i] = 0x5c;
+   }
+
+   SHA1_Init(&state->inner);
+   SHA1_Update(&state->inner, ipad, sizeof(ipad));
+   SHA1_Init(&state->outer);
+   SHA1_Update(&state->outer, opad, sizeof(opad));
+   state->ctx = state->inner;
+
+   octet_string_set_to_zero(ipad, sizeof(ipad));
+   octet_string_set_to_zero(opad, sizeof(opad));
+
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_hmac_start(openssl_hmac_ctx_t* state)
+{
+   state->ctx = state->inner;
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_hmac_update(openssl_hmac_ctx_t* state, const uint8_t* message, int msg_octets)
+{
+   SHA1_Update(&state->ctx, message, msg_octets);
+   return err_status_ok;
+}
+
+static err_status_t
+openssl_hmac_compute(openssl_hmac_ctx_t* state, const void* message, int msg_octets, int tag_len, uint8_t* result)
+{
+   if(tag_len > 20)
+   {
+      return err_status_bad_param;
+   }
+
+   unsigned char hash[SHA_DIGEST_LENGTH];
+   SHA1_Update(&state->ctx, message, msg_octets);
+   SHA1_Final(hash, &state->ctx);
+
+   state->ctx = state->outer;
+   SHA1_Update(&state->ctx, hash, sizeof(hash));
+   SHA1_Final(hash, &state->ctx);
+
+   memcpy(result, hash, tag_len);
+   return err_status_ok;
+}
+
+#endif
+
+// The srtp library's own functions - restored on uninstall
+static cipher_alloc_func_t srtpAesIcmAlloc;
+static cipher_dealloc_func_t srtpAesIcmDealloc;
+static cipher_init_func_t srtpAesIcmInit;
+static cipher_encrypt_func_t srtpAesIcmEncrypt;
+static cipher_decrypt_func_t srtpAesIcmDecrypt;
+static auth_alloc_func srtpHmacAlloc;
+static auth_dealloc_func srtpHmacDealloc;
+static auth_init_func srtpHmacInit;
+static auth_compute_func srtpHmacCompute;
+static auth_update_func srtpHmacUpdate;
+static auth_start_func srtpHmacStart;
+static bool openSslCryptoInstalled = false;
+static Mutex openSslCryptoMutex;
+
+static void
+restoreSrtpCrypto()
+{
+   aes_icm.alloc = srtpAesIcmAlloc;
+   aes_icm.dealloc = srtpAesIcmDealloc;
+   aes_icm.init = srtpAesIcmInit;
+   aes_icm.encrypt = srtpAesIcmEncrypt;
+   aes_icm.decrypt = srtpAesIcmDecrypt;
+   hmac.alloc = srtpHmacAlloc;
+   hmac.dealloc = srtpHmacDealloc;
+   hmac.init = srtpHmacInit;
+   hmac.compute = srtpHmacCompute;
+   hmac.update = srtpHmacUpdate;
+   hmac.start = srtpHmacStart;
+}
+
+unsigned int
+FlowSrtpCrypto::protect(srtp_t session, SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   unsigned int numProtected = 0;
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      SrtpPacket& packet = packets[i];
+      if(rtcp)
+      {
+         packet.mStatus = srtp_protect_rtcp(session, packet.mData, (int*)&packet.mSize);
+      }
+      else
+      {
+         packet.mStatus = srtp_protect(session, packet.mData, (int*)&packet.mSize);
+      }
+      if(packet.mStatus == err_status_ok)
+      {
+         numProtected++;
+      }
+   }
+   return numProtected;
+}
+
+unsigned int
+FlowSrtpCrypto::unprotect(srtp_t session, SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   unsigned int numUnprotected = 0;
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      SrtpPacket& packet = packets[i];
+      if(rtcp)
+      {
+         packet.mStatus = srtp_unprotect_rtcp(session, packet.mData, (int*)&packet.mSize);
+      }
+      else
+      {
+         packet.mStatus = srtp_unprotect(session, packet.mData, (int*)&packet.mSize);
+      }
+      if(packet.mStatus == err_status_ok)
+      {
+         numUnprotected++;
+      }
+   }
+   return numUnprotected;
+}
+
+bool
+FlowSrtpCrypto::installOpenSslCrypto()
+{
+#ifdef FLOW_SRTP_OPENSSL_CRYPTO
+   Lock lock(openSslCryptoMutex);
+   if(openSslCryptoInstalled)
+   {
+      return true;
+   }
+   if(aes_icm.ref_count != 0 || hmac.ref_count != 0)
+   {
+      WarningLog(<< "Unable to switch to OpenSSL SRTP crypto while SRTP sessions exist");
+      return false;
+   }
+
+   srtpAesIcmAlloc = aes_icm.alloc;
+   srtpAesIcmDealloc = aes_icm.dealloc;
+   srtpAesIcmInit = aes_icm.init;
+   srtpAesIcmEncrypt = aes_icm.encrypt;
+   srtpAesIcmDecrypt = aes_icm.decrypt;
+   srtpHmacAlloc = hmac.alloc;
+   srtpHmacDealloc = hmac.dealloc;
+   srtpHmacInit = hmac.init;
+   srtpHmacCompute = hmac.compute;
+   srtpHmacUpdate = hmac.update;
+   srtpHmacStart = hmac.start;
+
+   aes_icm.alloc = (cipher_alloc_func_t)openssl_aes_icm_alloc;
+   aes_icm.dealloc = (cipher_dealloc_func_t)openssl_aes_icm_dealloc;
+   aes_icm.init = (cipher_init_func_t)openssl_aes_icm_init;
+   aes_icm.encrypt = (cipher_encrypt_func_t)openssl_aes_icm_encrypt;
+   aes_icm.decrypt = (cipher_decrypt_func_t)openssl_aes_icm_encrypt;
+   hmac.alloc = (auth_alloc_func)openssl_hmac_alloc;
+   hmac.dealloc = (auth_dealloc_func)openssl_hmac_dealloc;
+   hmac.init = (auth_init_func)openssl_hmac_init;
+   hmac.compute = (auth_compute_func)openssl_hmac_compute;
+   hmac.update = (auth_update_func)openssl_hmac_update;
+   hmac.start = (auth_start_func)openssl_hmac_start;
+
+   // Run the srtp library's known answer tests against the OpenSSL implementations
+   err_status_t status = cipher_type_self_test(&aes_icm);
+   if(status == err_status_ok)
+   {
+      status = auth_type_self_test(&hmac);
+   }
+   if(status != err_status_ok)
+   {
+      ErrLog(<< "OpenSSL SRTP crypto failed self test, error code=" << status << " - using SRTP library crypto");
+      restoreSrtpCrypto();
+      return false;
+   }
+
+   InfoLog(<< "Using OpenSSL SRTP crypto (" << OPENSSL_VERSION_TEXT << ")");
+   openSslCryptoInstalled = true;
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool
+FlowSrtpCrypto::uninstallOpenSslCrypto()
+{
+   Lock lock(openSslCryptoMutex);
+   if(!openSslCryptoInstalled)
+   {
+      return true;
+   }
+   if(aes_icm.ref_count != 0 || hmac.ref_count != 0)
+   {
+      WarningLog(<< "Unable to switch to SRTP library crypto while SRTP sessions exist");
+      return false;
+   }
+   restoreSrtpCrypto();
+   openSslCryptoInstalled = false;
+   return true;
+}
+
+bool
+FlowSrtpCrypto::isOpenSslCryptoInstalled()
+{
+   Lock lock(openSslCryptoMutex);
+   return openSslCryptoInstalled;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -0,0 +1,92 @@
+#if !defined(FlowSrtpCrypto_hxx)
+#define FlowSrtpCrypto_hxx
+
+#include <srtp.h>
+
+/**
+  This class provides the SRTP batch protect/unprotect helpers used by
+  MediaStream and FlowDtlsSocketContext, and allows the AES counter mode
+  cipher and HMAC-SHA1 auth function of the srtp library to be replaced by
+  OpenSSL implementations (AES-NI / SHA extensions when the CPU has them).
+
+  The replacement is done by swapping the functions of the srtp library's
+  aes_icm and hmac types - so that the srtp library still recognizes the
+  cipher as AES counter mode (for salt generation and iv handling).  Since
+  the cipher and auth states of the two implementations differ, the
+  implementation can only be changed when no srtp sessions exist.
+*/
+
+namespace flowmanager
+{
+
+/// A packet of a batch - mSize is updated in place to the protected or
+/// unprotected size, and mStatus receives the result for this packet
+class SrtpPacket
+{
+public:
+   SrtpPacket() : mData(0), mSize(0), mStatus(err_status_ok) {}
+   SrtpPacket(void* data, unsigned int size) : mData(data), mSize(size), mStatus(err_status_ok) {}
+
+   void* mData;
+   unsigned int mSize;
+   err_status_t mStatus;
+};
+
+class FlowSrtpCrypto
+{
+public:
+   /// Protects/unprotects numPackets packets with the session - returns the
+   /// number of packets that were processed successfully.  Note: when protecting,
+   /// each buffer must have room for the SRTP auth tag to be appended.
+   static unsigned int protect(srtp_t session, SrtpPacket* packets, unsigned int numPackets, bool rtcp);
+   static unsigned int unprotect(srtp_t session, SrtpPacket* packets, unsigned int numPackets, bool rtcp);
+
+   /// Switches the srtp library to the OpenSSL cipher and auth implementations.
+   /// Must be called after srtp_init.  Returns false if OpenSSL is too old, if
+   /// srtp sessions exist, or if the OpenSSL implementations fail the srtp
+   /// library's self tests (in which case the srtp library's own are kept).
+   static bool installOpenSslCrypto();
+   /// Switches back to the srtp library's own implementations - returns false if
+   /// srtp sessions exist
+   static bool uninstallOpenSslCrypto();
+   static bool isOpenSslCryptoInstalled();
+};
+
+}
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -22,7 +22,9 @@ MediaStream::MediaStream(asio::io_service& ioService,
                          const char* natTraversalServerHostname, 
                          unsigned short natTraversalServerPort, 
                          const char* stunUsername,
-                         const char* stunPassword) :
+                         const char* stunPassword,
+                         unsigned int receiveRingDepth,
+                         unsigned int receiveRingMaxPacketSize) :
    mDtlsFactory(dtlsFactory),
    mSRTPSessionInCreated(false),
    mSRTPSessionOutCreated(false),
@@ -42,13 +44,17 @@ MediaStream::MediaStream(asio::io_service& ioService,
                           sslContext, 
                           RTP_COMPONENT_ID, 
                           localRtpBinding, 
-                          *this);
+                          *this,
+                          receiveRingDepth,
+                          receiveRingMaxPacketSize);
 
       mRtcpFlow = new Flow(ioService, 
                            sslContext, 
                            RTCP_COMPONENT_ID,
                            localRtcpBinding, 
-                           *this);
+                           *this,
+                          receiveRingDepth,
+                          receiveRingMaxPacketSize);
 
       mRtpFlow->activateFlow(StunMessage::PropsPortPair);
 
@@ -64,7 +70,9 @@ MediaStream::MediaStream(asio::io_service& ioService,
                           sslContext, 
                           RTP_COMPONENT_ID,
                           localRtpBinding, 
-                          *this);
+                          *this,
+                          receiveRingDepth,
+                          receiveRingMaxPacketSize);
       mRtpFlow->activateFlow(StunMessage::PropsPortEven);
       mRtcpFlow = 0;
    }
@@ -258,6 +266,36 @@ MediaStream::srtpUnprotect(void* data, int* size, bool rtcp)
    return status;
 }
 
+unsigned int 
+MediaStream::srtpProtect(SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   Lock lock(mMutex);
+   if(mSRTPSessionOutCreated)
+   {
+      return FlowSrtpCrypto::protect(mSRTPSessionOut, packets, numPackets, rtcp);
+   }
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      packets[i].mStatus = err_status_no_ctx;
+   }
+   return 0;
+}
+
+unsigned int 
+MediaStream::srtpUnprotect(SrtpPacket* packets, unsigned int numPackets, bool rtcp)
+{
+   Lock lock(mMutex);
+   if(mSRTPSessionInCreated)
+   {
+      return FlowSrtpCrypto::unprotect(mSRTPSessionIn, packets, numPackets, rtcp);
+   }
+   for(unsigned int i = 0; i < numPackets; i++)
+   {
+      packets[i].mStatus = err_status_no_ctx;
+   }
+   return 0;
+}
+
 void 
 MediaStream::onFlowReady(unsigned int componentId)
 {
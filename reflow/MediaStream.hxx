@@ -8,6 +8,7 @@
 
 #include "dtls_wrapper/DtlsFactory.hxx"
 #include "Flow.hxx"
+#include "FlowSrtpCrypto.hxx"
 
 using namespace reTurn;
 
@@ -60,7 +61,9 @@ public:
                const char* natTraversalServerHostname = 0, 
                unsigned short natTraversalServerPort = 0, 
                const char* stunUsername = 0,
-               const char* stunPassword = 0); 
+               const char* stunPassword = 0,
+               unsigned int receiveRingDepth = FlowReceiveRing::DefaultDepth,   // see Flow
+               unsigned int receiveRingMaxPacketSize = FlowReceiveRing::DefaultMaxPacketSize); 
    virtual ~MediaStream();
 
    Flow* getRtpFlow() { return mRtpFlow; }
@@ -89,6 +92,10 @@ protected:
 
    err_status_t srtpProtect(void* data, int* size, bool rtcp);
    err_status_t srtpUnprotect(void* data, int* size, bool rtcp);
+   // Batch versions - the session is locked once for all packets, returns the number of packets 
+   // processed successfully (see SrtpPacket::mStatus for the result of each packet)
+   unsigned int srtpProtect(SrtpPacket* packets, unsigned int numPackets, bool rtcp);
+   unsigned int srtpUnprotect(SrtpPacket* packets, unsigned int numPackets, bool rtcp);
 
    // Nat Traversal Members
    NatTraversalMode mNatTraversalMode;
@@ -0,0 +1,240 @@
+// Unit tests for FlowReceiveRing:
+//   - slot reuse as the head and tail wrap around the ring
+//   - the ring full and packet too large drop counters
+//   - a producer thread and a consumer thread passing packets through a small ring
+
+#include <iostream>
+#include <cassert>
+#include <string.h>
+#ifndef WIN32
+#include <sched.h>
+#endif
+
+#include <rutil/ThreadIf.hxx>
+
+#include "../FlowReceiveRing.hxx"
+
+using namespace flowmanager;
+using namespace std;
+
+static const asio::ip::address address = asio::ip::address::from_string("192.0.2.1");
+
+// packet i is i % 251 repeated, with a size between 1 and maxSize
+static unsigned int
+fillPacket(char* buffer, unsigned int i, unsigned int maxSize)
+{
+   unsigned int size = 1 + i % maxSize;
+   memset(buffer, (int)(i % 251), size);
+   return size;
+}
+
+static void
+checkPacket(const FlowReceiveRing::Packet* packet, unsigned int i, unsigned int maxSize)
+{
+   char expected[FlowReceiveRing::DefaultMaxPacketSize];
+   unsigned int size = fillPacket(expected, i, maxSize);
+   assert(packet);
+   assert(packet->mSize == size);
+   assert(memcmp(packet->mData, expected, size) == 0);
+   assert(packet->mAddress == address);
+   assert(packet->mPort == (unsigned short)i);
+}
+
+static void
+yield()
+{
+#ifdef WIN32
+   Sleep(0);
+#else
+   sched_yield();
+#endif
+}
+
+static void
+testWraparound()
+{
+   const unsigned int maxSize = 16;
+   FlowReceiveRing ring(4, maxSize);
+   assert(ring.getDepth() == 4);
+   assert(ring.empty());
+   assert(ring.front() == 0);
+
+   // the head and tail wrap around the 4 slots many times, with 1 to 3 packets queued
+   char buffer[maxSize];
+   unsigned int pushed = 0;
+   unsigned int popped = 0;
+   for(unsigned int round = 0; round < 100; round++)
+   {
+      unsigned int count = 1 + round % 3;
+      for(unsigned int i = 0; i < count; i++, pushed++)
+      {
+         unsigned int size = fillPacket(buffer, pushed, maxSize);
+         assert(ring.push(address, (unsigned short)pushed, buffer, size));
+      }
+      assert(ring.size() == count);
+      for(unsigned int i = 0; i < count; i++, popped++)
+      {
+         checkPacket(ring.front(), popped, maxSize);
+         ring.pop();
+      }
+      assert(ring.empty());
+      assert(ring.front() == 0);
+   }
+   assert(ring.getNumOverflowDrops() == 0);
+   assert(ring.getNumTooLargeDrops() == 0);
+
+   // a depth of 0 still holds one packet
+   FlowReceiveRing tiny(0, maxSize);
+   assert(tiny.getDepth() == 1);
+   assert(tiny.push(address, 0, buffer, 1));
+   assert(!tiny.push(address, 0, buffer, 1));
+
+   cout << "Wraparound OK" << endl;
+}
+
+static void
+testDrops()
+{
+   const unsigned int maxSize = 16;
+   FlowReceiveRing ring(4, maxSize);
+   char buffer[maxSize + 1];
+   memset(buffer, 0, sizeof(buffer));
+
+   // larger than a slot - the largest size that fits is queued
+   assert(!ring.push(address, 0, buffer, maxSize + 1));
+   assert(ring.getNumTooLargeDrops() == 1);
+   assert(ring.push(address, 0, buffer, maxSize));
+   assert(ring.size() == 1);
+   ring.front();
+   ring.pop();
+
+   // full - the packets already queued are not touched
+   unsigned int i;
+   for(i = 0; i < 4; i++)
+   {
+      unsigned int size = fillPacket(buffer, i, maxSize);
+      assert(ring.push(address, (unsigned short)i, buffer, size));
+   }
+   for(int drop = 0; drop < 3; drop++)
+   {
+      unsigned int size = fillPacket(buffer, 100, maxSize);
+      assert(!ring.push(address, 100, buffer, size));
+   }
+   assert(ring.getNumOverflowDrops() == 3);
+   assert(ring.size() == 4);
+
+   // popping one packet makes room for one more
+   checkPacket(ring.front(), 0, maxSize);
+   ring.pop();
+   unsigned int size = fillPacket(buffer, i, maxSize);
+   assert(ring.push(address, (unsigned short)i, buffer, size));
+   assert(!ring.push(address, (unsigned short)i, buffer, size));
+   assert(ring.getNumOverflowDrops() == 4);
+   for(unsigned int j = 1; j <= 4; j++)
+   {
+      checkPacket(ring.front(), j, maxSize);
+      ring.pop();
+   }
+   assert(ring.empty());
+   assert(ring.getNumTooLargeDrops() == 1);
+
+   cout << "Drop counters OK" << endl;
+}
+
+class Producer : public resip::ThreadIf
+{
+public:
+   Producer(FlowReceiveRing& ring, unsigned int numPackets) : mRing(ring), mNumPackets(numPackets), mNumRetries(0) {}
+
+   virtual void thread()
+   {
+      char buffer[FlowReceiveRing::DefaultMaxPacketSize];
+      for(unsigned int i = 0; i < mNumPackets; i++)
+      {
+         unsigned int size = fillPacket(buffer, i, mRing.getMaxPacketSize());
+         // a full ring drops the packet - retry it until the consumer catches up
+         while(!mRing.push(address, (unsigned short)i, buffer, size))
+         {
+            mNumRetries++;
+            yield();
+         }
+      }
+   }
+
+   FlowReceiveRing& mRing;
+   const unsigned int mNumPackets;
+   unsigned long mNumRetries;
+};
+
+static void
+testProducerConsumer()
+{
+   const unsigned int numPackets = 200000;
+   FlowReceiveRing ring(8, 200);
+   Producer producer(ring, numPackets);
+   producer.run();
+
+   // every packet arrives once, in order and intact
+   for(unsigned int i = 0; i < numPackets; )
+   {
+      FlowReceiveRing::Packet* packet = ring.front();
+      if(packet == 0)
+      {
+         yield();
+         continue;
+      }
+      checkPacket(packet, i, ring.getMaxPacketSize());
+      ring.pop();
+      i++;
+   }
+   producer.join();
+
+   assert(ring.empty());
+   assert(ring.getNumOverflowDrops() == producer.mNumRetries);
+   assert(ring.getNumTooLargeDrops() == 0);
+   cout << "Producer/consumer OK: " << producer.mNumRetries << " pushes found the ring full" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   testWraparound();
+   testDrops();
+   testProducerConsumer();
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
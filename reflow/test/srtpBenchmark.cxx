@@ -0,0 +1,256 @@
+// Packets per second (per core) benchmark for SRTP protection in reflow.
+//
+// Protects and unprotects RTP packets with an AES_CM_128_HMAC_SHA1_80 session (as MediaStream creates) on
+// the calling thread, for both the srtp library's own crypto and the OpenSSL crypto (see FlowSrtpCrypto):
+//   - per packet: one mutex lock and srtp call per packet, as MediaStream::srtpProtect(data, size, rtcp)
+//   - batch:      one mutex lock per batch of packets, as MediaStream::srtpProtect(packets, numPackets, rtcp)
+// The protected packets of both crypto implementations are also compared, to check that they are identical.
+//
+// Usage: srtpBenchmark [numPackets] [payloadSize] [batchSize]
+
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+#include <rutil/Lock.hxx>
+#include <rutil/Mutex.hxx>
+#include <rutil/Timer.hxx>
+#include <rutil/Logger.hxx>
+
+#include "../FlowSrtpCrypto.hxx"
+
+using namespace flowmanager;
+using namespace resip;
+using namespace std;
+
+#define RTP_HEADER_SIZE 12
+#define RTP_SSRC 0x12345678
+
+static unsigned char masterKey[SRTP_MASTER_KEY_LEN] =
+{
+   0xe1, 0xf9, 0x7a, 0x0d, 0x3e, 0x01, 0x8b, 0xe0, 0xd6, 0x4f, 0xa3, 0x2c, 0x06, 0xde, 0x41, 0x39,
+   0x0e, 0xc6, 0x75, 0xad, 0x49, 0x8a, 0xfe, 0xeb, 0xb6, 0x96, 0x0b, 0x3a, 0xab, 0xe6
+};
+
+static void
+buildRtpPacket(unsigned char* buffer, unsigned int payloadSize, unsigned short seq)
+{
+   buffer[0] = 0x80;   // version 2
+   buffer[1] = 0;      // PCMU
+   buffer[2] = (unsigned char)(seq >> 8);
+   buffer[3] = (unsigned char)seq;
+   UInt32 timestamp = htonl(seq * 160);
+   memcpy(&buffer[4], &timestamp, 4);
+   UInt32 ssrc = htonl(RTP_SSRC);
+   memcpy(&buffer[8], &ssrc, 4);
+   for(unsigned int i = 0; i < payloadSize; i++)
+   {
+      buffer[RTP_HEADER_SIZE + i] = (unsigned char)(seq + i);
+   }
+}
+
+static bool
+createSession(srtp_t* session, srtp_policy_t& policy, bool outbound)
+{
+   memset(&policy, 0, sizeof(policy));
+   crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
+   crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+   policy.ssrc.type = outbound ? ssrc_any_outbound : ssrc_any_inbound;
+   policy.key = masterKey;
+   policy.next = 0;
+   err_status_t status = srtp_create(session, &policy);
+   if(status != err_status_ok)
+   {
+      cerr << "srtp_create failed, error code=" << status << endl;
+      return false;
+   }
+   return true;
+}
+
+static double
+packetsPerSecond(unsigned int numPackets, UInt64 microSecs)
+{
+   return microSecs ? numPackets * 1000000.0 / microSecs : 0;
+}
+
+// Runs numPackets through a protect and an unprotect session in batches of batchSize, and reports the packets
+// per second of each.  Also stores the first batch of protected packets in firstBatch.  Returns false on error.
+static bool
+runBenchmark(const char* name, unsigned int numPackets, unsigned int payloadSize, unsigned int batchSize, bool batched,
+             std::vector<unsigned char>& firstBatch)
+{
+   srtp_policy_t policyOut;
+   srtp_policy_t policyIn;
+   srtp_t sessionOut;
+   srtp_t sessionIn;
+   if(!createSession(&sessionOut, policyOut, true) || !createSession(&sessionIn, policyIn, false))
+   {
+      return false;
+   }
+
+   Mutex mutex;
+   const unsigned int bufferSize = RTP_HEADER_SIZE + payloadSize + SRTP_MAX_TRAILER_LEN;
+   std::vector<unsigned char> buffers(bufferSize * batchSize);
+   std::vector<SrtpPacket> packets(batchSize);
+   UInt64 protectTime = 0;
+   UInt64 unprotectTime = 0;
+   unsigned short seq = 0;
+   bool ok = true;
+
+   for(unsigned int sent = 0; sent < numPackets && ok; sent += batchSize)
+   {
+      for(unsigned int i = 0; i < batchSize; i++)
+      {
+         buildRtpPacket(&buffers[i * bufferSize], payloadSize, seq++);
+         packets[i] = SrtpPacket(&buffers[i * bufferSize], RTP_HEADER_SIZE + payloadSize);
+      }
+
+      UInt64 start = Timer::getTimeMicroSec();
+      if(batched)
+      {
+         Lock lock(mutex);
+         ok = FlowSrtpCrypto::protect(sessionOut, &packets[0], batchSize, false) == batchSize;
+      }
+      else
+      {
+         for(unsigned int i = 0; i < batchSize && ok; i++)
+         {
+            Lock lock(mutex);
+            ok = srtp_protect(sessionOut, packets[i].mData, (int*)&packets[i].mSize) == err_status_ok;
+         }
+      }
+      UInt64 protectedTime = Timer::getTimeMicroSec();
+      protectTime += protectedTime - start;
+
+      if(sent == 0)
+      {
+         firstBatch.assign(buffers.begin(), buffers.end());
+      }
+
+      if(batched)
+      {
+         Lock lock(mutex);
+         ok = ok && FlowSrtpCrypto::unprotect(sessionIn, &packets[0], batchSize, false) == batchSize;
+      }
+      else
+      {
+         for(unsigned int i = 0; i < batchSize && ok; i++)
+         {
+            Lock lock(mutex);
+            ok = srtp_unprotect(sessionIn, packets[i].mData, (int*)&packets[i].mSize) == err_status_ok;
+         }
+      }
+      unprotectTime += Timer::getTimeMicroSec() - protectedTime;
+
+      // Check the round trip
+      for(unsigned int i = 0; i < batchSize && ok; i++)
+      {
+         unsigned char expected[RTP_HEADER_SIZE + 1500];
+         buildRtpPacket(expected, payloadSize, (unsigned short)(seq - batchSize + i));
+         ok = packets[i].mSize == RTP_HEADER_SIZE + payloadSize &&
+              memcmp(packets[i].mData, expected, packets[i].mSize) == 0;
+      }
+   }
+
+   srtp_dealloc(sessionOut);
+   srtp_dealloc(sessionIn);
+
+   if(!ok)
+   {
+      cerr << name << ": SRTP protect/unprotect failed!" << endl;
+      return false;
+   }
+
+   cout << name << (batched ? " batch" : " per packet") << ": protect " << (unsigned long)packetsPerSecond(numPackets, protectTime)
+        << " pps, unprotect " << (unsigned long)packetsPerSecond(numPackets, unprotectTime) << " pps" << endl;
+   return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+   unsigned int numPackets = argc > 1 ? atoi(argv[1]) : 500000;
+   unsigned int payloadSize = argc > 2 ? atoi(argv[2]) : 160;
+   unsigned int batchSize = argc > 3 ? atoi(argv[3]) : 32;
+   if(payloadSize > 1500 || batchSize == 0)
+   {
+      cerr << "Usage: srtpBenchmark [numPackets] [payloadSize (<= 1500)] [batchSize (> 0)]" << endl;
+      return -1;
+   }
+   numPackets = ((numPackets + batchSize - 1) / batchSize) * batchSize;
+
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   err_status_t status = srtp_init();
+   if(status != err_status_ok)
+   {
+      cerr << "srtp_init failed, error code=" << status << endl;
+      return -1;
+   }
+
+   cout << numPackets << " RTP packets with " << payloadSize << " bytes of payload, batches of " << batchSize << endl;
+
+   std::vector<unsigned char> srtpFirstBatch;
+   std::vector<unsigned char> openSslFirstBatch;
+   if(!runBenchmark("srtp crypto", numPackets, payloadSize, batchSize, false, srtpFirstBatch) ||
+      !runBenchmark("srtp crypto", numPackets, payloadSize, batchSize, true, srtpFirstBatch))
+   {
+      return -1;
+   }
+
+   if(!FlowSrtpCrypto::installOpenSslCrypto())
+   {
+      cout << "OpenSSL crypto is not available" << endl;
+      return 0;
+   }
+   if(!runBenchmark("OpenSSL crypto", numPackets, payloadSize, batchSize, false, openSslFirstBatch) ||
+      !runBenchmark("OpenSSL crypto", numPackets, payloadSize, batchSize, true, openSslFirstBatch))
+   {
+      return -1;
+   }
+
+   if(srtpFirstBatch != openSslFirstBatch)
+   {
+      cerr << "SRTP packets protected with OpenSSL crypto differ from the srtp library's!" << endl;
+      return -1;
+   }
+   cout << "SRTP packets protected with OpenSSL crypto match the srtp library's" << endl;
+
+   return 0;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
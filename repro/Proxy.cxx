@@ -478,10 +478,10 @@ Proxy::name() const
 bool 
 Proxy::isMyUri(const Uri& uri) const
 {
-   bool ret = mStack.isMyDomain(uri.host(), uri.port());
+   bool ret = mStack.isMyDomain(uri);
    if(!ret)
    {
-      ret = isMyDomain(uri.host());
+      ret = isMyDomain(uri);
 
       if(ret) 
       {
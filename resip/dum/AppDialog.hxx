@@ -4,6 +4,7 @@
 #include "resip/dum/Handles.hxx"
 #include "resip/dum/Handled.hxx"
 #include "resip/dum/DialogId.hxx"
+#include "rutil/ObjectPool.hxx"
 
 
 #include <vector>
@@ -19,6 +20,8 @@ class NameAddr;
 class AppDialog : public Handled
 {
    public:
+      RESIP_ObjectPool(AppDialog);
+
       AppDialog(HandleManager& ham);
       virtual ~AppDialog();
 
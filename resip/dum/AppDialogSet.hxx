@@ -6,6 +6,7 @@
 #include "resip/dum/DialogSet.hxx"
 #include "resip/dum/DialogSetId.hxx"
 #include "resip/dum/UserProfile.hxx"
+#include "rutil/ObjectPool.hxx"
 
 namespace resip
 {
@@ -16,6 +17,7 @@ class DialogUsageManager;
 class AppDialogSet : public Handled
 {
    public:
+      RESIP_ObjectPool(AppDialogSet);
 
       // by default, calls the destructor. application can override this if it
       // wants to manage memory on its own. 
@@ -6,6 +6,8 @@
 #include "resip/dum/UserProfile.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/DataStream.hxx"
 #include "resip/dum/ClientAuthExtension.hxx"
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::DUM
@@ -14,9 +16,18 @@ using namespace resip;
 using namespace std;
 
 ClientAuthManager::ClientAuthManager() 
+   : mMaxCachedAuths(1000),
+     mCachedAuthLifetime(3600 * 1000)
 {
 }
 
+void
+ClientAuthManager::setPreemptiveCacheLimits(unsigned int maxEntries, unsigned int lifetimeSecs)
+{
+   mMaxCachedAuths = maxEntries;
+   mCachedAuthLifetime = (UInt64)lifetimeSecs * 1000;
+}
+
 
 bool 
 ClientAuthManager::handle(UserProfile& userProfile, SipMessage& origRequest, const SipMessage& response)
@@ -42,6 +53,10 @@ ClientAuthManager::handle(UserProfile& userProfile, SipMessage& origRequest, con
 
             // cache the result
             it->second.authSucceeded();
+            if (userProfile.getPreemptiveAuthenticationEnabled())
+            {
+               cacheAuth(makeCacheKey(userProfile, origRequest), it->second);
+            }
          }      
          return false;
       }   
@@ -65,6 +80,10 @@ ClientAuthManager::handle(UserProfile& userProfile, SipMessage& origRequest, con
       }
       else
       {
+         if (userProfile.getPreemptiveAuthenticationEnabled())
+         {
+            mCachedAuths.erase(makeCacheKey(userProfile, origRequest));
+         }
          return false;
       }
    }
@@ -86,6 +105,92 @@ ClientAuthManager::addAuthentication(SipMessage& request)
    }
 }
 
+void
+ClientAuthManager::addAuthentication(UserProfile& userProfile, SipMessage& request)
+{
+   if (userProfile.getPreemptiveAuthenticationEnabled() && 
+       request.header(h_RequestLine).method() != CANCEL &&
+       !request.header(h_To).exists(p_tag))
+   {
+      DialogSetId id(request);
+      if (mAttemptedAuths.find(id) == mAttemptedAuths.end())
+      {
+         CachedAuthMap::iterator it = mCachedAuths.find(makeCacheKey(userProfile, request));
+         if (it != mCachedAuths.end())
+         {
+            if (Timer::getTimeMs() - it->second.mCachedAt >= mCachedAuthLifetime)
+            {
+               DebugLog (<< "Cached credentials for " << id << " have expired");
+               mCachedAuths.erase(it);
+            }
+            else if (it->second.mAuthState.refreshCredentials(userProfile))
+            {
+               DebugLog (<< "Preemptively authenticating " << id << " with cached credentials");
+               mAttemptedAuths[id] = it->second.mAuthState;
+            }
+            else
+            {
+               mCachedAuths.erase(it);
+            }
+         }
+      }
+   }
+   addAuthentication(request);
+}
+
+void
+ClientAuthManager::cacheAuth(const CacheKey& key, const AuthState& authState)
+{
+   const UInt64 now = Timer::getTimeMs();
+   if (mCachedAuths.find(key) == mCachedAuths.end() && mCachedAuths.size() >= mMaxCachedAuths)
+   {
+      // make room - expired entries first, otherwise the one accepted longest ago
+      CachedAuthMap::iterator oldest = mCachedAuths.end();
+      for (CachedAuthMap::iterator it = mCachedAuths.begin(); it != mCachedAuths.end(); )
+      {
+         if (now - it->second.mCachedAt >= mCachedAuthLifetime)
+         {
+            mCachedAuths.erase(it++);
+         }
+         else
+         {
+            if (oldest == mCachedAuths.end() || it->second.mCachedAt < oldest->second.mCachedAt)
+            {
+               oldest = it;
+            }
+            ++it;
+         }
+      }
+      if (mCachedAuths.size() >= mMaxCachedAuths && oldest != mCachedAuths.end())
+      {
+         mCachedAuths.erase(oldest);
+      }
+      if (mCachedAuths.size() >= mMaxCachedAuths)
+      {
+         return;
+      }
+   }
+
+   CachedAuth& cached = mCachedAuths[key];
+   cached.mAuthState = authState;
+   cached.mCachedAt = now;
+}
+
+ClientAuthManager::CacheKey
+ClientAuthManager::makeCacheKey(UserProfile& userProfile, const SipMessage& request)
+{
+   // requests go to the outbound proxy if there is one, so that is who
+   // issued the challenge; otherwise key on the request-uri host
+   Data target;
+   {
+      DataStream ds(target);
+      const Uri& uri = userProfile.hasOutboundProxy() ? 
+         userProfile.getOutboundProxy().uri() : request.header(h_RequestLine).uri();
+      ds << uri.scheme() << ':' << uri.host() << ':' << uri.port();
+   }
+   return CacheKey(request.header(h_From).uri().getAor(), target);
+}
+
 void 
 ClientAuthManager::clearAuthenticationState(const DialogSetId& dsId)
 {
@@ -160,6 +265,23 @@ ClientAuthManager::AuthState::authSucceeded()
    }
 }
 
+bool
+ClientAuthManager::AuthState::refreshCredentials(UserProfile& userProfile)
+{
+   if (mFailed)
+   {
+      return false;
+   }
+   for(RealmStates::iterator i = mRealms.begin(); i!=mRealms.end(); i++)
+   {
+      if (!i->second.refreshCredential(userProfile))
+      {
+         return false;
+      }
+   }
+   return !mRealms.empty();
+}
+
 void 
 ClientAuthManager::AuthState::addAuthentication(SipMessage& request)
 {
@@ -178,7 +300,7 @@ ClientAuthManager::AuthState::addAuthentication(SipMessage& request)
 ClientAuthManager::RealmState::RealmState() :
    mIsProxyCredential(false),
    mState(Invalid),
-   mNonceCount(0)
+   mNonceCount(new unsigned int(0))
 {
 }
 
@@ -284,7 +406,14 @@ ClientAuthManager::RealmState::handleAuth(UserProfile& userProfile, const Auth&
 void
 ClientAuthManager::RealmState::clear()
 {
-   mNonceCount = 0;
+   // don't reset the count other dialog sets are still using
+   mNonceCount = SharedPtr<unsigned int>(new unsigned int(0));
+}
+
+bool
+ClientAuthManager::RealmState::refreshCredential(UserProfile& userProfile)
+{
+   return mState == Cached && findCredential(userProfile, mAuth);
 }
                      
 bool 
@@ -331,7 +460,7 @@ ClientAuthManager::RealmState::addAuthentication(SipMessage& request)
                                                          mCredential.password,
                                                          mAuth, 
                                                          cnonce,
-                                                         mNonceCount, 
+                                                         *mNonceCount, 
                                                          nonceCountString));
       
    }
@@ -342,7 +471,7 @@ ClientAuthManager::RealmState::addAuthentication(SipMessage& request)
                                                          mCredential.password,
                                                          mAuth, 
                                                          cnonce,
-                                                         mNonceCount, 
+                                                         *mNonceCount, 
                                                          nonceCountString));
    }
    
@@ -30,7 +30,17 @@ class ClientAuthManager
 
       //
       virtual void addAuthentication(SipMessage& origRequest);
+      // As above, but if the profile has preemptive authentication enabled
+      // and this is the first request of a new dialog set, credentials cached
+      // from earlier dialog sets towards the same target are added up front
+      virtual void addAuthentication(UserProfile& userProfile, SipMessage& origRequest);
       virtual void clearAuthenticationState(const DialogSetId& dsId);
+
+      // Bounds the credentials kept for preemptive authentication: an entry
+      // is dropped once it has not been accepted for lifetimeSecs, and when
+      // maxEntries (From AOR, target) pairs are cached the oldest one makes
+      // room for a new pair.  The defaults are 1000 entries and one hour.
+      void setPreemptiveCacheLimits(unsigned int maxEntries, unsigned int lifetimeSecs);
       
    private:
       friend class DialogSet;
@@ -52,6 +62,9 @@ class ClientAuthManager
 
             bool handleAuth(UserProfile& userProfile, const Auth& auth, bool isProxyCredential);
             void authSucceeded();
+            // re-reads the credential from userProfile before a cached realm
+            // is reused by another dialog set
+            bool refreshCredential(UserProfile& userProfile);
 
             void addAuthentication(SipMessage& origRequest);            
          private:
@@ -71,7 +84,10 @@ class ClientAuthManager
             bool mIsProxyCredential;
             
             State mState;            
-            unsigned int mNonceCount;
+            // shared by every dialog set that reuses this realm from the
+            // cache, so nc keeps increasing for the nonce; replaced whenever
+            // the nonce changes
+            SharedPtr<unsigned int> mNonceCount;
             Auth mAuth;            
 
             // FH add the realm state so it can change
@@ -90,6 +106,7 @@ class ClientAuthManager
             bool handleChallenge(UserProfile& userProfile, const SipMessage& challenge);
             void addAuthentication(SipMessage& origRequest);
             void authSucceeded();
+            bool refreshCredentials(UserProfile& userProfile);
             
          private:
             typedef std::map<Data, RealmState> RealmStates;
@@ -99,6 +116,21 @@ class ClientAuthManager
 
       typedef std::map<DialogSetId, AuthState> AttemptedAuthMap;
       AttemptedAuthMap mAttemptedAuths;      
+
+      // (From AOR, target) -> realms that were last accepted, for preemptive
+      // authentication of new dialog sets
+      typedef std::pair<Data, Data> CacheKey;
+      static CacheKey makeCacheKey(UserProfile& userProfile, const SipMessage& request);
+      struct CachedAuth
+      {
+         AuthState mAuthState;
+         UInt64 mCachedAt;  // ms, refreshed whenever a dialog set's credentials are accepted
+      };
+      typedef std::map<CacheKey, CachedAuth> CachedAuthMap;
+      void cacheAuth(const CacheKey& key, const AuthState& authState);
+      CachedAuthMap mCachedAuths;
+      unsigned int mMaxCachedAuths;
+      UInt64 mCachedAuthLifetime;  // ms
 };
  
 }
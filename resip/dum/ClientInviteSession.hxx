@@ -3,6 +3,7 @@
 
 #include "resip/dum/InviteSession.hxx"
 #include "resip/dum/Handles.hxx"
+#include "rutil/ObjectPool.hxx"
 
 namespace resip
 {
@@ -12,6 +13,8 @@ class SdpContents;
 class ClientInviteSession : public InviteSession
 {
    public:
+      RESIP_ObjectPool(ClientInviteSession);
+
       ClientInviteSession(DialogUsageManager& dum,
                           Dialog& dialog,
                           SharedPtr<SipMessage> request,
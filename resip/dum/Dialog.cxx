@@ -146,7 +146,9 @@ Dialog::Dialog(DialogUsageManager& dum, const SipMessage& msg, DialogSet& ds)
    }
    else if (msg.isResponse())
    {
-      mId = DialogId(msg);
+      // shares the dialog set's id rather than building another from the response
+      mId = DialogId(ds.getId(), 
+                     msg.header(h_To).exists(p_tag) ? msg.header(h_To).param(p_tag) : Data::Empty);
       const SipMessage& response = msg;
       mRemoteNameAddr = response.header(h_To);
       mLocalNameAddr = response.header(h_From);
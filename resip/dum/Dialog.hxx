@@ -14,6 +14,7 @@
 #include "resip/stack/SipMessage.hxx"
 #include "resip/dum/NetworkAssociation.hxx"
 #include "resip/dum/DialogUsageManager.hxx"
+#include "rutil/ObjectPool.hxx"
 
 namespace resip
 {
@@ -28,6 +29,8 @@ class AppDialog;
 class Dialog 
 {
    public:
+      RESIP_ObjectPool(Dialog);
+
       class Exception : public BaseException
       {
          public:
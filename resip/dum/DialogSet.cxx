@@ -218,7 +218,7 @@ DialogSet::findDialog(const SipMessage& msg)
             //more specific--this is the VonageKludgeFilter
             Dialog* dialog = it->second;
             DialogId old = dialog->getId();
-            dialog->mId = DialogId(old.getCallId(), old.getLocalTag(), msg.header(h_To).param(p_tag));
+            dialog->mId = DialogId(old.getDialogSetId(), msg.header(h_To).param(p_tag));
             dialog->mRemoteNameAddr.param(p_tag) = msg.header(h_To).param(p_tag);
             mDialogs.erase(it);
             mDialogs[dialog->getId()] = dialog;
@@ -10,6 +10,7 @@
 #include "resip/dum/Handles.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "rutil/SharedPtr.hxx"
+#include "rutil/ObjectPool.hxx"
 
 namespace resip
 {
@@ -24,6 +25,8 @@ class UserProfile;
 class DialogSet
 {
    public:
+      RESIP_ObjectPool(DialogSet);
+
       DialogSet(BaseCreator* creator, DialogUsageManager& dum);
       DialogSet(const SipMessage& request, DialogUsageManager& dum);
       virtual ~DialogSet();
@@ -9,9 +9,28 @@ using namespace resip;
 
 const DialogSetId DialogSetId::Empty;
 
-DialogSetId::DialogSetId(const SipMessage& msg) : 
-   mCallId(msg.header(h_CallID).value())
+DialogSetId::Storage::Storage(const Data& callId, const Data& tag)
+   : mCallId(callId),
+     mTag(tag),
+     mRefCount(1)
+{
+}
+
+void
+DialogSetId::Storage::release()
+{
+   if (mRefCount.decrement() == 0)
+   {
+      delete this;
+   }
+}
+
+DialogSetId::DialogSetId(const SipMessage& msg) 
+   : mStorage(0)
 {
+   const Data& callId = msg.header(h_CallID).value();
+   Data tag;
+
    //find local tag, generate one as necessary
    if (msg.isExternal())
    {
@@ -19,20 +38,20 @@ DialogSetId::DialogSetId(const SipMessage& msg) :
       {        
          if(msg.header(h_From).exists(p_tag))
          {
-            // .bwc. If no tag, leave mTag empty.
-            mTag = msg.header(h_From).param(p_tag);
+            // .bwc. If no tag, leave tag empty.
+            tag = msg.header(h_From).param(p_tag);
          }
       }
       else //external request; generate to tag if not present
       {
          if (msg.header(h_To).exists(p_tag))
          {
-            mTag = msg.header(h_To).param(p_tag);
+            tag = msg.header(h_To).param(p_tag);
          }
          else
          {
             DebugLog ( <<  "********** Generated Local Tag *********** " );            
-            mTag = Helper::computeTag(Helper::tagSize);
+            tag = Helper::computeTag(Helper::tagSize);
          }
       }
    }
@@ -41,78 +60,116 @@ DialogSetId::DialogSetId(const SipMessage& msg) :
       if(msg.isRequest())
       {
          assert(msg.header(h_From).exists(p_tag));
-         mTag = msg.header(h_From).param(p_tag);
+         tag = msg.header(h_From).param(p_tag);
       }
       else
       {
          assert(msg.header(h_To).exists(p_tag));
-         mTag = msg.header(h_To).param(p_tag);
+         tag = msg.header(h_To).param(p_tag);
       }
    }
+   mStorage = new Storage(callId, tag);
 }
 
 DialogSetId::DialogSetId(const Data& callId, const Data& tag)
-   : mCallId(callId),
-     mTag(tag)
+   : mStorage(new Storage(callId, tag))
 {
 }
 
 DialogSetId::DialogSetId() 
-   : mCallId(),
-     mTag()
+   : mStorage(0)
+{
+}
+
+DialogSetId::DialogSetId(const DialogSetId& rhs)
+   : mStorage(rhs.mStorage)
 {
+   if (mStorage)
+   {
+      mStorage->addRef();
+   }
+}
+
+DialogSetId::~DialogSetId()
+{
+   if (mStorage)
+   {
+      mStorage->release();
+   }
+}
+
+DialogSetId&
+DialogSetId::operator=(const DialogSetId& rhs)
+{
+   if (rhs.mStorage != mStorage)
+   {
+      if (rhs.mStorage)
+      {
+         rhs.mStorage->addRef();
+      }
+      if (mStorage)
+      {
+         mStorage->release();
+      }
+      mStorage = rhs.mStorage;
+   }
+   return *this;
 }
 
 bool
 DialogSetId::operator==(const DialogSetId& rhs) const
 {
-   return mCallId == rhs.mCallId && mTag == rhs.mTag;
+   if (mStorage == rhs.mStorage)
+   {
+      return true;
+   }
+   return getCallId() == rhs.getCallId() && getLocalTag() == rhs.getLocalTag();
 }
 
 bool
 DialogSetId::operator!=(const DialogSetId& rhs) const
 {
-   return mCallId != rhs.mCallId || mTag != rhs.mTag;
+   return !(*this == rhs);
 }
 
 bool
 DialogSetId::operator<(const DialogSetId& rhs) const
 {
-   if (mCallId < rhs.mCallId)
+   if (getCallId() < rhs.getCallId())
    {
       return true;
    }
-   if (mCallId > rhs.mCallId)
+   if (getCallId() > rhs.getCallId())
    {
       return false;
    }
-   return mTag < rhs.mTag;
+   return getLocalTag() < rhs.getLocalTag();
 }
 
 bool 
 DialogSetId::operator>(const DialogSetId& rhs) const
 {
-   if (mCallId > rhs.mCallId)
+   if (getCallId() > rhs.getCallId())
    {
       return true;
    }
-   if (mCallId < rhs.mCallId)
+   if (getCallId() < rhs.getCallId())
    {
       return false;
    }
-   return mTag > rhs.mTag;
+   return getLocalTag() > rhs.getLocalTag();
 }
 
 size_t DialogSetId::hash() const
 {
-    return mCallId.hash() ^ mTag.hash();
+    return getCallId().hash() ^ getLocalTag().hash();
 }
 
 
 EncodeStream&
 resip::operator<<(EncodeStream& os, const DialogSetId& id)
 {
-    return os << id.mCallId << '-' << id.mTag ;
+    return os << id.getCallId() << '-' << id.getLocalTag() ;
 }
 
 HashValueImp(resip::DialogSetId, data.hash());
@@ -3,6 +3,8 @@
 
 #include "rutil/HashMap.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/AtomicCounter.hxx"
+#include "rutil/ObjectPool.hxx"
 
 namespace resip
 {
@@ -16,6 +18,10 @@ class DialogSetId
       
       DialogSetId(const SipMessage& msg);
       DialogSetId(const Data& callId, const Data& senderRequestFromTag);
+      DialogSetId(const DialogSetId& rhs);
+      ~DialogSetId();
+
+      DialogSetId& operator=(const DialogSetId& rhs);
 
       bool operator==(const DialogSetId& rhs) const;
       bool operator!=(const DialogSetId& rhs) const;
@@ -24,13 +30,35 @@ class DialogSetId
       size_t hash() const;
       friend EncodeStream& operator<<(EncodeStream&, const DialogSetId& id);
       
-      const Data& getCallId() const { return mCallId; }
-      const Data& getLocalTag() const { return mTag; }
+      const Data& getCallId() const { return mStorage ? mStorage->mCallId : Data::Empty; }
+      const Data& getLocalTag() const { return mStorage ? mStorage->mTag : Data::Empty; }
    private:
       DialogSetId();
-      
-      Data mCallId;
-      Data mTag;
+
+      // The Call-ID and tag are kept in one immutable, reference counted
+      // block that every copy of the id shares (DialogSet, Dialogs, DialogIds
+      // used as map keys), so copying an id never touches the heap.  Ids
+      // that outlive a message are derived from their DialogSet's id, so a
+      // call keeps one block; ids built from a message only to look up a
+      // DialogSet get a short-lived block of their own.
+      class Storage
+      {
+         public:
+            RESIP_ObjectPool(Storage);
+
+            Storage(const Data& callId, const Data& tag);
+            void addRef() { mRefCount.increment(); }
+            void release();
+
+            const Data mCallId;
+            const Data mTag;
+
+         private:
+            ~Storage() {}
+            AtomicCounter mRefCount;
+      };
+
+      Storage* mStorage;
 };
 
     EncodeStream& operator<<(EncodeStream&, const DialogSetId&);
@@ -86,7 +86,9 @@ DialogUsageManager::DialogUsageManager(SipStack& stack, bool createDefaultFeatur
    mAppDialogSetFactory(new AppDialogSetFactory()),
    mStack(stack),
    mDumShutdownHandler(0),
-   mShutdownState(Running)
+   mShutdownState(Running),
+   mLoopIndex(0),
+   mLoopCount(1)
 {
    //TODO -- create default features
    mStack.registerTransactionUser(*this);
@@ -470,6 +472,17 @@ DialogUsageManager::makeUacDialogSet(BaseCreator* creator, AppDialogSet* appDs)
    {
       appDs = new AppDialogSet(*this);
    }
+   if (mLoopCount > 1)
+   {
+      // The DialogSetId is taken from the request, so the Call-ID has to be
+      // pinned to this loop before the DialogSet is built.
+      SharedPtr<SipMessage> request = creator->getLastRequest();
+      while (!isMyCallId(request->header(h_CallId).value()))
+      {
+         request->header(h_CallId).value() = Helper::computeCallId();
+      }
+   }
+
    DialogSet* ds = new DialogSet(creator, *this);
 
    appDs->mDialogSet = ds;
@@ -825,7 +838,7 @@ DialogUsageManager::send(SharedPtr<SipMessage> msg)
 
       if (mClientAuthManager.get() && msg->header(h_RequestLine).method() != ACK)
       {
-         mClientAuthManager->addAuthentication(*msg);
+         mClientAuthManager->addAuthentication(*userProfile, *msg);
       }
 
       if (msg->header(h_RequestLine).method() == INVITE)
@@ -2174,6 +2187,46 @@ DialogUsageManager::createDialogEventStateManager(DialogEventHandler* handler)
    return mDialogEventStateManager;
 }
 
+void
+DialogUsageManager::setLoopAffinity(unsigned int loopIndex, unsigned int loopCount)
+{
+   assert(loopCount > 0);
+   assert(loopIndex < loopCount);
+   mLoopIndex = loopIndex;
+   mLoopCount = loopCount;
+}
+
+unsigned int
+DialogUsageManager::loopForCallId(const Data& callId, unsigned int loopCount)
+{
+   if (loopCount <= 1)
+   {
+      return 0;
+   }
+   return (unsigned int)(callId.hash() % loopCount);
+}
+
+bool
+DialogUsageManager::isMyCallId(const Data& callId) const
+{
+   return loopForCallId(callId, mLoopCount) == mLoopIndex;
+}
+
+bool
+DialogUsageManager::isForMe(const SipMessage& msg) const
+{
+   // Every dialog set belongs to exactly one loop; everything sharing a
+   // Call-ID (CANCEL, ACK, in-dialog requests) must land on that loop too.
+   if (mLoopCount > 1 && 
+       (!msg.exists(h_CallId) || 
+        !msg.header(h_CallId).isWellFormed() ||
+        !isMyCallId(msg.header(h_CallId).value())))
+   {
+      return false;
+   }
+   return TransactionUser::isForMe(msg);
+}
+
 
 /* ====================================================================
  * The Vovida Software License, Version 1.0
@@ -326,9 +326,20 @@ class DialogUsageManager : public HandleManager, public TransactionUser
       // at the same time it deletes other handlers when DUM is destroyed.
       DialogEventStateManager* createDialogEventStateManager(DialogEventHandler* handler);
 
+      // Pins this DUM to one event loop of a DumThreadPool. Once set, the stack
+      // only hands this DUM requests whose Call-ID hashes to loopIndex, and new
+      // UAC dialog sets are given a Call-ID that hashes back here. Must be called
+      // before any processing starts.
+      void setLoopAffinity(unsigned int loopIndex, unsigned int loopCount);
+      unsigned int getLoopIndex() const { return mLoopIndex; }
+      unsigned int getLoopCount() const { return mLoopCount; }
+      bool isMyCallId(const Data& callId) const;
+      static unsigned int loopForCallId(const Data& callId, unsigned int loopCount);
+
    protected:
       virtual void onAllHandlesDestroyed();      
       //TransactionUser virtuals
+      virtual bool isForMe(const SipMessage& msg) const;
       virtual const Data& name() const;
       friend class DumThread;
 
@@ -525,6 +536,9 @@ class DialogUsageManager : public HandleManager, public TransactionUser
       OutgoingTarget* mOutgoingTarget;
 
       EventDispatcher<ConnectionTerminated> mConnectionTerminatedEventDispatcher;
+
+      unsigned int mLoopIndex;
+      unsigned int mLoopCount;
 };
 
 }
@@ -0,0 +1,286 @@
+#include "resip/dum/DumThreadPool.hxx"
+#include "resip/dum/DumThread.hxx"
+#include "resip/dum/DialogUsageManager.hxx"
+#include "resip/dum/DialogId.hxx"
+#include "resip/dum/DialogSetId.hxx"
+#include "resip/dum/InviteSession.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::DUM
+
+using namespace resip;
+
+DumThreadPool::ReplacesCommand::ReplacesCommand(const CallId& replaces)
+   : mReplaces(replaces),
+     mDum(0)
+{
+}
+
+void
+DumThreadPool::ReplacesCommand::executeCommand()
+{
+   assert(mDum);
+   std::pair<InviteSessionHandle, int> result = mDum->findInviteSession(mReplaces);
+   onInviteSession(*mDum, result.first, result.second);
+}
+
+EncodeStream&
+DumThreadPool::ReplacesCommand::encodeBrief(EncodeStream& strm) const
+{
+   return strm << "ReplacesCommand " << mReplaces;
+}
+
+DumThreadPool::InviteSessionCommand::InviteSessionCommand(const DialogId& dialogId)
+   : mDialogId(dialogId),
+     mDum(0)
+{
+}
+
+void
+DumThreadPool::InviteSessionCommand::executeCommand()
+{
+   assert(mDum);
+   onInviteSession(*mDum, mDum->findInviteSession(mDialogId));
+}
+
+EncodeStream&
+DumThreadPool::InviteSessionCommand::encodeBrief(EncodeStream& strm) const
+{
+   return strm << "InviteSessionCommand " << mDialogId;
+}
+
+DumThreadPool::ShutdownCounter::ShutdownCounter(unsigned int count)
+   : mRemaining(count),
+     mHandler(0)
+{
+}
+
+void
+DumThreadPool::ShutdownCounter::onDumCanBeDeleted()
+{
+   DumShutdownHandler* handler = 0;
+   {
+      Lock lock(mMutex);
+      assert(mRemaining > 0);
+      if (--mRemaining == 0)
+      {
+         handler = mHandler;
+      }
+   }
+   if (handler)
+   {
+      handler->onDumCanBeDeleted();
+   }
+}
+
+DumThreadPool::DumThreadPool(SipStack& stack, unsigned int numLoops, bool createDefaultFeatures)
+   : mShutdownCounter(numLoops),
+     mNext(0)
+{
+   assert(numLoops > 0);
+   for (unsigned int i = 0; i < numLoops; ++i)
+   {
+      DialogUsageManager* dum = new DialogUsageManager(stack, createDefaultFeatures);
+      dum->setLoopAffinity(i, numLoops);
+      mDums.push_back(dum);
+      mThreads.push_back(new DumThread(*dum));
+   }
+   InfoLog (<< "Created DumThreadPool with " << numLoops << " loops");
+}
+
+DumThreadPool::~DumThreadPool()
+{
+   stop();
+   join();
+   for (unsigned int i = 0; i < mThreads.size(); ++i)
+   {
+      delete mThreads[i];
+   }
+   for (unsigned int i = 0; i < mDums.size(); ++i)
+   {
+      delete mDums[i];
+   }
+}
+
+DialogUsageManager&
+DumThreadPool::dum(unsigned int loopIndex)
+{
+   assert(loopIndex < mDums.size());
+   return *mDums[loopIndex];
+}
+
+DialogUsageManager&
+DumThreadPool::dumForCallId(const Data& callId)
+{
+   return *mDums[DialogUsageManager::loopForCallId(callId, size())];
+}
+
+DialogUsageManager&
+DumThreadPool::dumFor(const DialogSetId& id)
+{
+   return dumForCallId(id.getCallId());
+}
+
+DialogUsageManager&
+DumThreadPool::dumFor(const DialogId& id)
+{
+   return dumForCallId(id.getCallId());
+}
+
+DialogUsageManager&
+DumThreadPool::nextDum()
+{
+   Lock lock(mNextMutex);
+   DialogUsageManager* dum = mDums[mNext];
+   mNext = (mNext + 1) % size();
+   return *dum;
+}
+
+void
+DumThreadPool::post(const Data& callId, DumCommand* command)
+{
+   dumForCallId(callId).post(command);
+}
+
+void
+DumThreadPool::post(std::auto_ptr<ReplacesCommand> command)
+{
+   DialogUsageManager& owner = dumForCallId(command->getReplaces().value());
+   command->mDum = &owner;
+   owner.post(command.release());
+}
+
+void
+DumThreadPool::post(std::auto_ptr<InviteSessionCommand> command)
+{
+   DialogUsageManager& owner = dumFor(command->getDialogId());
+   command->mDum = &owner;
+   owner.post(command.release());
+}
+
+#ifdef RESIP_HAS_RVALUE_REFS
+void
+DumThreadPool::post(std::unique_ptr<ReplacesCommand> command)
+{
+   post(std::auto_ptr<ReplacesCommand>(command.release()));
+}
+
+void
+DumThreadPool::post(std::unique_ptr<InviteSessionCommand> command)
+{
+   post(std::auto_ptr<InviteSessionCommand>(command.release()));
+}
+#endif
+
+void
+DumThreadPool::run()
+{
+   for (unsigned int i = 0; i < mThreads.size(); ++i)
+   {
+      mThreads[i]->run();
+   }
+}
+
+class DumThreadPoolShutdownCommand : public DumCommandAdapter
+{
+public:
+   DumThreadPoolShutdownCommand(DialogUsageManager& dum, DumShutdownHandler& handler)
+      : mDum(dum),
+        mHandler(handler)
+   {
+   }
+
+   virtual void executeCommand()
+   {
+      mDum.shutdown(&mHandler);
+   }
+
+   virtual EncodeStream& encodeBrief(EncodeStream& strm) const
+   {
+      return strm << "DumThreadPoolShutdownCommand";
+   }
+private:
+   DialogUsageManager& mDum;
+   DumShutdownHandler& mHandler;
+};
+
+void
+DumThreadPool::shutdown(DumShutdownHandler* handler)
+{
+   mShutdownCounter.setHandler(handler);
+   for (unsigned int i = 0; i < mDums.size(); ++i)
+   {
+      // each dum shuts down from within its own loop
+      mDums[i]->post(new DumThreadPoolShutdownCommand(*mDums[i], mShutdownCounter));
+   }
+}
+
+void
+DumThreadPool::stop()
+{
+   for (unsigned int i = 0; i < mThreads.size(); ++i)
+   {
+      mThreads[i]->shutdown();
+   }
+}
+
+void
+DumThreadPool::join()
+{
+   for (unsigned int i = 0; i < mThreads.size(); ++i)
+   {
+      mThreads[i]->join();
+   }
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,198 @@
+#ifndef RESIP_DumThreadPool__hxx
+#define RESIP_DumThreadPool__hxx
+
+#include <vector>
+#include <memory>
+
+#include "resip/dum/DialogId.hxx"
+#include "resip/dum/DumCommand.hxx"
+#include "resip/dum/DumShutdownHandler.hxx"
+#include "resip/dum/Handles.hxx"
+#include "resip/stack/CallId.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
+
+namespace resip
+{
+
+class SipStack;
+class DialogUsageManager;
+class DumThread;
+class DialogSetId;
+
+/**
+   Runs N DialogUsageManagers, each on its own DumThread, against one SipStack.
+
+   Every DialogSet is owned by exactly one loop, chosen by hashing its Call-ID
+   (see DialogUsageManager::setLoopAffinity). A loop only ever touches its own
+   DialogSetMap, handles and timers, so no locking is needed inside dum.
+
+   A handle is only dereferenced on the loop that owns it, including calls
+   to the *Command() methods of the usage through it: the lookup behind
+   operator-> reads the owning dum's handle map, and the usage may be deleted
+   by its loop at any time. To use an InviteSession from another loop, keep
+   its DialogId and post() an InviteSessionCommand; the pool runs it on the
+   owning loop with a handle that is valid there (or invalid if the session
+   is gone). post() is safe from any thread.
+
+   Each dum has to be configured (profiles, handlers, auth managers) the same
+   way before run() is called; handlers will be invoked from all loops.
+*/
+class DumThreadPool
+{
+   public:
+      // Executed on the loop that owns the dialog named by a Replaces header,
+      // with the result of DialogUsageManager::findInviteSession(CallId).
+      // Results needed by the originating loop must be posted back to it.
+      class ReplacesCommand : public DumCommandAdapter
+      {
+         public:
+            ReplacesCommand(const CallId& replaces);
+            virtual ~ReplacesCommand() {}
+
+            virtual void onInviteSession(DialogUsageManager& dum,
+                                         InviteSessionHandle session,
+                                         int errorStatusCode) = 0;
+
+            virtual void executeCommand();
+            virtual EncodeStream& encodeBrief(EncodeStream& strm) const;
+
+            const CallId& getReplaces() const { return mReplaces; }
+
+         private:
+            friend class DumThreadPool;
+            CallId mReplaces;
+            DialogUsageManager* mDum;
+      };
+
+      // Executed on the loop that owns the dialog, with the handle of its
+      // InviteSession, which may be dereferenced there; the handle is not
+      // valid if the dialog has no InviteSession (any more).
+      class InviteSessionCommand : public DumCommandAdapter
+      {
+         public:
+            InviteSessionCommand(const DialogId& dialogId);
+            virtual ~InviteSessionCommand() {}
+
+            virtual void onInviteSession(DialogUsageManager& dum,
+                                         InviteSessionHandle session) = 0;
+
+            virtual void executeCommand();
+            virtual EncodeStream& encodeBrief(EncodeStream& strm) const;
+
+            const DialogId& getDialogId() const { return mDialogId; }
+
+         private:
+            friend class DumThreadPool;
+            DialogId mDialogId;
+            DialogUsageManager* mDum;
+      };
+
+      DumThreadPool(SipStack& stack, unsigned int numLoops, bool createDefaultFeatures=false);
+      ~DumThreadPool();
+
+      unsigned int size() const { return (unsigned int)mDums.size(); }
+      DialogUsageManager& dum(unsigned int loopIndex);
+
+      DialogUsageManager& dumForCallId(const Data& callId);
+      DialogUsageManager& dumFor(const DialogSetId& id);
+      DialogUsageManager& dumFor(const DialogId& id);
+
+      // round robin; use it to pick the loop for a new outgoing session
+      DialogUsageManager& nextDum();
+
+      // runs command on the loop that owns callId; takes ownership
+      void post(const Data& callId, DumCommand* command);
+      void post(std::auto_ptr<ReplacesCommand> command);
+      void post(std::auto_ptr<InviteSessionCommand> command);
+#ifdef RESIP_HAS_RVALUE_REFS
+      void post(std::unique_ptr<ReplacesCommand> command);
+      void post(std::unique_ptr<InviteSessionCommand> command);
+#endif
+
+      void run();
+      // asks every dum to shutdown; handler is called once all of them can be
+      // deleted, after which stop() and join() may be called
+      void shutdown(DumShutdownHandler* handler);
+      void stop();
+      void join();
+
+   private:
+      class ShutdownCounter : public DumShutdownHandler
+      {
+         public:
+            ShutdownCounter(unsigned int count);
+            void setHandler(DumShutdownHandler* handler) { mHandler = handler; }
+            virtual void onDumCanBeDeleted();
+
+         private:
+            Mutex mMutex;
+            unsigned int mRemaining;
+            DumShutdownHandler* mHandler;
+      };
+
+      std::vector<DialogUsageManager*> mDums;
+      std::vector<DumThread*> mThreads;
+      ShutdownCounter mShutdownCounter;
+      Mutex mNextMutex;
+      unsigned int mNext;
+
+      // disabled
+      DumThreadPool(const DumThreadPool&);
+      DumThreadPool& operator=(const DumThreadPool&);
+};
+
+}
+
+#endif
+
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,281 @@
+#include "resip/dum/NotifyFanout.hxx"
+#include "resip/dum/DialogUsageManager.hxx"
+#include "resip/dum/DumCommand.hxx"
+#include "resip/dum/ServerSubscription.hxx"
+#include "resip/stack/RenderedContents.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::DUM
+
+using namespace resip;
+
+class NotifyFanout::Queue
+{
+   public:
+      Queue(NotifyFanout& fanout, const Data& aor) : mFanout(fanout), mAor(aor) {}
+      void operator()(ServerSubscriptionHandle h) { mFanout.queue(h, mAor); }
+
+   private:
+      NotifyFanout& mFanout;
+      const Data& mAor;
+};
+
+class NotifyFanout::ProcessCommand : public DumCommandAdapter
+{
+   public:
+      ProcessCommand(SharedPtr<NotifyFanout*> fanout) : mFanout(fanout) {}
+
+      virtual void executeCommand()
+      {
+         if (*mFanout)
+         {
+            (*mFanout)->mScheduled = false;
+            (*mFanout)->process();
+         }
+      }
+
+      virtual EncodeStream& encodeBrief(EncodeStream& strm) const
+      {
+         return strm << "NotifyFanout::ProcessCommand";
+      }
+
+   private:
+      SharedPtr<NotifyFanout*> mFanout;
+};
+
+NotifyFanout::NotifyFanout(DialogUsageManager& dum, const Data& eventType)
+   : mDum(dum),
+     mEventType(eventType),
+     mMinNotifyInterval(1000),
+     mBatchInterval(20),
+     mMaxNotifiesPerPass(500),
+     mNumPending(0),
+     mSelf(new NotifyFanout*(this)),
+     mScheduled(false)
+{
+}
+
+NotifyFanout::~NotifyFanout()
+{
+   *mSelf = 0;
+}
+
+void
+NotifyFanout::update(const Data& aor, const Contents& document)
+{
+   Resource& resource = mResources[aor];
+   resource.mDocument = SharedPtr<Contents>(new RenderedContents(document));
+   ++resource.mVersion;
+
+   mDum.applyToServerSubscriptions(aor, mEventType, Queue(*this, aor));
+   if (mNumPending)
+   {
+      schedule(mBatchInterval);
+   }
+}
+
+NotifyFanout::Watcher&
+NotifyFanout::findWatcher(ServerSubscriptionHandle h)
+{
+   Watchers::iterator it = mWatchers.find(h.getId());
+   if (it == mWatchers.end())
+   {
+      Watcher& watcher = mWatchers[h.getId()];
+      watcher.mHandle = h;
+      watcher.mConnection = h->getLastSubscribe().getSource();
+      return watcher;
+   }
+   return it->second;
+}
+
+void
+NotifyFanout::queue(ServerSubscriptionHandle h, const Data& aor)
+{
+   Watcher& watcher = findWatcher(h);
+   watcher.mAor = aor;
+   if (!watcher.mPending)
+   {
+      watcher.mPending = true;
+      mPending[watcher.mConnection].push_back(h.getId());
+      ++mNumPending;
+   }
+}
+
+bool
+NotifyFanout::notifyNow(ServerSubscriptionHandle h)
+{
+   Resources::const_iterator r = mResources.find(h->getDocumentKey());
+   if (r == mResources.end() || !r->second.mDocument.get())
+   {
+      return false;
+   }
+   Watcher& watcher = findWatcher(h);
+   watcher.mAor = r->first;
+   // refreshes may come in over a new connection
+   watcher.mConnection = h->getLastSubscribe().getSource();
+   sendNotify(watcher, r->second, Timer::getTimeMs());
+   // if it was pending, the drain pass finds it up to date and skips it
+   return true;
+}
+
+void
+NotifyFanout::removeResource(const Data& aor)
+{
+   mResources.erase(aor);
+}
+
+void
+NotifyFanout::remove(ServerSubscriptionHandle h)
+{
+   // left in mPending; the drain pass drops ids it no longer knows
+   mWatchers.erase(h.getId());
+}
+
+void
+NotifyFanout::sendNotify(Watcher& watcher, const Resource& resource, UInt64 now)
+{
+   watcher.mSentVersion = resource.mVersion;
+   watcher.mLastNotify = now;
+   watcher.mHandle->send(watcher.mHandle->update(resource.mDocument.get()));
+}
+
+void
+NotifyFanout::process()
+{
+   const UInt64 now = Timer::getTimeMs();
+   unsigned int budget = mMaxNotifiesPerPass;
+   UInt64 nextDue = 0;
+   unsigned int sent = 0;
+
+   for (PendingByConnection::iterator c = mPending.begin(); c != mPending.end(); )
+   {
+      std::list<Handled::Id>& ids = c->second;
+      for (std::list<Handled::Id>::iterator i = ids.begin(); i != ids.end(); )
+      {
+         Watchers::iterator w = mWatchers.find(*i);
+         if (w == mWatchers.end() || !w->second.mHandle.isValid())
+         {
+            if (w != mWatchers.end())
+            {
+               mWatchers.erase(w);
+            }
+            i = ids.erase(i);
+            --mNumPending;
+            continue;
+         }
+
+         Watcher& watcher = w->second;
+         Resources::const_iterator r = mResources.find(watcher.mAor);
+         if (r == mResources.end() || watcher.mSentVersion == r->second.mVersion)
+         {
+            // resource removed, or already sent by notifyNow
+            watcher.mPending = false;
+            i = ids.erase(i);
+            --mNumPending;
+            continue;
+         }
+
+         UInt64 due = watcher.mLastNotify + mMinNotifyInterval;
+         if (due > now || budget == 0)
+         {
+            if (budget == 0)
+            {
+               due = now;
+            }
+            if (nextDue == 0 || due < nextDue)
+            {
+               nextDue = due;
+            }
+            ++i;
+            continue;
+         }
+
+         watcher.mPending = false;
+         i = ids.erase(i);
+         --mNumPending;
+         --budget;
+         ++sent;
+         sendNotify(watcher, r->second, now);
+      }
+
+      if (ids.empty())
+      {
+         mPending.erase(c++);
+      }
+      else
+      {
+         ++c;
+      }
+   }
+
+   DebugLog (<< "NotifyFanout " << mEventType << " sent " << sent << ", " << mNumPending << " pending");
+
+   if (mNumPending)
+   {
+      unsigned int wait = (unsigned int)(nextDue > now ? nextDue - now : 0);
+      schedule(wait > mBatchInterval ? wait : mBatchInterval);
+   }
+}
+
+void
+NotifyFanout::schedule(unsigned int ms)
+{
+   if (!mScheduled)
+   {
+      mScheduled = true;
+      mDum.getSipStack().postMS(std::auto_ptr<ApplicationMessage>(new ProcessCommand(mSelf)), ms, &mDum);
+   }
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
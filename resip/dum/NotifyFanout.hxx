@@ -0,0 +1,173 @@
+#if !defined(RESIP_NOTIFYFANOUT_HXX)
+#define RESIP_NOTIFYFANOUT_HXX
+
+#include <map>
+#include <list>
+
+#include "resip/dum/Handled.hxx"
+#include "resip/dum/Handles.hxx"
+#include "resip/stack/Contents.hxx"
+#include "resip/stack/Tuple.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/SharedPtr.hxx"
+
+namespace resip
+{
+
+class DialogUsageManager;
+
+/**
+   Sends event state (presence, dialog/BLF, ...) to every ServerSubscription
+   of a resource without rendering and sending a NOTIFY per watcher on each
+   change.
+
+   - update() encodes the new document once into a RenderedContents; every
+     NOTIFY for that version shares the encoded body.
+   - Each watcher gets at most one NOTIFY per minimum interval.  Changes in
+     between are coalesced, so the watcher only gets the latest version.
+   - Pending NOTIFYs are sent from a drain pass every batch interval.  The
+     pass sends them grouped by the connection the SUBSCRIBE arrived on, so
+     NOTIFYs for one peer leave back to back.  At most maxNotifiesPerPass
+     are sent in one pass; the rest wait for the next.
+
+   Lives in, and must only be used from, the thread of its
+   DialogUsageManager (with a DumThreadPool, use one NotifyFanout per loop).
+   Typical use from a ServerSubscriptionHandler:
+      onNewSubscription:  h->send(h->accept()); fanout.notifyNow(h);
+      onRefresh:          h->send(h->accept()); fanout.notifyNow(h);
+      onTerminated:       fanout.remove(h);
+   and on every state change for aor: fanout.update(aor, document).
+*/
+class NotifyFanout
+{
+   public:
+      NotifyFanout(DialogUsageManager& dum, const Data& eventType);
+      ~NotifyFanout();
+
+      // defaults: 1000ms, 20ms, 500
+      void setMinNotifyInterval(unsigned int ms) { mMinNotifyInterval = ms; }
+      void setBatchInterval(unsigned int ms) { mBatchInterval = ms; }
+      void setMaxNotifiesPerPass(unsigned int max) { mMaxNotifiesPerPass = max; }
+
+      // new state for aor (as in BaseSubscription::getDocumentKey(), e.g.
+      // bob@example.com); queues a NOTIFY for each of its watchers
+      void update(const Data& aor, const Contents& document);
+
+      // sends the current state of the resource h is watching immediately,
+      // bypassing the rate limit; returns false if no state has been set
+      // with update() (the caller should send its own NOTIFY in that case)
+      bool notifyNow(ServerSubscriptionHandle h);
+
+      // forget about the resource (watchers keep their subscriptions)
+      void removeResource(const Data& aor);
+      void remove(ServerSubscriptionHandle h);
+
+      // runs a drain pass; called from the batch timer
+      void process();
+
+      unsigned int numPending() const { return mNumPending; }
+
+   private:
+      struct Resource
+      {
+         Resource() : mVersion(0) {}
+         SharedPtr<Contents> mDocument;
+         UInt32 mVersion;
+      };
+      typedef std::map<Data, Resource> Resources;
+
+      struct Watcher
+      {
+         Watcher() : mLastNotify(0), mSentVersion(0), mPending(false) {}
+         ServerSubscriptionHandle mHandle;
+         Data mAor;
+         Tuple mConnection;
+         UInt64 mLastNotify;
+         UInt32 mSentVersion;
+         bool mPending;
+      };
+      typedef std::map<Handled::Id, Watcher> Watchers;
+      typedef std::map<Tuple, std::list<Handled::Id> > PendingByConnection;
+
+      class Queue;
+      friend class Queue;
+      class ProcessCommand;
+
+      Watcher& findWatcher(ServerSubscriptionHandle h);
+      void queue(ServerSubscriptionHandle h, const Data& aor);
+      void sendNotify(Watcher& watcher, const Resource& resource, UInt64 now);
+      void schedule(unsigned int ms);
+
+      DialogUsageManager& mDum;
+      const Data mEventType;
+      unsigned int mMinNotifyInterval;
+      unsigned int mBatchInterval;
+      unsigned int mMaxNotifiesPerPass;
+
+      Resources mResources;
+      Watchers mWatchers;
+      PendingByConnection mPending;
+      unsigned int mNumPending;
+
+      // shared with the ProcessCommand in flight, cleared in the destructor
+      SharedPtr<NotifyFanout*> mSelf;
+      bool mScheduled;
+
+      // disabled
+      NotifyFanout(const NotifyFanout&);
+      NotifyFanout& operator=(const NotifyFanout&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
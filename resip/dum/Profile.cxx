@@ -53,6 +53,7 @@ Profile::reset()
    unsetRinstanceEnabled();
    unsetOutboundDecorator();
    unsetMethodsParamEnabled();
+   unsetPreemptiveAuthenticationEnabled();
 }
 
 void
@@ -917,6 +918,38 @@ Profile::unsetMethodsParamEnabled()
    }
 }
 
+void 
+Profile::setPreemptiveAuthenticationEnabled(bool enabled)
+{
+   mPreemptiveAuthenticationEnabled = enabled;
+   mHasPreemptiveAuthenticationEnabled = true;
+}
+
+bool 
+Profile::getPreemptiveAuthenticationEnabled() const
+{
+   // Fall through seting (if required)
+   if(!mHasPreemptiveAuthenticationEnabled && mBaseProfile.get())
+   {
+       return mBaseProfile->getPreemptiveAuthenticationEnabled();
+   }
+   return mPreemptiveAuthenticationEnabled;
+}
+
+void
+Profile::unsetPreemptiveAuthenticationEnabled()
+{
+   if(mBaseProfile.get()) 
+   {
+      mHasPreemptiveAuthenticationEnabled = false;
+   }
+   else
+   {
+      mHasPreemptiveAuthenticationEnabled = true;
+      mPreemptiveAuthenticationEnabled = false;
+   }
+}
+
 
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
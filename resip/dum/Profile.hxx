@@ -208,6 +208,14 @@ class Profile
       virtual bool getMethodsParamEnabled() const;
       virtual void unsetMethodsParamEnabled();      
 
+      ///If enabled, credentials that were accepted by a server are remembered
+      ///per user and target, and new dialog sets towards the same target send
+      ///Authorization/Proxy-Authorization up front instead of waiting to be
+      ///challenged.  Requires a ClientAuthManager.  Disabled by default.
+      virtual void setPreemptiveAuthenticationEnabled(bool enabled);
+      virtual bool getPreemptiveAuthenticationEnabled() const;
+      virtual void unsetPreemptiveAuthenticationEnabled();
+
    private:
       bool mHasDefaultRegistrationExpires;
       UInt32 mDefaultRegistrationExpires;
@@ -284,6 +292,9 @@ class Profile
       bool mHasMethodsParamEnabled;
       bool mMethodsParamEnabled;
 
+      bool mHasPreemptiveAuthenticationEnabled;
+      bool mPreemptiveAuthenticationEnabled;
+
       SharedPtr<Profile> mBaseProfile;  // All non-set settings will fall through to this Profile (if set)
 };
 
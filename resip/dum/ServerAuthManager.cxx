@@ -8,6 +8,7 @@
 #include "resip/dum/TargetCommand.hxx"
 #include "rutil/Logger.hxx"
 #include "resip/dum/UserAuthInfo.hxx"
+#include "resip/stack/DigestVerifier.hxx"
 #include "resip/stack/Helper.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -155,16 +156,15 @@ ServerAuthManager::handleUserAuthInfo(UserAuthInfo* userAuth)
    bool digestAccepted = (userAuth->getMode() == UserAuthInfo::DigestAccepted);
    if(userAuth->getMode() == UserAuthInfo::RetrievedA1)
    {
-      //!dcm! -- need to handle stale/unit test advancedAuthenticateRequest
       //!dcm! -- delta? deal with.
-      std::pair<Helper::AuthResult,Data> resPair = 
-         Helper::advancedAuthenticateRequest(*requestWithAuth, 
+      Helper::AuthResult result = 
+         DigestVerifier::authenticateRequest(*requestWithAuth, 
                                              userAuth->getRealm(),
                                              userAuth->getA1(),
                                              3000,
                                              proxyAuthenticationMode());
 
-      switch (resPair.first) 
+      switch (result) 
       {
          case Helper::Authenticated:
             digestAccepted = true;
@@ -268,6 +268,13 @@ ServerAuthManager::rejectBadNonces() const
 }
 
 
+bool
+ServerAuthManager::useSha256Digest() const
+{
+   return false;
+}
+
+
 ServerAuthManager::AsyncBool
 ServerAuthManager::requiresChallenge(const SipMessage& msg)
 {
@@ -391,6 +398,16 @@ ServerAuthManager::issueChallenge(SipMessage *sipMsg)
                                                         false /*stale*/,
                                                         proxyAuthenticationMode()));
 
+  if (useSha256Digest())
+  {
+     // same nonce, listed first as the preferred algorithm
+     Auths& auths = proxyAuthenticationMode() ? 
+        challenge->header(h_ProxyAuthenticates) : challenge->header(h_WWWAuthenticates);
+     Auth sha256(auths.front());
+     sha256.param(p_algorithm) = DigestVerifier::algorithmName(DigestVerifier::SHA256);
+     auths.push_front(sha256);
+  }
+
   InfoLog (<< "Sending challenge to " << sipMsg->brief());
   mDum.send(challenge);
 }
@@ -59,6 +59,8 @@ class ServerAuthManager : public DumFeature
       };
 
       // this call back should async cause a post of UserAuthInfo
+      // the A1 posted back must be hashed with the algorithm named in auth
+      // (MD5 if absent, or SHA-256 if useSha256Digest() is enabled)
       virtual void requestCredential(const Data& user, 
                                      const Data& realm, 
                                      const SipMessage& msg,
@@ -68,6 +70,8 @@ class ServerAuthManager : public DumFeature
       virtual bool useAuthInt() const;
       virtual bool proxyAuthenticationMode() const;
       virtual bool rejectBadNonces() const;
+      /// if true, challenges offer algorithm=SHA-256 ahead of MD5 (RFC 8760)
+      virtual bool useSha256Digest() const;
       
       typedef std::map<Data, SipMessage*> MessageMap;
       MessageMap mMessages;
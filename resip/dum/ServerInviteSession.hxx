@@ -3,6 +3,7 @@
 
 #include "resip/dum/InviteSession.hxx"
 #include "resip/stack/SipMessage.hxx"
+#include "rutil/ObjectPool.hxx"
 
 #include <deque>
 
@@ -12,6 +13,8 @@ namespace resip
 class ServerInviteSession: public InviteSession
 {
    public:
+      RESIP_ObjectPool(ServerInviteSession);
+
       typedef Handle<ServerInviteSession> ServerInviteSessionHandle;
       ServerInviteSessionHandle getHandle();
 
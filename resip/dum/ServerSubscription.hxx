@@ -16,6 +16,8 @@ class ServerSubscription : public BaseSubscription
       ServerSubscriptionHandle getHandle();
 
       const Data& getSubscriber() const { return mSubscriber; }
+      // the SUBSCRIBE that created or most recently refreshed this subscription
+      const SipMessage& getLastSubscribe() const { return mLastSubscribe; }
       UInt32 getTimeLeft();
      
       //only 200 and 202 are permissable.  SubscriptionState is not affected.
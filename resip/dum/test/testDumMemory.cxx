@@ -0,0 +1,199 @@
+// Measures the steady state heap footprint of a call in DUM: INVITEs are
+// fed straight into DialogUsageManager::internalProcess (no transports, no
+// stack thread) and the live heap is sampled before and after.
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "resip/dum/DialogUsageManager.hxx"
+#include "resip/dum/MasterProfile.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/ObjectPool.hxx"
+#include "rutil/Timer.hxx"
+
+#include "TestDumHandlers.hxx"
+
+using namespace resip;
+using namespace std;
+
+// Global operator new/delete are replaced so live bytes and allocation counts
+// can be sampled around the calls.
+namespace
+{
+size_t liveBytes = 0;
+size_t allocations = 0;
+
+union Header
+{
+   size_t size;
+   double align;
+};
+}
+
+void* operator new(size_t bytes)
+{
+   Header* h = static_cast<Header*>(malloc(sizeof(Header) + bytes));
+   if (!h)
+   {
+      throw std::bad_alloc();
+   }
+   h->size = bytes;
+   liveBytes += bytes;
+   ++allocations;
+   return h + 1;
+}
+
+void operator delete(void* p) throw()
+{
+   if (p)
+   {
+      Header* h = static_cast<Header*>(p) - 1;
+      liveBytes -= h->size;
+      free(h);
+   }
+}
+
+void* operator new[](size_t bytes)
+{
+   return operator new(bytes);
+}
+
+void operator delete[](void* p) throw()
+{
+   operator delete(p);
+}
+
+class NullInviteSessionHandler : public TestInviteSessionHandler
+{
+   public:
+      virtual void onNewSession(ServerInviteSessionHandle, InviteSession::OfferAnswerType, const SipMessage&)
+      {
+      }
+
+      virtual void onReferNoSub(InviteSessionHandle, const SipMessage&)
+      {
+      }
+};
+
+static SipMessage*
+makeInvite(int n)
+{
+   Data txt;
+   {
+      DataStream strm(txt);
+      strm << "INVITE sip:uas@127.0.0.1:5070 SIP/2.0\r\n"
+           << "Via: SIP/2.0/UDP 127.0.0.1:5060;branch=z9hG4bK-" << n << "-a1b2c3d4;rport\r\n"
+           << "Max-Forwards: 70\r\n"
+           << "From: \"Alice\" <sip:alice@example.com>;tag=" << n << "-5f3e2d1c\r\n"
+           << "To: <sip:uas@127.0.0.1:5070>\r\n"
+           << "Call-ID: " << n << "-0c6b1f7e9a2d4e8b8f6c5a3b2d1e0f9a@127.0.0.1\r\n"
+           << "CSeq: 1 INVITE\r\n"
+           << "Contact: <sip:alice@127.0.0.1:5060>\r\n"
+           << "Allow: INVITE, ACK, CANCEL, BYE, OPTIONS, UPDATE, INFO\r\n"
+           << "Content-Length: 0\r\n"
+           << "\r\n";
+   }
+   return SipMessage::make(txt, true);
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   int calls = argc > 1 ? atoi(argv[1]) : 10000;
+
+   SipStack stack;
+   DialogUsageManager dum(stack);
+   SharedPtr<MasterProfile> profile(new MasterProfile);
+   dum.setMasterProfile(profile);
+   NullInviteSessionHandler handler;
+   dum.setInviteSessionHandler(&handler);
+
+   // warm up lazily created statics and the first pool chunks
+   for (int i = 0; i < 10; ++i)
+   {
+      dum.internalProcess(std::auto_ptr<Message>(makeInvite(-1 - i)));
+   }
+
+   std::vector<SipMessage*> invites;
+   invites.reserve(calls);
+
+   size_t bytesBefore = liveBytes;
+   size_t allocationsBefore = allocations;
+   for (int i = 0; i < calls; ++i)
+   {
+      invites.push_back(makeInvite(i));
+   }
+
+   size_t allocationsParsed = allocations;
+   UInt64 start = Timer::getTimeMs();
+   for (int i = 0; i < calls; ++i)
+   {
+      dum.internalProcess(std::auto_ptr<Message>(invites[i]));
+   }
+   UInt64 elapsed = Timer::getTimeMs() - start;
+
+   cout << calls << " calls in " << elapsed << " ms" << endl;
+   cout << "retained heap per call:    " << (liveBytes - bytesBefore) / calls << " bytes" << endl;
+   cout << "parse allocations per call: " 
+        << (double)(allocationsParsed - allocationsBefore) / calls << endl;
+   cout << "dum allocations per call:   " 
+        << (double)(allocations - allocationsParsed) / calls << endl;
+   cout << "object pools:" << endl;
+   ObjectPool::dump(cout);
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,373 @@
+// Checks that a DumThreadPool gives every Call-ID to exactly one loop: the
+// stack's isForMe() dispatch, dumForCallId(), the Call-IDs of new UAC dialog
+// sets and the loop that commands posted with DumThreadPool::post() run on
+// all agree on it.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "resip/dum/DialogUsageManager.hxx"
+#include "resip/dum/DumShutdownHandler.hxx"
+#include "resip/dum/DumThreadPool.hxx"
+#include "resip/dum/InviteSession.hxx"
+#include "resip/dum/MasterProfile.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "resip/stack/StackThread.hxx"
+#include "rutil/Condition.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Mutex.hxx"
+
+using namespace resip;
+using namespace std;
+
+static const unsigned int NumLoops = 4;
+
+struct ReplacesResult
+{
+   ReplacesResult() : mDum(0), mStatusCode(0) {}
+   Data mCallId;
+   DialogUsageManager* mDum;
+   int mStatusCode;
+};
+
+class RecordReplaces : public DumThreadPool::ReplacesCommand
+{
+   public:
+      RecordReplaces(const CallId& replaces, ReplacesResult& result,
+                     Mutex& mutex, Condition& done, int& pending)
+         : ReplacesCommand(replaces),
+           mResult(result),
+           mMutex(mutex),
+           mDone(done),
+           mPending(pending)
+      {}
+
+      virtual void onInviteSession(DialogUsageManager& dum,
+                                   InviteSessionHandle session,
+                                   int errorStatusCode)
+      {
+         assert(!session.isValid());
+         Lock lock(mMutex);
+         mResult.mDum = &dum;
+         mResult.mStatusCode = errorStatusCode;
+         --mPending;
+         mDone.signal();
+      }
+
+   private:
+      ReplacesResult& mResult;
+      Mutex& mMutex;
+      Condition& mDone;
+      int& mPending;
+};
+
+struct SessionResult
+{
+   SessionResult() : mDum(0), mValid(true) {}
+   Data mCallId;
+   DialogUsageManager* mDum;
+   bool mValid;
+};
+
+class RecordSession : public DumThreadPool::InviteSessionCommand
+{
+   public:
+      RecordSession(const DialogId& id, SessionResult& result,
+                    Mutex& mutex, Condition& done, int& pending)
+         : InviteSessionCommand(id),
+           mResult(result),
+           mMutex(mutex),
+           mDone(done),
+           mPending(pending)
+      {}
+
+      virtual void onInviteSession(DialogUsageManager& dum, InviteSessionHandle session)
+      {
+         Lock lock(mMutex);
+         mResult.mDum = &dum;
+         mResult.mValid = session.isValid();
+         --mPending;
+         mDone.signal();
+      }
+
+   private:
+      SessionResult& mResult;
+      Mutex& mMutex;
+      Condition& mDone;
+      int& mPending;
+};
+
+class ShutdownWaiter : public DumShutdownHandler
+{
+   public:
+      ShutdownWaiter() : mDone(false) {}
+
+      virtual void onDumCanBeDeleted()
+      {
+         Lock lock(mMutex);
+         mDone = true;
+         mCondition.signal();
+      }
+
+      void wait()
+      {
+         Lock lock(mMutex);
+         while (!mDone)
+         {
+            mCondition.wait(mMutex);
+         }
+      }
+
+   private:
+      Mutex mMutex;
+      Condition mCondition;
+      bool mDone;
+};
+
+// asks a TU the question the stack's TuSelector asks it - isForMe() is protected
+class TuSelectorProbe : public TransactionUser
+{
+   public:
+      static bool accepts(const TransactionUser& tu, const SipMessage& msg)
+      {
+         bool (TransactionUser::*check)(const SipMessage&) const = &TuSelectorProbe::isForMe;
+         return (tu.*check)(msg);
+      }
+};
+
+// the stack selects the first TU whose isForMe() accepts the request
+static unsigned int
+acceptingLoops(DumThreadPool& pool, const SipMessage& request, DialogUsageManager** last)
+{
+   unsigned int count = 0;
+   for (unsigned int i = 0; i < pool.size(); ++i)
+   {
+      if (TuSelectorProbe::accepts(pool.dum(i), request))
+      {
+         ++count;
+         *last = &pool.dum(i);
+      }
+   }
+   return count;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   const int numCallIds = argc > 1 ? atoi(argv[1]) : 1000;
+
+   SipStack stack;
+   StackThread stackThread(stack);
+   DumThreadPool pool(stack, NumLoops);
+   assert(pool.size() == NumLoops);
+
+   NameAddr target("sip:bob@127.0.0.1");
+   NameAddr from("sip:alice@example.com");
+   for (unsigned int i = 0; i < pool.size(); ++i)
+   {
+      SharedPtr<MasterProfile> profile(new MasterProfile);
+      profile->setDefaultFrom(from);
+      pool.dum(i).setMasterProfile(profile);
+   }
+
+   // every Call-ID belongs to exactly one loop, and only that loop takes its requests
+   unsigned int perLoop[NumLoops] = {0};
+   for (int n = 0; n < numCallIds; ++n)
+   {
+      Data callId(Helper::computeCallId());
+      DialogUsageManager& owner = pool.dumForCallId(callId);
+
+      unsigned int mine = 0;
+      for (unsigned int i = 0; i < pool.size(); ++i)
+      {
+         if (pool.dum(i).isMyCallId(callId))
+         {
+            ++mine;
+            assert(&pool.dum(i) == &owner);
+            assert(owner.getLoopIndex() == i);
+            ++perLoop[i];
+         }
+      }
+      assert(mine == 1);
+
+      // the initial request, a CANCEL and an in-dialog request all land on the owner
+      SharedPtr<SipMessage> invite(Helper::makeRequest(target, from, INVITE));
+      invite->header(h_CallId).value() = callId;
+      DialogUsageManager* selected = 0;
+      assert(acceptingLoops(pool, *invite, &selected) == 1);
+      assert(selected == &owner);
+
+      auto_ptr<SipMessage> cancel(Helper::makeCancel(*invite));
+      assert(acceptingLoops(pool, *cancel, &selected) == 1);
+      assert(selected == &owner);
+
+      SharedPtr<SipMessage> bye(Helper::makeRequest(target, from, BYE));
+      bye->header(h_CallId).value() = callId;
+      bye->header(h_To).param(p_tag) = "remote";
+      assert(acceptingLoops(pool, *bye, &selected) == 1);
+      assert(selected == &owner);
+   }
+   for (unsigned int i = 0; i < NumLoops; ++i)
+   {
+      cerr << "loop " << i << ": " << perLoop[i] << " Call-IDs" << endl;
+      assert(perLoop[i] > 0);
+   }
+
+   // a request without a usable Call-ID is for no loop
+   {
+      SharedPtr<SipMessage> options(Helper::makeRequest(target, from, OPTIONS));
+      options->remove(h_CallId);
+      DialogUsageManager* selected = 0;
+      assert(acceptingLoops(pool, *options, &selected) == 0);
+   }
+
+   // new UAC dialog sets get a Call-ID that hashes back to the loop that made them
+   for (unsigned int i = 0; i < pool.size(); ++i)
+   {
+      for (int n = 0; n < 20; ++n)
+      {
+         SharedPtr<SipMessage> request = pool.dum(i).makeOutOfDialogRequest(target, OPTIONS);
+         const Data& callId = request->header(h_CallId).value();
+         assert(pool.dum(i).isMyCallId(callId));
+         assert(&pool.dumForCallId(callId) == &pool.dum(i));
+         DialogUsageManager* selected = 0;
+         assert(acceptingLoops(pool, *request, &selected) == 1);
+         assert(selected == &pool.dum(i));
+         // there is no transport, so the request fails and its dialog set goes away
+         pool.dum(i).send(request);
+      }
+   }
+
+   stackThread.run();
+   pool.run();
+
+   // a ReplacesCommand runs on the loop that owns the replaced dialog
+   {
+      const int numCommands = 40;
+      Mutex mutex;
+      Condition done;
+      int pending = numCommands;
+      ReplacesResult results[numCommands];
+      for (int n = 0; n < numCommands; ++n)
+      {
+         CallId replaces;
+         replaces.value() = Helper::computeCallId();
+         replaces.param(p_toTag) = "to";
+         replaces.param(p_fromTag) = "from";
+         results[n].mCallId = replaces.value();
+         // the dum deletes the command once it has run
+         pool.post(std::auto_ptr<DumThreadPool::ReplacesCommand>(
+                      new RecordReplaces(replaces, results[n], mutex, done, pending)));
+      }
+      Lock lock(mutex);
+      while (pending > 0)
+      {
+         done.wait(mutex);
+      }
+      for (int n = 0; n < numCommands; ++n)
+      {
+         assert(results[n].mDum == &pool.dumForCallId(results[n].mCallId));
+         // no such dialog on the owning loop either
+         assert(results[n].mStatusCode == 481);
+      }
+   }
+
+   // an InviteSessionCommand gets the session handle on the loop that owns the dialog
+   {
+      const int numCommands = 40;
+      Mutex mutex;
+      Condition done;
+      int pending = numCommands;
+      SessionResult results[numCommands];
+      for (int n = 0; n < numCommands; ++n)
+      {
+         DialogId id(Helper::computeCallId(), "local", "remote");
+         results[n].mCallId = id.getCallId();
+#ifdef RESIP_HAS_RVALUE_REFS
+         pool.post(std::unique_ptr<DumThreadPool::InviteSessionCommand>(
+                      new RecordSession(id, results[n], mutex, done, pending)));
+#else
+         pool.post(std::auto_ptr<DumThreadPool::InviteSessionCommand>(
+                      new RecordSession(id, results[n], mutex, done, pending)));
+#endif
+      }
+      Lock lock(mutex);
+      while (pending > 0)
+      {
+         done.wait(mutex);
+      }
+      for (int n = 0; n < numCommands; ++n)
+      {
+         assert(results[n].mDum == &pool.dumForCallId(results[n].mCallId));
+         // there is no such session, so the handle is not valid
+         assert(!results[n].mValid);
+      }
+   }
+
+   ShutdownWaiter waiter;
+   pool.shutdown(&waiter);
+   waiter.wait();
+   pool.stop();
+   pool.join();
+   stackThread.shutdown();
+   stackThread.join();
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
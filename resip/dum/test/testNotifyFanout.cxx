@@ -0,0 +1,244 @@
+// Feeds SUBSCRIBEs for one resource from several peers straight into
+// DialogUsageManager::internalProcess and checks that NotifyFanout shares one
+// rendered body between all NOTIFYs, coalesces changes per watcher, keeps to
+// the per pass budget and sends NOTIFYs grouped by connection.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+#include "resip/dum/DialogUsageManager.hxx"
+#include "resip/dum/MasterProfile.hxx"
+#include "resip/dum/NotifyFanout.hxx"
+#include "resip/dum/ServerSubscription.hxx"
+#include "resip/dum/SubscriptionHandler.hxx"
+#include "resip/stack/PlainContents.hxx"
+#include "resip/stack/RenderedContents.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Timer.hxx"
+
+#ifdef WIN32
+#define usleep(x) Sleep(x/1000)
+#else
+#include <unistd.h>
+#endif
+
+using namespace resip;
+using namespace std;
+
+static const int NumConnections = 4;
+
+class FanoutHandler : public ServerSubscriptionHandler
+{
+   public:
+      FanoutHandler() : mFanout(0), mNotifies(0), mConnectionChanges(0) {}
+
+      virtual void onNewSubscription(ServerSubscriptionHandle h, const SipMessage& sub)
+      {
+         h->send(h->accept(200));
+         bool sent = mFanout->notifyNow(h);
+         assert(sent);
+      }
+
+      virtual void onTerminated(ServerSubscriptionHandle h)
+      {
+         mFanout->remove(h);
+      }
+
+      virtual void onReadyToSend(ServerSubscriptionHandle h, SipMessage& msg)
+      {
+         if (!msg.isRequest() || msg.header(h_RequestLine).method() != NOTIFY)
+         {
+            return;
+         }
+         ++mNotifies;
+         const RenderedContents* body = dynamic_cast<const RenderedContents*>(msg.getContents());
+         assert(body);
+         mBodies.insert(&body->body());
+         mLastBody = body->body();
+
+         const Tuple& connection = h->getLastSubscribe().getSource();
+         if (mNotifies > 1 && !(connection == mLastConnection))
+         {
+            ++mConnectionChanges;
+         }
+         mLastConnection = connection;
+      }
+
+      void reset()
+      {
+         mNotifies = 0;
+         mConnectionChanges = 0;
+         mBodies.clear();
+      }
+
+      NotifyFanout* mFanout;
+      int mNotifies;
+      int mConnectionChanges;
+      std::set<const Data*> mBodies;
+      Data mLastBody;
+      Tuple mLastConnection;
+};
+
+static SipMessage*
+makeSubscribe(int n)
+{
+   Data txt;
+   {
+      DataStream strm(txt);
+      strm << "SUBSCRIBE sip:bob@example.com SIP/2.0\r\n"
+           << "Via: SIP/2.0/UDP 10.0.0." << (n % NumConnections) + 1 << ":5060;branch=z9hG4bK-" << n << "-f4n0ut\r\n"
+           << "Max-Forwards: 70\r\n"
+           << "From: <sip:watcher" << n << "@example.com>;tag=" << n << "-8a7b\r\n"
+           << "To: <sip:bob@example.com>\r\n"
+           << "Call-ID: " << n << "-fanout@10.0.0." << (n % NumConnections) + 1 << "\r\n"
+           << "CSeq: 1 SUBSCRIBE\r\n"
+           << "Contact: <sip:watcher" << n << "@10.0.0." << (n % NumConnections) + 1 << ":5060>\r\n"
+           << "Event: presence\r\n"
+           << "Accept: text/plain\r\n"
+           << "Expires: 3600\r\n"
+           << "Content-Length: 0\r\n"
+           << "\r\n";
+   }
+   SipMessage* msg = SipMessage::make(txt, true);
+   Data host("10.0.0.");
+   host += Data((n % NumConnections) + 1);
+   msg->setSource(Tuple(host, 5060, UDP));
+   return msg;
+}
+
+static PlainContents
+makeState(int version)
+{
+   Data text("open ");
+   text += Data(version);
+   return PlainContents(text);
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   int watchers = argc > 1 ? atoi(argv[1]) : 200;
+
+   SipStack stack;
+   DialogUsageManager dum(stack);
+   SharedPtr<MasterProfile> profile(new MasterProfile);
+   profile->addSupportedMethod(SUBSCRIBE);
+   profile->addAllowedEvent(Token("presence"));
+   profile->addSupportedMimeType(SUBSCRIBE, PlainContents::getStaticType());
+   dum.setMasterProfile(profile);
+
+   FanoutHandler handler;
+   dum.addServerSubscriptionHandler("presence", &handler);
+
+   NotifyFanout fanout(dum, "presence");
+   fanout.setMinNotifyInterval(200);
+   handler.mFanout = &fanout;
+
+   int version = 1;
+   fanout.update("bob@example.com", makeState(version));
+   assert(fanout.numPending() == 0);
+
+   for (int i = 0; i < watchers; ++i)
+   {
+      dum.internalProcess(std::auto_ptr<Message>(makeSubscribe(i)));
+   }
+   assert(handler.mNotifies == watchers);
+   assert(handler.mBodies.size() == 1);
+   cerr << "initial NOTIFYs share one body" << endl;
+
+   // a burst of changes inside the minimum interval is coalesced
+   handler.reset();
+   for (int i = 0; i < 5; ++i)
+   {
+      fanout.update("bob@example.com", makeState(++version));
+   }
+   assert(fanout.numPending() == (unsigned int)watchers);
+   fanout.process();
+   assert(handler.mNotifies == 0);
+
+   usleep(250*1000);
+   fanout.process();
+   assert(handler.mNotifies == watchers);
+   assert(handler.mBodies.size() == 1);
+   assert(handler.mLastBody == makeState(version).text());
+   assert(handler.mConnectionChanges == NumConnections - 1);
+   assert(fanout.numPending() == 0);
+   cerr << "coalesced " << 5 * watchers << " changes into " << handler.mNotifies << " NOTIFYs" << endl;
+
+   // per pass budget
+   handler.reset();
+   fanout.setMaxNotifiesPerPass(watchers / 2);
+   usleep(250*1000);
+   fanout.update("bob@example.com", makeState(++version));
+   fanout.process();
+   assert(handler.mNotifies == watchers / 2);
+   assert(fanout.numPending() == (unsigned int)(watchers - watchers / 2));
+   fanout.process();
+   assert(handler.mNotifies == watchers);
+   assert(fanout.numPending() == 0);
+   cerr << "per pass budget respected" << endl;
+
+   // nothing to send for a resource nobody watches
+   handler.reset();
+   fanout.update("alice@example.com", makeState(1));
+   assert(fanout.numPending() == 0);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
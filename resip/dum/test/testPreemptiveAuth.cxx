@@ -0,0 +1,247 @@
+// Drives ClientAuthManager through a digest challenge on one dialog set and
+// checks that, with preemptive authentication enabled, the first request of a
+// second dialog set to the same realm already carries Authorization, and that
+// the nonce count the dialog sets share keeps increasing without repeating.
+// Also covers a stale nonce on a preemptively authenticated request, and the
+// limits on how many credentials are cached and for how long.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <set>
+
+#include "resip/dum/ClientAuthManager.hxx"
+#include "resip/dum/UserProfile.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+static const Data Realm("example.com");
+static const Data Password("secret");
+
+static SipMessage*
+makeInvite(const NameAddr& target, const NameAddr& from)
+{
+   SipMessage* invite = Helper::makeRequest(target, from, INVITE);
+   invite->header(h_From).param(p_tag) = Helper::computeTag(4);
+   return invite;
+}
+
+// returns the nc of the request's Authorization, which must be a valid answer to the challenge
+static unsigned long
+checkAuthorization(const SipMessage& request)
+{
+   assert(request.exists(h_Authorizations));
+   assert(request.header(h_Authorizations).size() == 1);
+   const Auth& auth = request.header(h_Authorizations).front();
+   assert(auth.param(p_realm) == Realm);
+   assert(Helper::authenticateRequest(request, Realm, Password) == Helper::Authenticated);
+   return strtoul(auth.param(p_nc).c_str(), 0, 16);
+}
+
+// a new dialog set to target that is challenged once and then accepted
+static void
+authenticate(ClientAuthManager& authManager, UserProfile& profile, const NameAddr& target, const NameAddr& from)
+{
+   auto_ptr<SipMessage> request(makeInvite(target, from));
+   authManager.addAuthentication(profile, *request);
+   if (!request->exists(h_Authorizations))
+   {
+      auto_ptr<SipMessage> challenge(Helper::makeWWWChallenge(*request, Realm));
+      assert(authManager.handle(profile, *request, *challenge));
+      authManager.addAuthentication(profile, *request);
+   }
+   checkAuthorization(*request);
+   auto_ptr<SipMessage> ok(Helper::makeResponse(*request, 200));
+   assert(!authManager.handle(profile, *request, *ok));
+}
+
+static bool
+isPreemptivelyAuthenticated(ClientAuthManager& authManager, UserProfile& profile, const NameAddr& target, const NameAddr& from)
+{
+   auto_ptr<SipMessage> request(makeInvite(target, from));
+   authManager.addAuthentication(profile, *request);
+   return request->exists(h_Authorizations);
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   const int numRequests = argc > 1 ? atoi(argv[1]) : 20;
+
+   NameAddr target("sip:bob@example.com");
+   NameAddr from("sip:alice@example.com");
+
+   UserProfile profile;
+   profile.setDefaultFrom(from);
+   profile.setDigestCredential(Realm, "alice", Password);
+   profile.setPreemptiveAuthenticationEnabled(true);
+
+   ClientAuthManager authManager;
+   set<unsigned long> nonceCounts;
+
+   // the first dialog set is challenged and answers the challenge
+   auto_ptr<SipMessage> first(makeInvite(target, from));
+   authManager.addAuthentication(profile, *first);
+   assert(!first->exists(h_Authorizations));
+   {
+      auto_ptr<SipMessage> challenge(Helper::makeWWWChallenge(*first, Realm));
+      assert(authManager.handle(profile, *first, *challenge));
+   }
+   authManager.addAuthentication(profile, *first);
+   nonceCounts.insert(checkAuthorization(*first));
+   {
+      auto_ptr<SipMessage> ok(Helper::makeResponse(*first, 200));
+      assert(!authManager.handle(profile, *first, *ok));
+   }
+
+   // a second dialog set to the same realm is sent with Authorization straight away
+   auto_ptr<SipMessage> second(makeInvite(target, from));
+   assert(!(DialogSetId(*second) == DialogSetId(*first)));
+   authManager.addAuthentication(profile, *second);
+   unsigned long nc = checkAuthorization(*second);
+   assert(nonceCounts.insert(nc).second);
+   assert(second->header(h_Authorizations).front().param(p_nonce) ==
+          first->header(h_Authorizations).front().param(p_nonce));
+
+   // both dialog sets keep drawing from the one count
+   unsigned long last = nc;
+   for (int i = 0; i < numRequests; ++i)
+   {
+      SipMessage& request = (i % 2) ? *first : *second;
+      request.header(h_CSeq).sequence()++;
+      authManager.addAuthentication(profile, request);
+      nc = checkAuthorization(request);
+      assert(nc > last);
+      assert(nonceCounts.insert(nc).second);
+      last = nc;
+   }
+   cerr << "nc reached " << last << " over " << nonceCounts.size() << " requests" << endl;
+   assert(nonceCounts.size() == (size_t)numRequests + 2);
+
+   // the server finds the cached nonce stale: the request is answered again with the new nonce,
+   // and the cache is refreshed with it rather than dropped
+   const Data oldNonce = second->header(h_Authorizations).front().param(p_nonce);
+   const Data newNonce = Helper::makeNonce(*second, Data(Timer::getTimeSecs() + 1));
+   assert(newNonce != oldNonce);
+   {
+      auto_ptr<SipMessage> challenge(Helper::makeWWWChallenge(*second, Realm, true, true));
+      assert(challenge->header(h_WWWAuthenticates).front().param(p_stale) == "true");
+      challenge->header(h_WWWAuthenticates).front().param(p_nonce) = newNonce;
+      assert(authManager.handle(profile, *second, *challenge));
+   }
+   // until then, new dialog sets still get the old nonce
+   assert(isPreemptivelyAuthenticated(authManager, profile, target, from));
+   authManager.addAuthentication(profile, *second);
+   assert(second->header(h_Authorizations).front().param(p_nonce) == newNonce);
+   assert(checkAuthorization(*second) == 1);
+   {
+      auto_ptr<SipMessage> ok(Helper::makeResponse(*second, 200));
+      assert(!authManager.handle(profile, *second, *ok));
+   }
+   {
+      auto_ptr<SipMessage> fourth(makeInvite(target, from));
+      authManager.addAuthentication(profile, *fourth);
+      assert(fourth->header(h_Authorizations).front().param(p_nonce) == newNonce);
+      assert(checkAuthorization(*fourth) == 2);
+   }
+
+   // a different target is not sent the cached credentials
+   {
+      auto_ptr<SipMessage> other(makeInvite(NameAddr("sip:carol@other.example.org"), from));
+      authManager.addAuthentication(profile, *other);
+      assert(!other->exists(h_Authorizations));
+   }
+
+   // and neither is anyone once preemptive authentication is turned off
+   {
+      profile.setPreemptiveAuthenticationEnabled(false);
+      auto_ptr<SipMessage> third(makeInvite(target, from));
+      authManager.addAuthentication(profile, *third);
+      assert(!third->exists(h_Authorizations));
+   }
+
+   // only as many (From AOR, target) pairs as allowed are cached - the oldest goes first
+   {
+      profile.setPreemptiveAuthenticationEnabled(true);
+      ClientAuthManager bounded;
+      bounded.setPreemptiveCacheLimits(2, 3600);
+      NameAddr a("sip:bob@a.example.com");
+      NameAddr b("sip:bob@b.example.com");
+      NameAddr c("sip:bob@c.example.com");
+      authenticate(bounded, profile, a, from);
+      authenticate(bounded, profile, b, from);
+      assert(isPreemptivelyAuthenticated(bounded, profile, a, from));
+      authenticate(bounded, profile, c, from);
+      assert(!isPreemptivelyAuthenticated(bounded, profile, a, from));
+      assert(isPreemptivelyAuthenticated(bounded, profile, b, from));
+      assert(isPreemptivelyAuthenticated(bounded, profile, c, from));
+   }
+
+   // and cached credentials expire
+   {
+      ClientAuthManager expiring;
+      expiring.setPreemptiveCacheLimits(1000, 0);
+      authenticate(expiring, profile, target, from);
+      assert(!isPreemptivelyAuthenticated(expiring, profile, target, from));
+   }
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,325 @@
+#include "AudioMixer.hxx"
+#include "ReconSubsystem.hxx"
+
+#include <rutil/Lock.hxx>
+#include <rutil/Log.hxx>
+#include <rutil/Logger.hxx>
+
+#include <string.h>
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RECON_MIXER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace recon;
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM ReconSubsystem::RECON
+
+// Gains are applied in Q15 - unity gain is 32768, which is added without a multiply
+#define Q15_UNITY 32768
+#define UNDETERMINED_GAIN -1
+
+static int 
+toQ15(int weight)
+{
+   if(weight <= 0) return 0;
+   if(weight >= AudioMixer::UnityGain) return Q15_UNITY;
+   return (weight * Q15_UNITY) / AudioMixer::UnityGain;
+}
+
+static inline short 
+saturate(int sample)
+{
+   if(sample > 32767) return 32767;
+   if(sample < -32768) return -32768;
+   return (short)sample;
+}
+
+AudioMixer::AudioMixer(unsigned int numPorts) :
+   mNumPorts(numPorts),
+   mWeights(numPorts * numPorts, 0),
+   mWeightsChanged(true),
+   mNumMixes(0)
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+}
+
+void 
+AudioMixer::setMixWeightsForOutput(unsigned int output, const int* weights)
+{
+   assert(output < mNumPorts);
+   Lock lock(mMutex);
+   for(unsigned int i = 0; i < mNumPorts; i++)
+   {
+      mWeights[output * mNumPorts + i] = toQ15(weights[i]);
+   }
+   mWeightsChanged = true;
+}
+
+void 
+AudioMixer::setMixWeight(unsigned int output, unsigned int input, int weight)
+{
+   assert(output < mNumPorts && input < mNumPorts);
+   Lock lock(mMutex);
+   mWeights[output * mNumPorts + input] = toQ15(weight);
+   mWeightsChanged = true;
+}
+
+int 
+AudioMixer::getMixWeight(unsigned int output, unsigned int input)
+{
+   assert(output < mNumPorts && input < mNumPorts);
+   Lock lock(mMutex);
+   return (mWeights[output * mNumPorts + input] * UnityGain + Q15_UNITY / 2) / Q15_UNITY;
+}
+
+void 
+AudioMixer::buildMixGroups()
+{
+   // Greedily group each output with the following outputs that can share its mix.  An output with
+   // weights r can join a group with gains G if r == G, or (for mix-minus) if it does not hear itself 
+   // and r == G everywhere except for its own input.  Gains of the inputs of mix-minus outputs are 
+   // undetermined, until another output in the group determines them.
+   mMixGroups.clear();
+   vector<bool> grouped(mNumPorts, false);
+   for(unsigned int i = 0; i < mNumPorts; i++)
+   {
+      if(grouped[i]) continue;
+
+      MixGroup group;
+      const int* row = &mWeights[i * mNumPorts];
+      group.mGains.assign(row, row + mNumPorts);
+      if(row[i] == 0)
+      {
+         group.mGains[i] = UNDETERMINED_GAIN;
+         group.mMinusOutputs.push_back(i);
+      }
+      else
+      {
+         group.mOutputs.push_back(i);
+      }
+      grouped[i] = true;
+
+      for(unsigned int k = i + 1; k < mNumPorts; k++)
+      {
+         if(grouped[k]) continue;
+
+         row = &mWeights[k * mNumPorts];
+         bool minus = row[k] == 0;
+         unsigned int j;
+         for(j = 0; j < mNumPorts; j++)
+         {
+            if(minus && j == k) continue;
+            if(group.mGains[j] != UNDETERMINED_GAIN && group.mGains[j] != row[j]) break;
+         }
+         if(j != mNumPorts) continue;  // No match
+
+         for(j = 0; j < mNumPorts; j++)
+         {
+            if(group.mGains[j] == UNDETERMINED_GAIN && !(minus && j == k))
+            {
+               group.mGains[j] = row[j];
+            }
+         }
+         if(minus)
+         {
+            group.mMinusOutputs.push_back(k);
+         }
+         else
+         {
+            group.mOutputs.push_back(k);
+         }
+         grouped[k] = true;
+      }
+
+      // Gains that no output determined are only used by the mix-minus output that does not hear them
+      for(unsigned int j = 0; j < mNumPorts; j++)
+      {
+         if(group.mGains[j] == UNDETERMINED_GAIN)
+         {
+            group.mGains[j] = 0;
+         }
+      }
+      mMixGroups.push_back(group);
+   }
+   DebugLog(<< "AudioMixer: " << mNumPorts << " outputs mixed in " << mMixGroups.size() << " groups");
+}
+
+void 
+AudioMixer::accumulate(int* acc, const short* input, int gain, unsigned int numSamples)
+{
+   unsigned int i = 0;
+#ifdef RECON_MIXER_SSE2
+   if(gain == Q15_UNITY)
+   {
+      for(; i + 8 <= numSamples; i += 8)
+      {
+         __m128i x = _mm_loadu_si128((const __m128i*)&input[i]);
+         // Sign extend to 32 bits
+         __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+         __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+         _mm_storeu_si128((__m128i*)&acc[i], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&acc[i]), lo));
+         _mm_storeu_si128((__m128i*)&acc[i + 4], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&acc[i + 4]), hi));
+      }
+   }
+   else
+   {
+      __m128i g = _mm_set1_epi16((short)gain);
+      for(; i + 8 <= numSamples; i += 8)
+      {
+         __m128i x = _mm_loadu_si128((const __m128i*)&input[i]);
+         // 32 bit products from the low and high halves, then back to Q0
+         __m128i productLo = _mm_mullo_epi16(x, g);
+         __m128i productHi = _mm_mulhi_epi16(x, g);
+         __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(productLo, productHi), 15);
+         __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(productLo, productHi), 15);
+         _mm_storeu_si128((__m128i*)&acc[i], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&acc[i]), lo));
+         _mm_storeu_si128((__m128i*)&acc[i + 4], _mm_add_epi32(_mm_loadu_si128((const __m128i*)&acc[i + 4]), hi));
+      }
+   }
+#endif
+   for(; i < numSamples; i++)
+   {
+      acc[i] += (input[i] * gain) >> 15;
+   }
+}
+
+void 
+AudioMixer::store(short* output, const int* acc, const short* input, int gain, unsigned int numSamples)
+{
+   // Subtract the contribution of input (exactly as accumulate added it), then saturate to 16 bits
+   unsigned int i = 0;
+   if(!input) gain = 0;
+#ifdef RECON_MIXER_SSE2
+   __m128i g = _mm_set1_epi16((short)gain);
+   for(; i + 8 <= numSamples; i += 8)
+   {
+      __m128i lo = _mm_loadu_si128((const __m128i*)&acc[i]);
+      __m128i hi = _mm_loadu_si128((const __m128i*)&acc[i + 4]);
+      if(gain == Q15_UNITY)
+      {
+         __m128i x = _mm_loadu_si128((const __m128i*)&input[i]);
+         lo = _mm_sub_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+         hi = _mm_sub_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+      }
+      else if(gain != 0)
+      {
+         __m128i x = _mm_loadu_si128((const __m128i*)&input[i]);
+         __m128i productLo = _mm_mullo_epi16(x, g);
+         __m128i productHi = _mm_mulhi_epi16(x, g);
+         lo = _mm_sub_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(productLo, productHi), 15));
+         hi = _mm_sub_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(productLo, productHi), 15));
+      }
+      _mm_storeu_si128((__m128i*)&output[i], _mm_packs_epi32(lo, hi));  // saturating pack
+   }
+#endif
+   for(; i < numSamples; i++)
+   {
+      output[i] = saturate(gain ? acc[i] - ((input[i] * gain) >> 15) : acc[i]);
+   }
+}
+
+void 
+AudioMixer::mixFrame(const short* const* inputs, short* const* outputs, unsigned int numSamples)
+{
+   Lock lock(mMutex);
+   if(mWeightsChanged)
+   {
+      buildMixGroups();
+      mWeightsChanged = false;
+   }
+   if(mAccumulator.size() < numSamples)
+   {
+      mAccumulator.resize(numSamples);
+   }
+   int* acc = numSamples ? &mAccumulator[0] : 0;
+
+   mNumMixes = 0;
+   vector<MixGroup>::iterator it;
+   for(it = mMixGroups.begin(); it != mMixGroups.end(); it++)
+   {
+      // Skip groups with no outputs to mix
+      bool needed = false;
+      unsigned int m;
+      for(m = 0; m < it->mOutputs.size() && !needed; m++) needed = outputs[it->mOutputs[m]] != 0;
+      for(m = 0; m < it->mMinusOutputs.size() && !needed; m++) needed = outputs[it->mMinusOutputs[m]] != 0;
+      if(!needed) continue;
+
+      memset(acc, 0, numSamples * sizeof(int));
+      bool silent = true;
+      for(unsigned int j = 0; j < mNumPorts; j++)
+      {
+         if(it->mGains[j] && inputs[j])
+         {
+            accumulate(acc, inputs[j], it->mGains[j], numSamples);
+            silent = false;
+         }
+      }
+      if(!silent) mNumMixes++;
+
+      // Outputs with identical weights get a copy of the first one
+      short* first = 0;
+      for(m = 0; m < it->mOutputs.size(); m++)
+      {
+         short* output = outputs[it->mOutputs[m]];
+         if(!output) continue;
+         if(first)
+         {
+            memcpy(output, first, numSamples * sizeof(short));
+         }
+         else
+         {
+            store(output, acc, 0, 0, numSamples);
+            first = output;
+         }
+      }
+      for(m = 0; m < it->mMinusOutputs.size(); m++)
+      {
+         unsigned int port = it->mMinusOutputs[m];
+         if(!outputs[port]) continue;
+         store(outputs[port], acc, inputs[port], it->mGains[port], numSamples);
+      }
+   }
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -0,0 +1,129 @@
+#if !defined(AudioMixer_hxx)
+#define AudioMixer_hxx
+
+#include <vector>
+#include <rutil/Mutex.hxx>
+
+namespace recon
+{
+
+/**
+  This class is a native N-party audio mixer, driven by the same mix matrix
+  that BridgeMixer calculates for the sipX bridge: mix weight [output][input]
+  is the gain that input is heard with on output, where UnityGain (1000) 
+  is full volume - the MpBridgeGain scale.
+
+  Each frame, the inputs are accumulated in 32 bits (SSE2 vectorized when
+  available) and saturated to 16 bits on output.  Outputs are grouped so that
+  each mix is only computed once:
+   - outputs whose mix weights are the same, except that they do not hear 
+     themselves (the usual conference), share one accumulated mix, and each
+     gets the mix minus its own input
+   - outputs with identical mix weights get the same (copied) mix
+
+  Threading Notes:  the mix weights may be set from any thread - mixFrame 
+  must only be called from one thread at a time (ie. the media thread).
+*/
+
+class AudioMixer
+{
+public:  
+   enum { UnityGain = 1000 };
+
+   AudioMixer(unsigned int numPorts);
+   virtual ~AudioMixer();
+
+   unsigned int getNumPorts() const { return mNumPorts; }
+
+   /**
+     Sets the mix weights for an output - weights must contain
+     getNumPorts() gains, indexed by input port.  Gains above 
+     UnityGain are treated as UnityGain.
+   */
+   void setMixWeightsForOutput(unsigned int output, const int* weights);
+
+   /**
+     Sets a single mix weight.
+   */
+   void setMixWeight(unsigned int output, unsigned int input, int weight);
+   int getMixWeight(unsigned int output, unsigned int input);
+
+   /**
+     Mixes one frame of numSamples 16 bit samples.  inputs and outputs
+     are indexed by port, and must contain getNumPorts() entries.  A null
+     input is silence, and a null output is not mixed.  Outputs that hear
+     no inputs are set to silence.
+   */
+   void mixFrame(const short* const* inputs, short* const* outputs, unsigned int numSamples);
+
+   /**
+     Returns the number of accumulated mixes the last call to mixFrame 
+     needed - ie. with everyone in one conference this is 1, regardless 
+     of the number of participants.
+   */
+   unsigned int getNumMixes() const { return mNumMixes; }
+
+private:
+   // A set of outputs that share one accumulated mix: the outputs get 
+   // saturate(sum of mGains[j] * input j), and the mix-minus outputs get
+   // saturate(sum of mGains[j] * input j - mGains[m] * input m)
+   class MixGroup
+   {
+   public:
+      std::vector<int> mGains;                 // Q15 gain of each input
+      std::vector<unsigned int> mOutputs;
+      std::vector<unsigned int> mMinusOutputs;
+   };
+
+   void buildMixGroups();
+   static void accumulate(int* acc, const short* input, int gain, unsigned int numSamples);
+   static void store(short* output, const int* acc, const short* input, int gain, unsigned int numSamples);
+
+   const unsigned int mNumPorts;
+   std::vector<int> mWeights;  // [output * mNumPorts + input]
+
+   resip::Mutex mMutex;
+   bool mWeightsChanged;
+   std::vector<MixGroup> mMixGroups;
+   std::vector<int> mAccumulator;
+   unsigned int mNumMixes;
+};
+
+}
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
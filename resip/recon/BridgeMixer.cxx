@@ -18,7 +18,8 @@ using namespace std;
 #define RESIPROCATE_SUBSYSTEM ReconSubsystem::RECON
 
 BridgeMixer::BridgeMixer(ConversationManager& conversationManager) :
-   mConversationManager(conversationManager)
+   mConversationManager(conversationManager),
+   mAudioMixer(DEFAULT_BRIDGE_MAX_IN_OUTPUTS)
 {
    // Set default to 0 gain for entire matrix
    memset(mMixMatrix, 0, sizeof(mMixMatrix));
@@ -91,6 +92,13 @@ BridgeMixer::calculateMixWeightsForParticipant(Participant* participant)
       // Apply new bridge weights
       MprBridge::setMixWeightsForOutput(DEFAULT_BRIDGE_RESOURCE_NAME, *mConversationManager.getMediaInterface()->getMsgQ(), bridgePort, DEFAULT_BRIDGE_MAX_IN_OUTPUTS, mMixMatrix[bridgePort]);
       MprBridge::setMixWeightsForInput(DEFAULT_BRIDGE_RESOURCE_NAME, *mConversationManager.getMediaInterface()->getMsgQ(), bridgePort, DEFAULT_BRIDGE_MAX_IN_OUTPUTS, inputBridgeWeights);
+
+      // Apply the same weights to the native mixer
+      for(int i = 0; i < DEFAULT_BRIDGE_MAX_IN_OUTPUTS; i++)
+      {
+         mAudioMixer.setMixWeight(bridgePort, i, mMixMatrix[bridgePort][i]);
+         mAudioMixer.setMixWeight(i, bridgePort, mMixMatrix[i][bridgePort]);
+      }
    }   
 }
 
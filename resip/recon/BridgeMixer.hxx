@@ -4,6 +4,8 @@
 #include <mp/MprBridge.h>
 #include <mp/MpResourceTopology.h>
 
+#include "AudioMixer.hxx"
+
 namespace recon
 {
 class ConversationManager;
@@ -16,6 +18,10 @@ class Participant;
   application should call calculateMixWeightsForParticipant
   in order to have the changes detected and applied.
 
+  The mix matrix is also applied to a native AudioMixer (see
+  getAudioMixer), for applications that mix the bridge ports
+  themselves.
+
   Author: Scott Godin (sgodin AT SipSpectrum DOT com)
 */
 
@@ -47,9 +53,16 @@ public:
    */
    void outputBridgeMixWeights();
 
+   /**
+     Returns the native mixer, that mixes the bridge ports
+     with the current mixing matrix.
+   */
+   AudioMixer& getAudioMixer() { return mAudioMixer; }
+
 private:
    MpBridgeGain mMixMatrix[DEFAULT_BRIDGE_MAX_IN_OUTPUTS][DEFAULT_BRIDGE_MAX_IN_OUTPUTS];
    ConversationManager& mConversationManager;
+   AudioMixer mAudioMixer;
 };
 
 }
@@ -0,0 +1,289 @@
+// Tests the recon AudioMixer with synthetic PCM against a straightforward per-output mix, and 
+// benchmarks it in conference participants per core.
+//
+// Usage: testAudioMixer [numParticipants] [numFrames]
+
+#include "AudioMixer.hxx"
+
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include <rutil/Log.hxx>
+#include <rutil/Timer.hxx>
+
+using namespace recon;
+using namespace resip;
+using namespace std;
+
+#define SAMPLES_PER_FRAME 160     // 20ms at 8kHz
+#define FRAMES_PER_SECOND 50
+
+class Frames
+{
+public:
+   Frames(unsigned int numPorts, unsigned int numSamples) : 
+      mData(numPorts * numSamples), mPointers(numPorts) 
+   {
+      for(unsigned int i = 0; i < numPorts; i++) mPointers[i] = &mData[i * numSamples];
+   }
+   vector<short> mData;
+   vector<short*> mPointers;
+};
+
+// Gain as AudioMixer applies it
+static int 
+q15(int weight)
+{
+   if(weight <= 0) return 0;
+   if(weight >= AudioMixer::UnityGain) return 32768;
+   return (weight * 32768) / AudioMixer::UnityGain;
+}
+
+// Mixes each output on its own
+static void 
+referenceMix(const vector<int>& weights, unsigned int numPorts, const short* const* inputs, short* const* outputs, unsigned int numSamples)
+{
+   for(unsigned int o = 0; o < numPorts; o++)
+   {
+      if(!outputs[o]) continue;
+      for(unsigned int n = 0; n < numSamples; n++)
+      {
+         int sum = 0;
+         for(unsigned int i = 0; i < numPorts; i++)
+         {
+            if(inputs[i]) sum += (inputs[i][n] * q15(weights[o * numPorts + i])) >> 15;
+         }
+         outputs[o][n] = sum > 32767 ? 32767 : (sum < -32768 ? -32768 : (short)sum);
+      }
+   }
+}
+
+// Speech-like synthetic PCM: a tone per port, plus noise
+static void 
+generatePcm(Frames& frames, unsigned int numPorts, unsigned int numSamples, unsigned int frame, int amplitude)
+{
+   for(unsigned int p = 0; p < numPorts; p++)
+   {
+      for(unsigned int n = 0; n < numSamples; n++)
+      {
+         double t = (double)(frame * numSamples + n) / 8000.0;
+         int sample = (int)(amplitude * sin(2 * 3.14159265 * (200 + 50 * p) * t)) + (rand() % 201) - 100;
+         frames.mPointers[p][n] = sample > 32767 ? 32767 : (sample < -32768 ? -32768 : (short)sample);
+      }
+   }
+}
+
+static void 
+setWeights(AudioMixer& mixer, const vector<int>& weights)
+{
+   for(unsigned int o = 0; o < mixer.getNumPorts(); o++)
+   {
+      mixer.setMixWeightsForOutput(o, &weights[o * mixer.getNumPorts()]);
+   }
+}
+
+// Mixes a few frames with both mixers - returns the number of mixes the AudioMixer needed
+static unsigned int 
+checkMix(const char* name, const vector<int>& weights, unsigned int numPorts, unsigned int numSamples, int amplitude, 
+         bool withNullInput = false)
+{
+   AudioMixer mixer(numPorts);
+   setWeights(mixer, weights);
+
+   Frames inputs(numPorts, numSamples);
+   Frames outputs(numPorts, numSamples);
+   Frames expected(numPorts, numSamples);
+   for(unsigned int frame = 0; frame < 3; frame++)
+   {
+      generatePcm(inputs, numPorts, numSamples, frame, amplitude);
+      vector<const short*> in(inputs.mPointers.begin(), inputs.mPointers.end());
+      if(withNullInput) in[numPorts / 2] = 0;
+      mixer.mixFrame(&in[0], &outputs.mPointers[0], numSamples);
+      referenceMix(weights, numPorts, &in[0], &expected.mPointers[0], numSamples);
+      if(outputs.mData != expected.mData)
+      {
+         cerr << name << ": FAILED - mixed output differs from the reference mix" << endl;
+         assert(false);
+         exit(-1);
+      }
+   }
+   cout << name << ": ok, " << mixer.getNumMixes() << " mixes for " << numPorts << " outputs" << endl;
+   return mixer.getNumMixes();
+}
+
+// Everyone hears everyone else
+static vector<int> 
+conferenceWeights(unsigned int numPorts, int gain = AudioMixer::UnityGain)
+{
+   vector<int> weights(numPorts * numPorts, gain);
+   for(unsigned int p = 0; p < numPorts; p++) weights[p * numPorts + p] = 0;
+   return weights;
+}
+
+static void 
+runTests()
+{
+   const unsigned int numPorts = 10;
+   unsigned int numMixes;
+
+   // Full conference - one mix, mix-minus for everyone
+   numMixes = checkMix("conference", conferenceWeights(numPorts), numPorts, SAMPLES_PER_FRAME, 3000);
+   assert(numMixes == 1);
+
+   // Loud conference - checks saturation, and that the mix-minus is taken before saturating
+   checkMix("loud conference", conferenceWeights(numPorts), numPorts, SAMPLES_PER_FRAME, 30000);
+
+   // Conference at 50% gain, and an odd frame size (not a multiple of the vector size)
+   checkMix("half gain conference", conferenceWeights(numPorts, 500), numPorts, 163, 20000);
+
+   // Conference with a port that is not sending
+   checkMix("null input", conferenceWeights(numPorts), numPorts, SAMPLES_PER_FRAME, 3000, true);
+
+   // Two conferences of 5
+   {
+      vector<int> weights(numPorts * numPorts, 0);
+      for(unsigned int o = 0; o < numPorts; o++)
+         for(unsigned int i = 0; i < numPorts; i++)
+            if(o != i && (o < 5) == (i < 5)) weights[o * numPorts + i] = AudioMixer::UnityGain;
+      numMixes = checkMix("two conferences", weights, numPorts, SAMPLES_PER_FRAME, 3000);
+      assert(numMixes == 2);
+   }
+
+   // Conference of 4, with 6 listen only participants (ie. a lecture) - the listeners hear the same mix
+   {
+      vector<int> weights(numPorts * numPorts, 0);
+      for(unsigned int o = 0; o < numPorts; o++)
+         for(unsigned int i = 0; i < 4; i++)
+            if(o != i) weights[o * numPorts + i] = AudioMixer::UnityGain;
+      numMixes = checkMix("lecture", weights, numPorts, SAMPLES_PER_FRAME, 3000);
+      assert(numMixes == 1);
+   }
+
+   // Port 0 hears everyone at 30% (ie. a recorder that also hears itself)
+   {
+      vector<int> weights = conferenceWeights(numPorts);
+      for(unsigned int i = 0; i < numPorts; i++) weights[i] = 300;
+      checkMix("recorder", weights, numPorts, SAMPLES_PER_FRAME, 3000);
+   }
+
+   // Random matrices
+   for(unsigned int r = 0; r < 50; r++)
+   {
+      vector<int> weights(numPorts * numPorts);
+      static const int gains[] = { 0, 0, 0, 250, 500, 1000, 1000, 1000 };
+      for(unsigned int w = 0; w < weights.size(); w++) weights[w] = gains[rand() % 8];
+      checkMix("random", weights, numPorts, 1 + rand() % 400, 10000 + rand() % 20000);
+   }
+
+   // Weights that change between frames
+   {
+      AudioMixer mixer(numPorts);
+      vector<int> weights = conferenceWeights(numPorts);
+      setWeights(mixer, weights);
+      Frames inputs(numPorts, SAMPLES_PER_FRAME);
+      Frames outputs(numPorts, SAMPLES_PER_FRAME);
+      Frames expected(numPorts, SAMPLES_PER_FRAME);
+      for(unsigned int frame = 0; frame < 20; frame++)
+      {
+         unsigned int o = rand() % numPorts;
+         unsigned int i = rand() % numPorts;
+         weights[o * numPorts + i] = (rand() % 3) * 500;
+         mixer.setMixWeight(o, i, weights[o * numPorts + i]);
+         assert(mixer.getMixWeight(o, i) == weights[o * numPorts + i]);
+         generatePcm(inputs, numPorts, SAMPLES_PER_FRAME, frame, 8000);
+         mixer.mixFrame(&inputs.mPointers[0], &outputs.mPointers[0], SAMPLES_PER_FRAME);
+         referenceMix(weights, numPorts, &inputs.mPointers[0], &expected.mPointers[0], SAMPLES_PER_FRAME);
+         assert(outputs.mData == expected.mData);
+      }
+      cout << "changing weights: ok" << endl;
+   }
+}
+
+static void 
+runBenchmark(unsigned int numParticipants, unsigned int numFrames)
+{
+   vector<int> weights = conferenceWeights(numParticipants);
+   AudioMixer mixer(numParticipants);
+   setWeights(mixer, weights);
+
+   Frames inputs(numParticipants, SAMPLES_PER_FRAME);
+   Frames outputs(numParticipants, SAMPLES_PER_FRAME);
+   generatePcm(inputs, numParticipants, SAMPLES_PER_FRAME, 0, 3000);
+
+   UInt64 start = Timer::getTimeMicroSec();
+   for(unsigned int frame = 0; frame < numFrames; frame++)
+   {
+      mixer.mixFrame(&inputs.mPointers[0], &outputs.mPointers[0], SAMPLES_PER_FRAME);
+   }
+   UInt64 mixerTime = Timer::getTimeMicroSec() - start;
+
+   start = Timer::getTimeMicroSec();
+   for(unsigned int frame = 0; frame < numFrames; frame++)
+   {
+      referenceMix(weights, numParticipants, &inputs.mPointers[0], &outputs.mPointers[0], SAMPLES_PER_FRAME);
+   }
+   UInt64 referenceTime = Timer::getTimeMicroSec() - start;
+
+   // Each participant needs FRAMES_PER_SECOND frames per second
+   double mixerParticipants = mixerTime ? (double)numParticipants * numFrames * 1000000.0 / mixerTime / FRAMES_PER_SECOND : 0;
+   double referenceParticipants = referenceTime ? (double)numParticipants * numFrames * 1000000.0 / referenceTime / FRAMES_PER_SECOND : 0;
+   cout << numParticipants << " party conference, " << SAMPLES_PER_FRAME << " samples per frame: " 
+        << (unsigned long)mixerParticipants << " participants per core (per output mixing: " 
+        << (unsigned long)referenceParticipants << ")" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   unsigned int numParticipants = argc > 1 ? atoi(argv[1]) : 32;
+   unsigned int numFrames = argc > 2 ? atoi(argv[2]) : 20000;
+
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   runTests();
+
+   runBenchmark(3, numFrames);
+   runBenchmark(numParticipants, numFrames);
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
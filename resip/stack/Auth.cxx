@@ -163,7 +163,7 @@ Auth::encodeAuthParameters(EncodeStream& str) const
          str << Symbols::COMMA;
       }
       first = false;
-      (*it)->encode(str);
+      getParameter(*it)->encode(str);
    }
 
    for (ParameterList::iterator it = mUnknownParameters.begin();
@@ -174,7 +174,7 @@ Auth::encodeAuthParameters(EncodeStream& str) const
          str << Symbols::COMMA;
       }
       first = false;
-      (*it)->encode(str);
+      getParameter(*it)->encode(str);
    }
    return str;
 }
@@ -8,6 +8,7 @@
 #include "resip/stack/ConnectionManager.hxx"
 #include "resip/stack/InteropHelper.hxx"
 #include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipTrace.hxx"
 #include "resip/stack/TcpBaseTransport.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -184,6 +185,11 @@ Connection::read(Fifo<TransactionMessage>& fifo)
    }  
    getConnectionManager().touch(this);
 
+   if (SipTrace::isActive())
+   {
+      SipTrace::received(who(), transport()->getTuple(), writePair.first, bytesRead);
+   }
+
 #ifdef USE_SIGCOMP
    // If this is the first data we read, determine whether the
    // connection is compressed.
@@ -0,0 +1,368 @@
+#include <string.h>
+
+#include "resip/stack/DigestVerifier.hxx"
+#include "resip/stack/Auth.hxx"
+#include "resip/stack/Contents.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/StatelessNonceHelper.hxx"
+#include "resip/stack/Symbols.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Sha256.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/vmd5.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::SIP
+
+namespace
+{
+
+static const char hexDigits[] = "0123456789abcdef";
+
+// H() of RFC 2617/7616 over either algorithm
+class DigestHash
+{
+   public:
+      DigestHash(DigestVerifier::Algorithm algorithm) : mAlgorithm(algorithm)
+      {
+         if (mAlgorithm == DigestVerifier::SHA256)
+         {
+            Sha256Init(&mSha256);
+         }
+         else
+         {
+            MD5Init(&mMd5);
+         }
+      }
+
+      void update(const char* buf, size_t len)
+      {
+         if (mAlgorithm == DigestVerifier::SHA256)
+         {
+            Sha256Update(&mSha256, (const unsigned char*)buf, (unsigned)len);
+         }
+         else
+         {
+            MD5Update(&mMd5, (const md5byte*)buf, (unsigned)len);
+         }
+      }
+
+      DigestHash& operator<<(const Data& data)
+      {
+         update(data.data(), data.size());
+         return *this;
+      }
+
+      DigestHash& operator<<(char c)
+      {
+         update(&c, 1);
+         return *this;
+      }
+
+      // writes lower case hex and a terminator
+      size_t finalHex(char* out)
+      {
+         unsigned char digest[32];
+         size_t len;
+         if (mAlgorithm == DigestVerifier::SHA256)
+         {
+            Sha256Final(digest, &mSha256);
+            len = 32;
+         }
+         else
+         {
+            MD5Final(digest, &mMd5);
+            len = 16;
+         }
+         for (size_t i = 0; i < len; ++i)
+         {
+            out[i*2] = hexDigits[digest[i] >> 4];
+            out[i*2+1] = hexDigits[digest[i] & 0x0f];
+         }
+         out[len*2] = 0;
+         return len*2;
+      }
+
+   private:
+      DigestVerifier::Algorithm mAlgorithm;
+      MD5Context mMd5;
+      Sha256Context mSha256;
+};
+
+// hex digests from clients may be upper case
+bool
+equalHex(const Data& received, const char* computed, size_t len)
+{
+   if (received.size() != len)
+   {
+      return false;
+   }
+   const char* r = received.data();
+   int diff = 0;
+   for (size_t i = 0; i < len; ++i)
+   {
+      diff |= (r[i] | 0x20) ^ computed[i];
+   }
+   return diff == 0;
+}
+
+}
+
+static const Data md5Name("MD5");
+static const Data sha256Name("SHA-256");
+static const Data digest("digest");
+
+bool
+DigestVerifier::getAlgorithm(const Auth& auth, Algorithm& algorithm)
+{
+   if (!auth.exists(p_algorithm) || isEqualNoCase(auth.param(p_algorithm), md5Name))
+   {
+      algorithm = MD5;
+      return true;
+   }
+   if (isEqualNoCase(auth.param(p_algorithm), sha256Name))
+   {
+      algorithm = SHA256;
+      return true;
+   }
+   return false;
+}
+
+const Data&
+DigestVerifier::algorithmName(Algorithm algorithm)
+{
+   return algorithm == SHA256 ? sha256Name : md5Name;
+}
+
+size_t
+DigestVerifier::computeHA1(Algorithm algorithm,
+                           const Data& username, 
+                           const Data& realm, 
+                           const Data& password,
+                           char hA1[MaxHexSize])
+{
+   DigestHash a1(algorithm);
+   a1 << username << ':' << realm << ':' << password;
+   return a1.finalHex(hA1);
+}
+
+size_t
+DigestVerifier::computeResponse(Algorithm algorithm,
+                                const Data& hA1,
+                                const Data& method, 
+                                const Data& digestUri, 
+                                const Data& nonce,
+                                const Data& qop, 
+                                const Data& cnonce, 
+                                const Data& nonceCount,
+                                const Contents* entityBody,
+                                char response[MaxHexSize])
+{
+   char hA2[MaxHexSize];
+   {
+      DigestHash a2(algorithm);
+      a2 << method << ':' << digestUri;
+      if (qop == Symbols::authInt)
+      {
+         DigestHash body(algorithm);
+         if (entityBody)
+         {
+            Data encoded;
+            {
+               DataStream ds(encoded);
+               ds << *entityBody;
+            }
+            body << encoded;
+         }
+         char hBody[MaxHexSize];
+         size_t len = body.finalHex(hBody);
+         a2 << ':';
+         a2.update(hBody, len);
+      }
+      a2.finalHex(hA2);
+   }
+
+   DigestHash r(algorithm);
+   r << hA1 << ':' << nonce << ':';
+   if (!qop.empty())
+   {
+      r << nonceCount << ':' << cnonce << ':' << qop << ':';
+   }
+   r.update(hA2, strlen(hA2));
+   return r.finalHex(response);
+}
+
+Helper::AuthResult
+DigestVerifier::authenticateRequest(const SipMessage& request,
+                                    const Data& realm,
+                                    const Data& hA1,
+                                    int expiresDelta,
+                                    bool proxyAuthorization)
+{
+   const ParserContainer<Auth>* auths = 0;
+   if (proxyAuthorization)
+   {
+      if (request.exists(h_ProxyAuthorizations))
+      {
+         auths = &request.header(h_ProxyAuthorizations);
+      }
+   }
+   else if (request.exists(h_Authorizations))
+   {
+      auths = &request.header(h_Authorizations);
+   }
+
+   if (!auths)
+   {
+      DebugLog (<< "No authentication headers. Failing request.");
+      return Helper::Failed;
+   }
+
+   for (ParserContainer<Auth>::const_iterator i = auths->begin(); i != auths->end(); ++i)
+   {
+      if (i->exists(p_realm) && i->param(p_realm) == realm &&
+          isEqualNoCase(i->scheme(), digest))
+      {
+         return authenticate(request, *i, hA1, expiresDelta);
+      }
+   }
+   return Helper::BadlyFormed;
+}
+
+Helper::AuthResult
+DigestVerifier::authenticate(const SipMessage& request,
+                             const Auth& auth,
+                             const Data& hA1,
+                             int expiresDelta)
+{
+   if (!auth.exists(p_nonce) || !auth.exists(p_response) || !auth.exists(p_uri))
+   {
+      return Helper::BadlyFormed;
+   }
+
+   Algorithm algorithm;
+   if (!getAlgorithm(auth, algorithm))
+   {
+      InfoLog (<< "Unsupported algorithm=" << auth.param(p_algorithm));
+      return Helper::Failed;
+   }
+
+   const Data* qop = &Data::Empty;
+   const Data* cnonce = &Data::Empty;
+   const Data* nonceCount = 0;
+   if (auth.exists(p_qop))
+   {
+      if (auth.param(p_qop) != Symbols::auth && auth.param(p_qop) != Symbols::authInt)
+      {
+         InfoLog (<< "Unsupported qop=" << auth.param(p_qop));
+         return Helper::Failed;
+      }
+      if (!auth.exists(p_cnonce) || !auth.exists(p_nc))
+      {
+         return Helper::BadlyFormed;
+      }
+      qop = &auth.param(p_qop);
+      cnonce = &auth.param(p_cnonce);
+      nonceCount = &auth.param(p_nc);
+   }
+
+   const Data& nonce = auth.param(p_nonce);
+   StatelessNonceHelper* stateless = dynamic_cast<StatelessNonceHelper*>(Helper::getNonceHelper());
+   if (stateless)
+   {
+      Helper::AuthResult result = stateless->checkNonce(nonce, request, nonceCount, expiresDelta);
+      if (result != Helper::Authenticated)
+      {
+         return result;
+      }
+   }
+   else
+   {
+      NonceHelper::Nonce x_nonce = Helper::getNonceHelper()->parseNonce(nonce);
+      if (x_nonce.getCreationTime() == 0)
+      {
+         return Helper::BadlyFormed;
+      }
+      if (expiresDelta > 0 && x_nonce.getCreationTime() + expiresDelta < Timer::getTimeSecs())
+      {
+         DebugLog(<< "Nonce has expired.");
+         return Helper::Expired;
+      }
+      if (!Helper::getNonceHelper()->isValidNonce(nonce, request))
+      {
+         InfoLog(<< "Not my nonce. received=" << nonce);
+         return Helper::BadlyFormed;
+      }
+   }
+
+   const RequestLine& rl = request.header(h_RequestLine);
+   const Data& method = rl.getMethod() == UNKNOWN ? rl.unknownMethodName() : getMethodName(rl.getMethod());
+
+   char response[MaxHexSize];
+   size_t len = computeResponse(algorithm, hA1, method, auth.param(p_uri), nonce,
+                                *qop, *cnonce, nonceCount ? *nonceCount : Data::Empty,
+                                request.getContents(), response);
+   if (!equalHex(auth.param(p_response), response, len))
+   {
+      return Helper::Failed;
+   }
+
+   // only an authenticated request may use up the nonce count
+   if (stateless && nonceCount && !stateless->recordNonceCount(nonce, *nonceCount))
+   {
+      return Helper::Expired;
+   }
+   return Helper::Authenticated;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,130 @@
+#if !defined(RESIP_DIGESTVERIFIER_HXX)
+#define RESIP_DIGESTVERIFIER_HXX
+
+#include "resip/stack/Helper.hxx"
+#include "rutil/Data.hxx"
+
+namespace resip
+{
+
+class Auth;
+class Contents;
+class SipMessage;
+
+/**
+   Server side digest verification without building intermediate Data
+   strings.  Hashes are computed directly from the parsed parameters into
+   stack buffers, so checking a request with a precomputed H(A1) does not
+   touch the heap (except for qop=auth-int, which needs the encoded body).
+
+   Supports the MD5 and SHA-256 (RFC 7616/RFC 8760) algorithms; the
+   algorithm is taken from the Authorization header, and H(A1) has to have
+   been computed with the same algorithm.
+
+   If the installed NonceHelper is a StatelessNonceHelper its replay window
+   is applied as well.
+*/
+class DigestVerifier
+{
+   public:
+      enum Algorithm
+      {
+         MD5,
+         SHA256
+      };
+
+      // large enough for a hex SHA-256 digest and terminator
+      enum { MaxHexSize = 65 };
+
+      // Absent algorithm means MD5.  Returns false for anything else,
+      // including the -sess variants.
+      static bool getAlgorithm(const Auth& auth, Algorithm& algorithm);
+      static const Data& algorithmName(Algorithm algorithm);
+
+      // writes hex H(username:realm:password) and returns its length
+      static size_t computeHA1(Algorithm algorithm,
+                               const Data& username, 
+                               const Data& realm, 
+                               const Data& password,
+                               char hA1[MaxHexSize]);
+
+      // writes the hex request-digest (RFC 2617 3.2.2.1) and returns its length
+      static size_t computeResponse(Algorithm algorithm,
+                                    const Data& hA1,
+                                    const Data& method, 
+                                    const Data& digestUri, 
+                                    const Data& nonce,
+                                    const Data& qop, 
+                                    const Data& cnonce, 
+                                    const Data& nonceCount,
+                                    const Contents* entityBody,
+                                    char response[MaxHexSize]);
+
+      // Same contract as Helper::advancedAuthenticateRequest, for the
+      // Authorization (or Proxy-Authorization) line matching realm.
+      static Helper::AuthResult authenticateRequest(const SipMessage& request,
+                                                    const Data& realm,
+                                                    const Data& hA1,
+                                                    int expiresDelta = 0,
+                                                    bool proxyAuthorization = true);
+
+      // checks a single Authorization line
+      static Helper::AuthResult authenticate(const SipMessage& request,
+                                             const Auth& auth,
+                                             const Data& hA1,
+                                             int expiresDelta = 0);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -5,6 +5,9 @@
 #include "ExtensionHeader.hxx"
 #include "HeaderTypes.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/compat.hxx"
 
 #include <cassert>
 #include "rutil/ParseBuffer.hxx"
@@ -13,8 +16,47 @@
 
 using namespace resip;
 
+namespace
+{
+// Registered names, open addressed by case-insensitive hash. Entries are
+// only ever added, and only at startup, so the lookups made while parsing
+// take no lock.
+struct Registry
+{
+      enum {TableSize = 2*ExtensionHeader::MaxRegistered};
+
+      Registry() : mCount(0)
+      {
+         for (int i = 0; i < TableSize; ++i)
+         {
+            mTable[i] = -1;
+         }
+      }
+
+      Mutex mMutex;
+      Data mNames[ExtensionHeader::MaxRegistered];
+      size_t mHashes[ExtensionHeader::MaxRegistered];
+      int mTable[TableSize];
+      int mCount;
+};
+
+Registry&
+registry()
+{
+   static Registry theRegistry;
+   return theRegistry;
+}
+
+size_t
+hashName(const Data& name)
+{
+   return Data::rawCaseInsensitiveHash((const unsigned char*)name.data(), name.size());
+}
+}
+
 ExtensionHeader::ExtensionHeader(const char* name)
-   : mName(name)
+   : mName(name),
+     mHash(hashName(mName))
 {
    assert(name);
    if (mName.empty())
@@ -26,7 +68,8 @@ ExtensionHeader::ExtensionHeader(const char* name)
 }
 
 ExtensionHeader::ExtensionHeader(const Data& name)
-   : mName(name)
+   : mName(name),
+     mHash(hashName(mName))
 {
    if (mName.empty())
    {
@@ -42,6 +85,97 @@ ExtensionHeader::getName() const
    return mName;
 }
 
+size_t
+ExtensionHeader::getHash() const
+{
+   return mHash;
+}
+
+int
+ExtensionHeader::getSlot() const
+{
+   return getSlot(mName.data(), (int)mName.size(), mHash);
+}
+
+int
+ExtensionHeader::registerHeader(const Data& name)
+{
+   if (name.empty())
+   {
+      assert(false);
+      throw Exception("Empty extension header",__FILE__,__LINE__);
+   }
+   assert(Headers::getType(name.data(), name.size()) == Headers::UNKNOWN);
+
+   Registry& reg = registry();
+   Lock lock(reg.mMutex);
+
+   const size_t hash = hashName(name);
+   int slot = getSlot(name.data(), (int)name.size(), hash);
+   if (slot >= 0)
+   {
+      return slot;
+   }
+
+   if (reg.mCount == MaxRegistered)
+   {
+      throw Exception("Too many registered extension headers: " + name,__FILE__,__LINE__);
+   }
+
+   slot = reg.mCount;
+   reg.mNames[slot] = name;
+   reg.mHashes[slot] = hash;
+   reg.mCount = slot + 1;
+
+   size_t bucket = hash % Registry::TableSize;
+   while (reg.mTable[bucket] != -1)
+   {
+      bucket = (bucket + 1) % Registry::TableSize;
+   }
+   reg.mTable[bucket] = slot;
+
+   DebugLog(<< "Registered extension header " << name << " in slot " << slot);
+   return slot;
+}
+
+int
+ExtensionHeader::getSlot(const char* name, int len, size_t hash)
+{
+   const Registry& reg = registry();
+   if (reg.mCount == 0)
+   {
+      return -1;
+   }
+
+   // the table is never more than half full, so this finds an empty
+   // bucket quickly when the name is not registered
+   for (size_t bucket = hash % Registry::TableSize; reg.mTable[bucket] != -1;
+        bucket = (bucket + 1) % Registry::TableSize)
+   {
+      const int slot = reg.mTable[bucket];
+      if (reg.mHashes[slot] == hash &&
+          reg.mNames[slot].size() == (Data::size_type)len &&
+          strncasecmp(reg.mNames[slot].data(), name, len) == 0)
+      {
+         return slot;
+      }
+   }
+   return -1;
+}
+
+const Data&
+ExtensionHeader::getSlotName(int slot)
+{
+   assert(slot >= 0 && slot < registry().mCount);
+   return registry().mNames[slot];
+}
+
+int
+ExtensionHeader::numSlots()
+{
+   return registry().mCount;
+}
+
 ExtensionHeader::Exception::Exception(const Data& msg, const Data& file, const int line)
    : BaseException(msg, file, line) 
 {}
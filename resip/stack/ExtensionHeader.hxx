@@ -3,6 +3,7 @@
 
 #include "rutil/Data.hxx"
 #include "rutil/BaseException.hxx"
+
 namespace resip
 {
 
@@ -13,6 +14,38 @@ class ExtensionHeader
       explicit ExtensionHeader(const Data& unknownHeaderName);
 
       const Data& getName() const;
+      // case-insensitive hash of the name, computed once at construction
+      size_t getHash() const;
+
+      /**
+         Registers name as a pseudo-known header: every SipMessage keeps
+         it in a slot of its own instead of the unknown header list, so
+         header(), exists() and remove() go straight to it. Registering
+         the same name twice returns the same slot.
+
+         Registration is meant for startup. It must be finished before
+         any message carrying the header is parsed or built; the lookups
+         done while parsing are not locked against it.
+
+         @return the slot of the header
+         @throw ExtensionHeader::Exception if MaxRegistered names are
+                already registered
+      */
+      static int registerHeader(const Data& name);
+
+      /**
+         @return the slot of a registered header name, -1 if the name
+                 is not registered. hash is the case-insensitive hash of
+                 the name (Data::rawCaseInsensitiveHash).
+      */
+      static int getSlot(const char* name, int len, size_t hash);
+      int getSlot() const;
+
+      // name a registered header is encoded with
+      static const Data& getSlotName(int slot);
+      static int numSlots();
+
+      enum {MaxRegistered = 32};
 
       class Exception : public BaseException
       {
@@ -23,6 +56,7 @@ class ExtensionHeader
 
    private:
       const Data mName;
+      const size_t mHash;
 };
 
 }
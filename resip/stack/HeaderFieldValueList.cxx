@@ -24,7 +24,9 @@ HeaderFieldValueList::~HeaderFieldValueList()
 
 HeaderFieldValueList::HeaderFieldValueList(const HeaderFieldValueList& rhs)
    : mHeaders(0),
-     mParserContainer(0)
+     mParserContainer(0),
+     mRefCount(1),
+     mShareable(true)
 {
    if (rhs.mParserContainer != 0)
    {
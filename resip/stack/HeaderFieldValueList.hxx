@@ -4,6 +4,8 @@
 #include <iosfwd>
 #include <vector>
 
+#include "rutil/AtomicCounter.hxx"
+
 namespace resip
 {
 
@@ -16,7 +18,9 @@ class HeaderFieldValueList
    public:
       HeaderFieldValueList()
          : mHeaders(), 
-           mParserContainer(0)
+           mParserContainer(0),
+           mRefCount(1),
+           mShareable(true)
       {}
 
       ~HeaderFieldValueList();
@@ -41,6 +45,16 @@ class HeaderFieldValueList
       const HeaderFieldValue* back() const {return mHeaders.back();}
 
       bool parsedEmpty() const;
+
+      // Copies of a SipMessage share the lists nobody has looked into yet.
+      // A list is shareable until something is given access to its
+      // contents; after that copies take their own.
+      void addRef() { mRefCount.increment(); }
+      // returns true if the caller held the last reference
+      bool removeRef() { return mRefCount.decrement() == 0; }
+      bool isShared() const { return mRefCount.value() > 1; }
+      bool isShareable() const { return mShareable; }
+      void setUnshareable() { mShareable = false; }
    private:
       typedef std::vector<HeaderFieldValue*> ListImpl;
    public:
@@ -55,6 +69,11 @@ class HeaderFieldValueList
    private:
       std::vector<HeaderFieldValue*> mHeaders;
       ParserContainerBase* mParserContainer;
+      AtomicCounter mRefCount;
+      bool mShareable;
+
+      // assignment would break sharing; not implemented
+      HeaderFieldValueList& operator=(const HeaderFieldValueList&);
 };
 
 }
@@ -616,9 +616,9 @@ Helper::computeUniqueBranch()
 {
    Data result(16, Data::Preallocate);
    result += cookie;
-   result += Random::getRandomHex(4);
+   Random::appendRandomHex(result, 4);
    result += "C1";
-   result += Random::getRandomHex(2);
+   Random::appendRandomHex(result, 2);
    return result;
 }
 
@@ -823,12 +823,10 @@ Helper::advancedAuthenticateRequest(const SipMessage& request,
                }
             }
 
-            Data then(x_nonce.getCreationTime());
-            if (i->param(p_nonce) != makeNonce(request, then))
+            if (!getNonceHelper()->isValidNonce(i->param(p_nonce), request))
             {
-               InfoLog(<< "Not my nonce. expected=" << makeNonce(request, then) 
-                       << " received=" << i->param(p_nonce)
-                       << " then=" << then);
+               InfoLog(<< "Not my nonce. received=" << i->param(p_nonce)
+                       << " then=" << x_nonce.getCreationTime());
                
                return make_pair(BadlyFormed,username);
             }
@@ -979,8 +977,7 @@ Helper::authenticateRequest(const SipMessage& request,
             }
          }
 
-         Data then(x_nonce.getCreationTime());
-         if (i->param(p_nonce) != makeNonce(request, then))
+         if (!getNonceHelper()->isValidNonce(i->param(p_nonce), request))
          {
             InfoLog(<< "Not my nonce.");
             return Failed;
@@ -1007,8 +1004,8 @@ Helper::authenticateRequest(const SipMessage& request,
                                                             i->param(p_nonce),
                                                             i->param(p_qop),
                                                             i->param(p_cnonce),
-                                                            i->param(p_nc)),
-                                                            request.getContents())
+                                                            i->param(p_nc),
+                                                            request.getContents()))
                   {
                      return Authenticated;
                   }
@@ -1134,9 +1131,7 @@ Helper::authenticateRequestWithA1(const SipMessage& request,
             }
          }
 
-         Data then(x_nonce.getCreationTime());
-
-         if (i->param(p_nonce) != makeNonce(request, then))
+         if (!getNonceHelper()->isValidNonce(i->param(p_nonce), request))
          {
             InfoLog(<< "Not my nonce.");
             return Failed;
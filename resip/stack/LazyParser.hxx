@@ -37,6 +37,7 @@ class LazyParser
       bool isParsed() const {return (mState!=NOT_PARSED);}
 
       HeaderFieldValue& getHeaderField() { return *mHeaderField; }
+      const HeaderFieldValue& getHeaderField() const { return *mHeaderField; }
 
       // call (internally) before every access 
       void checkParsed() const;
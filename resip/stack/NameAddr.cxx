@@ -219,7 +219,7 @@ NameAddr::parse(ParseBuffer& pb)
          for (ParameterList::iterator it = mParameters.begin(); 
               it != mParameters.end();)
          {
-            switch ((*it)->getType())
+            switch (it->getType())
             {
                case ParameterTypes::comp:             
                case ParameterTypes::lr:
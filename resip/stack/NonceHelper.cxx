@@ -15,6 +15,13 @@ NonceHelper::~NonceHelper()
 {
 }
 
+bool
+NonceHelper::isValidNonce(const Data& nonce, const SipMessage& request)
+{
+   Data then(parseNonce(nonce).getCreationTime());
+   return nonce == makeNonce(request, then);
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0
  *
@@ -30,6 +30,12 @@ class NonceHelper
       // Read a nonce string into a Nonce instance, so that we can inspect
       // the un-encrypted time stamp
       virtual NonceHelper::Nonce parseNonce(const Data& nonce) = 0;
+
+      // Returns true if nonce was issued by this helper for request.  The
+      // default regenerates the nonce from its timestamp and compares; 
+      // helpers whose nonces are not a pure function of (request, timestamp)
+      // must override this
+      virtual bool isValidNonce(const Data& nonce, const SipMessage& request);
 };
 
 }
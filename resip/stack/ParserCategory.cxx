@@ -12,9 +12,14 @@
 
 #include "resip/stack/UnknownParameter.hxx"
 #include "resip/stack/ExtensionParameter.hxx"
+#include "resip/stack/DataParameter.hxx"
+#include "resip/stack/QuotedDataParameter.hxx"
+#include "resip/stack/ExistsParameter.hxx"
+#include "resip/stack/ExistsOrDataParameter.hxx"
 
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 #include "rutil/Logger.hxx"
 #define RESIPROCATE_SUBSYSTEM Subsystem::SIP
@@ -26,24 +31,37 @@ using namespace std;
 const ParserCategory::ParameterTypeSet 
 ParserCategory::EmptyParameterTypeSet; 
 
+static const char* const ParameterTerminators = " \t\r\n;?>";
+
+ParserCategory::ParameterEntry::ParameterEntry(Parameter* param)
+   : mParam(param),
+     mText(0),
+     mLength(0),
+     mType(param->getType())
+{
+}
+
 ParserCategory::ParserCategory(HeaderFieldValue* headerFieldValue,
                                Headers::Type headerType)
     : LazyParser(headerFieldValue),
       mParameters(),
       mUnknownParameters(),
-      mHeaderType(headerType)
+      mHeaderType(headerType),
+      mParameterText(0)
 {
 }
 
 ParserCategory::ParserCategory()
    : LazyParser(),
-     mHeaderType(Headers::NONE)
+     mHeaderType(Headers::NONE),
+     mParameterText(0)
 {
 }
 
 ParserCategory::ParserCategory(const ParserCategory& rhs)
    : LazyParser(rhs),
-     mHeaderType(rhs.mHeaderType)
+     mHeaderType(rhs.mHeaderType),
+     mParameterText(0)
 {
    if (isParsed())
    {
@@ -76,31 +94,69 @@ ParserCategory::clear()
    for (ParameterList::iterator it = mParameters.begin();
         it != mParameters.end(); it++)
    {
-      delete *it;
+      delete it->mParam;
    }
    mParameters.clear();
 
    for (ParameterList::iterator it = mUnknownParameters.begin();
         it != mUnknownParameters.end(); it++)
    {
-      delete *it;
+      delete it->mParam;
    }   
    mUnknownParameters.clear();
+
+   delete [] mParameterText;
+   mParameterText = 0;
+}
+
+// Parameters that were never materialized are copied as text into a single
+// buffer rather than cloned one object at a time. Each copy is followed by a
+// NUL so a later parse of it stops where the original one did.
+void
+ParserCategory::copyParameterList(const ParameterList& from,
+                                  ParameterList& to,
+                                  char*& text)
+{
+   to.reserve(from.size());
+   for (ParameterList::const_iterator it = from.begin();
+        it != from.end(); it++)
+   {
+      if (it->mParam)
+      {
+         to.push_back(it->mParam->clone());
+      }
+      else
+      {
+         memcpy(text, it->mText, it->mLength);
+         to.push_back(ParameterEntry(it->mType, text, it->mLength));
+         text += it->mLength;
+         *text++ = 0;
+      }
+   }
 }
 
 void 
 ParserCategory::copyParametersFrom(const ParserCategory& other)
 {
-   for (ParameterList::iterator it = other.mParameters.begin();
+   size_t textSize = 0;
+   for (ParameterList::const_iterator it = other.mParameters.begin();
         it != other.mParameters.end(); it++)
    {
-      mParameters.push_back((*it)->clone());
+      textSize += it->mParam ? 0 : it->mLength + 1;
    }
-   for (ParameterList::iterator it = other.mUnknownParameters.begin();
+   for (ParameterList::const_iterator it = other.mUnknownParameters.begin();
         it != other.mUnknownParameters.end(); it++)
    {
-      mUnknownParameters.push_back((*it)->clone());
+      textSize += it->mParam ? 0 : it->mLength + 1;
    }
+
+   char* text = 0;
+   if (textSize)
+   {
+      text = mParameterText = new char[textSize];
+   }
+   copyParameterList(other.mParameters, mParameters, text);
+   copyParameterList(other.mUnknownParameters, mUnknownParameters, text);
 }
 
 ParserCategory::~ParserCategory()
@@ -129,7 +185,7 @@ ParserCategory::param(const ExtensionParameter& param)
    if (!p)
    {
       p = new UnknownParameter(param.getName());
-      mUnknownParameters.push_back(p);
+      mUnknownParameters.push_back(ParameterEntry(p));
    } 
    return static_cast<UnknownParameter*>(p)->value();
 }
@@ -138,8 +194,17 @@ bool
 ParserCategory::exists(const ParamBase& paramType) const
 {
     checkParsed();
-    bool ret = getParameterByEnum(paramType.getTypeNum()) != NULL;
-    return ret;
+    // answered from the list itself; does not materialize the parameter
+    ParameterTypes::Type type = paramType.getTypeNum();
+    for (ParameterList::const_iterator it = mParameters.begin();
+         it != mParameters.end(); it++)
+    {
+       if (it->mType == type)
+       {
+          return true;
+       }
+    }
+    return false;
 }
 
 // removing non-present parameter is allowed      
@@ -161,7 +226,7 @@ bool
 ParserCategory::exists(const ExtensionParameter& param) const
 {
    checkParsed();
-   return getParameterByData(param.getName()) != NULL;
+   return findParameterByData(param.getName()) != mUnknownParameters.end();
 }
 
 void 
@@ -171,9 +236,9 @@ ParserCategory::removeParametersExcept(const ParameterTypeSet& set)
    for (ParameterList::iterator it = mParameters.begin();
         it != mParameters.end();)
    {
-      if (set.find((*it)->getType()) == set.end())
+      if (set.find(it->getType()) == set.end())
       {
-         delete *it;
+         delete it->mParam;
          it = mParameters.erase(it);
       }
       else
@@ -183,6 +248,85 @@ ParserCategory::removeParametersExcept(const ParameterTypeSet& set)
    }
 }
 
+// Steps over the value of a parameter the way its decode() would, and
+// returns the end of its text if that text is exactly what the parsed
+// parameter would encode to. Otherwise returns 0 and the caller parses the
+// parameter now; this keeps encoding (and parse failures) as they were.
+static const char*
+skipCanonicalParameter(ParameterTypes::Type type,
+                       const char* keyStart,
+                       const char* keyEnd,
+                       ParseBuffer& pb)
+{
+   bool valueRequired = false;
+   bool quotedRequired = false;
+   bool valueAllowed = true;
+
+   if (type != ParameterTypes::UNKNOWN)
+   {
+      const Data& name = ParameterTypes::ParameterNames[type];
+      if (name.size() != (Data::size_type)(keyEnd - keyStart) ||
+          memcmp(name.data(), keyStart, name.size()) != 0)
+      {
+         return 0;
+      }
+
+      ParameterTypes::Factory factory = ParameterTypes::ParameterFactories[type];
+      if (factory == DataParameter::decode)
+      {
+         valueRequired = true;
+      }
+      else if (factory == QuotedDataParameter::decode)
+      {
+         valueRequired = true;
+         quotedRequired = true;
+      }
+      else if (factory == ExistsParameter::decode)
+      {
+         valueAllowed = false;
+      }
+      else if (factory != ExistsOrDataParameter::decode)
+      {
+         return 0;
+      }
+   }
+
+   if (pb.eof() || *pb.position() != Symbols::EQUALS[0])
+   {
+      if (valueRequired || (!pb.eof() && ParseBuffer::oneOf(*pb.position(), " \t\r\n")))
+      {
+         return 0;
+      }
+      return keyEnd;
+   }
+
+   if (!valueAllowed)
+   {
+      return 0;
+   }
+   pb.skipChar();
+   if (pb.eof())
+   {
+      return 0;
+   }
+   const char c = *pb.position();
+   if (c == Symbols::DOUBLE_QUOTE[0])
+   {
+      pb.skipChar();
+      pb.skipToEndQuote();
+      pb.skipChar();
+   }
+   else if (quotedRequired || ParseBuffer::oneOf(c, ParameterTerminators))
+   {
+      return 0;
+   }
+   else
+   {
+      pb.skipToOneOf(ParameterTerminators);
+   }
+   return pb.position();
+}
+
 void
 ParserCategory::parseParameters(ParseBuffer& pb)
 {
@@ -201,15 +345,25 @@ ParserCategory::parseParameters(ParseBuffer& pb)
          if((int)(keyEnd-keyStart) != 0)
          {
             ParameterTypes::Type type = ParameterTypes::getType(keyStart, (keyEnd - keyStart));
-            if (type == ParameterTypes::UNKNOWN)
+            ParameterList& list = (type == ParameterTypes::UNKNOWN ? mUnknownParameters : mParameters);
+            const char* end = skipCanonicalParameter(type, keyStart, keyEnd, pb);
+            if (end)
             {
-               mUnknownParameters.push_back(new UnknownParameter(keyStart, 
-                                                                 int((keyEnd - keyStart)), pb, " \t\r\n;?>"));
+               list.push_back(ParameterEntry(type, keyStart, UInt32(end - keyStart)));
             }
             else
             {
-               // invoke the particular factory
-               mParameters.push_back(ParameterTypes::ParameterFactories[type](type, pb, " \t\r\n;?>"));
+               pb.reset(keyEnd);
+               if (type == ParameterTypes::UNKNOWN)
+               {
+                  list.push_back(new UnknownParameter(keyStart, 
+                                                      int((keyEnd - keyStart)), pb, ParameterTerminators));
+               }
+               else
+               {
+                  // invoke the particular factory
+                  list.push_back(ParameterTypes::ParameterFactories[type](type, pb, ParameterTerminators));
+               }
             }
          }
       }
@@ -272,19 +426,34 @@ ParserCategory::encodeParameters(EncodeStream& str) const
       str << Symbols::SEMI_COLON;
       // !ah! this is a TOTAL hack to work around an MSN bug that
       // !ah! requires a SPACE after the SEMI following the MIME type.
-      if (it == mParameters.begin() && getParameterByData(up_Msgr))
+      if (it == mParameters.begin() && 
+          findParameterByData(up_Msgr) != mUnknownParameters.end())
       {
          str << Symbols::SPACE;
       }
       
-      (*it)->encode(str);
+      if (it->mParam)
+      {
+         it->mParam->encode(str);
+      }
+      else
+      {
+         str.write(it->mText, it->mLength);
+      }
 #endif
    }
    for (ParameterList::iterator it = mUnknownParameters.begin();
         it != mUnknownParameters.end(); it++)
    {
       str << Symbols::SEMI_COLON;
-      (*it)->encode(str);
+      if (it->mParam)
+      {
+         it->mParam->encode(str);
+      }
+      else
+      {
+         str.write(it->mText, it->mLength);
+      }
    }
    return str;
 }
@@ -302,14 +471,33 @@ ParserCategory::getParameterByEnum(ParameterTypes::Type type) const
    for (ParameterList::iterator it = mParameters.begin();
         it != mParameters.end(); it++)
    {
-      if ((*it)->getType() == type)
+      if (it->mType == type)
       {
-         return *it;
+         return getParameter(*it);
       }
    }
    return 0;
 }
 
+Parameter*
+ParserCategory::materialize(ParameterEntry& entry) const
+{
+   assert(!entry.mParam);
+   ParseBuffer pb(entry.mText, entry.mLength, errorContext());
+   const char* keyEnd = pb.skipToOneOf(" \t\r\n;=?>");
+   if (entry.mType == ParameterTypes::UNKNOWN)
+   {
+      entry.mParam = new UnknownParameter(entry.mText, int(keyEnd - entry.mText), 
+                                          pb, ParameterTerminators);
+   }
+   else
+   {
+      entry.mParam = ParameterTypes::ParameterFactories[entry.mType](entry.mType, pb, 
+                                                                    ParameterTerminators);
+   }
+   return entry.mParam;
+}
+
 void
 ParserCategory::setParameter(const Parameter* parameter)
 {
@@ -318,18 +506,18 @@ ParserCategory::setParameter(const Parameter* parameter)
    for (ParameterList::iterator it = mParameters.begin();
         it != mParameters.end(); it++)
    {
-      if ((*it)->getType() == parameter->getType())
+      if (it->mType == parameter->getType())
       {
-         delete *it;
+         delete it->mParam;
          mParameters.erase(it);
-         mParameters.push_back(parameter->clone());
+         mParameters.push_back(ParameterEntry(parameter->clone()));
          return;
       }
    }
 
    // !dlb! kinda hacky -- what is the correct semantics here?
    // should be quietly add, quietly do nothing, throw?
-   mParameters.push_back(parameter->clone());
+   mParameters.push_back(ParameterEntry(parameter->clone()));
 }
 
 void 
@@ -339,9 +527,9 @@ ParserCategory::removeParameterByEnum(ParameterTypes::Type type)
    for (ParameterList::iterator it = mParameters.begin();
         it != mParameters.end();)
    {
-      if ((*it)->getType() == type)
+      if (it->mType == type)
       {
-         delete *it;
+         delete it->mParam;
          it = mParameters.erase(it);
       }
       else
@@ -351,18 +539,38 @@ ParserCategory::removeParameterByEnum(ParameterTypes::Type type)
    }
  }
 
-Parameter* 
-ParserCategory::getParameterByData(const Data& data) const
+// the name of an unknown parameter, without materializing it
+Data
+ParserCategory::unknownParameterName(const ParameterEntry& entry)
 {
-   for (ParameterList::iterator it = mUnknownParameters.begin();
-        it != mUnknownParameters.end(); it++)
+   if (entry.mParam)
    {
-      if (isEqualNoCase((*it)->getName(), data))
+      return Data(Data::Share, entry.mParam->getName());
+   }
+   const char* eq = (const char*)memchr(entry.mText, Symbols::EQUALS[0], entry.mLength);
+   return Data(Data::Share, entry.mText, 
+               eq ? int(eq - entry.mText) : int(entry.mLength));
+}
+
+ParserCategory::ParameterList::iterator
+ParserCategory::findParameterByData(const Data& data) const
+{
+   ParameterList::iterator it = mUnknownParameters.begin();
+   for (; it != mUnknownParameters.end(); it++)
+   {
+      if (isEqualNoCase(unknownParameterName(*it), data))
       {
-         return *it;
+         break;
       }
    }
-   return 0;
+   return it;
+}
+
+Parameter* 
+ParserCategory::getParameterByData(const Data& data) const
+{
+   ParameterList::iterator it = findParameterByData(data);
+   return it == mUnknownParameters.end() ? 0 : getParameter(*it);
 }
 
 void 
@@ -372,9 +580,9 @@ ParserCategory::removeParameterByData(const Data& data)
    for (ParameterList::iterator it = mUnknownParameters.begin();
         it != mUnknownParameters.end();)
    {
-      if ((*it)->getName() == data)
+      if (unknownParameterName(*it) == data)
       {
-         delete *it;
+         delete it->mParam;
          it = mUnknownParameters.erase(it);
       }
       else
@@ -394,7 +602,7 @@ ParserCategory::param(const _enum##_Param& paramType)
    if (!p)                                                                                                      \
    {                                                                                                            \
       p = new _enum##_Param::Type(paramType.getTypeNum());                                                      \
-      mParameters.push_back(p);                                                                                 \
+      mParameters.push_back(ParameterEntry(p));                                                                 \
    }                                                                                                            \
    return p->value();                                                                                           \
 }                                                                                                               \
@@ -516,14 +724,14 @@ ParserCategory::commutativeParameterHash() const
    Data buffer;
    Data working;
 
-   for (ParameterList::const_iterator i = mParameters.begin(); i != mParameters.end(); ++i)
+   for (ParameterList::iterator i = mParameters.begin(); i != mParameters.end(); ++i)
    {
-      if ((*i)->getType() != ParameterTypes::lr)
+      if (i->getType() != ParameterTypes::lr)
       {
          buffer.clear();
          {
             DataStream strm(buffer);
-            (*i)->encode(strm);
+            getParameter(*i)->encode(strm);
          }
          working ^= buffer;
       }
@@ -532,7 +740,7 @@ ParserCategory::commutativeParameterHash() const
    buffer.clear();
    for (ParameterList::iterator i = mUnknownParameters.begin(); i != mUnknownParameters.end(); ++i)
    {
-      UnknownParameter* p = static_cast<UnknownParameter*>(*i);
+      UnknownParameter* p = static_cast<UnknownParameter*>(getParameter(*i));
       buffer = p->getName();
       buffer += p->value();
       working ^= buffer;
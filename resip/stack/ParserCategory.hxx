@@ -191,13 +191,49 @@ class ParserCategory : public LazyParser
 
       virtual const Data& errorContext() const;
 
-      typedef std::vector<Parameter*> ParameterList; 
+      /**
+         One parameter in a ParameterList. A parameter whose text is already
+         in canonical form is not parsed; mParam stays 0 and mText/mLength
+         locate its "name[=value]" text (in the parsed buffer or, for
+         copies, in mParameterText). It is materialized on first access
+         through getParameter(). Parameters that would re-encode
+         differently are parsed up front and never have text.
+      */
+      struct ParameterEntry
+      {
+            ParameterEntry(Parameter* param);
+            ParameterEntry(ParameterTypes::Type type, const char* text, UInt32 length)
+               : mParam(0), mText(text), mLength(length), mType(type) {}
+
+            ParameterTypes::Type getType() const { return mType; }
+
+            Parameter* mParam;
+            const char* mText;
+            UInt32 mLength;
+            ParameterTypes::Type mType;
+      };
+
+      typedef std::vector<ParameterEntry> ParameterList; 
       mutable ParameterList mParameters;
       mutable ParameterList mUnknownParameters;
       Headers::Type mHeaderType;
+
+      Parameter* getParameter(ParameterEntry& entry) const
+      {
+         return entry.mParam ? entry.mParam : materialize(entry);
+      }
+
    private:
       void clear();
       void copyParametersFrom(const ParserCategory& other);
+      Parameter* materialize(ParameterEntry& entry) const;
+      ParameterList::iterator findParameterByData(const Data& data) const;
+      static void copyParameterList(const ParameterList& from, ParameterList& to, char*& text);
+      static Data unknownParameterName(const ParameterEntry& entry);
+
+      // backing store for the text of unmaterialized parameters of a copy
+      char* mParameterText;
+
       friend EncodeStream& operator<<(EncodeStream&, const ParserCategory&);
       friend class NameAddr;
 };
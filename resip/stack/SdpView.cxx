@@ -0,0 +1,483 @@
+#if defined(HAVE_CONFIG_H)
+#include "resip/stack/config.hxx"
+#endif
+
+#include <cassert>
+#include <cstring>
+
+#include "resip/stack/SdpView.hxx"
+#include "resip/stack/SdpContents.hxx"
+#include "resip/stack/Symbols.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+const int SdpView::SessionLevel;
+
+SdpView::SdpView(const char* buffer, size_t length)
+{
+   index(buffer, length);
+}
+
+SdpView::SdpView(const Data& sdp)
+{
+   index(sdp.data(), sdp.size());
+}
+
+SdpView::SdpView(const SdpContents& sdp)
+{
+   if (!sdp.isParsed())
+   {
+      const HeaderFieldValue& hfv = sdp.getHeaderField();
+      index(hfv.mField, hfv.mFieldLength);
+   }
+   else
+   {
+      mEncoded = Data::from(sdp);
+      index(mEncoded.data(), mEncoded.size());
+   }
+}
+
+void
+SdpView::index(const char* buffer, size_t length)
+{
+   const char* end = buffer + length;
+   const char* pos = buffer;
+   while (pos < end)
+   {
+      const char* eol = (const char*)memchr(pos, '\n', end - pos);
+      const char* next = eol ? eol + 1 : end;
+      if (!eol)
+      {
+         eol = end;
+      }
+      if (eol > pos && eol[-1] == '\r')
+      {
+         --eol;
+      }
+      if (eol > pos)
+      {
+         Line line = { pos, size_t(eol - pos) };
+         mLines.push_back(line);
+      }
+      pos = next;
+   }
+   indexMedia();
+}
+
+void
+SdpView::indexMedia()
+{
+   mMedia.clear();
+   for (size_t i = 0; i < mLines.size(); ++i)
+   {
+      if (mLines[i].mLength >= 2 && mLines[i].mStart[0] == 'm' && mLines[i].mStart[1] == '=')
+      {
+         mMedia.push_back(i);
+      }
+   }
+}
+
+size_t
+SdpView::begin(int medium) const
+{
+   assert(medium >= SessionLevel && medium < numMedia());
+   return medium == SessionLevel ? 0 : mMedia[medium];
+}
+
+size_t
+SdpView::end(int medium) const
+{
+   assert(medium >= SessionLevel && medium < numMedia());
+   return medium + 1 < numMedia() ? mMedia[medium + 1] : mLines.size();
+}
+
+const SdpView::Line*
+SdpView::find(char type, int medium) const
+{
+   size_t i = findIndex(type, medium);
+   return i == mLines.size() ? 0 : &mLines[i];
+}
+
+size_t
+SdpView::findIndex(char type, int medium) const
+{
+   size_t last = end(medium);
+   for (size_t i = begin(medium); i < last; ++i)
+   {
+      const Line& line = mLines[i];
+      if (line.mLength >= 2 && line.mStart[0] == type && line.mStart[1] == '=')
+      {
+         return i;
+      }
+   }
+   return mLines.size();
+}
+
+bool
+SdpView::isAttribute(const Line& line, const Data& attribute) const
+{
+   // a=<attribute> or a=<attribute>:<value>
+   return (line.mLength >= attribute.size() + 2 &&
+           line.mStart[0] == 'a' && line.mStart[1] == '=' &&
+           memcmp(line.mStart + 2, attribute.data(), attribute.size()) == 0 &&
+           (line.mLength == attribute.size() + 2 || line.mStart[attribute.size() + 2] == ':'));
+}
+
+bool
+SdpView::field(const Line& line, int n, const char*& start, const char*& end)
+{
+   const char* pos = line.mStart + 2;
+   const char* last = line.mStart + line.mLength;
+   for (int i = 0; ; ++i)
+   {
+      while (pos < last && *pos == ' ')
+      {
+         ++pos;
+      }
+      if (pos == last)
+      {
+         return false;
+      }
+      start = pos;
+      while (pos < last && *pos != ' ')
+      {
+         ++pos;
+      }
+      end = pos;
+      if (i == n)
+      {
+         return true;
+      }
+   }
+}
+
+bool
+SdpView::replaceField(Line& line, int n, const Data& value)
+{
+   const char* start;
+   const char* end;
+   if (!field(line, n, start, end))
+   {
+      return false;
+   }
+
+   Data text(int(line.mLength - (end - start) + value.size()), Data::Preallocate);
+   text.append(line.mStart, Data::size_type(start - line.mStart));
+   text += value;
+   text.append(end, Data::size_type(line.mStart + line.mLength - end));
+   line = addText(text);
+   return true;
+}
+
+SdpView::Line
+SdpView::addText(const Data& text)
+{
+   mText.push_back(text);
+   Line line = { mText.back().data(), mText.back().size() };
+   return line;
+}
+
+static Data
+borrow(const char* start, const char* end)
+{
+   return Data(Data::Borrow, start, int(end - start));
+}
+
+Data
+SdpView::originAddressType() const
+{
+   // o=<username> <sess-id> <sess-version> <nettype> <addrtype> <address>
+   const Line* line = find('o', SessionLevel);
+   const char* start;
+   const char* end;
+   return line && field(*line, 4, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+Data
+SdpView::originAddress() const
+{
+   const Line* line = find('o', SessionLevel);
+   const char* start;
+   const char* end;
+   return line && field(*line, 5, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+bool
+SdpView::hasConnection(int medium) const
+{
+   return find('c', medium) != 0;
+}
+
+int
+SdpView::numConnections(int medium) const
+{
+   int count = 0;
+   for (size_t i = begin(medium); i < end(medium); ++i)
+   {
+      const Line& line = mLines[i];
+      if (line.mLength >= 2 && line.mStart[0] == 'c' && line.mStart[1] == '=')
+      {
+         ++count;
+      }
+   }
+   return count;
+}
+
+Data
+SdpView::connectionAddressType(int medium) const
+{
+   // c=<nettype> <addrtype> <connection-address>
+   const Line* line = find('c', medium);
+   if (!line && medium != SessionLevel)
+   {
+      line = find('c', SessionLevel);
+   }
+   const char* start;
+   const char* end;
+   return line && field(*line, 1, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+Data
+SdpView::connectionAddress(int medium) const
+{
+   const Line* line = find('c', medium);
+   if (!line && medium != SessionLevel)
+   {
+      line = find('c', SessionLevel);
+   }
+   const char* start;
+   const char* end;
+   return line && field(*line, 2, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+Data
+SdpView::mediaType(int medium) const
+{
+   // m=<media> <port>[/<number of ports>] <proto> <fmt> ...
+   const Line& line = mLines[begin(medium)];
+   const char* start;
+   const char* end;
+   return field(line, 0, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+int
+SdpView::port(int medium) const
+{
+   const Line& line = mLines[begin(medium)];
+   const char* start;
+   const char* end;
+   if (!field(line, 1, start, end))
+   {
+      return 0;
+   }
+   int port = 0;
+   for (; start < end && *start >= '0' && *start <= '9'; ++start)
+   {
+      port = port * 10 + (*start - '0');
+   }
+   return port;
+}
+
+Data
+SdpView::protocol(int medium) const
+{
+   const Line& line = mLines[begin(medium)];
+   const char* start;
+   const char* end;
+   return field(line, 2, start, end) ? borrow(start, end) : Data::Empty;
+}
+
+Data
+SdpView::formats(int medium) const
+{
+   const Line& line = mLines[begin(medium)];
+   const char* start;
+   const char* end;
+   return field(line, 3, start, end) ? borrow(start, line.mStart + line.mLength) : Data::Empty;
+}
+
+bool
+SdpView::exists(const Data& attribute, int medium) const
+{
+   for (size_t i = begin(medium); i < end(medium); ++i)
+   {
+      if (isAttribute(mLines[i], attribute))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+Data
+SdpView::attribute(const Data& attribute, int medium) const
+{
+   for (size_t i = begin(medium); i < end(medium); ++i)
+   {
+      const Line& line = mLines[i];
+      if (isAttribute(line, attribute))
+      {
+         const char* value = line.mStart + 2 + attribute.size();
+         const char* last = line.mStart + line.mLength;
+         return value < last ? borrow(value + 1, last) : Data::Empty;
+      }
+   }
+   return Data::Empty;
+}
+
+bool
+SdpView::setOriginAddress(const Data& address, const Data& addrType)
+{
+   size_t i = findIndex('o', SessionLevel);
+   if (i == mLines.size() || !replaceField(mLines[i], 5, address))
+   {
+      return false;
+   }
+   return addrType.empty() || replaceField(mLines[i], 4, addrType);
+}
+
+bool
+SdpView::setConnectionAddress(const Data& address, int medium, const Data& addrType)
+{
+   size_t i = findIndex('c', medium);
+   if (i == mLines.size() || !replaceField(mLines[i], 2, address))
+   {
+      return false;
+   }
+   return addrType.empty() || replaceField(mLines[i], 1, addrType);
+}
+
+bool
+SdpView::setPort(int medium, int port)
+{
+   Line& line = mLines[begin(medium)];
+   const char* start;
+   const char* end;
+   if (!field(line, 1, start, end))
+   {
+      return false;
+   }
+   const char* slash = (const char*)memchr(start, '/', end - start);
+   Data value(port);
+   if (slash)
+   {
+      value.append(slash, Data::size_type(end - slash));
+   }
+   return replaceField(line, 1, value);
+}
+
+void
+SdpView::addAttribute(const Data& attribute, const Data& value, int medium)
+{
+   Data text(int(attribute.size() + value.size() + 3), Data::Preallocate);
+   text += "a=";
+   text += attribute;
+   if (!value.empty())
+   {
+      text += Symbols::COLON;
+      text += value;
+   }
+   mLines.insert(mLines.begin() + end(medium), addText(text));
+   indexMedia();
+}
+
+int
+SdpView::removeAttribute(const Data& attribute, int medium)
+{
+   int removed = 0;
+   size_t last = end(medium);
+   for (size_t i = begin(medium); i < last; )
+   {
+      if (isAttribute(mLines[i], attribute))
+      {
+         mLines.erase(mLines.begin() + i);
+         --last;
+         ++removed;
+      }
+      else
+      {
+         ++i;
+      }
+   }
+   if (removed)
+   {
+      indexMedia();
+   }
+   return removed;
+}
+
+void
+SdpView::removeMedium(int medium)
+{
+   assert(medium != SessionLevel);
+   mLines.erase(mLines.begin() + begin(medium), mLines.begin() + end(medium));
+   indexMedia();
+}
+
+EncodeStream&
+SdpView::encode(EncodeStream& str) const
+{
+   for (std::vector<Line>::const_iterator i = mLines.begin(); i != mLines.end(); ++i)
+   {
+      str.write(i->mStart, i->mLength);
+      str << Symbols::CRLF;
+   }
+   return str;
+}
+
+EncodeStream&
+resip::operator<<(EncodeStream& str, const SdpView& sdp)
+{
+   return sdp.encode(str);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,173 @@
+#if !defined(RESIP_SDPVIEW_HXX)
+#define RESIP_SDPVIEW_HXX
+
+#include <list>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/resipfaststreams.hxx"
+
+namespace resip
+{
+
+class SdpContents;
+
+/**
+   @brief An index of the lines of an SDP body, for code that only needs to
+   look at or rewrite a few of them.
+
+   SdpContents parses a body into a Session/Medium/Codec object graph. A
+   media-anchoring B2BUA or proxy only wants the connection addresses, the
+   media ports and perhaps an attribute or two, so SdpView records where each
+   line starts and ends instead. The accessors return Data that borrow from
+   the viewed buffer, which must outlive the view.
+
+   The rewrite calls replace, add or remove whole lines in the index. The
+   new text of those lines is kept by the view; the other lines still point
+   into the original buffer and are copied out as they are by encode(). Lines
+   are always encoded with CRLF.
+
+   Media are numbered from 0 in the order of their m= lines; SessionLevel
+   names the part before the first m= line.
+*/
+class SdpView
+{
+   public:
+      static const int SessionLevel = -1;
+
+      SdpView(const char* buffer, size_t length);
+      explicit SdpView(const Data& sdp);
+      /// views the body as received if sdp was never parsed, else encodes it
+      explicit SdpView(const SdpContents& sdp);
+
+      int numMedia() const { return (int)mMedia.size(); }
+
+      Data originAddressType() const;
+      Data originAddress() const;
+
+      /// whether the section has a c= line of its own
+      bool hasConnection(int medium = SessionLevel) const;
+      /// number of c= lines in the section itself - a medium may have one per address
+      int numConnections(int medium = SessionLevel) const;
+      /// for a medium without a c= line these come from the session's
+      Data connectionAddressType(int medium = SessionLevel) const;
+      Data connectionAddress(int medium = SessionLevel) const;
+
+      Data mediaType(int medium) const;
+      /// 0 if the m= line has no usable port
+      int port(int medium) const;
+      Data protocol(int medium) const;
+      /// the rest of the m= line after the protocol, e.g. "0 8 101"
+      Data formats(int medium) const;
+
+      bool exists(const Data& attribute, int medium = SessionLevel) const;
+      /// the value of the first a=attribute:value line; empty if there is none
+      Data attribute(const Data& attribute, int medium = SessionLevel) const;
+
+      /**
+         Rewrite the address (and, if addrType is not empty, the address
+         type) of the o= line, or of the section's own c= line. Return false if
+         there is no such line; a c= line is not added to a medium without one.
+      */
+      bool setOriginAddress(const Data& address, const Data& addrType = Data::Empty);
+      bool setConnectionAddress(const Data& address,
+                                int medium = SessionLevel,
+                                const Data& addrType = Data::Empty);
+      /// keeps a /<number of ports> suffix; false if medium has no port field
+      bool setPort(int medium, int port);
+
+      /// appended after the last line of the section
+      void addAttribute(const Data& attribute,
+                        const Data& value = Data::Empty,
+                        int medium = SessionLevel);
+      /// removes every a=attribute line of the section; returns how many
+      int removeAttribute(const Data& attribute, int medium = SessionLevel);
+      /// removes the m= line and everything up to the next one
+      void removeMedium(int medium);
+
+      EncodeStream& encode(EncodeStream& str) const;
+
+   private:
+      struct Line
+      {
+         const char* mStart;
+         size_t mLength;
+      };
+
+      SdpView(const SdpView&);
+      SdpView& operator=(const SdpView&);
+
+      void index(const char* buffer, size_t length);
+      void indexMedia();
+
+      size_t begin(int medium) const;
+      size_t end(int medium) const;
+      const Line* find(char type, int medium) const;
+      size_t findIndex(char type, int medium) const; // mLines.size() if none
+      bool isAttribute(const Line& line, const Data& attribute) const;
+
+      static bool field(const Line& line, int n, const char*& start, const char*& end);
+      bool replaceField(Line& line, int n, const Data& value);
+      Line addText(const Data& text);
+
+      Data mEncoded; // only when viewing a parsed SdpContents
+      std::vector<Line> mLines;
+      std::vector<size_t> mMedia; // where each m= line is in mLines
+      std::list<Data> mText; // rewritten and added lines
+};
+
+EncodeStream& operator<<(EncodeStream& str, const SdpView& sdp);
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
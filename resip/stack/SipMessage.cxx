@@ -32,9 +32,9 @@ SipMessage::SipMessage(const Transport* fromWire)
      mIsBadAck200(false),     
      mIsExternal(fromWire != 0),
      mTransport(fromWire),
+     mBuffers(0),
      mStartLine(0),
-     mContentsHfv(0),
-     mContents(0),
+     mBody(0),
      mRFC2543TransactionId(),
      mRequest(false),
      mResponse(false),
@@ -50,9 +50,9 @@ SipMessage::SipMessage(const Transport* fromWire)
 }
 
 SipMessage::SipMessage(const SipMessage& from)
-   : mStartLine(0),
-     mContentsHfv(0),
-     mContents(0),
+   : mBuffers(0),
+     mStartLine(0),
+     mBody(0),
      mCreatedTime(Timer::getTimeMicroSec()),
      mForceTarget(0)
 {
@@ -84,8 +84,7 @@ SipMessage::operator=(const SipMessage& rhs)
       mSource = rhs.mSource;
       mDestination = rhs.mDestination;
       mStartLine = 0;
-      mContentsHfv = 0;
-      mContents = 0;
+      mBody = 0;
       mRFC2543TransactionId = rhs.mRFC2543TransactionId;
       mRequest = rhs.mRequest;
       mResponse = rhs.mResponse;
@@ -94,11 +93,18 @@ SipMessage::operator=(const SipMessage& rhs)
       mForceTarget = 0;
       mTlsDomain = rhs.mTlsDomain;
       
+      // shared header lists and bodies may point into the raw buffers
+      if (rhs.mBuffers != 0)
+      {
+         rhs.mBuffers->mRefCount.increment();
+         mBuffers = rhs.mBuffers;
+      }
+
       for (int i = 0; i < Headers::MAX_HEADERS; i++)
       {
          if (rhs.mHeaders[i] != 0)
          {
-            mHeaders[i] = new HeaderFieldValueList(*rhs.mHeaders[i]);
+            mHeaders[i] = copyHeaders(rhs.mHeaders[i]);
          }
          else
          {
@@ -111,19 +117,33 @@ SipMessage::operator=(const SipMessage& rhs)
       {
          mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(
                                       i->first,
-                                      new HeaderFieldValueList(*i->second)));
+                                      copyHeaders(i->second)));
       }
-      if (rhs.mStartLine != 0)
+      mUnknownHashes = rhs.mUnknownHashes;
+
+      mRegisteredHeaders.resize(rhs.mRegisteredHeaders.size(), 0);
+      for (size_t i = 0; i < rhs.mRegisteredHeaders.size(); ++i)
       {
-         mStartLine = new HeaderFieldValueList(*rhs.mStartLine); 
+         if (rhs.mRegisteredHeaders[i] != 0)
+         {
+            mRegisteredHeaders[i] = copyHeaders(rhs.mRegisteredHeaders[i]);
+         }
       }
-      if (rhs.mContents != 0)
+      if (rhs.mStartLine != 0)
       {
-         mContents = rhs.mContents->clone();
+         mStartLine = copyHeaders(rhs.mStartLine); 
       }
-      else if (rhs.mContentsHfv != 0)
+      if (rhs.mBody != 0)
       {
-         mContentsHfv = new HeaderFieldValue(*rhs.mContentsHfv, HeaderFieldValue::CopyPadding);
+         if (rhs.mBody->mShareable)
+         {
+            rhs.mBody->mRefCount.increment();
+            mBody = rhs.mBody;
+         }
+         else
+         {
+            mBody = new Body(*rhs.mBody);
+         }
       }
       else
       {
@@ -175,35 +195,128 @@ SipMessage::~SipMessage()
    cleanUp();
 }
 
+SipMessage::Body::Body(const Body& rhs)
+   : mHfv(0),
+     mContents(0),
+     mRefCount(1),
+     mShareable(true)
+{
+   if (rhs.mContents != 0)
+   {
+      mContents = rhs.mContents->clone();
+   }
+   else if (rhs.mHfv != 0)
+   {
+      mHfv = new HeaderFieldValue(*rhs.mHfv, HeaderFieldValue::CopyPadding);
+   }
+}
+
+SipMessage::Body::~Body()
+{
+   delete mContents;
+   delete mHfv;
+}
+
+SipMessage::Buffers::~Buffers()
+{
+   for (vector<char*>::iterator i = mList.begin(); i != mList.end(); i++)
+   {
+      delete [] *i;
+   }
+}
+
+HeaderFieldValueList*
+SipMessage::copyHeaders(HeaderFieldValueList* hfvs)
+{
+   if (hfvs->isShareable())
+   {
+      hfvs->addRef();
+      return hfvs;
+   }
+   return new HeaderFieldValueList(*hfvs);
+}
+
+HeaderFieldValueList*
+SipMessage::ownHeaders(HeaderFieldValueList*& hfvs) const
+{
+   if (hfvs->isShared())
+   {
+      HeaderFieldValueList* copy = new HeaderFieldValueList(*hfvs);
+      release(hfvs);
+      hfvs = copy;
+   }
+   // whoever asked may keep a reference into it
+   hfvs->setUnshareable();
+   return hfvs;
+}
+
+SipMessage::Body*
+SipMessage::ownBody() const
+{
+   if (mBody != 0)
+   {
+      if (mBody->mRefCount.value() > 1)
+      {
+         Body* copy = new Body(*mBody);
+         release(mBody);
+         mBody = copy;
+      }
+      mBody->mShareable = false;
+   }
+   return mBody;
+}
+
+void
+SipMessage::release(HeaderFieldValueList* hfvs)
+{
+   if (hfvs && hfvs->removeRef())
+   {
+      delete hfvs;
+   }
+}
+
+void
+SipMessage::release(Body* body)
+{
+   if (body && body->mRefCount.decrement() == 0)
+   {
+      delete body;
+   }
+}
+
 void
 SipMessage::cleanUp()
 {
    for (int i = 0; i < Headers::MAX_HEADERS; i++)
    {
-      delete mHeaders[i];
+      release(mHeaders[i]);
       mHeaders[i] = 0;
    }
 
    for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
         i != mUnknownHeaders.end(); i++)
    {
-      delete i->second;
+      release(i->second);
    }
    mUnknownHeaders.clear();
+   mUnknownHashes.clear();
+
+   for (size_t i = 0; i < mRegisteredHeaders.size(); ++i)
+   {
+      release(mRegisteredHeaders[i]);
+   }
+   mRegisteredHeaders.clear();
    
-   for (vector<char*>::iterator i = mBufferList.begin();
-        i != mBufferList.end(); i++)
+   if (mBuffers && mBuffers->mRefCount.decrement() == 0)
    {
-      delete [] *i;
+      delete mBuffers;
    }
-   mBufferList.clear();
+   mBuffers = 0;
 
-   delete mStartLine;
+   release(mStartLine);
    mStartLine = 0;
-   delete mContents;
-   mContents = 0;
-   delete mContentsHfv;
-   mContentsHfv = 0;
+   release(mBody);
+   mBody = 0;
    delete mForceTarget;
    mForceTarget = 0;
 
@@ -276,6 +389,7 @@ SipMessage::parseAllHeaders()
         i != mUnknownHeaders.end(); i++)
    {
       ParserContainerBase* scs=0;
+      ownHeaders(i->second);
       if(!(scs=i->second->getParserContainer()))
       {
          scs=new ParserContainer<StringCategory>(i->second,Headers::RESIP_DO_NOT_USE);
@@ -284,8 +398,25 @@ SipMessage::parseAllHeaders()
       
       scs->parseAll();
    }
+
+   for (size_t i = 0; i < mRegisteredHeaders.size(); ++i)
+   {
+      if (mRegisteredHeaders[i] != 0)
+      {
+         ParserContainerBase* scs=0;
+         HeaderFieldValueList* hfvs = ownHeaders(mRegisteredHeaders[i]);
+         if(!(scs=hfvs->getParserContainer()))
+         {
+            scs=new ParserContainer<StringCategory>(hfvs,Headers::RESIP_DO_NOT_USE);
+            hfvs->setParserContainer(scs);
+         }
+
+         scs->parseAll();
+      }
+   }
    
    assert(mStartLine);
+   ownHeaders(mStartLine);
    ParserContainerBase* slc = 0;
 
    if(!(slc=mStartLine->getParserContainer()))
@@ -499,13 +630,13 @@ SipMessage::getCanonicalIdentityString() const
    strm << Symbols::BAR;
    
    // bodies 
-   if (mContents != 0)
+   if (mBody != 0 && mBody->mContents != 0)
    {
-      mContents->encode(strm);
+      mBody->mContents->encode(strm);
    }
-   else if (mContentsHfv != 0)
+   else if (mBody != 0 && mBody->mHfv != 0)
    {
-      mContentsHfv->encode(strm);
+      mBody->mHfv->encode(strm);
    }
 
    strm.flush();
@@ -675,16 +806,16 @@ SipMessage::encode(EncodeStream& str, bool isSipFrag) const
    }
 
    Data contents;
-   if (mContents != 0)
+   if (mBody != 0 && mBody->mContents != 0)
    {
       oDataStream temp(contents);
-      mContents->encode(temp);
+      mBody->mContents->encode(temp);
    }
-   else if (mContentsHfv != 0)
+   else if (mBody != 0 && mBody->mHfv != 0)
    {
       // !bwc! This causes an additional copy; sure would be nice to have a way
       // to get a data to take on a buffer with Data::Share _after_ construction
-      contents.append(mContentsHfv->mField, mContentsHfv->mFieldLength);
+      contents.append(mBody->mHfv->mField, mBody->mHfv->mFieldLength);
    }
 
 
@@ -699,6 +830,14 @@ SipMessage::encode(EncodeStream& str, bool isSipFrag) const
       }
    }
 
+   for (size_t i = 0; i < mRegisteredHeaders.size(); ++i)
+   {
+      if (mRegisteredHeaders[i] != 0)
+      {
+         mRegisteredHeaders[i]->encode(ExtensionHeader::getSlotName((int)i), str);
+      }
+   }
+
    for (UnknownHeaders::const_iterator i = mUnknownHeaders.begin(); 
         i != mUnknownHeaders.end(); i++)
    {
@@ -741,6 +880,23 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
       }
    }
 
+   for (size_t i = 0; i < mRegisteredHeaders.size(); ++i)
+   {
+      if (mRegisteredHeaders[i] != 0)
+      {
+         if (first)
+         {
+            str << Symbols::QUESTION;
+            first = false;
+         }
+         else
+         {
+            str << Symbols::AMPERSAND;
+         }
+         mRegisteredHeaders[i]->encodeEmbedded(ExtensionHeader::getSlotName((int)i), str);
+      }
+   }
+
    for (UnknownHeaders::const_iterator i = mUnknownHeaders.begin(); 
         i != mUnknownHeaders.end(); i++)
    {
@@ -756,7 +912,7 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
       i->second->encodeEmbedded(i->first, str);
    }
 
-   if (mContents != 0)
+   if (mBody != 0 && mBody->mContents != 0)
    {
       if (first)
       {
@@ -771,11 +927,11 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
       Data contents;
       {
          DataStream s(contents);
-         mContents->encode(s);
+         mBody->mContents->encode(s);
       }
       str << Embedded::encode(contents);
    }
-   else if (mContentsHfv != 0)
+   else if (mBody != 0 && mBody->mHfv != 0)
    {
       if (first)
       {
@@ -790,7 +946,7 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
       Data contents;
       {
          DataStream s(contents);
-         mContentsHfv->encode(str);
+         mBody->mHfv->encode(str);
       }
       str << Embedded::encode(contents);
    }
@@ -801,7 +957,11 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
 void
 SipMessage::addBuffer(char* buf)
 {
-   mBufferList.push_back(buf);
+   if (mBuffers == 0)
+   {
+      mBuffers = new Buffers;
+   }
+   mBuffers->mList.push_back(buf);
 }
 
 void 
@@ -899,18 +1059,17 @@ SipMessage::setBody(const char* start, UInt32 len)
                      
          }
          
-         mContentsHfv = new HeaderFieldValue(start,contentLength);
+         len = contentLength;
       }
       else
       {
          InfoLog(<< "Message has a body, but no Content-Length header.");
-         mContentsHfv = new HeaderFieldValue(start,len);
       }
    }
-   else
-   {
-      mContentsHfv = new HeaderFieldValue(start,len);
-   }
+
+   release(mBody);
+   mBody = new Body;
+   mBody->mHfv = new HeaderFieldValue(start,len);
 }
 
 void
@@ -918,10 +1077,8 @@ SipMessage::setContents(auto_ptr<Contents> contents)
 {
    Contents* contentsP = contents.release();
 
-   delete mContents;
-   mContents = 0;
-   delete mContentsHfv;
-   mContentsHfv = 0;
+   release(mBody);
+   mBody = 0;
 
    if (contentsP == 0)
    {
@@ -933,30 +1090,31 @@ SipMessage::setContents(auto_ptr<Contents> contents)
       return;
    }
 
-   mContents = contentsP;
+   mBody = new Body;
+   mBody->mContents = contentsP;
 
    // copy contents headers into message
-   if (mContents->exists(h_ContentDisposition))
+   if (contentsP->exists(h_ContentDisposition))
    {
-      header(h_ContentDisposition) = mContents->header(h_ContentDisposition);
+      header(h_ContentDisposition) = contentsP->header(h_ContentDisposition);
    }
-   if (mContents->exists(h_ContentTransferEncoding))
+   if (contentsP->exists(h_ContentTransferEncoding))
    {
-      header(h_ContentTransferEncoding) = mContents->header(h_ContentTransferEncoding);
+      header(h_ContentTransferEncoding) = contentsP->header(h_ContentTransferEncoding);
    }
-   if (mContents->exists(h_ContentLanguages))
+   if (contentsP->exists(h_ContentLanguages))
    {
-      header(h_ContentLanguages) = mContents->header(h_ContentLanguages);
+      header(h_ContentLanguages) = contentsP->header(h_ContentLanguages);
    }
-   if (mContents->exists(h_ContentType))
+   if (contentsP->exists(h_ContentType))
    {
-      header(h_ContentType) = mContents->header(h_ContentType);
-      assert( header(h_ContentType).type() == mContents->getType().type() );
-      assert( header(h_ContentType).subType() == mContents->getType().subType() );
+      header(h_ContentType) = contentsP->header(h_ContentType);
+      assert( header(h_ContentType).type() == contentsP->getType().type() );
+      assert( header(h_ContentType).subType() == contentsP->getType().subType() );
    }
    else
    {
-      header(h_ContentType) = mContents->getType();
+      header(h_ContentType) = contentsP->getType();
    }
 }
 
@@ -976,7 +1134,14 @@ SipMessage::setContents(const Contents* contents)
 Contents*
 SipMessage::getContents() const
 {
-   if (mContents == 0 && mContentsHfv != 0)
+   Body* body = ownBody();
+   if (body == 0)
+   {
+      return 0;
+   }
+
+   Contents*& contents = body->mContents;
+   if (contents == 0 && body->mHfv != 0)
    {
       if (empty(h_ContentType) ||
             !header(h_ContentType).isWellFormed())
@@ -997,34 +1162,34 @@ SipMessage::getContents() const
                  << header(h_ContentType).subType()
                  << ") that is not known, "
                  << "returning as opaque application/octet-stream");
-         mContents = ContentsFactoryBase::getFactoryMap()[OctetContents::getStaticType()]->create(mContentsHfv, OctetContents::getStaticType());
+         contents = ContentsFactoryBase::getFactoryMap()[OctetContents::getStaticType()]->create(body->mHfv, OctetContents::getStaticType());
       }
       else
       {
-         mContents = ContentsFactoryBase::getFactoryMap()[header(h_ContentType)]->create(mContentsHfv, header(h_ContentType));
+         contents = ContentsFactoryBase::getFactoryMap()[header(h_ContentType)]->create(body->mHfv, header(h_ContentType));
       }
-      assert( mContents );
+      assert( contents );
       
       // copy contents headers into the contents
       if (!empty(h_ContentDisposition))
       {
-         mContents->header(h_ContentDisposition) = header(h_ContentDisposition);
+         contents->header(h_ContentDisposition) = header(h_ContentDisposition);
       }
       if (!empty(h_ContentTransferEncoding))
       {
-         mContents->header(h_ContentTransferEncoding) = header(h_ContentTransferEncoding);
+         contents->header(h_ContentTransferEncoding) = header(h_ContentTransferEncoding);
       }
       if (!empty(h_ContentLanguages))
       {
-         mContents->header(h_ContentLanguages) = header(h_ContentLanguages);
+         contents->header(h_ContentLanguages) = header(h_ContentLanguages);
       }
       if (!empty(h_ContentType))
       {
-         mContents->header(h_ContentType) = header(h_ContentType);
+         contents->header(h_ContentType) = header(h_ContentType);
       }
       // !dlb! Content-Transfer-Encoding?
    }
-   return mContents;
+   return contents;
 }
 
 auto_ptr<Contents>
@@ -1032,7 +1197,10 @@ SipMessage::releaseContents()
 {
    // .bwc. auto_ptr owns the Contents. No other references allowed!
    auto_ptr<Contents> ret(getContents());
-   mContents = 0;
+   if (mBody != 0)
+   {
+      mBody->mContents = 0;
+   }
 
    if (ret.get() != 0 && !ret->isWellFormed())
    {
@@ -1041,29 +1209,60 @@ SipMessage::releaseContents()
 
    // .bwc. At this point, the Contents object has been parsed, so we don't need
    // this anymore.
-   delete mContentsHfv;
-   mContentsHfv=0;
+   release(mBody);
+   mBody = 0;
 
    return ret;
 }
 
+int
+SipMessage::findUnknown(const char* name, int len, size_t hash) const
+{
+   for (size_t i = 0; i < mUnknownHashes.size(); ++i)
+   {
+      if (mUnknownHashes[i] == hash)
+      {
+         const Data& other = mUnknownHeaders[i].first;
+         if (other.size() == (Data::size_type)len &&
+             strncasecmp(other.data(), name, len) == 0)
+         {
+            return (int)i;
+         }
+      }
+   }
+   return -1;
+}
+
+HeaderFieldValueList**
+SipMessage::findExtension(const ExtensionHeader& symbol) const
+{
+   int slot = symbol.getSlot();
+   if (slot >= 0)
+   {
+      if (slot < (int)mRegisteredHeaders.size() && mRegisteredHeaders[slot] != 0)
+      {
+         return &mRegisteredHeaders[slot];
+      }
+      return 0;
+   }
+
+   int i = findUnknown(symbol.getName().data(), (int)symbol.getName().size(), symbol.getHash());
+   return i >= 0 ? &mUnknownHeaders[i].second : 0;
+}
+
 // unknown header interface
 const StringCategories& 
 SipMessage::header(const ExtensionHeader& headerName) const
 {
-   for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
-        i != mUnknownHeaders.end(); i++)
+   HeaderFieldValueList** found = findExtension(headerName);
+   if (found != 0)
    {
-      // !dlb! case sensitive?
-      if (i->first == headerName.getName())
+      HeaderFieldValueList* hfvs = ownHeaders(*found);
+      if (hfvs->getParserContainer() == 0)
       {
-         HeaderFieldValueList* hfvs = i->second;
-         if (hfvs->getParserContainer() == 0)
-         {
-            hfvs->setParserContainer(new ParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
-         }
-         return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
+         hfvs->setParserContainer(new ParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
       }
+      return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
    }
    // missing extension header
    assert(false);
@@ -1074,54 +1273,65 @@ SipMessage::header(const ExtensionHeader& headerName) const
 StringCategories& 
 SipMessage::header(const ExtensionHeader& headerName)
 {
-   for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
-        i != mUnknownHeaders.end(); i++)
+   HeaderFieldValueList** found = findExtension(headerName);
+   if (found != 0)
    {
-      // !dlb! case sensitive?
-      if (i->first == headerName.getName())
+      HeaderFieldValueList* hfvs = ownHeaders(*found);
+      if (hfvs->getParserContainer() == 0)
       {
-         HeaderFieldValueList* hfvs = i->second;
-         if (hfvs->getParserContainer() == 0)
-         {
-            hfvs->setParserContainer(new ParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
-         }
-         return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
+         hfvs->setParserContainer(new ParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
       }
+      return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
    }
 
    // create the list empty
    HeaderFieldValueList* hfvs = new HeaderFieldValueList;
+   hfvs->setUnshareable();
    hfvs->setParserContainer(new ParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
-   mUnknownHeaders.push_back(make_pair(headerName.getName(), hfvs));
+
+   int slot = headerName.getSlot();
+   if (slot >= 0)
+   {
+      if (slot >= (int)mRegisteredHeaders.size())
+      {
+         mRegisteredHeaders.resize(ExtensionHeader::numSlots(), 0);
+      }
+      mRegisteredHeaders[slot] = hfvs;
+   }
+   else
+   {
+      mUnknownHeaders.push_back(make_pair(headerName.getName(), hfvs));
+      mUnknownHashes.push_back(headerName.getHash());
+   }
    return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
 }
 
 bool
 SipMessage::exists(const ExtensionHeader& symbol) const
 {
-   for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
-        i != mUnknownHeaders.end(); i++)
-   {
-      if (i->first == symbol.getName())
-      {
-         return true;
-      }
-   }
-   return false;
+   return findExtension(symbol) != 0;
 }
 
 void
 SipMessage::remove(const ExtensionHeader& headerName)
 {
-   for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
-        i != mUnknownHeaders.end(); i++)
+   int slot = headerName.getSlot();
+   if (slot >= 0)
    {
-      if (i->first == headerName.getName())
+      if (slot < (int)mRegisteredHeaders.size())
       {
-         delete i->second;
-         mUnknownHeaders.erase(i);
-         return;
+         release(mRegisteredHeaders[slot]);
+         mRegisteredHeaders[slot] = 0;
       }
+      return;
+   }
+
+   int i = findUnknown(headerName.getName().data(), (int)headerName.getName().size(), headerName.getHash());
+   if (i >= 0)
+   {
+      release(mUnknownHeaders[i].second);
+      mUnknownHeaders.erase(mUnknownHeaders.begin() + i);
+      mUnknownHashes.erase(mUnknownHashes.begin() + i);
    }
 }
 
@@ -1165,29 +1375,44 @@ SipMessage::addHeader(Headers::Type header, const char* headerName, int headerLe
    else
    {
       assert(headerLen >= 0);
-      for (UnknownHeaders::iterator i = mUnknownHeaders.begin();
-           i != mUnknownHeaders.end(); i++)
+      const size_t hash = Data::rawCaseInsensitiveHash((const unsigned char*)headerName, headerLen);
+
+      HeaderFieldValueList* hfvs = 0;
+      int slot = ExtensionHeader::getSlot(headerName, headerLen, hash);
+      if (slot >= 0)
       {
-         if (i->first.size() == (unsigned int)headerLen &&
-             strncasecmp(i->first.data(), headerName, headerLen) == 0)
+         if (slot >= (int)mRegisteredHeaders.size())
          {
-            // add to end of list
-            if (len)
-            {
-               i->second->push_back(new HeaderFieldValue(start, len));
-            }
-            return;
+            mRegisteredHeaders.resize(ExtensionHeader::numSlots(), 0);
+         }
+         if (mRegisteredHeaders[slot] == 0)
+         {
+            mRegisteredHeaders[slot] = new HeaderFieldValueList();
+         }
+         hfvs = mRegisteredHeaders[slot];
+      }
+      else
+      {
+         int i = findUnknown(headerName, headerLen, hash);
+         if (i >= 0)
+         {
+            hfvs = mUnknownHeaders[i].second;
+         }
+         else
+         {
+            // didn't find it, add an entry
+            hfvs = new HeaderFieldValueList();
+            mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(Data(headerName, headerLen),
+                                                                        hfvs));
+            mUnknownHashes.push_back(hash);
          }
       }
 
-      // didn't find it, add an entry
-      HeaderFieldValueList *hfvs = new HeaderFieldValueList();
+      // add to end of list
       if (len)
       {
          hfvs->push_back(new HeaderFieldValue(start, len));
       }
-      mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(Data(headerName, headerLen),
-                                                                  hfvs));
    }
 }
 
@@ -1214,7 +1439,7 @@ SipMessage::header(const RequestLineType& l)
       mStartLine->setParserContainer(new ParserContainer<RequestLine>(mStartLine, Headers::NONE));
       mRequest = true;
    }
-   return dynamic_cast<ParserContainer<RequestLine>*>(mStartLine->getParserContainer())->front();
+   return dynamic_cast<ParserContainer<RequestLine>*>(ownHeaders(mStartLine)->getParserContainer())->front();
 }
 
 const RequestLine& 
@@ -1226,7 +1451,7 @@ SipMessage::header(const RequestLineType& l) const
       // request line missing
       assert(false);
    }
-   return dynamic_cast<ParserContainer<RequestLine>*>(mStartLine->getParserContainer())->front();
+   return dynamic_cast<ParserContainer<RequestLine>*>(ownHeaders(mStartLine)->getParserContainer())->front();
 }
 
 StatusLine& 
@@ -1240,7 +1465,7 @@ SipMessage::header(const StatusLineType& l)
       mStartLine->setParserContainer(new ParserContainer<StatusLine>(mStartLine, Headers::NONE));
       mResponse = true;
    }
-   return dynamic_cast<ParserContainer<StatusLine>*>(mStartLine->getParserContainer())->front();
+   return dynamic_cast<ParserContainer<StatusLine>*>(ownHeaders(mStartLine)->getParserContainer())->front();
 }
 
 const StatusLine& 
@@ -1252,7 +1477,7 @@ SipMessage::header(const StatusLineType& l) const
       // status line missing
       assert(false);
    }
-   return dynamic_cast<ParserContainer<StatusLine>*>(mStartLine->getParserContainer())->front();
+   return dynamic_cast<ParserContainer<StatusLine>*>(ownHeaders(mStartLine)->getParserContainer())->front();
 }
 
 HeaderFieldValueList* 
@@ -1265,6 +1490,7 @@ SipMessage::ensureHeaders(Headers::Type type, bool single)
    {
       // create the list with a new component
       hfvs = new HeaderFieldValueList;
+      hfvs->setUnshareable();
       mHeaders[type] = hfvs;
       if (single)
       {
@@ -1272,8 +1498,13 @@ SipMessage::ensureHeaders(Headers::Type type, bool single)
          hfvs->push_back(hfv);
       }
    }
+   else
+   {
+      hfvs = ownHeaders(mHeaders[type]);
+   }
+
    // !dlb! not thrilled about checking this every access
-   else if (single)
+   if (single)
    {
       if (hfvs->parsedEmpty())
       {
@@ -1299,8 +1530,10 @@ SipMessage::ensureHeaders(Headers::Type type, bool single) const
       DebugLog (<< *this);
       throw Exception("Missing header " + Headers::getHeaderName(type), __FILE__, __LINE__);
    }
+   hfvs = ownHeaders(mHeaders[type]);
+
    // !dlb! not thrilled about checking this every access
-   else if (single)
+   if (single)
    {
       if (hfvs->parsedEmpty())
       {
@@ -1331,7 +1564,7 @@ SipMessage::empty(const HeaderBase& headerType) const
 void
 SipMessage::remove(const HeaderBase& headerType)
 {
-   delete mHeaders[headerType.getTypeNum()]; 
+   release(mHeaders[headerType.getTypeNum()]); 
    mHeaders[headerType.getTypeNum()] = 0; 
 };
 
@@ -1492,7 +1725,7 @@ SipMessage::setRawHeader(const HeaderFieldValueList* hfvs, Headers::Type headerT
 {
    if (mHeaders[headerType] != hfvs)
    {
-      delete mHeaders[headerType];
+      release(mHeaders[headerType]);
       mHeaders[headerType] = new HeaderFieldValueList(*hfvs);
    }
 }
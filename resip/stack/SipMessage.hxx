@@ -21,6 +21,7 @@
 #include "rutil/Data.hxx"
 #include "rutil/Timer.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
+#include "rutil/AtomicCounter.hxx"
 
 namespace resip
 {
@@ -73,7 +74,7 @@ class SipMessage : public TransactionMessage
 {
    public:
       RESIP_HeapCount(SipMessage);
-      typedef std::list< std::pair<Data, HeaderFieldValueList*> > UnknownHeaders;
+      typedef std::vector< std::pair<Data, HeaderFieldValueList*> > UnknownHeaders;
 
       explicit SipMessage(const Transport* fromWire = 0);
       // .dlb. public, allows pass by value to compile.
@@ -266,6 +267,8 @@ class SipMessage : public TransactionMessage
       // typeless header interface
       const HeaderFieldValueList* getRawHeader(Headers::Type headerType) const;
       void setRawHeader(const HeaderFieldValueList* hfvs, Headers::Type headerType);
+      // headers registered with ExtensionHeader::registerHeader are not
+      // in this list
       const UnknownHeaders& getRawUnknownHeaders() const {return mUnknownHeaders;}
 
       Contents* getContents() const;
@@ -348,11 +351,51 @@ class SipMessage : public TransactionMessage
    private:
       void compute2543TransactionHash() const;
 
+      // Copies of a message share the header lists, the body and the raw
+      // buffers those point into, for as long as nothing has been given
+      // access to the shared part. The first access through a header() or
+      // contents accessor takes a private copy if the part is shared.
+      class Body
+      {
+         public:
+            Body() : mHfv(0), mContents(0), mRefCount(1), mShareable(true) {}
+            Body(const Body& rhs);
+            ~Body();
+
+            // raw text for the contents (all of them)
+            HeaderFieldValue* mHfv;
+            // lazy parser for the contents
+            Contents* mContents;
+            AtomicCounter mRefCount;
+            bool mShareable;
+      };
+
+      class Buffers
+      {
+         public:
+            Buffers() : mRefCount(1) {}
+            ~Buffers();
+
+            std::vector<char*> mList;
+            AtomicCounter mRefCount;
+      };
+
+      static HeaderFieldValueList* copyHeaders(HeaderFieldValueList* hfvs);
+      HeaderFieldValueList* ownHeaders(HeaderFieldValueList*& hfvs) const;
+      Body* ownBody() const;
+      static void release(HeaderFieldValueList* hfvs);
+      static void release(Body* body);
+
       EncodeStream& 
       encode(EncodeStream& str, bool isSipFrag) const;      
 
       void copyFrom(const SipMessage& message);
 
+      // index in mUnknownHeaders of the header called name, -1 if absent
+      int findUnknown(const char* name, int len, size_t hash) const;
+      // where the list for an extension header is kept, 0 if absent
+      HeaderFieldValueList** findExtension(const ExtensionHeader& symbol) const;
+
       HeaderFieldValueList* ensureHeaders(Headers::Type type, bool single);
       HeaderFieldValueList* ensureHeaders(Headers::Type type, bool single) const; // throws if not present
 
@@ -364,6 +407,12 @@ class SipMessage : public TransactionMessage
 
       // raw text corresponding to each unknown header
       mutable UnknownHeaders mUnknownHeaders;
+      // case-insensitive hash of each name in mUnknownHeaders, in the same
+      // order; compared before any name is
+      std::vector<size_t> mUnknownHashes;
+
+      // raw text of the registered extension headers, indexed by slot
+      mutable std::vector<HeaderFieldValueList*> mRegisteredHeaders;
   
       // !jf!
       const Transport* mTransport;
@@ -376,16 +425,13 @@ class SipMessage : public TransactionMessage
       Tuple mDestination;
       
       // Raw buffers coming from the Transport. message manages the memory
-      std::vector<char*> mBufferList;
+      Buffers* mBuffers;
 
       // special case for the first line of message
       mutable HeaderFieldValueList* mStartLine;
 
-      // raw text for the contents (all of them)
-      mutable HeaderFieldValue* mContentsHfv;
-
-      // lazy parser for the contents
-      mutable Contents* mContents;
+      // the message body, 0 if there is none
+      mutable Body* mBody;
 
       // cached value of a hash of the transaction id for a message received
       // from a 2543 sip element. as per rfc3261 see 17.2.3
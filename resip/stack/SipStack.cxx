@@ -11,6 +11,7 @@
 
 #include "rutil/compat.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/Logger.hxx"
@@ -225,6 +226,16 @@ SipStack::addAlias(const Data& domain, int port)
    DebugLog (<< "Adding domain alias: " << domain << ":" << portToUse);
    assert(!mShuttingDown);
    mDomains.insert(domain + ":" + Data(portToUse));
+   const Data* interned = DataIntern::intern(domain);
+   if (interned)
+   {
+      mInternedDomains.insert(std::make_pair(interned, portToUse));
+   }
+   else
+   {
+      WarningLog(<< "Intern table full, " << domain << " compared as a string");
+      mUninternedDomains.insert(domain + ":" + Data(portToUse));
+   }
 
 
    if(mUri.host().empty())
@@ -291,8 +302,27 @@ SipStack::getHostAddress()
 bool 
 SipStack::isMyDomain(const Data& domain, int port) const
 {
-   return (mDomains.count(domain + ":" + 
-                          Data(port == 0 ? Symbols::DefaultSipPort : port)) != 0);
+   int portToUse = (port == 0) ? Symbols::DefaultSipPort : port;
+   const Data* interned = DataIntern::find(domain);
+   if (interned && mInternedDomains.count(std::make_pair(interned, portToUse)) != 0)
+   {
+      return true;
+   }
+   return (!mUninternedDomains.empty() &&
+           mUninternedDomains.count(domain + ":" + Data(portToUse)) != 0);
+}
+
+bool 
+SipStack::isMyDomain(const Uri& uri) const
+{
+   int portToUse = (uri.port() == 0) ? Symbols::DefaultSipPort : uri.port();
+   const Data* interned = uri.internedHost();
+   if (interned && mInternedDomains.count(std::make_pair(interned, portToUse)) != 0)
+   {
+      return true;
+   }
+   return (!mUninternedDomains.empty() &&
+           mUninternedDomains.count(uri.host() + ":" + Data(portToUse)) != 0);
 }
 
 bool
@@ -160,6 +160,12 @@ class SipStack
           @param port     Port number to check.
       */
       bool isMyDomain(const Data& domain, int port) const;
+
+      /**
+          As isMyDomain(uri.host(), uri.port()), but uses the interned host of
+          uri (see Uri::internedHost) when it has one.
+      */
+      bool isMyDomain(const Uri& uri) const;
       
       /**
           Returns true if port is handled by this stack.  Convenience for
@@ -568,6 +574,12 @@ class SipStack
           addAlias and addTransport interfaces and checks can be made with isMyDomain() */
       std::set<Data> mDomains;
 
+      /** the same domains, interned (see DataIntern) so that isMyDomain()
+          compares pointers; mUninternedDomains holds the "domain:port"
+          entries that did not fit in the intern table */
+      std::set<std::pair<const Data*, int> > mInternedDomains;
+      std::set<Data> mUninternedDomains;
+
       /** store all ports that this stack is lisenting on.  Controlled by addTransport
           and checks can be made with isMyPort() */
       std::set<int> mPorts;
@@ -0,0 +1,139 @@
+#if defined(HAVE_CONFIG_H)
+#include "resip/stack/config.hxx"
+#endif
+
+#include <cstring>
+
+#include "resip/stack/SipTrace.hxx"
+#include "resip/stack/Tuple.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
+
+volatile bool SipTrace::mActive = false;
+BinaryTraceFile SipTrace::mFile;
+
+bool
+SipTrace::start(const Data& fileName, unsigned int maxFileSize, unsigned int maxFiles)
+{
+   if (!mFile.open(fileName, maxFileSize, maxFiles))
+   {
+      return false;
+   }
+   InfoLog(<< "Tracing SIP messages to " << fileName);
+   mActive = true;
+   return true;
+}
+
+void
+SipTrace::stop()
+{
+   // a record written concurrently is either complete or refused by the closed file
+   mActive = false;
+   mFile.close();
+}
+
+static void
+fillAddress(UInt8* address, const Tuple& tuple)
+{
+   memset(address, 0, 16);
+#ifdef USE_IPV6
+   if (tuple.ipVersion() == V6)
+   {
+      memcpy(address, &reinterpret_cast<const sockaddr_in6&>(tuple.getSockaddr()).sin6_addr, 16);
+      return;
+   }
+#endif
+   memcpy(address, &reinterpret_cast<const sockaddr_in&>(tuple.getSockaddr()).sin_addr, 4);
+}
+
+void
+SipTrace::fillTupleRecord(TupleRecord& record, const Tuple& source, const Tuple& destination)
+{
+   record.mTransportType = (UInt8)(destination.getType() != UNKNOWN_TRANSPORT ? destination.getType() : source.getType());
+   record.mIpVersion = destination.ipVersion() == V6 ? 6 : 4;
+   record.mReserved = 0;
+   record.mSourcePort = (UInt16)source.getPort();
+   record.mDestinationPort = (UInt16)destination.getPort();
+   fillAddress(record.mSourceAddress, source);
+   fillAddress(record.mDestinationAddress, destination);
+}
+
+void
+SipTrace::received(const Tuple& source, const Tuple& destination, const char* data, size_t size)
+{
+   TupleRecord record;
+   fillTupleRecord(record, source, destination);
+   mFile.write(MessageReceived, &record, sizeof(record), data, size);
+}
+
+void
+SipTrace::sent(const Tuple& source, const Tuple& destination, const char* data, size_t size)
+{
+   TupleRecord record;
+   fillTupleRecord(record, source, destination);
+   mFile.write(MessageSent, &record, sizeof(record), data, size);
+}
+
+void
+SipTrace::event(EventCode code, UInt32 arg, const Data& tid)
+{
+   EventRecord record;
+   record.mCode = (UInt16)code;
+   record.mReserved = 0;
+   record.mArg = arg;
+   mFile.write(Event, &record, sizeof(record), tid.data(), tid.size());
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,133 @@
+#if !defined(RESIP_SIPTRACE_HXX)
+#define RESIP_SIPTRACE_HXX
+
+#include "rutil/BinaryTrace.hxx"
+#include "rutil/Data.hxx"
+
+namespace resip
+{
+
+class Tuple;
+
+/**
+   @brief Binary trace of the stack: the raw bytes of every SIP message the
+   transports send and receive, with a timestamp and the addresses, and 
+   compact event codes from the transaction state machines.
+
+   Records go into memory mapped, rotating files (see BinaryTraceFile), so 
+   tracing costs a memcpy per message instead of formatting it into the log.
+   apps/sipTraceDecode renders the files as text or as a pcap capture.
+
+   Stream transports record the bytes as they are read from the connection,
+   which need not be one message per record.  TLS connections record the
+   decrypted bytes.
+*/
+class SipTrace
+{
+   public:
+      typedef enum
+      {
+         MessageReceived = 1,    ///< TupleRecord, then the bytes
+         MessageSent,            ///< TupleRecord, then the bytes
+         Event                   ///< EventRecord, then the transaction id
+      } RecordType;
+
+      typedef enum
+      {
+         TransactionCreated = 1, ///< arg: machine << 8 | state
+         TransactionStateChange, ///< arg: old state << 8 | new state
+         TransactionTimer,       ///< arg: Timer::Type
+         TransactionTransportFailure, ///< arg: TransportFailure::FailureReason
+         TransactionDeleted      ///< arg: state
+      } EventCode;
+
+      struct TupleRecord
+      {
+         UInt8 mTransportType;   ///< TransportType
+         UInt8 mIpVersion;       ///< 4 or 6
+         UInt16 mReserved;
+         UInt16 mSourcePort;
+         UInt16 mDestinationPort;
+         UInt8 mSourceAddress[16];      ///< network byte order, IPv4 in the first 4 bytes
+         UInt8 mDestinationAddress[16];
+      };
+
+      struct EventRecord
+      {
+         UInt16 mCode;           ///< EventCode
+         UInt16 mReserved;
+         UInt32 mArg;
+      };
+
+      /// Starts tracing into fileName - returns false if the file could not be created
+      static bool start(const Data& fileName, 
+                        unsigned int maxFileSize = 16*1024*1024, 
+                        unsigned int maxFiles = 4);
+      static void stop();
+      static bool isActive() { return mActive; }
+
+      static void received(const Tuple& source, const Tuple& destination, const char* data, size_t size);
+      static void sent(const Tuple& source, const Tuple& destination, const char* data, size_t size);
+      static void event(EventCode code, UInt32 arg, const Data& tid);
+
+      /// Fills in the addresses of a TupleRecord
+      static void fillTupleRecord(TupleRecord& record, const Tuple& source, const Tuple& destination);
+
+   private:
+      static volatile bool mActive;
+      static BinaryTraceFile mFile;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
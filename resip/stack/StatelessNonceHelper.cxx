@@ -0,0 +1,389 @@
+#include <string.h>
+#include <stdio.h>
+
+#include "resip/stack/StatelessNonceHelper.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::SIP
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static int
+hexValue(char c)
+{
+   if (c >= '0' && c <= '9') return c - '0';
+   if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+   if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+   return -1;
+}
+
+StatelessNonceHelper::StatelessNonceHelper(unsigned int replayWindow) :
+   mReplayWindow(replayWindow),
+   mHasStale(false),
+   mStaleUpTo(0)
+{
+   setPrivateKey(Random::getCryptoRandom(24));
+   mSequence.add(Random::getRandom() & 0xffff);
+}
+
+StatelessNonceHelper::~StatelessNonceHelper() 
+{
+}
+
+void
+StatelessNonceHelper::setPrivateKey(const Data& privateKey)
+{
+   // RFC 2104; keep the contexts after the padded key blocks so each MAC
+   // costs two MD5 passes over the message and no rekeying
+   unsigned char key[64];
+   memset(key, 0, sizeof(key));
+   if (privateKey.size() > sizeof(key))
+   {
+      MD5Context ctx;
+      MD5Init(&ctx);
+      MD5Update(&ctx, (const md5byte*)privateKey.data(), (unsigned)privateKey.size());
+      MD5Final(key, &ctx);
+   }
+   else
+   {
+      memcpy(key, privateKey.data(), privateKey.size());
+   }
+
+   unsigned char pad[64];
+   for (int i = 0; i < 64; ++i)
+   {
+      pad[i] = key[i] ^ 0x36;
+   }
+   MD5Init(&mInnerContext);
+   MD5Update(&mInnerContext, pad, sizeof(pad));
+
+   for (int i = 0; i < 64; ++i)
+   {
+      pad[i] = key[i] ^ 0x5c;
+   }
+   MD5Init(&mOuterContext);
+   MD5Update(&mOuterContext, pad, sizeof(pad));
+}
+
+void
+StatelessNonceHelper::computeMac(const char* prefix, size_t prefixLen,
+                                 const SipMessage& request,
+                                 unsigned char mac[MacSize]) const
+{
+   const Data& user = request.header(h_From).uri().user();
+
+   MD5Context ctx = mInnerContext;
+   MD5Update(&ctx, (const md5byte*)prefix, (unsigned)prefixLen);
+   MD5Update(&ctx, (const md5byte*)user.data(), (unsigned)user.size());
+   unsigned char inner[16];
+   MD5Final(inner, &ctx);
+
+   ctx = mOuterContext;
+   MD5Update(&ctx, inner, sizeof(inner));
+   MD5Final(mac, &ctx);
+}
+
+Data 
+StatelessNonceHelper::makeNonce(const SipMessage& request, const Data& timestamp) 
+{
+   UInt32 sequence = (UInt32)mSequence.increment();
+
+   // <timestamp>:<sequence>: is also the MAC input, followed by the user
+   char buf[128];
+   size_t len = timestamp.size() < 20 ? timestamp.size() : 20;
+   memcpy(buf, timestamp.data(), len);
+   len += sprintf(buf + len, ":%08x:", (unsigned int)sequence);
+
+   unsigned char mac[MacSize];
+   computeMac(buf, len, request, mac);
+   for (int i = 0; i < MacSize; ++i)
+   {
+      buf[len++] = hexDigits[mac[i] >> 4];
+      buf[len++] = hexDigits[mac[i] & 0x0f];
+   }
+   return Data(buf, (int)len);
+}
+
+bool
+StatelessNonceHelper::parse(const Data& nonce, UInt64& timestamp, UInt32& sequence,
+                            const char*& mac, size_t& prefixLen) const
+{
+   const char* p = nonce.data();
+   const char* end = p + nonce.size();
+
+   timestamp = 0;
+   const char* start = p;
+   while (p < end && *p >= '0' && *p <= '9' && p - start < 20)
+   {
+      timestamp = timestamp * 10 + (*p++ - '0');
+   }
+   if (p == start || p == end || *p++ != ':')
+   {
+      return false;
+   }
+
+   sequence = 0;
+   for (int i = 0; i < 8; ++i)
+   {
+      int v = p < end ? hexValue(*p++) : -1;
+      if (v < 0)
+      {
+         return false;
+      }
+      sequence = (sequence << 4) | v;
+   }
+   if (p == end || *p++ != ':')
+   {
+      return false;
+   }
+
+   prefixLen = p - nonce.data();
+   if (end - p != MacSize * 2)
+   {
+      return false;
+   }
+   mac = p;
+   return true;
+}
+
+NonceHelper::Nonce
+StatelessNonceHelper::parseNonce(const Data& nonce) 
+{
+   UInt64 timestamp;
+   UInt32 sequence;
+   const char* mac;
+   size_t prefixLen;
+   if (!parse(nonce, timestamp, sequence, mac, prefixLen))
+   {
+      DebugLog(<< "Invalid nonce " << nonce);
+      return Nonce(0);
+   }
+   return Nonce(timestamp);
+}
+
+bool
+StatelessNonceHelper::verify(const Data& nonce, const SipMessage& request,
+                             UInt64& timestamp, UInt32& sequence) const
+{
+   const char* received;
+   size_t prefixLen;
+   if (!parse(nonce, timestamp, sequence, received, prefixLen))
+   {
+      return false;
+   }
+
+   unsigned char mac[MacSize];
+   computeMac(nonce.data(), prefixLen, request, mac);
+
+   // constant time, the received MAC may be upper case
+   int diff = 0;
+   for (int i = 0; i < MacSize; ++i)
+   {
+      int hi = hexValue(received[i*2]);
+      int lo = hexValue(received[i*2+1]);
+      if (hi < 0 || lo < 0)
+      {
+         return false;
+      }
+      diff |= (hi << 4 | lo) ^ mac[i];
+   }
+   return diff == 0;
+}
+
+bool
+StatelessNonceHelper::isValidNonce(const Data& nonce, const SipMessage& request)
+{
+   UInt64 timestamp;
+   UInt32 sequence;
+   return verify(nonce, request, timestamp, sequence);
+}
+
+Helper::AuthResult
+StatelessNonceHelper::checkNonce(const Data& nonce,
+                                 const SipMessage& request,
+                                 const Data* nonceCount,
+                                 int expiresDelta)
+{
+   UInt64 timestamp;
+   UInt32 sequence;
+   if (!verify(nonce, request, timestamp, sequence))
+   {
+      DebugLog(<< "Not my nonce: " << nonce);
+      return Helper::BadlyFormed;
+   }
+
+   if (expiresDelta > 0 && timestamp + expiresDelta < Timer::getTimeSecs())
+   {
+      DebugLog(<< "Nonce has expired.");
+      return Helper::Expired;
+   }
+
+   if (mReplayWindow)
+   {
+      UInt32 nc = 0;
+      if (nonceCount && !parseNonceCount(*nonceCount, nc))
+      {
+         return Helper::BadlyFormed;
+      }
+
+      Lock lock(mMutex);
+      if (isStale(sequence))
+      {
+         DebugLog(<< "Nonce " << sequence << " is outside the replay window");
+         return Helper::Expired;
+      }
+      if (nonceCount && isReplay(sequence, nc))
+      {
+         InfoLog(<< "Replayed nonce count " << nc << " for nonce " << sequence);
+         return Helper::Expired;
+      }
+   }
+   return Helper::Authenticated;
+}
+
+bool
+StatelessNonceHelper::recordNonceCount(const Data& nonce, const Data& nonceCount)
+{
+   if (!mReplayWindow)
+   {
+      return true;
+   }
+
+   UInt64 timestamp;
+   UInt32 sequence;
+   const char* mac;
+   size_t prefixLen;
+   UInt32 nc;
+   if (!parse(nonce, timestamp, sequence, mac, prefixLen) ||
+       !parseNonceCount(nonceCount, nc))
+   {
+      return false;
+   }
+
+   Lock lock(mMutex);
+   if (isStale(sequence) || isReplay(sequence, nc))
+   {
+      InfoLog(<< "Replayed nonce count " << nc << " for nonce " << sequence);
+      return false;
+   }
+
+   std::map<UInt32, UInt32>::iterator i = mNonceCounts.find(sequence);
+   if (i != mNonceCounts.end())
+   {
+      i->second = nc;
+      return true;
+   }
+
+   mNonceCounts[sequence] = nc;
+   mFirstUsed.push_back(sequence);
+   while (mFirstUsed.size() > mReplayWindow)
+   {
+      const UInt32 oldest = mFirstUsed.front();
+      mFirstUsed.pop_front();
+      mNonceCounts.erase(oldest);
+      // without its count the dropped nonce could be replayed, so it and
+      // everything issued before it become stale
+      if (!isStale(oldest))
+      {
+         mHasStale = true;
+         mStaleUpTo = oldest;
+      }
+   }
+   return true;
+}
+
+bool
+StatelessNonceHelper::parseNonceCount(const Data& nonceCount, UInt32& nc)
+{
+   nc = 0;
+   if (nonceCount.size() != 8)
+   {
+      DebugLog(<< "Invalid nc " << nonceCount);
+      return false;
+   }
+   for (int i = 0; i < 8; ++i)
+   {
+      int v = hexValue(nonceCount[i]);
+      if (v < 0)
+      {
+         DebugLog(<< "Invalid nc " << nonceCount);
+         return false;
+      }
+      nc = (nc << 4) | v;
+   }
+   return true;
+}
+
+bool
+StatelessNonceHelper::isStale(UInt32 sequence) const
+{
+   if (!mHasStale)
+   {
+      return false;
+   }
+   // compare ages rather than sequences so that wrapping does not matter
+   const UInt32 current = (UInt32)mSequence.value();
+   return (UInt32)(current - sequence) >= (UInt32)(current - mStaleUpTo);
+}
+
+bool
+StatelessNonceHelper::isReplay(UInt32 sequence, UInt32 nc) const
+{
+   std::map<UInt32, UInt32>::const_iterator i = mNonceCounts.find(sequence);
+   return i != mNonceCounts.end() ? nc <= i->second : nc == 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
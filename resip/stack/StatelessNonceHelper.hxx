@@ -0,0 +1,155 @@
+#if !defined(RESIP_STATELESSNONCEHELPER_HXX)
+#define RESIP_STATELESSNONCEHELPER_HXX
+
+#include <deque>
+#include <map>
+
+#include "resip/stack/NonceHelper.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/AtomicCounter.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/vmd5.hxx"
+
+namespace resip
+{
+
+/**
+ * StatelessNonceHelper issues nonces of the form
+ *
+ *    <timestamp>:<sequence>:<HMAC-MD5(key, timestamp:sequence:from-user)>
+ *
+ * Validating one needs no per-nonce state: the MAC is recomputed from the
+ * nonce itself with the HMAC key schedule computed once in setPrivateKey,
+ * without heap allocation.
+ *
+ * The sequence number lets checkNonce() detect replays: once a request has
+ * been authenticated with a nonce, recordNonceCount() keeps the highest
+ * nonce-count (nc) seen for it, and a later request that does not increase
+ * it is treated as stale.  Only nonces that have authenticated a request
+ * take room, so challenges alone never push a nonce out.  At most
+ * replayWindow nonces are tracked; when one more is used, the one first
+ * used longest ago is dropped and every nonce issued up to it becomes
+ * stale, so clients are re-challenged with stale=true rather than
+ * rejected.  Size replayWindow to the number of nonces in use at once,
+ * i.e. the clients authenticating within a nonce lifetime.
+ *
+ * As with BasicNonceHelper, a farm of servers must share the private key
+ * and have synchronized clocks; replay detection is per instance.
+ *
+ * Install with Helper::setNonceHelper(new StatelessNonceHelper).
+ */
+class StatelessNonceHelper : public NonceHelper 
+{
+   public:
+      // replayWindow of 0 disables nonce-count tracking
+      StatelessNonceHelper(unsigned int replayWindow = 4096);
+      virtual ~StatelessNonceHelper();
+
+      // not thread safe; call before any nonce is issued
+      void setPrivateKey(const Data& privateKey);
+
+      virtual Data makeNonce(const SipMessage& request, const Data& timestamp);
+      virtual Nonce parseNonce(const Data& nonce);
+      // checks the MAC only
+      virtual bool isValidNonce(const Data& nonce, const SipMessage& request);
+
+      // Checks the MAC, expiry (if expiresDelta > 0), that the nonce has
+      // not left the replay window and, if nonceCount is given, that it is
+      // higher than any recorded for this nonce. Records nothing.
+      // Returns Authenticated, Expired or BadlyFormed.
+      Helper::AuthResult checkNonce(const Data& nonce, 
+                                    const SipMessage& request,
+                                    const Data* nonceCount,
+                                    int expiresDelta);
+
+      // Call once the response has been verified, so that only
+      // authenticated requests use up nonce counts. Returns false if the
+      // count is no longer higher than the recorded one (a replay that
+      // raced this request) or the nonce has left the window.
+      bool recordNonceCount(const Data& nonce, const Data& nonceCount);
+
+   private:
+      enum { MacSize = 16 };
+
+      void computeMac(const char* prefix, size_t prefixLen, 
+                      const SipMessage& request, 
+                      unsigned char mac[MacSize]) const;
+      bool parse(const Data& nonce, UInt64& timestamp, UInt32& sequence,
+                 const char*& mac, size_t& prefixLen) const;
+      bool verify(const Data& nonce, const SipMessage& request,
+                  UInt64& timestamp, UInt32& sequence) const;
+      static bool parseNonceCount(const Data& nonceCount, UInt32& nc);
+      // both need mMutex held
+      bool isStale(UInt32 sequence) const;
+      bool isReplay(UInt32 sequence, UInt32 nc) const;
+
+      MD5Context mInnerContext;
+      MD5Context mOuterContext;
+
+      AtomicCounter mSequence;
+      const unsigned int mReplayWindow;
+      Mutex mMutex;
+      // highest nc per used nonce, keyed by sequence
+      std::map<UInt32, UInt32> mNonceCounts;
+      // sequences in mNonceCounts, in the order they were first used
+      std::deque<UInt32> mFirstUsed;
+      // nonces issued up to and including mStaleUpTo are stale
+      bool mHasStale;
+      UInt32 mStaleUpTo;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
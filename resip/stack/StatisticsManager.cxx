@@ -69,9 +69,15 @@ StatisticsManager::process()
 bool
 StatisticsManager::sent(SipMessage* msg, bool retrans)
 {
-   MethodTypes met = msg->header(h_CSeq).method();
+   return sent(msg->header(h_CSeq).method(),
+               msg->isResponse() ? msg->header(h_StatusLine).statusCode() : 0,
+               retrans);
+}
 
-   if (msg->isRequest())
+bool
+StatisticsManager::sent(MethodTypes met, int responseCode, bool retrans)
+{
+   if (responseCode == 0)
    {
       if (retrans)
       {
@@ -81,9 +87,9 @@ StatisticsManager::sent(SipMessage* msg, bool retrans)
       ++requestsSent;
       ++requestsSentByMethod[met];
    }
-   else if (msg->isResponse())
+   else
    {
-      int code = msg->header(h_StatusLine).statusCode();
+      int code = responseCode;
       if (code < 0 || code >= MaxCode)
       {
          code = 0;
@@ -42,6 +42,8 @@ class StatisticsManager : public StatisticsMessage::Payload
    private:
       friend class TransactionState;
       bool sent(SipMessage* msg, bool retrans);
+      // for a message that is no longer around; responseCode is 0 for requests
+      bool sent(MethodTypes met, int responseCode, bool retrans);
       bool received(SipMessage* msg);
 
       void poll(); // force an update
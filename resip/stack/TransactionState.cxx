@@ -2,6 +2,8 @@
 #include "resip/stack/config.hxx"
 #endif
 
+#include <utility>
+
 #include "resip/stack/AbandonServerTransaction.hxx"
 #include "resip/stack/CancelClientInviteTransaction.hxx"
 #include "resip/stack/ConnectionTerminated.hxx"
@@ -11,6 +13,7 @@
 #include "resip/stack/MethodTypes.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/SipStack.hxx"
+#include "resip/stack/SipTrace.hxx"
 #include "resip/stack/StatisticsManager.hxx"
 #include "resip/stack/TimerMessage.hxx"
 #include "resip/stack/TransactionController.hxx"
@@ -46,6 +49,8 @@ TransactionState::TransactionState(TransactionController& controller, Machine m,
    mIsAbandoned(false),
    mIsReliable(true), // !jf! 
    mMsgToRetransmit(0),
+   mMethodToRetransmit(UNKNOWN),
+   mCodeToRetransmit(0),
    mDnsResult(0),
    mId(id),
    mAckIsValid(false),
@@ -54,6 +59,10 @@ TransactionState::TransactionState(TransactionController& controller, Machine m,
    mFailureReason(TransportFailure::None)
 {
    StackLog (<< "Creating new TransactionState: " << *this);
+   if (SipTrace::isActive())
+   {
+      SipTrace::event(SipTrace::TransactionCreated, (mMachine << 8) | mState, mId);
+   }
 }
 
 
@@ -126,6 +135,11 @@ TransactionState::~TransactionState()
 {
    assert(mState != Bogus);
 
+   if (SipTrace::isActive())
+   {
+      SipTrace::event(SipTrace::TransactionDeleted, mState, mId);
+   }
+
    if (mDnsResult)
    {
       mDnsResult->destroy();
@@ -236,6 +250,20 @@ TransactionState::process(TransactionController& controller)
    TransactionState* state = 0;
    if (message->isClientTransaction()) state = controller.mClientTransactionMap.find(tid);
    else state = controller.mServerTransactionMap.find(tid);
+
+   if (state && !sip && SipTrace::isActive())
+   {
+      TimerMessage* timer = dynamic_cast<TimerMessage*>(message);
+      TransportFailure* failure = timer ? 0 : dynamic_cast<TransportFailure*>(message);
+      if (timer)
+      {
+         SipTrace::event(SipTrace::TransactionTimer, timer->getType(), tid);
+      }
+      else if (failure)
+      {
+         SipTrace::event(SipTrace::TransactionTransportFailure, failure->getFailureReason(), tid);
+      }
+   }
    
    if (state && sip && sip->isExternal())
    {
@@ -442,7 +470,7 @@ TransactionState::process(TransactionController& controller)
                if (Timer::T100 == 0)
                {
                   state->sendToWire(state->mMsgToRetransmit); // will get deleted when this is deleted
-                  state->mState = Proceeding;
+                  state->setState(Proceeding);
                }
                else
                {
@@ -695,7 +723,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
             {
                mController.mTimers.add(Timer::TimerE2, mId, Timer::T2 );
             }
-            mState = Proceeding;
+            setState(Proceeding);
             sendToTU(msg); // don't delete            
          }
          else
@@ -723,7 +751,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
          }
          else if (mState != Completed) // prevent TimerK reproduced
          {
-            mState = Completed;
+            setState(Completed);
             mController.mTimers.add(Timer::TimerK, mId, Timer::T4 );            
          }
       }
@@ -742,7 +770,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
                if (d < Timer::T2) d *= 2;
                mController.mTimers.add(Timer::TimerE1, mId, d);
                StackLog (<< "Retransmitting: " << mMsgToRetransmit->brief());
-               sendToWire(mMsgToRetransmit, true);
+               resendToWire();
                delete msg;
             }
             else
@@ -757,7 +785,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
             {
                mController.mTimers.add(Timer::TimerE2, mId, Timer::T2);
                StackLog (<< "Retransmitting: " << mMsgToRetransmit->brief());
-               sendToWire(mMsgToRetransmit, true);
+               resendToWire();
                delete msg;
             }
             else 
@@ -858,7 +886,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
             {
                if (mState == Calling || mState == Proceeding)
                {
-                  mState = Proceeding;
+                  setState(Proceeding);
                   if(mIsAbandoned)
                   {
                      SipMessage* cancel = Helper::makeCancel(*mMsgToRetransmit);
@@ -920,7 +948,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
                      // transaction MUST generate an ACK request, even if the transport is
                      // reliable, if transport is Unreliable then Fire the Timer D which 
                      // take care of re-Transmission of ACK 
-                     mState = Completed;
+                     setState(Completed);
                      mController.mTimers.add(Timer::TimerD, mId, Timer::TD );
                      SipMessage* ack;
                      ack = Helper::makeFailureAck(*mMsgToRetransmit, *sip);
@@ -936,7 +964,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
                      // cause the ACK to be re-passed to the transport
                      // layer for retransmission.
                      assert (mMsgToRetransmit->method() == ACK);
-                     sendToWire(mMsgToRetransmit, true);
+                     resendToWire();
                      delete msg;
                   }
                   else
@@ -979,7 +1007,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
 
                mController.mTimers.add(Timer::TimerA, mId, d);
                InfoLog (<< "Retransmitting INVITE: " << mMsgToRetransmit->brief());
-               sendToWire(mMsgToRetransmit, true);
+               resendToWire();
             }
             delete msg;
             break;
@@ -1091,10 +1119,11 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
             SipMessage* req = dynamic_cast<SipMessage*>(msg);
             mMsgToRetransmit=Helper::makeResponse(*req, 500);
             sendToWire(mMsgToRetransmit);
+            onlyRetransmitFromNowOn();
          }
          else
          {
-            sendToWire(mMsgToRetransmit, true);
+            resendToWire();
          }
          delete msg;
       }
@@ -1117,7 +1146,7 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
          {
             delete mMsgToRetransmit;
             mMsgToRetransmit = sip;
-            mState = Proceeding;
+            setState(Proceeding);
             sendToWire(sip); // don't delete msg
          }
          else
@@ -1140,11 +1169,12 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
          {
             if (mState == Trying || mState == Proceeding)
             {
-               mState = Completed;
+               setState(Completed);
                mController.mTimers.add(Timer::TimerJ, mId, 64*Timer::T1 );
                delete mMsgToRetransmit;
                mMsgToRetransmit = sip;
                sendToWire(sip); // don't delete msg
+               onlyRetransmitFromNowOn();
             }
             else if (mState == Completed)
             {
@@ -1187,7 +1217,7 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
             {
                // Timer E has reached T2 - send a 100 as recommended by RFC4320 NIT-Problem-Actions
                sendToWire(mMsgToRetransmit);
-               mState = Proceeding;
+               setState(Proceeding);
             }
             delete msg;
             break;
@@ -1227,7 +1257,7 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
             // If we haven't sent a 500 yet, we'll do so when the next
             // retransmission comes in. In the meantime, set up timers for
             // transaction termination.
-            mState = Completed;
+            setState(Completed);
             mController.mTimers.add(Timer::TimerJ, mId, 64*Timer::T1 );
          }
       }
@@ -1258,13 +1288,14 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                mAckIsValid=true;
                delete mMsgToRetransmit; 
                mMsgToRetransmit=Helper::makeResponse(*sip, 500);
-               mState = Completed;
+               setState(Completed);
                mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
                if (!mIsReliable)
                {
                   mController.mTimers.add(Timer::TimerG, mId, Timer::T1 );
                }
                sendToWire(mMsgToRetransmit);
+               onlyRetransmitFromNowOn();
                delete msg;
                return;
             }
@@ -1278,12 +1309,16 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                  passed from the TU for this transaction.
                */
                //StackLog (<< "Received invite from wire - forwarding to TU state=" << mState);
-               if (!mMsgToRetransmit)
+               if (!mMsgToRetransmit && mEncodedToRetransmit.empty())
                {
                   mMsgToRetransmit = make100(sip);
+                  sendToWire(mMsgToRetransmit);
+               }
+               else
+               {
+                  resendToWire();
                }
                delete msg;
-               sendToWire(mMsgToRetransmit);
             }
             else
             {
@@ -1310,7 +1345,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                else
                {
                   //StackLog (<< "Received ACK in Completed (unreliable) - confirmed, start Timer I");
-                  mState = Confirmed;
+                  setState(Confirmed);
                   mController.mTimers.add(Timer::TimerI, mId, Timer::T4 );
                   delete msg;
                }
@@ -1346,7 +1381,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                   //StackLog (<< "Received 100 in Trying or Proceeding. Send over wire");
                   delete mMsgToRetransmit; // may be replacing the 100
                   mMsgToRetransmit = sip;
-                  mState = Proceeding;
+                  setState(Proceeding);
                   sendToWire(msg); // don't delete msg
                }
                else
@@ -1362,7 +1397,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                   //StackLog (<< "Received 1xx in Trying or Proceeding. Send over wire");
                   delete mMsgToRetransmit; // may be replacing the 100
                   mMsgToRetransmit = sip;
-                  mState = Proceeding;
+                  setState(Proceeding);
                   sendToWire(msg); // don't delete msg
                }
                else
@@ -1410,13 +1445,14 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                   StackLog (<< "Received failed response in Trying or Proceeding. Start Timer H, move to completed." << *this);
                   delete mMsgToRetransmit; 
                   mMsgToRetransmit = sip; 
-                  mState = Completed;                     
+                  setState(Completed);
                   mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
                   if (!mIsReliable)
                   {
                      mController.mTimers.add(Timer::TimerG, mId, Timer::T1 );
                   }
                   sendToWire(msg); // don't delete msg
+                  onlyRetransmitFromNowOn();
                }
                else
                {
@@ -1450,7 +1486,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
             if (mState == Completed)
             {
                StackLog (<< "TimerG fired. retransmit, and re-add TimerG");
-               sendToWire(mMsgToRetransmit, true);
+               resendToWire();
                mController.mTimers.add(Timer::TimerG, mId, resipMin(Timer::T2, timer->getDuration()*2) );  //  TimerG is supposed to double - up until a max of T2 RFC3261 17.2.1
             }
             break;
@@ -1480,7 +1516,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
             {
                //StackLog (<< "TimerTrying fired. Send a 100");
                sendToWire(mMsgToRetransmit); // will get deleted when this is deleted
-               mState = Proceeding;
+               setState(Proceeding);
             }
             else
             {
@@ -1513,9 +1549,10 @@ TransactionState::processServerInvite(TransactionMessage* msg)
             mMsgToRetransmit->header(h_StatusLine).statusCode()=500;
             mMsgToRetransmit->header(h_StatusLine).reason()="Server Error";
             sendToWire(mMsgToRetransmit);
+            onlyRetransmitFromNowOn();
             mAckIsValid=true;
             StackLog (<< "Received failed response in Trying or Proceeding. Start Timer H, move to completed." << *this);
-            mState = Completed;
+            setState(Completed);
             mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
             if (!mIsReliable)
             {
@@ -1875,6 +1912,7 @@ TransactionState::handle(DnsResult* result)
             mTarget = mDnsResult->next();
             processReliability(mTarget.getType());
             mController.mTransportSelector.transmit(mMsgToRetransmit, mTarget);
+            rememberEncoded(mMsgToRetransmit);
             break;
             
          case DnsResult::Finished:
@@ -1971,7 +2009,7 @@ simpleTupleForUri(const Uri& uri)
 }
 
 void
-TransactionState::sendToWire(TransactionMessage* msg, bool resend) 
+TransactionState::sendToWire(TransactionMessage* msg) 
 {
    SipMessage* sip = dynamic_cast<SipMessage*>(msg);
 
@@ -1985,114 +2023,162 @@ TransactionState::sendToWire(TransactionMessage* msg, bool resend)
    if(mController.mStack.statisticsManagerEnabled())
    {
       // ?bwc? What if we have to drop the message below?
-      mController.mStatsManager.sent(sip, resend);
+      mController.mStatsManager.sent(sip, false);
    }
 
-   if(resend)
+   if(isClient())
    {
-      if(isClient())
+      if(mTarget.getType() != UNKNOWN_TRANSPORT) // mTarget is set, so just send.
       {
-         // .bwc. mTarget will almost always be set here, _except_ when DNS 
-         // resolution hasn't finished yet.
-         if(mTarget.getType() == UNKNOWN_TRANSPORT)
-         {
-            // .bwc. DNS isn't done yet, and it is time to retransmit. Oh well...
-            assert(mDnsResult);
-            assert(mWaitingForDnsResult);
-            return;
-         }
-         mController.mTransportSelector.retransmit(sip, mTarget);
+         mController.mTransportSelector.transmit(sip, mTarget);
       }
-      else
+      else // mTarget isn't set...
       {
-         assert(mResponseTarget.getType() != UNKNOWN_TRANSPORT);
-         mController.mTransportSelector.retransmit(sip, mResponseTarget);
-      }
-   }
-   else // initial transmission; need to determine target
-   {
-      if(isClient())
-      {
-         if(mTarget.getType() != UNKNOWN_TRANSPORT) // mTarget is set, so just send.
+         if (sip->getDestination().mFlowKey) //...but sip->getDestination() will work
          {
+            // ?bwc? Maybe we should be nice to the TU and do DNS in this case?
+            assert(sip->getDestination().getType() != UNKNOWN_TRANSPORT);
+
+            // .bwc. We have the FlowKey. This completely specifies our 
+            // Transport (and Connection, if applicable). No DNS required.
+            DebugLog(<< "Sending to tuple: " << sip->getDestination());
+            mTarget = sip->getDestination();
+            processReliability(mTarget.getType());
             mController.mTransportSelector.transmit(sip, mTarget);
          }
-         else // mTarget isn't set...
+         else // ...so DNS is required...
          {
-            if (sip->getDestination().mFlowKey) //...but sip->getDestination() will work
+            if(mDnsResult == 0) // ... and we haven't started a DNS query yet.
             {
-               // ?bwc? Maybe we should be nice to the TU and do DNS in this case?
-               assert(sip->getDestination().getType() != UNKNOWN_TRANSPORT);
-
-               // .bwc. We have the FlowKey. This completely specifies our 
-               // Transport (and Connection, if applicable). No DNS required.
-               DebugLog(<< "Sending to tuple: " << sip->getDestination());
-               mTarget = sip->getDestination();
-               processReliability(mTarget.getType());
-               mController.mTransportSelector.transmit(sip, mTarget);
+               StackLog (<< "sendToWire with no dns result: " << *this);
+               assert(sip->isRequest());
+               assert(!mIsCancel); // .bwc. mTarget should be set in this case.
+               mDnsResult = mController.mTransportSelector.createDnsResult(this);
+               mWaitingForDnsResult=true;
+               mController.mTransportSelector.dnsResolve(mDnsResult, sip);
             }
-            else // ...so DNS is required...
+            else // ... but our DNS query isn't done yet.
             {
-               if(mDnsResult == 0) // ... and we haven't started a DNS query yet.
-               {
-                  StackLog (<< "sendToWire with no dns result: " << *this);
-                  assert(sip->isRequest());
-                  assert(!mIsCancel); // .bwc. mTarget should be set in this case.
-                  mDnsResult = mController.mTransportSelector.createDnsResult(this);
-                  mWaitingForDnsResult=true;
-                  mController.mTransportSelector.dnsResolve(mDnsResult, sip);
-               }
-               else // ... but our DNS query isn't done yet.
-               {
-                  // .bwc. While the resolver was attempting to find a target, another
-                  // request came down from the TU. This could be a bug in the TU, or 
-                  // could be a retransmission of an ACK/200. Either way, we cannot
-                  // expect to ever be able to send this request (nowhere to store it
-                  // temporarily).
-                  // ?bwc? Higher log-level?
-                  DebugLog(<< "Received a second request from the TU for a transaction"
-                           " that already existed, before the DNS subsystem was done "
-                           "resolving the target for the first request. Either the TU"
-                           " has messed up, or it is retransmitting ACK/200 (the only"
-                           " valid case for this to happen)");
-               }
+               // .bwc. While the resolver was attempting to find a target, another
+               // request came down from the TU. This could be a bug in the TU, or 
+               // could be a retransmission of an ACK/200. Either way, we cannot
+               // expect to ever be able to send this request (nowhere to store it
+               // temporarily).
+               // ?bwc? Higher log-level?
+               DebugLog(<< "Received a second request from the TU for a transaction"
+                        " that already existed, before the DNS subsystem was done "
+                        "resolving the target for the first request. Either the TU"
+                        " has messed up, or it is retransmitting ACK/200 (the only"
+                        " valid case for this to happen)");
             }
          }
       }
-      else // server transaction
+   }
+   else // server transaction
+   {
+      assert(mDnsResult == 0);
+      assert(sip->exists(h_Vias));
+      assert(!sip->header(h_Vias).empty());
+
+      // .bwc. Code that tweaks mResponseTarget based on stuff in the SipMessage.
+      // ?bwc? Why?
+      if (sip->hasForceTarget())
       {
-         assert(mDnsResult == 0);
-         assert(sip->exists(h_Vias));
-         assert(!sip->header(h_Vias).empty());
+         // ?bwc? Override the target for a single response? Should we even
+         // allow this? What about client transactions? Should we overwrite 
+         // mResponseTarget here? I don't think this has been thought out properly.
+         Tuple target = simpleTupleForUri(sip->getForceTarget());
+         StackLog(<<"!ah! response with force target going to : "<<target);
+         mController.mTransportSelector.transmit(sip, target);
+         rememberEncoded(sip);
+         return;
+      }
+      else if (sip->header(h_Vias).front().exists(p_rport) && sip->header(h_Vias).front().param(p_rport).hasValue())
+      {
+         // ?bwc? This was not setting the port in mResponseTarget before. Why would
+         // the rport be different than the port in mResponseTarget? Didn't we 
+         // already set this? Maybe the TU messed with it? If so, why should we pay 
+         // attention to it? Again, this hasn't been thought out.
+         mResponseTarget.setPort(sip->header(h_Vias).front().param(p_rport).port());
+         StackLog(<< "rport present in response: " << mResponseTarget.getPort());
+      }
 
-         // .bwc. Code that tweaks mResponseTarget based on stuff in the SipMessage.
-         // ?bwc? Why?
-         if (sip->hasForceTarget())
-         {
-            // ?bwc? Override the target for a single response? Should we even
-            // allow this? What about client transactions? Should we overwrite 
-            // mResponseTarget here? I don't think this has been thought out properly.
-            Tuple target = simpleTupleForUri(sip->getForceTarget());
-            StackLog(<<"!ah! response with force target going to : "<<target);
-            mController.mTransportSelector.transmit(sip, target);
-            return;
-         }
-         else if (sip->header(h_Vias).front().exists(p_rport) && sip->header(h_Vias).front().param(p_rport).hasValue())
-         {
-            // ?bwc? This was not setting the port in mResponseTarget before. Why would
-            // the rport be different than the port in mResponseTarget? Didn't we 
-            // already set this? Maybe the TU messed with it? If so, why should we pay 
-            // attention to it? Again, this hasn't been thought out.
-            mResponseTarget.setPort(sip->header(h_Vias).front().param(p_rport).port());
-            StackLog(<< "rport present in response: " << mResponseTarget.getPort());
-         }
+      StackLog(<< "tid=" << sip->getTransactionId() << " sending to : " << mResponseTarget);
+      mController.mTransportSelector.transmit(sip, mResponseTarget);
+   }
+
+   rememberEncoded(sip);
+}
 
-         StackLog(<< "tid=" << sip->getTransactionId() << " sending to : " << mResponseTarget);
-         mController.mTransportSelector.transmit(sip, mResponseTarget);
+void
+TransactionState::resendToWire()
+{
+   if(mController.mStack.statisticsManagerEnabled())
+   {
+      if (mMsgToRetransmit)
+      {
+         mController.mStatsManager.sent(mMsgToRetransmit, true);
+      }
+      else
+      {
+         mController.mStatsManager.sent(mMethodToRetransmit, mCodeToRetransmit, true);
       }
-      
    }
 
+   if(isClient())
+   {
+      // .bwc. mTarget will almost always be set here, _except_ when DNS 
+      // resolution hasn't finished yet.
+      if(mTarget.getType() == UNKNOWN_TRANSPORT)
+      {
+         // .bwc. DNS isn't done yet, and it is time to retransmit. Oh well...
+         assert(mDnsResult);
+         assert(mWaitingForDnsResult);
+         return;
+      }
+      mController.mTransportSelector.retransmit(mEncodedToRetransmit, mTarget,
+                                                mMsgToRetransmit->getTransactionId(),
+                                                mCompartmentToRetransmit);
+   }
+   else
+   {
+      assert(mResponseTarget.getType() != UNKNOWN_TRANSPORT);
+      mController.mTransportSelector.retransmit(mEncodedToRetransmit, mResponseTarget,
+                                                mMsgToRetransmit ? mMsgToRetransmit->getTransactionId() : mId,
+                                                mCompartmentToRetransmit);
+   }
+}
+
+void
+TransactionState::rememberEncoded(SipMessage* sip)
+{
+   if (sip != mMsgToRetransmit)
+   {
+      return;
+   }
+
+   // Take the bytes rather than copying them; the next transmit() of this
+   // message encodes it afresh anyway.
+#ifdef RESIP_HAS_RVALUE_REFS
+   mEncodedToRetransmit = std::move(sip->getEncoded());
+#else
+   mEncodedToRetransmit = sip->getEncoded();
+   sip->getEncoded().clear();
+#endif
+   mCompartmentToRetransmit = sip->getCompartmentId();
+}
+
+void
+TransactionState::onlyRetransmitFromNowOn()
+{
+   assert(!isClient());
+   if (mMsgToRetransmit)
+   {
+      mMethodToRetransmit = mMsgToRetransmit->header(h_CSeq).method();
+      mCodeToRetransmit = mMsgToRetransmit->header(h_StatusLine).statusCode();
+      delete mMsgToRetransmit;
+      mMsgToRetransmit = 0;
+   }
 }
 
 void
@@ -2263,10 +2349,20 @@ TransactionState::tid(SipMessage* sip) const
    return (mId.empty() && sip) ? sip->getTransactionId() : mId;
 }
 
+void
+TransactionState::setState(State state)
+{
+   if (SipTrace::isActive())
+   {
+      SipTrace::event(SipTrace::TransactionStateChange, (mState << 8) | state, mId);
+   }
+   mState = state;
+}
+
 void
 TransactionState::terminateClientTransaction(const Data& tid)
 {
-   mState = Terminated;
+   setState(Terminated);
    if (mController.mTuSelector.isTransactionUserStillRegistered(mTransactionUser) && 
        mTransactionUser->isRegisteredForTransactionTermination())
    {
@@ -2278,7 +2374,7 @@ TransactionState::terminateClientTransaction(const Data& tid)
 void
 TransactionState::terminateServerTransaction(const Data& tid)
 {
-   mState = Terminated;
+   setState(Terminated);
    if (mController.mTuSelector.isTransactionUserStillRegistered(mTransactionUser) && 
        mTransactionUser->isRegisteredForTransactionTermination())
    {
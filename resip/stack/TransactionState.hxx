@@ -4,6 +4,7 @@
 #include <iosfwd>
 #include <memory>
 #include "rutil/dns/DnsHandler.hxx"
+#include "resip/stack/MethodTypes.hxx"
 #include "resip/stack/Transport.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
 
@@ -89,8 +90,12 @@ class TransactionState : public DnsHandler
       bool isCancelClientTransaction(TransactionMessage* msg) const;
       void sendToTU(TransactionMessage* msg) const;
       static void sendToTU(TransactionUser* tu, TransactionController& controller, TransactionMessage* msg);
-      void sendToWire(TransactionMessage* msg, bool retransmit=false);
+      void sendToWire(TransactionMessage* msg);
+      void resendToWire();
+      void rememberEncoded(SipMessage* sip);
+      void onlyRetransmitFromNowOn();
       SipMessage* make100(SipMessage* request) const;
+      void setState(State state);
       void terminateClientTransaction(const Data& tid); 
       void terminateServerTransaction(const Data& tid); 
       const Data& tid(SipMessage* sip) const;
@@ -125,6 +130,17 @@ class TransactionState : public DnsHandler
       // !rk! The contract for this variable needs to be defined.
       SipMessage* mMsgToRetransmit;
 
+      // What mMsgToRetransmit was encoded to the last time it was sent.
+      // Retransmissions resend these bytes to mTarget/mResponseTarget instead
+      // of encoding the message again. Once a server transaction has sent its
+      // final response it has no use for the parsed message, so
+      // onlyRetransmitFromNowOn() frees it and keeps only these, plus what
+      // the statistics need.
+      Data mEncodedToRetransmit;
+      Data mCompartmentToRetransmit;
+      MethodTypes mMethodToRetransmit;
+      int mCodeToRetransmit; // 0 for a request
+
       // Handle to the dns results queried by the TransportSelector
       DnsResult* mDnsResult;
 
@@ -1,5 +1,7 @@
 #include "resip/stack/TransactionUser.hxx"
 #include "resip/stack/MessageFilterRule.hxx"
+#include "resip/stack/Uri.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -82,14 +84,40 @@ TransactionUser::isForMe(const SipMessage& msg) const
 bool 
 TransactionUser::isMyDomain(const Data& domain) const
 {
-   // Domain search should be case insensitive - search in lowercase only
-   return mDomainList.count(Data(domain).lowercase()) > 0;
+   // Domain search should be case insensitive - interning ignores case
+   const Data* interned = DataIntern::find(domain);
+   if (interned && mDomainList.count(interned) > 0)
+   {
+      return true;
+   }
+   return !mUninternedDomains.empty() &&
+      mUninternedDomains.count(Data(domain).lowercase()) > 0;
+}
+
+bool 
+TransactionUser::isMyDomain(const Uri& uri) const
+{
+   const Data* interned = uri.internedHost();
+   if (interned && mDomainList.count(interned) > 0)
+   {
+      return true;
+   }
+   return !mUninternedDomains.empty() &&
+      mUninternedDomains.count(Data(uri.host()).lowercase()) > 0;
 }
 
 void TransactionUser::addDomain(const Data& domain)
 {
-   // Domain search should be case insensitive - store in lowercase only
-   mDomainList.insert(Data(domain).lowercase());  
+   const Data* interned = DataIntern::intern(domain);
+   if (interned)
+   {
+      mDomainList.insert(interned);
+   }
+   else
+   {
+      WarningLog(<< "Intern table full, " << domain << " compared as a string");
+      mUninternedDomains.insert(Data(domain).lowercase());
+   }
 }
 
 EncodeStream& 
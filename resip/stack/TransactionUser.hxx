@@ -11,6 +11,8 @@
 
 namespace resip
 {
+
+class Uri;
 class SipMessage;
 
 /**
@@ -23,6 +25,8 @@ class TransactionUser
    public:
       void post(Message *);
       bool isMyDomain(const Data& domain) const;
+      /// As isMyDomain(uri.host()), using the Uri's interned host if it has one
+      bool isMyDomain(const Uri& uri) const;
       void addDomain(const Data& domain);
 
       virtual const Data& name() const=0;
@@ -62,8 +66,11 @@ class TransactionUser
 
    private:
       MessageFilterRuleList mRuleList;
-      typedef std::set<Data> DomainList;
+      // domains are interned (see DataIntern), so lookups compare pointers
+      typedef std::set<const Data*> DomainList;
       DomainList mDomainList;
+      // lowercased domains that did not fit in the DataIntern table
+      std::set<Data> mUninternedDomains;
       bool mRegisteredForTransactionTermination;
       bool mRegisteredForConnectionTermination;
       friend class TuSelector;      
@@ -16,6 +16,7 @@
 #include "resip/stack/ConnectionTerminated.hxx"
 #include "resip/stack/Transport.hxx"
 #include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipTrace.hxx"
 #include "resip/stack/TransportFailure.hxx"
 #include "resip/stack/Helper.hxx"
 #include "rutil/WinLeakCheck.hxx"
@@ -211,6 +212,10 @@ Transport::send( const Tuple& dest, const Data& d, const Data& tid, const Data &
 {
    assert(dest.getPort() != -1);
    DebugLog (<< "Adding message to tx buffer to: " << dest); // << " " << d.escaped());
+   if (SipTrace::isActive())
+   {
+      SipTrace::sent(mTuple, dest, d.data(), d.size());
+   }
    transmit(dest, d, tid, sigcompId); 
 }
 
@@ -262,6 +267,10 @@ Transport::makeFailedResponse(const SipMessage& msg,
     }
   }
 
+  if (SipTrace::isActive())
+  {
+    SipTrace::sent(mTuple, dest, encoded.data(), encoded.size());
+  }
   transmit(dest, encoded, Data::Empty, remoteSigcompId);
 }
 
@@ -963,7 +963,8 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target)
 }
 
 void
-TransportSelector::retransmit(SipMessage* msg, Tuple& target)
+TransportSelector::retransmit(const Data& encoded, Tuple& target,
+                              const Data& tid, const Data& sigcompId)
 {
    assert(target.transport);
 
@@ -990,10 +991,10 @@ TransportSelector::retransmit(SipMessage* msg, Tuple& target)
    // data to be transmitted, sendto will block unless the socket has been
    // placed in a nonblocking mode.
 
-   if(!msg->getEncoded().empty())
+   if(!encoded.empty())
    {
       //DebugLog(<<"!ah! retransmit to " << target);
-      target.transport->send(target, msg->getEncoded(), msg->getTransactionId(), msg->getCompartmentId());
+      target.transport->send(target, encoded, tid, sigcompId);
    }
 }
 
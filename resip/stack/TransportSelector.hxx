@@ -82,8 +82,9 @@ class TransportSelector
 	  */
       void transmit( SipMessage* msg, Tuple& target );
       
-      /// Resend to the same transport as last time
-      void retransmit(SipMessage* msg, Tuple& target );
+      /// Resend the bytes a previous transmit() encoded, to the same transport
+      void retransmit(const Data& encoded, Tuple& target, const Data& tid,
+                      const Data& sigcompId);
       
       unsigned int sumTransportFifoSizes() const;
 
@@ -7,6 +7,7 @@
 #include "resip/stack/Helper.hxx"
 #include "resip/stack/SendData.hxx"
 #include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipTrace.hxx"
 #include "resip/stack/UdpTransport.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/DnsUtil.hxx"
@@ -186,6 +187,11 @@ UdpTransport::process(FdSet& fdset)
          return;
       }
 
+      if (SipTrace::isActive())
+      {
+         SipTrace::received(tuple, mTuple, buffer, len);
+      }
+
       //handle incoming CRLFCRLF keep-alive packets
       if (len == 4 &&
           strncmp(buffer, Symbols::CRLFCRLF, len) == 0)
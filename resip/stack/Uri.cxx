@@ -11,6 +11,7 @@
 #include "resip/stack/Symbols.hxx"
 #include "resip/stack/UnknownParameter.hxx"
 #include "resip/stack/Uri.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/DataStream.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Logger.hxx"
@@ -30,12 +31,14 @@ Data Uri::mUriNonEncodingUserChars = Data("abcdefghijklmnopqrstuvwxyzABCDEFGHIJK
 Data Uri::mUriNonEncodingPasswordChars = Data("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_.!~*\\()&=+$");
 Uri::EncodingTable Uri::mUriEncodingUserTable;
 Uri::EncodingTable Uri::mUriEncodingPasswordTable;
+bool Uri::mInternHosts = false;
 
 Uri::Uri() 
    : ParserCategory(),
      mScheme(Data::Share, Symbols::DefaultSipScheme),
      mPort(0),
      mOldPort(0),
+     mHostIntern(0),
      mEmbeddedHeaders(0)
 {
 }
@@ -46,6 +49,7 @@ Uri::Uri(const Data& data)
      mScheme(Symbols::DefaultSipScheme),
      mPort(0),
      mOldPort(0),
+     mHostIntern(0),
      mEmbeddedHeaders(0)
 {
    // must copy because parse creates overlays
@@ -64,6 +68,7 @@ Uri::Uri(const Uri& rhs)
      mPort(rhs.mPort),
      mPassword(rhs.mPassword),
      mOldPort(0),
+     mHostIntern(rhs.mHostIntern),
      mEmbeddedHeadersText(rhs.mEmbeddedHeadersText),
      mEmbeddedHeaders(rhs.mEmbeddedHeaders ? new SipMessage(*rhs.mEmbeddedHeaders) : 0)
 {}
@@ -296,6 +301,7 @@ Uri::operator=(const Uri& rhs)
       ParserCategory::operator=(rhs);
       mScheme = rhs.mScheme;
       mHost = rhs.mHost;
+      mHostIntern = rhs.mHostIntern;
       mUser = rhs.mUser;
       mUserParameters = rhs.mUserParameters;
       mPort = rhs.mPort;
@@ -335,7 +341,11 @@ Uri::operator==(const Uri& other) const
    other.checkParsed();
 
    // compare hosts
-   if (DnsUtil::isIpV6Address(mHost) &&
+   if (mHostIntern && mHostIntern == other.mHostIntern)
+   {
+      // same interned host
+   }
+   else if (DnsUtil::isIpV6Address(mHost) &&
        DnsUtil::isIpV6Address(other.mHost))
    {
 
@@ -376,14 +386,14 @@ Uri::operator==(const Uri& other) const
    {
       for (ParameterList::iterator it = mParameters.begin(); it != mParameters.end(); ++it)
       {
-         Parameter* otherParam = other.getParameterByEnum((*it)->getType());
+         Parameter* otherParam = other.getParameterByEnum(it->getType());
 
-         switch ((*it)->getType())
+         switch (it->getType())
          {
             case ParameterTypes::user:
             {
                if (!(otherParam &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(otherParam)->value())))
                {
                   return false;
@@ -393,7 +403,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::ttl:
             {
                if (!(otherParam &&
-                     (dynamic_cast<UInt32Parameter*>(*it)->value() ==
+                     (dynamic_cast<UInt32Parameter*>(getParameter(*it))->value() ==
                       dynamic_cast<UInt32Parameter*>(otherParam)->value())))
                {
                   return false;
@@ -407,13 +417,13 @@ Uri::operator==(const Uri& other) const
                
                if (otherParam)
                {
-                  DataParameter* dp1 = dynamic_cast<DataParameter*>(*it);
+                  DataParameter* dp1 = dynamic_cast<DataParameter*>(getParameter(*it));
                   DataParameter* dp2 = dynamic_cast<DataParameter*>(otherParam);
                   assert(dp1);
                   assert(dp2);
                }
                if (!(otherParam &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(otherParam)->value())))
                {
                   return false;
@@ -423,7 +433,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::maddr:
             {               
                if (!(otherParam &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(otherParam)->value())))
                {
                   return false;
@@ -433,7 +443,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::transport:
             {
                if (!(otherParam &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(otherParam)->value())))
                {
                   return false;
@@ -453,13 +463,13 @@ Uri::operator==(const Uri& other) const
       // now check the other way, sigh
       for (ParameterList::iterator it = other.mParameters.begin(); it != other.mParameters.end(); ++it)
       {
-         Parameter* param = getParameterByEnum((*it)->getType());
-         switch ((*it)->getType())
+         Parameter* param = getParameterByEnum(it->getType());
+         switch (it->getType())
          {
             case ParameterTypes::user:
             {
                if (!(param &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(other.getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(param)->value())))
                {
                   return false;
@@ -469,7 +479,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::ttl:
             {
                if (!(param &&
-                     (dynamic_cast<UInt32Parameter*>(*it)->value() == 
+                     (dynamic_cast<UInt32Parameter*>(other.getParameter(*it))->value() == 
                       dynamic_cast<UInt32Parameter*>(param)->value())))
                {
                   return false;
@@ -481,7 +491,7 @@ Uri::operator==(const Uri& other) const
                // this should possilby be case sensitive, but is allowed to be
                // case insensitive for robustness.  
                if (!(param &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(other.getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(param)->value())))
                {
                   return false;
@@ -491,7 +501,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::maddr:
             {               
                if (!(param &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(other.getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(param)->value())))
                {
                   return false;
@@ -501,7 +511,7 @@ Uri::operator==(const Uri& other) const
             case ParameterTypes::transport:
             {
                if (!(param &&
-                     isEqualNoCase(dynamic_cast<DataParameter*>(*it)->value(),
+                     isEqualNoCase(dynamic_cast<DataParameter*>(other.getParameter(*it))->value(),
                                    dynamic_cast<DataParameter*>(param)->value())))
                {
                   return false;
@@ -537,12 +547,12 @@ Uri::operator==(const Uri& other) const
    for (ParameterList::iterator i = mUnknownParameters.begin();
         i != mUnknownParameters.end(); ++i)
    {
-      unA.insert(*i);
+      unA.insert(getParameter(*i));
    }
    for (ParameterList::iterator i = other.mUnknownParameters.begin();
         i != other.mUnknownParameters.end(); ++i)
    {
-      unB.insert(*i);
+      unB.insert(other.getParameter(*i));
    }
 
    ParameterSet::iterator a = unA.begin();
@@ -550,14 +560,26 @@ Uri::operator==(const Uri& other) const
 #else
    // .dlb. more efficient to copy to vector for sorting?
    // Uri comparison is expensive; consider caching? ugh
-   ParameterList unA = mUnknownParameters;
-   ParameterList unB = other.mUnknownParameters;
+   std::vector<Parameter*> unA;
+   std::vector<Parameter*> unB;
+   unA.reserve(mUnknownParameters.size());
+   unB.reserve(other.mUnknownParameters.size());
+   for (ParameterList::iterator i = mUnknownParameters.begin();
+        i != mUnknownParameters.end(); ++i)
+   {
+      unA.push_back(getParameter(*i));
+   }
+   for (ParameterList::iterator i = other.mUnknownParameters.begin();
+        i != other.mUnknownParameters.end(); ++i)
+   {
+      unB.push_back(other.getParameter(*i));
+   }
 
    sort(unA.begin(), unA.end(), orderUnknown);
    sort(unB.begin(), unB.end(), orderUnknown);
  
-   ParameterList::iterator a = unA.begin();
-   ParameterList::iterator b = unB.begin();
+   std::vector<Parameter*>::iterator a = unA.begin();
+   std::vector<Parameter*>::iterator b = unB.begin();
 #endif
 
    while(a != unA.end() && b != unB.end())
@@ -656,6 +678,23 @@ Uri::getAorNoPort() const
    return aor;
 }
 
+const Data*
+Uri::internedHost() const
+{
+   checkParsed();
+   if (!mHostIntern)
+   {
+      mHostIntern = DataIntern::find(mHost);
+   }
+   return mHostIntern;
+}
+
+void
+Uri::setInternHosts(bool intern)
+{
+   mInternHosts = intern;
+}
+
 const Data&
 Uri::getAor() const
 {
@@ -815,6 +854,8 @@ Uri::parse(ParseBuffer& pb)
       pb.data(mHost, start);
    }
 
+   mHostIntern = mInternHosts ? DataIntern::tryIntern(mHost) : 0;
+
    pb.skipToOneOf(ParseBuffer::Whitespace, ":;?>");
    if (!pb.eof() && *pb.position() == ':')
    {
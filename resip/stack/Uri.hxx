@@ -28,15 +28,26 @@ class Uri : public ParserCategory
       //static Uri fromTel(const Uri&, const Data& host);  // deprecate...
       static Uri fromTel(const Uri&, const Uri& hostUri);
 
-      Data& host() {checkParsed(); return mHost;}
+      Data& host() {checkParsed(); mHostIntern = 0; return mHost;}
       const Data& host() const {checkParsed(); return mHost;}
       Data& user() {checkParsed(); return mUser;}
       const Data& user() const {checkParsed(); return mUser;}
       Data& userParameters() {checkParsed(); return mUserParameters;}
       const Data& userParameters() const {checkParsed(); return mUserParameters;}
-      Data& opaque() {checkParsed(); return mHost;}
+      Data& opaque() {checkParsed(); mHostIntern = 0; return mHost;}
       const Data& opaque() const {checkParsed(); return mHost;}
 
+      /** The host as interned in DataIntern (lowercased), or 0 if it is not
+          interned. Equal non-zero results mean the hosts are equal ignoring
+          case. Cached once found, until the host is modified. */
+      const Data* internedHost() const;
+
+      /** If true, parse() adds every host it sees to DataIntern (with
+          DataIntern::tryIntern); otherwise internedHost() only finds hosts
+          that were interned elsewhere, such as configured domains.
+          Defaults to false. */
+      static void setInternHosts(bool intern);
+
       const Data& getAor() const;
       const Data getAorNoPort() const;
 
@@ -102,6 +113,11 @@ class Uri : public ParserCategory
       // cache for IPV6 host comparison
       mutable Data mCanonicalHost;
 
+      // cache for internedHost(); 0 until found
+      mutable const Data* mHostIntern;
+
+      static bool mInternHosts;
+
       static bool mEncodingReady;
       // characters listed in these strings should not be URI encoded
       static Data mUriNonEncodingUserChars;
@@ -44,6 +44,10 @@
 #include "resip/stack/DtlsMessage.hxx"
 #endif
 
+#ifndef RESIP_SIPTRACE_HXX
+#include "resip/stack/SipTrace.hxx"
+#endif
+
 #ifndef RESIP_DTLSTRANSPORT_HXX
 #include "resip/stack/ssl/DtlsTransport.hxx"
 #endif
@@ -273,6 +277,11 @@ DtlsTransport::_read( FdSet& fdset )
    if ( len <= 0 )
        return ;
 
+   if ( SipTrace::isActive() )
+   {
+      SipTrace::received( tuple, mTuple, (const char*)pt, len ) ;
+   }
+
    if ( SSL_in_init( ssl ) )
       mTimer.add( ssl, DtlsReceiveTimeout ) ;
 
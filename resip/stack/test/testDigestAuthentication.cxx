@@ -18,10 +18,13 @@
 #include "resip/stack/ParserCategories.hxx"
 #include "resip/stack/Uri.hxx"
 #include "resip/stack/Helper.hxx"
+#include "resip/stack/DigestVerifier.hxx"
+#include "resip/stack/StatelessNonceHelper.hxx"
 #include "resip/stack/test/TestSupport.hxx"
 #include "rutil/Timer.hxx"
 #include "rutil/DataStream.hxx"
 #include "rutil/MD5Stream.hxx"
+#include "rutil/Sha256.hxx"
 #include "digcalc.hxx"
 
 using namespace std;
@@ -506,6 +509,156 @@ Calculated digest == 575a9ecd3a6f1989a978748217b24a25
       assert(res == Helper::Expired);
       
    }
+   {
+      struct { const char* in; unsigned int repeat; const char* out; } vectors[] =
+      {
+         { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+         { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+         { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, 
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+         { "a", 1000, "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3" }
+      };
+      for (unsigned int v = 0; v < sizeof(vectors)/sizeof(vectors[0]); ++v)
+      {
+         Sha256Context ctx;
+         Sha256Init(&ctx);
+         for (unsigned int r = 0; r < vectors[v].repeat; ++r)
+         {
+            Sha256Update(&ctx, (const unsigned char*)vectors[v].in, (unsigned)strlen(vectors[v].in));
+         }
+         unsigned char digest[32];
+         Sha256Final(digest, &ctx);
+         assert(Data(digest, 32).hex() == vectors[v].out);
+      }
+      cerr << "Sha256 passed" << endl;
+   }
+
+   {
+      // RFC 7616 3.9.1
+      Data username("Mufasa");
+      Data realm("http-auth@example.org");
+      Data nonce("7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v");
+      Data cnonce("f2/wE4q74E6zIJEtWaHKaf5wv/H5QzzpXusqGemxURZJ");
+      char hA1[DigestVerifier::MaxHexSize];
+      char response[DigestVerifier::MaxHexSize];
+
+      DigestVerifier::computeHA1(DigestVerifier::MD5, username, realm, "Circle of Life", hA1);
+      assert(Data(hA1) == "3d78807defe7de2157e2b0b6573a855f");
+      DigestVerifier::computeResponse(DigestVerifier::MD5, hA1, "GET", "/dir/index.html", nonce,
+                                      Symbols::auth, cnonce, "00000001", 0, response);
+      assert(Data(response) == "8ca523f5e9506fed4657c9700eebdbec");
+      assert(Data(response) == Helper::makeResponseMD5(username, "Circle of Life", realm, "GET", 
+                                                       "/dir/index.html", nonce, Symbols::auth, 
+                                                       cnonce, "00000001"));
+
+      DigestVerifier::computeHA1(DigestVerifier::SHA256, username, realm, "Circle of Life", hA1);
+      assert(Data(hA1) == "7987c64c30e25f1b74be53f966b49b90f2808aa92faf9a00262392d7b4794232");
+      DigestVerifier::computeResponse(DigestVerifier::SHA256, hA1, "GET", "/dir/index.html", nonce,
+                                      Symbols::auth, cnonce, "00000001", 0, response);
+      assert(Data(response) == "753927fa0e85d155564e2e272a28d1802ca10daf4496794697cf8db5856cb6c1");
+      cerr << "DigestVerifier::computeResponse passed" << endl;
+   }
+
+   {
+      Data txt("REGISTER sip:atlanta.com SIP/2.0\r\n"
+               "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bKnashds7\r\n"
+               "To: Alice <sip:alice@atlanta.com>\r\n"
+               "From: Alice <sip:alice@atlanta.com>;tag=456248\r\n"
+               "Call-ID: 843817637684230@998sdasdh09\r\n"
+               "CSeq: 1826 REGISTER\r\n"
+               "Contact: <sip:alice@pc33.atlanta.com>\r\n"
+               "Content-Length: 0\r\n"
+               "\r\n");
+
+      Helper::setNonceHelper(new StatelessNonceHelper(16));
+      StatelessNonceHelper* nonceHelper = dynamic_cast<StatelessNonceHelper*>(Helper::getNonceHelper());
+      assert(nonceHelper);
+
+      Data realm("atlanta.com");
+      Data password("secret");
+      char hA1[DigestVerifier::MaxHexSize];
+      DigestVerifier::computeHA1(DigestVerifier::MD5, "alice", realm, password, hA1);
+
+      auto_ptr<SipMessage> request(TestSupport::makeMessage(txt.c_str()));
+      auto_ptr<SipMessage> challenge(Helper::makeWWWChallenge(*request, realm, true));
+      const Data& nonce = challenge->header(h_WWWAuthenticates).front().param(p_nonce);
+      assert(nonceHelper->isValidNonce(nonce, *request));
+      assert(nonceHelper->parseNonce(nonce).getCreationTime() != 0);
+
+      // tampered nonce
+      Data forged(nonce);
+      forged[0] = forged[0] == '1' ? '2' : '1';
+      assert(!nonceHelper->isValidNonce(forged, *request));
+
+      unsigned int nc = 0;
+      Helper::addAuthorization(*request, *challenge, "alice", password, "0a4f113b", nc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Authenticated);
+      // Helper agrees, and does not track nonce counts
+      assert(Helper::authenticateRequest(*request, realm, password, 30) == Helper::Authenticated);
+      // same nc again is a replay
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Expired);
+      // a wrong password does not use up the nonce count, not even a high one
+      request->remove(h_Authorizations);
+      unsigned int highNc = 0xfffffff0;
+      Helper::addAuthorization(*request, *challenge, "alice", "wrong", "0a4f113b", highNc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Failed);
+      request->remove(h_Authorizations);
+      Helper::addAuthorization(*request, *challenge, "alice", "wrong", "0a4f113b", nc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Failed);
+      --nc;
+      request->remove(h_Authorizations);
+      Helper::addAuthorization(*request, *challenge, "alice", password, "0a4f113b", nc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Authenticated);
+
+      // issuing challenges does not push a nonce out of the window
+      for (int i = 0; i < 100; ++i)
+      {
+         Helper::makeNonce(*request, Data(Timer::getTimeSecs()));
+      }
+      request->remove(h_Authorizations);
+      Helper::addAuthorization(*request, *challenge, "alice", password, "0a4f113b", nc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Authenticated);
+
+      // once 16 other nonces have authenticated requests this one is stale
+      for (int i = 0; i < 16; ++i)
+      {
+         auto_ptr<SipMessage> other(TestSupport::makeMessage(txt.c_str()));
+         auto_ptr<SipMessage> otherChallenge(Helper::makeWWWChallenge(*other, realm, true));
+         unsigned int otherNc = 0;
+         Helper::addAuthorization(*other, *otherChallenge, "alice", password, "0a4f113b", otherNc);
+         assert(DigestVerifier::authenticateRequest(*other, realm, hA1, 30, false) == Helper::Authenticated);
+      }
+      request->remove(h_Authorizations);
+      Helper::addAuthorization(*request, *challenge, "alice", password, "0a4f113b", nc);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Expired);
+
+      // SHA-256
+      Auth sha256(challenge->header(h_WWWAuthenticates).front());
+      sha256.param(p_nonce) = Helper::makeNonce(*request, Data(Timer::getTimeSecs()));
+      sha256.param(p_algorithm) = "SHA-256";
+      DigestVerifier::computeHA1(DigestVerifier::SHA256, "alice", realm, password, hA1);
+      Auth credentials;
+      credentials.scheme() = Symbols::Digest;
+      credentials.param(p_username) = "alice";
+      credentials.param(p_realm) = realm;
+      credentials.param(p_nonce) = sha256.param(p_nonce);
+      credentials.param(p_uri) = "sip:atlanta.com";
+      credentials.param(p_algorithm) = "SHA-256";
+      credentials.param(p_qop) = Symbols::auth;
+      credentials.param(p_cnonce) = "0a4f113b";
+      credentials.param(p_nc) = "00000001";
+      char response[DigestVerifier::MaxHexSize];
+      DigestVerifier::computeResponse(DigestVerifier::SHA256, hA1, "REGISTER", "sip:atlanta.com",
+                                      sha256.param(p_nonce), Symbols::auth, "0a4f113b", "00000001",
+                                      0, response);
+      credentials.param(p_response) = response;
+      request->remove(h_Authorizations);
+      request->header(h_Authorizations).push_back(credentials);
+      assert(DigestVerifier::authenticateRequest(*request, realm, hA1, 30, false) == Helper::Authenticated);
+
+      cerr << "StatelessNonceHelper passed" << endl;
+   }
+
    cerr << "ALL OK" << endl;
    return 0;
 }
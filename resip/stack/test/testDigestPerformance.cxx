@@ -0,0 +1,240 @@
+// Compares server side digest verification through Helper against
+// DigestVerifier with a precomputed H(A1), for a set of pre-parsed REGISTERs
+// carrying qop=auth credentials.  Reports verifications per second and heap
+// allocations per verification.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "resip/stack/DigestVerifier.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/StatelessNonceHelper.hxx"
+#include "resip/stack/test/TestSupport.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+namespace
+{
+size_t allocations = 0;
+}
+
+void* operator new(size_t bytes)
+{
+   ++allocations;
+   void* p = malloc(bytes ? bytes : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void* operator new[](size_t bytes)
+{
+   return operator new(bytes);
+}
+
+void operator delete[](void* p) throw()
+{
+   operator delete(p);
+}
+
+static const Data realm("atlanta.com");
+static const Data password("secret");
+
+static SipMessage*
+makeRequest(int i, DigestVerifier::Algorithm algorithm)
+{
+   Data user("user");
+   user += Data(i);
+   Data txt("REGISTER sip:atlanta.com SIP/2.0\r\n"
+            "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bKnashds7\r\n"
+            "To: <sip:" + user + "@atlanta.com>\r\n"
+            "From: <sip:" + user + "@atlanta.com>;tag=456248\r\n"
+            "Call-ID: 843817637684230@998sdasdh09\r\n"
+            "CSeq: 1826 REGISTER\r\n"
+            "Contact: <sip:" + user + "@pc33.atlanta.com>\r\n"
+            "Max-Forwards: 70\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+   SipMessage* request = TestSupport::makeMessage(txt);
+
+   char hA1[DigestVerifier::MaxHexSize];
+   DigestVerifier::computeHA1(algorithm, user, realm, password, hA1);
+
+   Auth auth;
+   auth.scheme() = Symbols::Digest;
+   auth.param(p_username) = user;
+   auth.param(p_realm) = realm;
+   auth.param(p_nonce) = Helper::makeNonce(*request, Data(Timer::getTimeSecs()));
+   auth.param(p_uri) = "sip:atlanta.com";
+   auth.param(p_algorithm) = DigestVerifier::algorithmName(algorithm);
+   auth.param(p_qop) = Symbols::auth;
+   auth.param(p_cnonce) = "0a4f113b";
+   auth.param(p_nc) = "00000001";
+   char response[DigestVerifier::MaxHexSize];
+   DigestVerifier::computeResponse(algorithm, hA1, "REGISTER", auth.param(p_uri), auth.param(p_nonce),
+                                   Symbols::auth, auth.param(p_cnonce), auth.param(p_nc), 0, response);
+   auth.param(p_response) = response;
+   request->header(h_Authorizations).push_back(auth);
+   return request;
+}
+
+struct Run
+{
+   const char* name;
+   size_t allocations;
+   UInt64 ms;
+};
+
+static void
+report(const Run& run, int runs)
+{
+   cout << run.name << ": " << runs * 1000.0 / (run.ms ? run.ms : 1) << " verifications/s, "
+        << (double)run.allocations / runs << " allocations each" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, argc > 2 ? Log::toLevel(argv[2]) : Log::Warning, argv[0]);
+   int runs = argc > 1 ? atoi(argv[1]) : 200000;
+
+   // nonce counts are replayed on every pass, so no replay window here
+   Helper::setNonceHelper(new StatelessNonceHelper(0));
+
+   const int numRequests = 64;
+   vector<SipMessage*> md5Requests;
+   vector<Data> md5HA1s;
+   vector<SipMessage*> sha256Requests;
+   vector<Data> sha256HA1s;
+   for (int i = 0; i < numRequests; ++i)
+   {
+      char hA1[DigestVerifier::MaxHexSize];
+      md5Requests.push_back(makeRequest(i, DigestVerifier::MD5));
+      DigestVerifier::computeHA1(DigestVerifier::MD5, "user" + Data(i), realm, password, hA1);
+      md5HA1s.push_back(hA1);
+      sha256Requests.push_back(makeRequest(i, DigestVerifier::SHA256));
+      DigestVerifier::computeHA1(DigestVerifier::SHA256, "user" + Data(i), realm, password, hA1);
+      sha256HA1s.push_back(hA1);
+
+      // check agreement, which also parses everything up front
+      assert(Helper::authenticateRequest(*md5Requests[i], realm, password, 300) == Helper::Authenticated);
+      assert(Helper::advancedAuthenticateRequest(*md5Requests[i], realm, md5HA1s[i], 300, false).first == 
+             Helper::Authenticated);
+      assert(DigestVerifier::authenticateRequest(*md5Requests[i], realm, md5HA1s[i], 300, false) == 
+             Helper::Authenticated);
+      assert(DigestVerifier::authenticateRequest(*md5Requests[i], realm, sha256HA1s[i], 300, false) == 
+             Helper::Failed);
+      assert(DigestVerifier::authenticateRequest(*sha256Requests[i], realm, sha256HA1s[i], 300, false) == 
+             Helper::Authenticated);
+   }
+
+   Run results[4] = { { "Helper::authenticateRequest", 0, 0 },
+                      { "Helper::advancedAuthenticateRequest", 0, 0 },
+                      { "DigestVerifier MD5", 0, 0 },
+                      { "DigestVerifier SHA-256", 0, 0 } };
+   for (int r = 0; r < 4; ++r)
+   {
+      size_t startAllocations = allocations;
+      UInt64 start = Timer::getTimeMs();
+      for (int i = 0; i < runs; ++i)
+      {
+         int n = i % numRequests;
+         Helper::AuthResult result = Helper::Failed;
+         switch (r)
+         {
+            case 0:
+               result = Helper::authenticateRequest(*md5Requests[n], realm, password, 300);
+               break;
+            case 1:
+               result = Helper::advancedAuthenticateRequest(*md5Requests[n], realm, md5HA1s[n], 300, false).first;
+               break;
+            case 2:
+               result = DigestVerifier::authenticateRequest(*md5Requests[n], realm, md5HA1s[n], 300, false);
+               break;
+            case 3:
+               result = DigestVerifier::authenticateRequest(*sha256Requests[n], realm, sha256HA1s[n], 300, false);
+               break;
+         }
+         assert(result == Helper::Authenticated);
+      }
+      results[r].ms = Timer::getTimeMs() - start;
+      results[r].allocations = allocations - startAllocations;
+   }
+
+   for (int r = 0; r < 4; ++r)
+   {
+      report(results[r], runs);
+   }
+
+   for (int i = 0; i < numRequests; ++i)
+   {
+      delete md5Requests[i];
+      delete sha256Requests[i];
+   }
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
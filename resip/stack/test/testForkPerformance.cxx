@@ -0,0 +1,271 @@
+// Measures what it costs a proxy to fork one INVITE to several targets: each
+// branch copies the request, rewrites the Request-URI, Max-Forwards and top
+// Via, and encodes it for the wire.  Copies share every header list and the
+// body that nobody has looked at, so this is compared against the same
+// request with everything parsed, where each copy has to duplicate the lot.
+// Reports branches per second and heap allocations per branch.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "resip/stack/ExtensionHeader.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SdpContents.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/test/TestSupport.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+namespace
+{
+size_t allocations = 0;
+}
+
+void* operator new(size_t bytes)
+{
+   ++allocations;
+   void* p = malloc(bytes ? bytes : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void* operator new[](size_t bytes)
+{
+   return operator new(bytes);
+}
+
+void operator delete[](void* p) throw()
+{
+   operator delete(p);
+}
+
+static const Data invite(
+   "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+   "Via: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf9;rport\r\n"
+   "Max-Forwards: 70\r\n"
+   "Route: <sip:proxy.biloxi.example.com;lr>\r\n"
+   "From: Alice <sip:alice@atlanta.example.com>;tag=9fxced76sl\r\n"
+   "To: Bob <sip:bob@biloxi.example.com>\r\n"
+   "Call-ID: 3848276298220188511@atlanta.example.com\r\n"
+   "CSeq: 1 INVITE\r\n"
+   "Contact: <sip:alice@client.atlanta.example.com;transport=tcp>;+sip.instance=\"<urn:uuid:f81d4fae-7dec-11d0-a765-00a0c91e6bf6>\"\r\n"
+   "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, UPDATE\r\n"
+   "Supported: replaces, timer, 100rel\r\n"
+   "Session-Expires: 1800;refresher=uac\r\n"
+   "P-Asserted-Identity: \"Alice\" <sip:alice@atlanta.example.com>\r\n"
+   "User-Agent: resip/1.0\r\n"
+   "X-Billing-Id: 4422-991-ab\r\n"
+   "Content-Type: application/sdp\r\n"
+   "Content-Length: 151\r\n"
+   "\r\n"
+   "v=0\r\n"
+   "o=alice 2890844526 2890844526 IN IP4 client.atlanta.example.com\r\n"
+   "s=-\r\n"
+   "c=IN IP4 192.0.2.101\r\n"
+   "t=0 0\r\n"
+   "m=audio 49172 RTP/AVP 0\r\n"
+   "a=rtpmap:0 PCMU/8000\r\n");
+
+// what the proxy and transaction layer look at in an incoming request
+static void
+receive(SipMessage& request)
+{
+   assert(request.header(h_RequestLine).method() == INVITE);
+   assert(!request.header(h_Vias).front().param(p_branch).getTransactionId().empty());
+   assert(request.header(h_CSeq).sequence() == 1);
+   assert(!request.header(h_CallId).value().empty());
+   assert(request.header(h_From).exists(p_tag));
+   assert(!request.header(h_To).exists(p_tag));
+   assert(request.header(h_MaxForwards).value() == 70);
+   request.remove(h_Routes);
+}
+
+static void
+fork(const SipMessage& request, const Uri& target, Data& wire)
+{
+   SipMessage branch(request);
+   branch.header(h_RequestLine).uri() = target;
+   --branch.header(h_MaxForwards).value();
+   Via via;
+   via.sentHost() = "proxy.biloxi.example.com";
+   via.transport() = "UDP";
+   via.param(p_branch).reset(Helper::computeUniqueBranch());
+   branch.header(h_Vias).push_front(via);
+
+   wire.clear();
+   DataStream strm(wire);
+   branch.encode(strm);
+}
+
+struct Run
+{
+   const char* name;
+   size_t allocations;
+   UInt64 ms;
+};
+
+static void
+report(const Run& run, int branches)
+{
+   cout << run.name << ": " << branches * 1000.0 / (run.ms ? run.ms : 1) << " branches/s, "
+        << (double)run.allocations / branches << " allocations each" << endl;
+}
+
+static void
+testSharing()
+{
+   auto_ptr<SipMessage> request(TestSupport::makeMessage(invite));
+   receive(*request);
+   SipMessage copy(*request);
+
+   // untouched headers and the body are shared; looked-at ones are not
+   assert(copy.getRawHeader(Headers::UserAgent) == request->getRawHeader(Headers::UserAgent));
+   assert(copy.getRawHeader(Headers::CSeq) != request->getRawHeader(Headers::CSeq));
+
+   copy.header(h_UserAgent).value() = "changed";
+   assert(copy.getRawHeader(Headers::UserAgent) != request->getRawHeader(Headers::UserAgent));
+   assert(request->header(h_UserAgent).value() == "resip/1.0");
+
+   copy.header(ExtensionHeader("X-Billing-Id")).front().value() = "0";
+   assert(request->header(ExtensionHeader("X-Billing-Id")).front().value() == "4422-991-ab");
+
+   SdpContents* sdp = dynamic_cast<SdpContents*>(copy.getContents());
+   assert(sdp);
+   sdp->session().name() = "changed";
+   Data original(Data::from(*request));
+   assert(original.find("s=-") != Data::npos);
+   assert(Data::from(copy).find("s=changed") != Data::npos);
+
+   // copies keep what they share alive after the original has gone
+   SipMessage second(*request);
+   SipMessage third(second);
+   request.reset();
+   assert(Data::from(second) == original);
+   assert(Data::from(third) == original);
+   second.header(h_Supporteds).push_back(Token("path"));
+   assert(Data::from(third) == original);
+
+   // an assigned-over message drops its share
+   third = copy;
+   assert(Data::from(third) == Data::from(copy));
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, argc > 2 ? Log::toLevel(argv[2]) : Log::Warning, argv[0]);
+   int requests = argc > 1 ? atoi(argv[1]) : 20000;
+   const int targets = 10;
+
+   testSharing();
+
+   vector<Uri> contacts;
+   for (int t = 0; t < targets; ++t)
+   {
+      contacts.push_back(Uri("sip:bob@192.0.2." + Data(t + 10) + ":5060;transport=udp"));
+   }
+
+   Run results[2] = { { "copy on write", 0, 0 },
+                      { "fully parsed (deep copies)", 0, 0 } };
+   Data wire;
+   wire.reserve(2048);
+   for (int r = 0; r < 2; ++r)
+   {
+      UInt64 ms = 0;
+      for (int i = 0; i < requests; ++i)
+      {
+         auto_ptr<SipMessage> request(TestSupport::makeMessage(invite));
+         receive(*request);
+         if (r == 1)
+         {
+            request->parseAllHeaders();
+         }
+
+         size_t startAllocations = allocations;
+         UInt64 start = Timer::getTimeMicroSec();
+         for (int t = 0; t < targets; ++t)
+         {
+            fork(*request, contacts[t], wire);
+         }
+         ms += Timer::getTimeMicroSec() - start;
+         results[r].allocations += allocations - startAllocations;
+      }
+      results[r].ms = ms / 1000;
+   }
+
+   cout << "forking an INVITE with an SDP body to " << targets << " targets" << endl;
+   for (int r = 0; r < 2; ++r)
+   {
+      report(results[r], requests * targets);
+   }
+   assert(results[0].allocations < results[1].allocations);
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -83,7 +83,53 @@ main(int arc, char** argv)
       
       assert(test.uri().param(p_transport) == copy.uri().param(p_transport));
    }
-   
+
+   {
+      TR _tr("Test parameters kept as text survive copies");
+
+      NameAddr* test = new NameAddr("<sip:bob@example.com;lr;maddr=10.0.0.1;foo=bar>"
+                                    ";tag=1928301774;+sip.instance=\"<urn:uuid:1>\""
+                                    ";expires=3600;text;baz;quux=\"a;b\"");
+      assert(test->exists(p_tag));
+      assert(test->uri().exists(p_lr));
+      NameAddr copy(*test);
+      NameAddr assigned;
+      assigned = copy;
+      Data original(Data::from(*test));
+      delete test;
+
+      assert(Data::from(copy) == original);
+      assert(Data::from(assigned) == original);
+      assert(copy.param(p_tag) == "1928301774");
+      assert(copy.param(p_Instance) == "<urn:uuid:1>");
+      assert(copy.param(p_expires) == 3600);
+      assert(copy.exists(p_text));
+      assert(copy.param(p_text).empty());
+      assert(copy.uri().param(p_maddr) == "10.0.0.1");
+      assert(copy.uri().exists(UnknownParameterType("foo")));
+      assert(copy.uri().param(UnknownParameterType("foo")) == "bar");
+      assert(copy.exists(UnknownParameterType("baz")));
+      assert(copy.param(UnknownParameterType("quux")) == "a;b");
+      assert(Data::from(copy) == original);
+
+      copy.param(p_tag) = "5";
+      copy.remove(UnknownParameterType("baz"));
+      assert(Data::from(copy) == "<sip:bob@example.com;lr;maddr=10.0.0.1;foo=bar>"
+                                 ";tag=5;+sip.instance=\"<urn:uuid:1>\""
+                                 ";expires=3600;text;quux=\"a;b\"");
+      assert(Data::from(assigned) == original);
+
+      // text that would not encode back the same way is still normalized
+      NameAddr loose("<sip:bob@example.com>;TAG = abc;+sip.instance=foo;Lr");
+      assert(Data::from(loose) == "<sip:bob@example.com>;tag=abc;+sip.instance=\"foo\";lr");
+      NameAddr looseCopy(loose);
+      assert(looseCopy.param(p_tag) == "abc");
+
+      Uri a("sip:bob@example.com;transport=tcp;foo=bar;lr");
+      Uri b("sip:bob@example.com;lr;foo=BAR;transport=TCP");
+      assert(a == b);
+   }
+
    {
       TR _tr("Test iterator erase in ParserContainer");
 
@@ -1,6 +1,7 @@
 #include "rutil/Logger.hxx"
 #include "rutil/DataStream.hxx"
 #include "resip/stack/SdpContents.hxx"
+#include "resip/stack/SdpView.hxx"
 #include "resip/stack/HeaderFieldValue.hxx"
 #include "rutil/ParseBuffer.hxx"
 
@@ -554,6 +555,152 @@ main(int argc, char* argv[])
        CritLog(<< "Received bad Dialogic fmtp line Ok");
     }
 
+   {
+      // SdpView reads the body as it is and rewrites single lines
+      Data txt("v=0\r\n"
+               "o=alice 2890844526 2890844526 IN IP4 192.0.2.101\r\n"
+               "s=-\r\n"
+               "c=IN IP4 192.0.2.101\r\n"
+               "t=0 0\r\n"
+               "a=group:BUNDLE 1\r\n"
+               "m=audio 49170 RTP/AVP 0 8 101\r\n"
+               "a=rtpmap:101 telephone-event/8000\r\n"
+               "a=sendrecv\r\n"
+               "m=video 51372/2 RTP/AVP 31\r\n"
+               "c=IN IP4 192.0.2.102\r\n"
+               "a=rtpmap:31 H261/90000\r\n"
+               "a=candidate:1 1 UDP 2130706431 192.0.2.102 51372 typ host\r\n"
+               "a=candidate:2 1 UDP 1694498815 198.51.100.7 51372 typ srflx\r\n");
+
+      HeaderFieldValue hfv(txt.data(), txt.size());
+      Mime type("application", "sdp");
+      SdpContents sdp(&hfv, type);
+      SdpView view(sdp);
+      assert(!sdp.isParsed());
+
+      assert(view.numMedia() == 2);
+      assert(view.originAddress() == "192.0.2.101");
+      assert(view.originAddressType() == "IP4");
+      assert(view.connectionAddress() == "192.0.2.101");
+      assert(view.connectionAddress().data() >= txt.data() &&
+             view.connectionAddress().data() < txt.data() + txt.size());
+      assert(!view.hasConnection(0));
+      assert(view.numConnections(0) == 0);
+      assert(view.connectionAddress(0) == "192.0.2.101");
+      assert(view.hasConnection(1));
+      assert(view.numConnections(1) == 1);
+      assert(view.numConnections() == 1);
+      assert(view.connectionAddress(1) == "192.0.2.102");
+      assert(view.mediaType(0) == "audio");
+      assert(view.port(0) == 49170);
+      assert(view.protocol(0) == "RTP/AVP");
+      assert(view.formats(0) == "0 8 101");
+      assert(view.mediaType(1) == "video");
+      assert(view.port(1) == 51372);
+      assert(view.exists("group"));
+      assert(!view.exists("sendrecv"));
+      assert(view.exists("sendrecv", 0));
+      assert(!view.exists("send", 0));
+      assert(view.attribute("rtpmap", 0) == "101 telephone-event/8000");
+      assert(view.attribute("sendrecv", 0).empty());
+
+      // an untouched view encodes to the original text
+      assert(Data::from(view) == txt);
+
+      assert(view.setOriginAddress("203.0.113.1"));
+      assert(view.setConnectionAddress("203.0.113.1"));
+      assert(!view.setConnectionAddress("203.0.113.1", 0));
+      assert(view.setConnectionAddress("2001:db8::1", 1, "IP6"));
+      assert(view.setPort(0, 30000));
+      assert(view.setPort(1, 30002));
+      assert(view.removeAttribute("candidate", 1) == 2);
+      assert(view.removeAttribute("candidate", 1) == 0);
+      view.addAttribute("rtcp", "30001", 0);
+      view.addAttribute("nortpproxy", "yes");
+
+      assert(view.port(0) == 30000);
+      assert(view.connectionAddress(1) == "2001:db8::1");
+      assert(view.connectionAddressType(1) == "IP6");
+      assert(view.attribute("rtcp", 0) == "30001");
+      assert(view.formats(0) == "0 8 101");
+
+      Data rewritten(Data::from(view));
+      assert(rewritten == "v=0\r\n"
+                          "o=alice 2890844526 2890844526 IN IP4 203.0.113.1\r\n"
+                          "s=-\r\n"
+                          "c=IN IP4 203.0.113.1\r\n"
+                          "t=0 0\r\n"
+                          "a=group:BUNDLE 1\r\n"
+                          "a=nortpproxy:yes\r\n"
+                          "m=audio 30000 RTP/AVP 0 8 101\r\n"
+                          "a=rtpmap:101 telephone-event/8000\r\n"
+                          "a=sendrecv\r\n"
+                          "a=rtcp:30001\r\n"
+                          "m=video 30002/2 RTP/AVP 31\r\n"
+                          "c=IN IP6 2001:db8::1\r\n"
+                          "a=rtpmap:31 H261/90000\r\n");
+
+      // and the full model agrees with it
+      HeaderFieldValue hfv2(rewritten.data(), rewritten.size());
+      SdpContents parsed(&hfv2, type);
+      assert(parsed.session().origin().getAddress() == "203.0.113.1");
+      assert(parsed.session().connection().getAddress() == "203.0.113.1");
+      assert(parsed.session().media().front().port() == 30000);
+      assert(parsed.session().media().back().port() == 30002);
+      assert(parsed.session().media().back().getMediumConnections().front().getAddressType() == SdpContents::IP6);
+
+      view.removeMedium(1);
+      assert(view.numMedia() == 1);
+      assert(Data::from(view).find("m=video") == Data::npos);
+      view.removeMedium(0);
+      assert(view.numMedia() == 0);
+      assert(view.exists("nortpproxy"));
+
+      // a parsed SdpContents is viewed through its encoding
+      SdpView fromParsed(parsed);
+      assert(fromParsed.numMedia() == 2);
+      assert(fromParsed.port(1) == 30002);
+   }
+
+   {
+      // bare LF line ends, a blank line and no final line end
+      Data txt("v=0\n"
+               "o=- 1 1 IN IP4 10.0.0.1\n"
+               "s=-\n"
+               "\n"
+               "c=IN IP4 10.0.0.1\n"
+               "t=0 0\n"
+               "m=audio 4000 RTP/AVP 0");
+      SdpView view(txt);
+      assert(view.numMedia() == 1);
+      assert(view.port(0) == 4000);
+      assert(view.formats(0) == "0");
+      assert(view.connectionAddress(0) == "10.0.0.1");
+      assert(Data::from(view) == "v=0\r\n"
+                                 "o=- 1 1 IN IP4 10.0.0.1\r\n"
+                                 "s=-\r\n"
+                                 "c=IN IP4 10.0.0.1\r\n"
+                                 "t=0 0\r\n"
+                                 "m=audio 4000 RTP/AVP 0\r\n");
+   }
+
+   {
+      // a medium with a c= line for each of its addresses
+      Data txt("v=0\r\n"
+               "o=- 1 1 IN IP4 10.0.0.1\r\n"
+               "s=-\r\n"
+               "t=0 0\r\n"
+               "m=audio 4000/2 RTP/AVP 0\r\n"
+               "c=IN IP4 224.2.1.1/127\r\n"
+               "c=IN IP4 224.2.1.2/127\r\n");
+      SdpView view(txt);
+      assert(!view.hasConnection());
+      assert(view.numConnections() == 0);
+      assert(view.numConnections(0) == 2);
+      assert(view.connectionAddress(0) == "224.2.1.1/127");
+      CritLog(<< "SdpView Ok");
+   }
+
    return 0;   
 }
 
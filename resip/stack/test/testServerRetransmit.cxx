@@ -0,0 +1,271 @@
+// Checks that a server transaction retransmits its final response byte for
+// byte, both when Timer G fires and when the request is retransmitted to it,
+// once the transaction has let go of the parsed response.
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Socket.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+#define CRLF "\r\n"
+
+static const int StackPort = 25190;
+static const int PeerPort = 25191;
+
+static const char* invite =
+"INVITE sip:B@127.0.0.1:25190 SIP/2.0" CRLF
+"Via: SIP/2.0/UDP 127.0.0.1:25191;branch=z9hG4bK-retrans-1" CRLF
+"Max-Forwards: 70" CRLF
+"From: A <sip:A@127.0.0.1>;tag=12345" CRLF
+"To: B <sip:B@127.0.0.1>" CRLF
+"Call-ID: retrans-1@127.0.0.1" CRLF
+"CSeq: 1 INVITE" CRLF
+"Contact: <sip:A@127.0.0.1:25191>" CRLF
+"Content-Length: 0" CRLF CRLF;
+
+static const char* ack =
+"ACK sip:B@127.0.0.1:25190 SIP/2.0" CRLF
+"Via: SIP/2.0/UDP 127.0.0.1:25191;branch=z9hG4bK-retrans-1" CRLF
+"Max-Forwards: 70" CRLF
+"From: A <sip:A@127.0.0.1>;tag=12345" CRLF
+"To: B <sip:B@127.0.0.1>;tag=%s" CRLF
+"Call-ID: retrans-1@127.0.0.1" CRLF
+"CSeq: 1 ACK" CRLF
+"Content-Length: 0" CRLF CRLF;
+
+static const char* options =
+"OPTIONS sip:B@127.0.0.1:25190 SIP/2.0" CRLF
+"Via: SIP/2.0/UDP 127.0.0.1:25191;branch=z9hG4bK-retrans-2" CRLF
+"Max-Forwards: 70" CRLF
+"From: A <sip:A@127.0.0.1>;tag=67890" CRLF
+"To: B <sip:B@127.0.0.1>" CRLF
+"Call-ID: retrans-2@127.0.0.1" CRLF
+"CSeq: 1 OPTIONS" CRLF
+"Content-Length: 0" CRLF CRLF;
+
+class Peer
+{
+   public:
+      Peer(SipStack& stack) : mStack(stack)
+      {
+         mFd = ::socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+         assert(mFd != INVALID_SOCKET);
+         sockaddr_in local;
+         memset(&local, 0, sizeof(local));
+         local.sin_family = AF_INET;
+         local.sin_addr.s_addr = inet_addr("127.0.0.1");
+         local.sin_port = htons(PeerPort);
+         int ret = ::bind(mFd, (sockaddr*)&local, sizeof(local));
+         assert(ret == 0);
+         (void)ret;
+
+         memset(&mStackAddr, 0, sizeof(mStackAddr));
+         mStackAddr.sin_family = AF_INET;
+         mStackAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+         mStackAddr.sin_port = htons(StackPort);
+      }
+
+      ~Peer()
+      {
+         closeSocket(mFd);
+      }
+
+      void send(const Data& msg)
+      {
+         int sent = ::sendto(mFd, msg.data(), msg.size(), 0, (sockaddr*)&mStackAddr, sizeof(mStackAddr));
+         assert(sent == (int)msg.size());
+         (void)sent;
+      }
+
+      // Runs the stack until a message shows up on the peer's socket, handing
+      // whatever the stack passes up to the TU back through tu.
+      Data receive(int timeoutMs, SipMessage** tu = 0)
+      {
+         UInt64 end = Timer::getTimeMs() + timeoutMs;
+         while (Timer::getTimeMs() < end)
+         {
+            FdSet fdset;
+            mStack.buildFdSet(fdset);
+            fdset.setRead(mFd);
+            fdset.selectMilliSeconds(10);
+            mStack.process(fdset);
+
+            SipMessage* msg = mStack.receive();
+            if (msg)
+            {
+               assert(tu && !*tu);
+               *tu = msg;
+            }
+
+            if (fdset.readyToRead(mFd))
+            {
+               char buf[4096];
+               int len = ::recv(mFd, buf, sizeof(buf), 0);
+               assert(len > 0);
+               return Data(buf, len);
+            }
+         }
+         return Data::Empty;
+      }
+
+      // Skips over provisional responses
+      Data receiveFinal(int timeoutMs, SipMessage** tu = 0)
+      {
+         UInt64 end = Timer::getTimeMs() + timeoutMs;
+         while (Timer::getTimeMs() < end)
+         {
+            Data msg = receive(end - Timer::getTimeMs(), tu);
+            if (!msg.prefix("SIP/2.0 1"))
+            {
+               return msg;
+            }
+         }
+         return Data::Empty;
+      }
+
+   private:
+      SipStack& mStack;
+      Socket mFd;
+      sockaddr_in mStackAddr;
+};
+
+static SipMessage*
+waitForRequest(Peer& peer, MethodTypes method)
+{
+   SipMessage* request = 0;
+   UInt64 end = Timer::getTimeMs() + 2000;
+   while (!request && Timer::getTimeMs() < end)
+   {
+      Data wire = peer.receive(50, &request);
+      assert(wire.empty() || wire.prefix("SIP/2.0 100"));
+   }
+   assert(request && request->isRequest() && request->method() == method);
+   return request;
+}
+
+static void
+testServerInvite(SipStack& stack, Peer& peer)
+{
+   peer.send(invite);
+   auto_ptr<SipMessage> request(waitForRequest(peer, INVITE));
+
+   auto_ptr<SipMessage> busy(Helper::makeResponse(*request, 486));
+   stack.send(*busy);
+   Data first = peer.receiveFinal(1000);
+   assert(first.prefix("SIP/2.0 486"));
+
+   // absorbed retransmission of the INVITE
+   peer.send(invite);
+   Data again = peer.receiveFinal(200);
+   assert(again == first);
+
+   // Timer G
+   again = peer.receiveFinal(2 * Timer::T1 + 200);
+   assert(again == first);
+
+   char buf[1024];
+   snprintf(buf, sizeof(buf), ack, busy->header(h_To).param(p_tag).c_str());
+   peer.send(buf);
+   assert(peer.receive(4 * Timer::T1).empty());
+}
+
+static void
+testServerNonInvite(SipStack& stack, Peer& peer)
+{
+   peer.send(options);
+   auto_ptr<SipMessage> request(waitForRequest(peer, OPTIONS));
+
+   auto_ptr<SipMessage> ok(Helper::makeResponse(*request, 200));
+   stack.send(*ok);
+   Data first = peer.receiveFinal(1000);
+   assert(first.prefix("SIP/2.0 200"));
+
+   for (int i = 0; i < 3; ++i)
+   {
+      peer.send(options);
+      Data again = peer.receiveFinal(200);
+      assert(again == first);
+   }
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, argc > 1 ? Log::toLevel(argv[1]) : Log::Warning, argv[0]);
+
+   SipStack stack;
+   stack.addTransport(UDP, StackPort, V4, StunDisabled, "127.0.0.1");
+   Peer peer(stack);
+
+   testServerInvite(stack, peer);
+   testServerNonInvite(stack, peer);
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
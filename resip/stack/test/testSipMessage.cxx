@@ -10,6 +10,7 @@
 #include "resip/stack/test/TestSupport.hxx"
 #include "resip/stack/PlainContents.hxx"
 #include "resip/stack/UnknownHeaderType.hxx"
+#include "resip/stack/ExtensionHeader.hxx"
 #include "resip/stack/UnknownParameterType.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
@@ -2209,6 +2210,66 @@ main(int argc, char** argv)
       assert(embeddedMsg2.header(h_Requires).find(Token(Symbols::Replaces)));
    }
 
+   {
+      // unknown headers are found whatever their case; registered ones
+      // are kept in their own slot
+      const int slot = ExtensionHeader::registerHeader("X-Carrier-Route");
+      assert(ExtensionHeader::registerHeader("x-carrier-route") == slot);
+      assert(ExtensionHeader("X-CARRIER-ROUTE").getSlot() == slot);
+      assert(ExtensionHeader("X-Carrier-Zone").getSlot() == -1);
+
+      Data txt("INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+               "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bKnashds8\r\n"
+               "To: Bob <sip:bob@biloxi.com>\r\n"
+               "From: Alice <sip:alice@atlanta.com>;tag=1928301774\r\n"
+               "Call-ID: a84b4c76e66710\r\n"
+               "CSeq: 314159 INVITE\r\n"
+               "X-Carrier-Zone: east\r\n"
+               "x-carrier-route: trunk-1\r\n"
+               "X-Carrier-Id: 17\r\n"
+               "x-carrier-zone: west\r\n"
+               "X-Carrier-Route: trunk-2\r\n"
+               "Content-Length: 0\r\n"
+               "\r\n");
+
+      auto_ptr<SipMessage> msg(TestSupport::makeMessage(txt));
+      const ExtensionHeader h_XCarrierZone("X-CARRIER-ZONE");
+      const ExtensionHeader h_XCarrierRoute("X-Carrier-Route");
+      const ExtensionHeader h_XCarrierId("x-carrier-id");
+
+      assert(msg->getRawUnknownHeaders().size() == 2);
+      assert(msg->exists(h_XCarrierZone));
+      assert(msg->header(h_XCarrierZone).size() == 2);
+      assert(msg->header(h_XCarrierZone).back().value() == "west");
+      assert(msg->exists(h_XCarrierRoute));
+      assert(msg->header(h_XCarrierRoute).size() == 2);
+      assert(msg->header(h_XCarrierRoute).front().value() == "trunk-1");
+      assert(msg->header(h_XCarrierId).front().value() == "17");
+      assert(!msg->exists(ExtensionHeader("X-Carrier")));
+
+      SipMessage copy(*msg);
+      copy.remove(h_XCarrierRoute);
+      copy.remove(h_XCarrierZone);
+      assert(!copy.exists(h_XCarrierRoute));
+      assert(!copy.exists(h_XCarrierZone));
+      assert(copy.getRawUnknownHeaders().size() == 1);
+      assert(msg->header(h_XCarrierRoute).size() == 2);
+      assert(msg->header(h_XCarrierZone).size() == 2);
+
+      copy.header(h_XCarrierRoute).push_back(StringCategory("trunk-3"));
+      assert(copy.header(h_XCarrierRoute).front().value() == "trunk-3");
+
+      Data encoded;
+      {
+         DataStream str(encoded);
+         msg->encode(str);
+      }
+      assert(encoded.find("X-Carrier-Route: trunk-1\r\n") != Data::npos);
+      assert(encoded.find("X-Carrier-Route: trunk-2\r\n") != Data::npos);
+      assert(encoded.find("X-Carrier-Zone: east\r\n") != Data::npos);
+      assert(encoded.find("X-Carrier-Id: 17\r\n") != Data::npos);
+   }
+
    resipCerr << "\nTEST OK" << endl;
    return 0;
 }
@@ -0,0 +1,215 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+
+#include "rutil/BinaryTrace.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "resip/stack/SipTrace.hxx"
+#include "resip/stack/Uri.hxx"
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+static const char* TraceFile = "testSipTrace.trc";
+
+// Files get rotated, and each one ends with its last complete record
+static void
+testRotation()
+{
+   const int numEvents = 500;
+   bool started = SipTrace::start(TraceFile, 4096, 3);
+   assert(started);
+   for (int i = 0; i < numEvents; ++i)
+   {
+      SipTrace::event(SipTrace::TransactionTimer, i, "z9hG4bK-testSipTrace");
+   }
+   SipTrace::stop();
+
+   const Data files[] = { Data(TraceFile) + ".2", Data(TraceFile) + ".1", Data(TraceFile) };
+   int last = -1;
+   int count = 0;
+   for (int f = 0; f < 3; ++f)
+   {
+      BinaryTraceReader reader;
+      bool opened = reader.open(files[f]);
+      assert(opened);
+
+      BinaryTrace::RecordHeader header;
+      Data payload;
+      while (reader.next(header, payload))
+      {
+         assert(header.mType == SipTrace::Event);
+         SipTrace::EventRecord event;
+         memcpy(&event, payload.data(), sizeof(event));
+         assert(event.mCode == SipTrace::TransactionTimer);
+         assert(Data(payload.data() + sizeof(event), payload.size() - sizeof(event)) == "z9hG4bK-testSipTrace");
+         // the oldest records were rotated out - the rest are consecutive
+         assert(last == -1 || event.mArg == (UInt32)last + 1);
+         last = event.mArg;
+         ++count;
+      }
+   }
+   assert(last == numEvents - 1);
+   assert(count > 0 && count < numEvents);
+   cerr << "rotation: " << count << " of " << numEvents << " records kept in 3 files" << endl;
+}
+
+// A request the stack sends to itself is traced as sent and received, with its transaction events
+static void
+testStack()
+{
+   const int port = 15062;
+   SipStack stack;
+   stack.addTransport(UDP, port, V4, StunDisabled, "127.0.0.1");
+
+   bool started = SipTrace::start(TraceFile);
+   assert(started);
+
+   NameAddr target;
+   target.uri().scheme() = "sip";
+   target.uri().user() = "trace";
+   target.uri().host() = "127.0.0.1";
+   target.uri().port() = port;
+   auto_ptr<SipMessage> options(Helper::makeRequest(target, target, OPTIONS));
+   stack.send(*options);
+
+   bool received = false;
+   UInt64 end = Timer::getTimeMs() + 2000;
+   while (!received && Timer::getTimeMs() < end)
+   {
+      FdSet fdset;
+      stack.buildFdSet(fdset);
+      fdset.selectMilliSeconds(resipMin(stack.getTimeTillNextProcessMS(), 100U));
+      stack.process(fdset);
+
+      SipMessage* msg = stack.receive();
+      if (msg)
+      {
+         received = msg->isRequest() && msg->isExternal() && msg->method() == OPTIONS;
+         delete msg;
+      }
+   }
+   assert(received);
+   SipTrace::stop();
+
+   BinaryTraceReader reader;
+   bool opened = reader.open(TraceFile);
+   assert(opened);
+   int sent = 0;
+   int receivedRecords = 0;
+   int created = 0;
+   BinaryTrace::RecordHeader header;
+   Data payload;
+   while (reader.next(header, payload))
+   {
+      if (header.mType == SipTrace::MessageSent || header.mType == SipTrace::MessageReceived)
+      {
+         SipTrace::TupleRecord tuple;
+         memcpy(&tuple, payload.data(), sizeof(tuple));
+         assert(tuple.mTransportType == UDP);
+         assert(tuple.mIpVersion == 4);
+         Data message(payload.data() + sizeof(tuple), payload.size() - sizeof(tuple));
+         if (message.prefix("OPTIONS sip:trace@127.0.0.1"))
+         {
+            if (header.mType == SipTrace::MessageSent)
+            {
+               assert(tuple.mDestinationPort == port);
+               ++sent;
+            }
+            else
+            {
+               assert(tuple.mDestinationPort == port);
+               ++receivedRecords;
+            }
+         }
+      }
+      else if (header.mType == SipTrace::Event)
+      {
+         SipTrace::EventRecord event;
+         memcpy(&event, payload.data(), sizeof(event));
+         if (event.mCode == SipTrace::TransactionCreated)
+         {
+            ++created;
+         }
+      }
+   }
+   cerr << "stack: " << sent << " sent, " << receivedRecords << " received, " 
+        << created << " transactions created" << endl;
+   assert(sent >= 1);
+   assert(receivedRecords >= 1);
+   // the client transaction and the server transaction
+   assert(created >= 2);
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, argc > 1 ? Log::toLevel(argv[1]) : Log::Warning, argv[0]);
+   initNetwork();
+
+   testRotation();
+   testStack();
+
+   remove(TraceFile);
+   remove((Data(TraceFile) + ".1").c_str());
+   remove((Data(TraceFile) + ".2").c_str());
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
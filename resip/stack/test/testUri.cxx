@@ -4,6 +4,7 @@
 #include "TestSupport.hxx"
 #include "resip/stack/UnknownParameterType.hxx"
 #include "resip/stack/Uri.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/DataStream.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/DnsUtil.hxx"
@@ -650,6 +651,39 @@ main(int argc, char* argv[])
       assert(Data::from(uri) == "sip:1234#00442031111111@lvdx.com");
    }
 
+   // interned hosts
+   {
+      Uri a("sip:alice@Atlanta.Example.com");
+      Uri b("sip:bob@atlanta.example.COM;transport=tcp");
+      assert(a.internedHost() == 0);
+      assert(b.internedHost() == 0);
+
+      const Data* atlanta = DataIntern::intern("atlanta.example.com");
+      assert(a.internedHost() == atlanta);
+      assert(b.internedHost() == atlanta);
+      // the message keeps its own spelling
+      assert(a.host() == "Atlanta.Example.com");
+
+      Uri c(a);
+      assert(c.internedHost() == atlanta);
+      c.user() = "bob";
+      c.param(p_transport) = "tcp";
+      assert(c == b);
+      c.host() = "biloxi.example.com";
+      assert(c.internedHost() == 0);
+      assert(!(c == b));
+
+      Uri::setInternHosts(true);
+      Uri d("sip:carol@chicago.example.com");
+      Uri e("sip:dave@CHICAGO.example.com");
+      assert(d.internedHost() != 0);
+      assert(d.internedHost() == e.internedHost());
+      assert(*d.internedHost() == "chicago.example.com");
+      Uri::setInternHosts(false);
+      Uri f("sip:erin@denver.example.com");
+      assert(f.internedHost() == 0);
+   }
+
    cerr << endl << "All OK" << endl;
    return 0;
 }
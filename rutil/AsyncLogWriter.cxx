@@ -0,0 +1,403 @@
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+
+#include "rutil/AsyncLogWriter.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::NONE
+
+// records are kept 8 byte aligned
+static inline unsigned long
+alignRecord(unsigned long size)
+{
+   return (size + 7) & ~7UL;
+}
+
+static unsigned int
+roundToPowerOfTwo(unsigned int size)
+{
+   unsigned int result = 1024;
+   while (result < size)
+   {
+      result <<= 1;
+   }
+   return result;
+}
+
+LogRecordRing::LogRecordRing(unsigned int size)
+   : mClosed(false),
+     mSize(roundToPowerOfTwo(size)),
+     mBuffer(new char[mSize]),
+     mProducerTail(0),
+     mProducerCachedHead(0),
+     mConsumerHead(0),
+     mConsumerCachedTail(0)
+{
+}
+
+LogRecordRing::~LogRecordRing()
+{
+   delete [] mBuffer;
+}
+
+bool
+LogRecordRing::push(void* target, Log::Level level, const char* data, unsigned int dataSize)
+{
+   const unsigned long recordSize = alignRecord(sizeof(Header) + dataSize);
+   const unsigned long pos = mProducerTail & (mSize - 1);
+   const unsigned long contiguous = mSize - pos;
+
+   // a record that does not fit before the end of the buffer starts over at the beginning
+   const unsigned long needed = recordSize <= contiguous ? recordSize : contiguous + recordSize;
+   if (recordSize > mSize / 2)
+   {
+      mDropCount.increment();
+      return false;
+   }
+   if (mProducerTail + needed - mProducerCachedHead > mSize)
+   {
+      mProducerCachedHead = (unsigned long)mHead.value();
+      if (mProducerTail + needed - mProducerCachedHead > mSize)
+      {
+         mDropCount.increment();
+         return false;
+      }
+   }
+
+   char* record = mBuffer + pos;
+   if (recordSize > contiguous)
+   {
+      // the consumer skips a remainder too short for a header on its own
+      if (contiguous >= sizeof(Header))
+      {
+         reinterpret_cast<Header*>(record)->mSize = 0;
+      }
+      record = mBuffer;
+   }
+
+   Header* header = reinterpret_cast<Header*>(record);
+   header->mSize = (UInt32)recordSize;
+   header->mDataSize = dataSize;
+   header->mLevel = level;
+   header->mTarget = target;
+   memcpy(record + sizeof(Header), data, dataSize);
+
+   // publishes the record - full barrier
+   mProducerTail += needed;
+   mTail.add((long)needed);
+   return true;
+}
+
+const LogRecordRing::Header*
+LogRecordRing::front()
+{
+   if (mConsumerHead == mConsumerCachedTail)
+   {
+      mConsumerCachedTail = (unsigned long)mTail.value();
+      if (mConsumerHead == mConsumerCachedTail)
+      {
+         return 0;
+      }
+   }
+
+   unsigned long pos = mConsumerHead & (mSize - 1);
+   const unsigned long contiguous = mSize - pos;
+   if (contiguous < sizeof(Header) ||
+       reinterpret_cast<const Header*>(mBuffer + pos)->mSize == 0)
+   {
+      // wrapped - the record is at the start of the buffer; the skipped space is released by pop()
+      mConsumerHead += contiguous;
+      pos = 0;
+   }
+   return reinterpret_cast<const Header*>(mBuffer + pos);
+}
+
+void
+LogRecordRing::pop()
+{
+   const Header* header = reinterpret_cast<const Header*>(mBuffer + (mConsumerHead & (mSize - 1)));
+   mConsumerHead += header->mSize;
+   mHead.add((long)(mConsumerHead - (unsigned long)mHead.value()));
+}
+
+extern "C"
+{
+   static void closeLogRecordRing(void* ring)
+   {
+      if (ring)
+      {
+         static_cast<LogRecordRing*>(ring)->mClosed = true;
+      }
+   }
+}
+
+AsyncLogWriter::AsyncLogWriter(unsigned int bufferSizePerThread)
+   : mBufferSizePerThread(bufferSizePerThread),
+     mBatchTarget(0),
+     mBatchLines(0),
+     mDrainCount(0),
+     mReportedDropCount(0)
+{
+   ThreadIf::tlsKeyCreate(mRingKey, closeLogRecordRing);
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+   stop();
+}
+
+void
+AsyncLogWriter::stop()
+{
+   if (mStopped.increment() != 1)
+   {
+      return;
+   }
+
+   // a log() that saw mStopped unset may still be pushing to its ring
+   {
+      Lock lock(mMutex);
+      while (mInFlight.value() != 0)
+      {
+         mDrained.wait(mMutex, 1);
+      }
+   }
+
+   // the writer thread drains the rings once more before it exits
+   shutdown();
+   join();
+
+   // threads that are still running keep their (now stale) ring pointer under the deleted key,
+   // log() no longer looks it up
+   ThreadIf::tlsKeyDelete(mRingKey);
+   Lock lock(mRingsMutex);
+   for (std::vector<LogRecordRing*>::iterator it = mRings.begin(); it != mRings.end(); ++it)
+   {
+      delete *it;
+   }
+   mRings.clear();
+}
+
+LogRecordRing*
+AsyncLogWriter::getRing()
+{
+   LogRecordRing* ring = static_cast<LogRecordRing*>(ThreadIf::tlsGetValue(mRingKey));
+   if (ring == 0)
+   {
+      ring = new LogRecordRing(mBufferSizePerThread);
+      {
+         Lock lock(mRingsMutex);
+         mRings.push_back(ring);
+      }
+      ThreadIf::tlsSetValue(mRingKey, ring);
+   }
+   return ring;
+}
+
+AsyncLogWriter::LogResult
+AsyncLogWriter::log(void* target, Log::Level level, const Data& record)
+{
+   // full barriers - either stop() sees this call in flight, or this call sees mStopped
+   mInFlight.increment();
+   if (mStopped.value() != 0)
+   {
+      mInFlight.decrement();
+      return Stopped;
+   }
+
+   LogResult result = Queued;
+   LogRecordRing* ring = getRing();
+   if (!ring->push(target, level, record.data(), (unsigned int)record.size()))
+   {
+      mDropCount.increment();
+      result = Dropped;
+   }
+   else if (ring->isFilling())
+   {
+      // the writer also wakes up on its own, so a lost signal only delays it
+      mWakeup.signal();
+   }
+   mInFlight.decrement();
+   return result;
+}
+
+void
+AsyncLogWriter::flush()
+{
+   Lock lock(mMutex);
+   // the pass that is running now may have passed over this thread's ring already
+   const unsigned long target = mDrainCount + 2;
+   while (mDrainCount < target && !isShutdown())
+   {
+      mWakeup.signal();
+      mDrained.wait(mMutex, 100);
+   }
+}
+
+void
+AsyncLogWriter::shutdown()
+{
+   ThreadIf::shutdown();
+   mWakeup.signal();
+}
+
+void
+AsyncLogWriter::thread()
+{
+   while (!isShutdown())
+   {
+      {
+         Lock lock(mMutex);
+         mWakeup.wait(mMutex, 20);
+      }
+
+      drain();
+
+      unsigned long dropCount = getDropCount();
+      if (dropCount != mReportedDropCount)
+      {
+         WarningLog(<< "Dropped " << dropCount - mReportedDropCount << " log records, log buffers are full");
+         mReportedDropCount = dropCount;
+      }
+
+      {
+         Lock lock(mMutex);
+         ++mDrainCount;
+         mDrained.broadcast();
+      }
+   }
+
+   // write out whatever was logged before shutdown
+   drain();
+   Lock lock(mMutex);
+   ++mDrainCount;
+   mDrained.broadcast();
+}
+
+unsigned int
+AsyncLogWriter::drain()
+{
+   unsigned int count = 0;
+   Lock lock(mRingsMutex);
+   for (std::vector<LogRecordRing*>::iterator it = mRings.begin(); it != mRings.end(); )
+   {
+      LogRecordRing* ring = *it;
+      // once the owning thread has exited, nothing more is pushed after the records drained below
+      const bool closed = ring->mClosed;
+
+      const LogRecordRing::Header* header;
+      while ((header = ring->front()) != 0)
+      {
+         Log::ThreadData* target = static_cast<Log::ThreadData*>(header->mTarget);
+         if (target != mBatchTarget)
+         {
+            writeBatch();
+            mBatchTarget = target;
+         }
+         mBatch.append(reinterpret_cast<const char*>(header + 1), header->mDataSize);
+         mBatch += '\n';
+         ++mBatchLines;
+         ring->pop();
+         ++count;
+
+         // syslog takes one record per call
+         if (target->mType == Log::Syslog)
+         {
+            writeBatch();
+         }
+      }
+
+      if (closed)
+      {
+         delete ring;
+         it = mRings.erase(it);
+      }
+      else
+      {
+         ++it;
+      }
+   }
+   writeBatch();
+   return count;
+}
+
+void
+AsyncLogWriter::writeBatch()
+{
+   if (mBatchLines == 0)
+   {
+      return;
+   }
+
+   Log::ThreadData* target = static_cast<Log::ThreadData*>(mBatchTarget);
+   {
+      Lock lock(Log::_mutex);
+      if (target->mType == Log::Syslog)
+      {
+         // endl is magic in syslog
+         target->Instance() << Data(Data::Share, mBatch.data(), mBatch.size() - 1) << std::endl;
+      }
+      else
+      {
+         target->write(mBatch.data(), mBatch.size(), mBatchLines);
+      }
+   }
+
+   mBatch.clear();
+   mBatchLines = 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,203 @@
+#ifndef RESIP_AsyncLogWriter_hxx
+#define RESIP_AsyncLogWriter_hxx
+
+#include <vector>
+
+#include "rutil/Log.hxx"
+#include "rutil/AtomicCounter.hxx"
+#include "rutil/Condition.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Lock-free single producer/single consumer ring of formatted log 
+   records - one per logging thread (see AsyncLogWriter).
+
+   Records are stored contiguously, so a record that does not fit before
+   the end of the buffer is written at its start.  A record that does not 
+   fit in the free space is dropped and counted.  The size of the ring is 
+   rounded up to a power of two.
+*/
+class LogRecordRing
+{
+   public:
+      struct Header
+      {
+         UInt32 mSize;       ///< size of the record, including the header - 0 marks a wrap to the start
+         UInt32 mDataSize;
+         Log::Level mLevel;
+         void* mTarget;      ///< the Log::ThreadData to write the record to
+      };
+
+      LogRecordRing(unsigned int size);
+      ~LogRecordRing();
+
+      /// Producer: returns false if the record was dropped
+      bool push(void* target, Log::Level level, const char* data, unsigned int dataSize);
+      /// Producer: true if more than half the ring was used the last time the producer looked
+      bool isFilling() const { return mProducerTail - mProducerCachedHead > mSize / 2; }
+
+      /// Consumer: returns the oldest record (its data follows the header), or 0 if the ring is empty
+      const Header* front();
+      /// Consumer: releases the oldest record
+      void pop();
+
+      unsigned long getDropCount() const { return (unsigned long)mDropCount.value(); }
+
+      /// Set when the owning thread has exited - the ring is freed once the writer has emptied it
+      volatile bool mClosed;
+
+   private:
+      const unsigned int mSize;
+      char* mBuffer;
+
+      // Total number of bytes written/released - each only written by one side.  Each side keeps its
+      // own copy, and the last value of the other side's counter it saw.
+      AtomicCounter mTail;
+      unsigned long mProducerTail;
+      unsigned long mProducerCachedHead;
+      char mProducerPad[64];
+
+      AtomicCounter mHead;
+      unsigned long mConsumerHead;
+      unsigned long mConsumerCachedTail;
+      char mConsumerPad[64];
+
+      AtomicCounter mDropCount;
+
+      // no value semantics
+      LogRecordRing(const LogRecordRing&);
+      LogRecordRing& operator=(const LogRecordRing&);
+};
+
+/**
+   @brief Background thread that writes log records for Log, so that logging 
+   threads never block on the log output or on Log::_mutex.
+
+   Each logging thread queues its formatted records in its own LogRecordRing,
+   and the writer thread writes them out in batches - one stream write per 
+   batch for Cout, Cerr and File loggers (rotating files that reach their 
+   maximum line count to <file>.1), and one syslog call per record for Syslog 
+   loggers.  Records from one thread are written in order, records from 
+   different threads may be interleaved differently than they were logged.
+
+   @see Log::startAsyncWriter
+*/
+class AsyncLogWriter : public ThreadIf
+{
+   public:
+      AsyncLogWriter(unsigned int bufferSizePerThread);
+      virtual ~AsyncLogWriter();
+
+      virtual void thread();
+      virtual void shutdown();
+
+      enum LogResult
+      {
+         Queued,
+         Dropped,  ///< the calling thread's buffer is full
+         Stopped   ///< stop() has been called - the caller writes the record itself
+      };
+
+      /// Queues a record for target
+      LogResult log(void* target, Log::Level level, const Data& record);
+
+      /**
+         Writes out everything queued, stops the writer thread and frees the
+         record buffers.  log() calls that got in first are waited for, and
+         later ones return Stopped.  Threads may still hold a pointer to the
+         writer, so this, not the destructor, is how Log retires it.
+      */
+      void stop();
+
+      /// Waits until all records queued before the call have been written
+      void flush();
+
+      unsigned long getDropCount() const { return (unsigned long)mDropCount.value(); }
+
+   private:
+      LogRecordRing* getRing();
+      /// Writes out all queued records - returns the number of records written
+      unsigned int drain();
+      void writeBatch();
+
+      const unsigned int mBufferSizePerThread;
+      ThreadIf::TlsKey mRingKey;
+
+      Mutex mRingsMutex;
+      std::vector<LogRecordRing*> mRings;
+
+      // Batch of consecutive records for the same target
+      void* mBatchTarget;
+      Data mBatch;
+      unsigned int mBatchLines;
+
+      Mutex mMutex;
+      Condition mWakeup;
+      Condition mDrained;
+      unsigned long mDrainCount;
+
+      AtomicCounter mDropCount;
+      unsigned long mReportedDropCount;
+
+      // log() calls between their check of mStopped and their push - stop() waits for them
+      AtomicCounter mInFlight;
+      AtomicCounter mStopped;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,144 @@
+#if !defined(RESIP_ATOMICCOUNTER_HXX)
+#define RESIP_ATOMICCOUNTER_HXX
+
+#include "rutil/compat.hxx"
+
+#if defined(WIN32)
+#include <windows.h>
+#elif !defined(__GNUC__)
+#include "rutil/Mutex.hxx"
+#include "rutil/Lock.hxx"
+#endif
+
+namespace resip
+{
+
+/**
+   @brief A counter that can be incremented and decremented from several
+   threads without a lock.
+
+   Intended for reference counts and statistics. Uses the compiler's atomic
+   intrinsics where available and falls back to a Mutex otherwise.
+*/
+class AtomicCounter
+{
+   public:
+      AtomicCounter(long initial = 0) : mValue(initial) {}
+
+      /// returns the new value
+      long increment()
+      {
+#if defined(WIN32)
+         return InterlockedIncrement(&mValue);
+#elif defined(__GNUC__)
+         return __sync_add_and_fetch(&mValue, 1);
+#else
+         Lock lock(mMutex); (void)lock;
+         return ++mValue;
+#endif
+      }
+
+      /// returns the new value
+      long decrement()
+      {
+#if defined(WIN32)
+         return InterlockedDecrement(&mValue);
+#elif defined(__GNUC__)
+         return __sync_sub_and_fetch(&mValue, 1);
+#else
+         Lock lock(mMutex); (void)lock;
+         return --mValue;
+#endif
+      }
+
+      /// returns the new value
+      long add(long amount)
+      {
+#if defined(WIN32)
+         return InterlockedExchangeAdd(&mValue, amount) + amount;
+#elif defined(__GNUC__)
+         return __sync_add_and_fetch(&mValue, amount);
+#else
+         Lock lock(mMutex); (void)lock;
+         return mValue += amount;
+#endif
+      }
+
+      long value() const
+      {
+#if defined(WIN32) || defined(__GNUC__)
+         return const_cast<AtomicCounter*>(this)->add(0);
+#else
+         Lock lock(mMutex); (void)lock;
+         return mValue;
+#endif
+      }
+
+   private:
+#if defined(WIN32)
+      volatile LONG mValue;
+#else
+      volatile long mValue;
+#endif
+#if !defined(WIN32) && !defined(__GNUC__)
+      mutable Mutex mMutex;
+#endif
+
+      // no value semantics
+      AtomicCounter(const AtomicCounter&);
+      AtomicCounter& operator=(const AtomicCounter&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,381 @@
+#include <cassert>
+#include <cstring>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rutil/BinaryTrace.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::NONE
+
+// records are kept 8 byte aligned
+static inline size_t
+alignRecord(size_t size)
+{
+   return (size + 7) & ~(size_t)7;
+}
+
+UInt64
+BinaryTrace::now()
+{
+#ifdef WIN32
+   FILETIME ft;
+   GetSystemTimeAsFileTime(&ft);
+   ULARGE_INTEGER t;
+   t.LowPart = ft.dwLowDateTime;
+   t.HighPart = ft.dwHighDateTime;
+   // 100ns intervals since 1601
+   return t.QuadPart / 10 - 11644473600000000ULL;
+#else
+   struct timeval tv;
+   gettimeofday(&tv, 0);
+   return UInt64(tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
+
+BinaryTraceFile::BinaryTraceFile()
+   : mMaxFileSize(0),
+     mMaxFiles(0),
+#ifdef WIN32
+     mFile(INVALID_HANDLE_VALUE),
+     mMapping(0),
+#else
+     mFd(-1),
+#endif
+     mBase(0),
+     mUsed(0),
+     mNumRecords(0),
+     mNumRotations(0)
+{
+}
+
+BinaryTraceFile::~BinaryTraceFile()
+{
+   close();
+}
+
+bool
+BinaryTraceFile::open(const Data& fileName, unsigned int maxFileSize, unsigned int maxFiles)
+{
+   Lock lock(mMutex);
+   finish();
+
+   mFileName = fileName;
+   mMaxFileSize = (unsigned int)alignRecord(resipMax(maxFileSize, 4096U));
+   mMaxFiles = resipMax(maxFiles, 1U);
+   return create();
+}
+
+void
+BinaryTraceFile::close()
+{
+   Lock lock(mMutex);
+   finish();
+}
+
+bool
+BinaryTraceFile::create()
+{
+   assert(mBase == 0);
+#ifdef WIN32
+   mFile = CreateFileA(mFileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0,
+                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+   if (mFile == INVALID_HANDLE_VALUE)
+   {
+      ErrLog(<< "Could not create trace file " << mFileName << ": " << GetLastError());
+      return false;
+   }
+   mMapping = CreateFileMapping(mFile, 0, PAGE_READWRITE, 0, mMaxFileSize, 0);
+   if (mMapping)
+   {
+      mBase = static_cast<char*>(MapViewOfFile(mMapping, FILE_MAP_WRITE, 0, 0, mMaxFileSize));
+   }
+   if (mBase == 0)
+   {
+      ErrLog(<< "Could not map trace file " << mFileName << ": " << GetLastError());
+      if (mMapping)
+      {
+         CloseHandle(mMapping);
+         mMapping = 0;
+      }
+      CloseHandle(mFile);
+      mFile = INVALID_HANDLE_VALUE;
+      return false;
+   }
+#else
+   mFd = ::open(mFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (mFd < 0)
+   {
+      ErrLog(<< "Could not create trace file " << mFileName << ": " << strerror(errno));
+      return false;
+   }
+   // the file reads as zeros past the last record
+   if (ftruncate(mFd, mMaxFileSize) != 0)
+   {
+      ErrLog(<< "Could not size trace file " << mFileName << ": " << strerror(errno));
+      ::close(mFd);
+      mFd = -1;
+      return false;
+   }
+   void* base = mmap(0, mMaxFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+   if (base == MAP_FAILED)
+   {
+      ErrLog(<< "Could not map trace file " << mFileName << ": " << strerror(errno));
+      ::close(mFd);
+      mFd = -1;
+      return false;
+   }
+   mBase = static_cast<char*>(base);
+#endif
+
+   BinaryTrace::FileHeader* header = reinterpret_cast<BinaryTrace::FileHeader*>(mBase);
+   memcpy(header->mMagic, BinaryTrace::Magic, sizeof(header->mMagic));
+   header->mVersion = BinaryTrace::Version;
+   header->mCreated = BinaryTrace::now();
+   mUsed = alignRecord(sizeof(BinaryTrace::FileHeader));
+   return true;
+}
+
+void
+BinaryTraceFile::finish()
+{
+   if (mBase == 0)
+   {
+      return;
+   }
+
+   // leave an end marker if there is room for one, then cut off the unused part
+   size_t size = mUsed;
+   if (size + sizeof(BinaryTrace::RecordHeader) <= mMaxFileSize)
+   {
+      size += sizeof(BinaryTrace::RecordHeader);
+   }
+#ifdef WIN32
+   UnmapViewOfFile(mBase);
+   CloseHandle(mMapping);
+   mMapping = 0;
+   LARGE_INTEGER end;
+   end.QuadPart = size;
+   SetFilePointerEx(mFile, end, 0, FILE_BEGIN);
+   SetEndOfFile(mFile);
+   CloseHandle(mFile);
+   mFile = INVALID_HANDLE_VALUE;
+#else
+   munmap(mBase, mMaxFileSize);
+   if (ftruncate(mFd, size) != 0)
+   {
+      WarningLog(<< "Could not truncate trace file " << mFileName << ": " << strerror(errno));
+   }
+   ::close(mFd);
+   mFd = -1;
+#endif
+   mBase = 0;
+   mUsed = 0;
+}
+
+void
+BinaryTraceFile::rotate()
+{
+   finish();
+
+   for (unsigned int i = mMaxFiles - 1; i > 0; --i)
+   {
+      Data from(mFileName);
+      if (i > 1)
+      {
+         from += "." + Data(i - 1);
+      }
+      Data to(mFileName + "." + Data(i));
+      remove(to.c_str());
+      rename(from.c_str(), to.c_str());
+   }
+   ++mNumRotations;
+
+   create();
+}
+
+bool
+BinaryTraceFile::write(UInt16 type,
+                       const void* part1, size_t size1,
+                       const void* part2, size_t size2,
+                       const void* part3, size_t size3)
+{
+   assert(type != 0);
+   const size_t size = size1 + size2 + size3;
+   const size_t recordSize = alignRecord(sizeof(BinaryTrace::RecordHeader) + size);
+   if (recordSize + alignRecord(sizeof(BinaryTrace::FileHeader)) > mMaxFileSize)
+   {
+      return false;
+   }
+   const UInt64 timestamp = BinaryTrace::now();
+
+   Lock lock(mMutex);
+   if (mBase == 0)
+   {
+      return false;
+   }
+   if (mUsed + recordSize > mMaxFileSize)
+   {
+      rotate();
+      if (mBase == 0)
+      {
+         return false;
+      }
+   }
+
+   char* record = mBase + mUsed;
+   BinaryTrace::RecordHeader* header = reinterpret_cast<BinaryTrace::RecordHeader*>(record);
+   header->mSize = (UInt32)size;
+   header->mReserved = 0;
+   header->mTimestamp = timestamp;
+   char* payload = record + sizeof(BinaryTrace::RecordHeader);
+   if (size1)
+   {
+      memcpy(payload, part1, size1);
+   }
+   if (size2)
+   {
+      memcpy(payload + size1, part2, size2);
+   }
+   if (size3)
+   {
+      memcpy(payload + size1 + size2, part3, size3);
+   }
+   // the type goes in last, so a reader of a crashed file does not see a partial record
+   header->mType = type;
+
+   mUsed += recordSize;
+   ++mNumRecords;
+   return true;
+}
+
+BinaryTraceReader::BinaryTraceReader()
+   : mFile(0)
+{
+   memset(&mFileHeader, 0, sizeof(mFileHeader));
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+   close();
+}
+
+bool
+BinaryTraceReader::open(const Data& fileName)
+{
+   close();
+   mFile = fopen(fileName.c_str(), "rb");
+   if (mFile == 0)
+   {
+      return false;
+   }
+   if (fread(&mFileHeader, sizeof(mFileHeader), 1, mFile) != 1 ||
+       memcmp(mFileHeader.mMagic, BinaryTrace::Magic, sizeof(mFileHeader.mMagic)) != 0 ||
+       mFileHeader.mVersion != BinaryTrace::Version)
+   {
+      close();
+      return false;
+   }
+   fseek(mFile, (long)alignRecord(sizeof(mFileHeader)), SEEK_SET);
+   return true;
+}
+
+void
+BinaryTraceReader::close()
+{
+   if (mFile)
+   {
+      fclose(mFile);
+      mFile = 0;
+   }
+}
+
+bool
+BinaryTraceReader::next(BinaryTrace::RecordHeader& header, Data& payload)
+{
+   if (mFile == 0 ||
+       fread(&header, sizeof(header), 1, mFile) != 1 ||
+       header.mType == 0)
+   {
+      return false;
+   }
+
+   payload.clear();
+   if (header.mSize)
+   {
+      char* buffer = new char[header.mSize];
+      if (fread(buffer, header.mSize, 1, mFile) != 1)
+      {
+         delete [] buffer;
+         return false;
+      }
+      payload = Data(Data::Take, buffer, header.mSize);
+   }
+   const size_t padding = alignRecord(sizeof(header) + header.mSize) - sizeof(header) - header.mSize;
+   if (padding)
+   {
+      fseek(mFile, (long)padding, SEEK_CUR);
+   }
+   return true;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,187 @@
+#ifndef RESIP_BinaryTrace_hxx
+#define RESIP_BinaryTrace_hxx
+
+#include <cstdio>
+
+#include "rutil/compat.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Layout of binary trace files (see BinaryTraceFile).
+
+   A file starts with a FileHeader, followed by records.  Each record is a
+   RecordHeader followed by mSize bytes of payload, padded to 8 bytes.  A 
+   record type of 0 marks the end of the records - files are zero filled 
+   when they are created, so a file that was not closed properly (the 
+   process crashed) still ends after the last complete record.  All values 
+   are in host byte order.
+*/
+namespace BinaryTrace
+{
+   static const char Magic[4] = { 'R', 'T', 'R', 'C' };
+   static const UInt32 Version = 1;
+
+   struct FileHeader
+   {
+      char mMagic[4];
+      UInt32 mVersion;
+      UInt64 mCreated;       ///< microseconds since the epoch
+   };
+
+   struct RecordHeader
+   {
+      UInt32 mSize;          ///< payload size, without padding
+      UInt16 mType;          ///< meaning of the payload - defined by the user of the trace
+      UInt16 mReserved;
+      UInt64 mTimestamp;     ///< microseconds since the epoch
+   };
+
+   /// Current wall clock time, in microseconds since the epoch
+   UInt64 now();
+}
+
+/**
+   @brief Writes binary trace records into memory mapped files, so that a
+   record costs a copy into the mapping and no system call.
+
+   When a record does not fit in the current file, the file is truncated to
+   the records it holds and renamed to <file>.1 (<file>.1 to <file>.2 and
+   so on, up to maxFiles - 1 old files), and a new file is started.
+
+   Thread safe - a short critical section per record.
+*/
+class BinaryTraceFile
+{
+   public:
+      BinaryTraceFile();
+      ~BinaryTraceFile();
+
+      /// Creates fileName with room for maxFileSize bytes of records - returns false on failure
+      bool open(const Data& fileName, unsigned int maxFileSize = 16*1024*1024, unsigned int maxFiles = 4);
+      void close();
+      bool isOpen() const { return mBase != 0; }
+
+      /**
+         Writes one record, its payload the concatenation of the parts.
+         Returns false if the file is not open or the record is larger than
+         a file.
+      */
+      bool write(UInt16 type,
+                 const void* part1, size_t size1,
+                 const void* part2 = 0, size_t size2 = 0,
+                 const void* part3 = 0, size_t size3 = 0);
+
+      UInt64 getNumRecords() const { return mNumRecords; }
+      UInt64 getNumRotations() const { return mNumRotations; }
+
+   private:
+      bool create();
+      void finish();
+      void rotate();
+
+      Mutex mMutex;
+      Data mFileName;
+      unsigned int mMaxFileSize;
+      unsigned int mMaxFiles;
+
+#ifdef WIN32
+      HANDLE mFile;
+      HANDLE mMapping;
+#else
+      int mFd;
+#endif
+      char* mBase;
+      size_t mUsed;
+
+      UInt64 mNumRecords;
+      UInt64 mNumRotations;
+
+      // no value semantics
+      BinaryTraceFile(const BinaryTraceFile&);
+      BinaryTraceFile& operator=(const BinaryTraceFile&);
+};
+
+/**
+   @brief Reads the records of a binary trace file, as written by
+   BinaryTraceFile.
+*/
+class BinaryTraceReader
+{
+   public:
+      BinaryTraceReader();
+      ~BinaryTraceReader();
+
+      /// Returns false if the file can not be opened or is not a trace file
+      bool open(const Data& fileName);
+      void close();
+
+      const BinaryTrace::FileHeader& fileHeader() const { return mFileHeader; }
+
+      /// Reads the next record - returns false at the end of the records
+      bool next(BinaryTrace::RecordHeader& header, Data& payload);
+
+   private:
+      FILE* mFile;
+      BinaryTrace::FileHeader mFileHeader;
+
+      BinaryTraceReader(const BinaryTraceReader&);
+      BinaryTraceReader& operator=(const BinaryTraceReader&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -361,10 +361,23 @@ Data::Data(const Data& data)
 }
 
 #ifdef RESIP_HAS_RVALUE_REFS
-Data::Data(Data &&data)
-   : mSize(0),mBuf(mPreBuffer),mCapacity(LocalAlloc),mMine(Borrow)
+Data::Data(Data &&data) noexcept
+   : mSize(data.mSize),
+     mBuf(data.mBuf),
+     mCapacity(data.mCapacity),
+     mMine(data.mMine)
 {
-   *this = std::move(data);
+   if (data.mBuf == data.mPreBuffer)
+   {
+      // local buffer; can't be taken, but fits in ours
+      mBuf = mPreBuffer;
+      memcpy(mPreBuffer, data.mPreBuffer, mSize + 1);
+   }
+   data.mSize = 0;
+   data.mBuf = data.mPreBuffer;
+   data.mBuf[0] = 0;
+   data.mCapacity = LocalAlloc;
+   data.mMine = Borrow;
 }
 #endif
 
@@ -784,18 +797,38 @@ Data& Data::operator=(Data &&data)
 {
    if (&data != this)
    {
-      if (data.mPreBuffer != data.mBuf)
+      // only an owned heap buffer can change hands; a Borrow of an external
+      // buffer must keep writing into that buffer
+      if (data.mMine == Take &&
+          (mMine != Borrow || mBuf == mPreBuffer))
       {
-         //data is not using the local buffer, take ownership of data.
+         if (mMine == Take)
+         {
+            delete[] mBuf;
+         }
          mBuf = data.mBuf;
-         mCapacity = data.mCapacity;
-         mMine = data.mMine;
          mSize = data.mSize;
-         data.mMine = Borrow; //don't delete the transferred buffer in data's destructor.
+         mCapacity = data.mCapacity;
+         mMine = Take;
+
+         data.mSize = 0;
+         data.mBuf = data.mPreBuffer;
+         data.mBuf[0] = 0;
+         data.mCapacity = LocalAlloc;
+         data.mMine = Borrow;
       }
       else
       {
-         *this = data; //lvalue assignment operator will be called for named rvalue.
+         *this = static_cast<const Data&>(data);
+         if (data.mMine != Take)
+         {
+            // drop any external buffer rather than copy it to own()
+            data.mBuf = data.mPreBuffer;
+            data.mCapacity = LocalAlloc;
+            data.mMine = Borrow;
+         }
+         data.mSize = 0;
+         data.mBuf[0] = 0;
       }
    }
    
@@ -1808,85 +1841,90 @@ resip::operator<<(std::ostream& strm, const Data& d)
    return strm.write(d.mBuf, d.mSize);
 }
 
-// random permutation of 0..255
-static const unsigned char randomPermutation[256] = 
-{
-   44, 9, 46, 184, 21, 30, 92, 231, 79, 7, 166, 237, 173, 72, 91, 123, 
-   212, 183, 16, 99, 85, 45, 190, 130, 118, 107, 169, 119, 100, 179, 251, 177,
-   23, 125, 12, 101, 121, 246, 61, 38, 156, 114, 159, 57, 181, 145, 198, 182,
-   58, 215, 174, 225, 82, 178, 150, 161, 63, 103, 32, 203, 68, 151, 139, 55, 
-   143, 2, 36, 110, 209, 154, 204, 89, 62, 17, 187, 226, 31, 105, 195, 208,
-   49, 56, 238, 172, 37, 3, 234, 206, 134, 233, 19, 148, 64, 4, 10, 224,
-   144, 88, 93, 191, 20, 131, 138, 199, 243, 244, 39, 50, 214, 87, 6, 84,
-   185, 112, 171, 75, 192, 193, 239, 69, 106, 43, 194, 1, 78, 67, 116, 200,
-   83, 70, 213, 25, 59, 137, 52, 13, 153, 42, 232, 0, 133, 210, 76, 33,
-   255, 236, 124, 104, 65, 201, 53, 155, 140, 254, 54, 196, 120, 146, 216, 29,
-   28, 86, 245, 90, 98, 26, 81, 115, 180, 66, 102, 136, 167, 51, 109, 132,
-   77, 175, 14, 202, 222, 48, 223, 188, 40, 242, 157, 5, 128, 229, 71, 127,
-   164, 207, 247, 8, 80, 149, 94, 160, 47, 117, 135, 176, 129, 142, 189, 97,
-   11, 250, 221, 218, 96, 220, 35, 197, 152, 126, 219, 74, 170, 252, 163, 41,
-   95, 27, 34, 22, 205, 230, 241, 186, 168, 228, 253, 249, 113, 108, 111, 211,
-   235, 217, 165, 122, 15, 141, 158, 147, 240, 24, 162, 18, 60, 73, 227, 248
-};
+// MurmurHash64A over native-endian words, with the case-insensitive
+// variant folding ASCII A-Z to a-z eight bytes at a time
+static const UInt64 HashMultiplier = 0xc6a4a7935bd1e995ULL;
+static const int HashShift = 47;
+static const UInt64 HashSeed = 0x9e3779b97f4a7c15ULL;
+static const UInt64 HashLowBits = 0x7f7f7f7f7f7f7f7fULL;
+static const UInt64 HashHighBits = 0x8080808080808080ULL;
+
+static inline UInt64
+hashLoad(const unsigned char* c, size_t size)
+{
+   UInt64 word = 0;
+   memcpy(&word, c, size);
+   return word;
+}
+
+static inline UInt64
+hashLower(UInt64 word)
+{
+   // per byte: high bit of (b + 0x3f) is b >= 'A', of (b + 0x25) is b > 'Z';
+   // bytes >= 0x80 are masked out and no addition carries into the next byte
+   UInt64 heptets = word & HashLowBits;
+   UInt64 aboveZ = heptets + 0x2525252525252525ULL;
+   UInt64 fromA = heptets + 0x3f3f3f3f3f3f3f3fULL;
+   UInt64 upper = ~word & (fromA ^ aboveZ) & HashHighBits;
+   return word | (upper >> 2);
+}
+
+static inline void
+hashStep(UInt64& h, UInt64 k)
+{
+   k *= HashMultiplier;
+   k ^= k >> HashShift;
+   k *= HashMultiplier;
+   h ^= k;
+   h *= HashMultiplier;
+}
+
+static inline size_t
+hashFinish(UInt64 h)
+{
+   h ^= h >> HashShift;
+   h *= HashMultiplier;
+   h ^= h >> HashShift;
+   return size_t(h ^ (h >> 32));
+}
 
 size_t
 Data::rawHash(const unsigned char* c, size_t size)
 {
-   // 4 byte Pearson's hash
-   // essentially random hashing
+   UInt64 h = HashSeed ^ (size * HashMultiplier);
 
-   union 
+   const unsigned char* end = c + (size & ~size_t(7));
+   for ( ; c != end; c += 8)
    {
-         size_t st;
-         unsigned char bytes[4];
-   };
-   st = 0; // suppresses warnings about unused st
-   bytes[0] = randomPermutation[0];
-   bytes[1] = randomPermutation[1];
-   bytes[2] = randomPermutation[2];
-   bytes[3] = randomPermutation[3];
-
-   const unsigned char* end = c + size;
-   for ( ; c != end; ++c)
+      hashStep(h, hashLoad(c, 8));
+   }
+   if (size & 7)
    {
-      bytes[0] = randomPermutation[*c ^ bytes[0]];
-      bytes[1] = randomPermutation[*c ^ bytes[1]];
-      bytes[2] = randomPermutation[*c ^ bytes[2]];
-      bytes[3] = randomPermutation[*c ^ bytes[3]];
+      h ^= hashLoad(c, size & 7);
+      h *= HashMultiplier;
    }
 
-   // convert from network to host byte order
-   return ntohl(st);
+   return hashFinish(h);
 }
 
 // use only for ascii characters!
 size_t 
 Data::rawCaseInsensitiveHash(const unsigned char* c, size_t size)
 {
+   UInt64 h = HashSeed ^ (size * HashMultiplier);
 
-   union 
+   const unsigned char* end = c + (size & ~size_t(7));
+   for ( ; c != end; c += 8)
    {
-         size_t st;
-         unsigned char bytes[4];
-   };
-   st = 0; // suppresses warnings about unused st
-   bytes[0] = randomPermutation[0];
-   bytes[1] = randomPermutation[1];
-   bytes[2] = randomPermutation[2];
-   bytes[3] = randomPermutation[3];
-
-   const unsigned char* end = c + size;
-   for ( ; c != end; ++c)
+      hashStep(h, hashLower(hashLoad(c, 8)));
+   }
+   if (size & 7)
    {
-      unsigned char cc = tolower(*c);
-      bytes[0] = randomPermutation[cc ^ bytes[0]];
-      bytes[1] = randomPermutation[cc ^ bytes[1]];
-      bytes[2] = randomPermutation[cc ^ bytes[2]];
-      bytes[3] = randomPermutation[cc ^ bytes[3]];
+      h ^= hashLower(hashLoad(c, size & 7));
+      h *= HashMultiplier;
    }
 
-   // convert from network to host byte order
-   return ntohl(st);
+   return hashFinish(h);
 }
 
 Data
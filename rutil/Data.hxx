@@ -9,8 +9,21 @@
 #include "rutil/HeapInstanceCounter.hxx"
 #include "rutil/HashMap.hxx"
 
+#if !defined(RESIP_HAS_RVALUE_REFS) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+#define RESIP_HAS_RVALUE_REFS
+#endif
+
+#ifdef RESIP_HAS_RVALUE_REFS
+#include <utility>
+#endif
+
+// Sized so that about 95% of the tokens in typical SIP traffic (tags, users,
+// hosts, ports, parameter names and values) fit without a heap allocation;
+// testDataPerformance reports the distribution. 23 keeps sizeof(Data) the
+// same as 16 did on LP64 platforms. Must be the same for every library and
+// application linked together (see Data::init).
 #ifndef RESIP_DATA_LOCAL_SIZE
-#define RESIP_DATA_LOCAL_SIZE 16
+#define RESIP_DATA_LOCAL_SIZE 23
 #endif
 
 class TestData;
@@ -138,7 +151,11 @@ class Data
       Data(const Data& data);
 
 #ifdef RESIP_HAS_RVALUE_REFS
-      Data(Data &&data);
+      /**
+        Takes over the buffer of data, whatever its ShareEnum, without
+        copying. data is left empty, using its local buffer.
+      */
+      Data(Data &&data) noexcept;
 #endif
       /**
         Creates a data with the contents of the string.
@@ -295,6 +312,11 @@ class Data
       Data& operator=(const Data& data);
 
 #ifdef RESIP_HAS_RVALUE_REFS
+      /**
+        Takes over the heap buffer of data if data owns one and this
+        Data is not borrowing an external buffer; otherwise copies, like
+        operator=(const Data&). data is left empty.
+      */
       Data& operator=(Data &&data);
 #endif
 
@@ -656,8 +678,9 @@ class Data
       Data base64encode(bool useUrlSafe=false) const;
 
       /**
-        Creates a 32-bit hash based on the contents of the indicated
-        buffer.
+        Creates a hash based on the contents of the indicated buffer.
+        Consumes the buffer a machine word at a time (MurmurHash64A
+        style), so the result is only stable within one platform.
 
         @param c Pointer to the buffer to hash
         @param size Number of bytes to be hashed
@@ -665,13 +688,14 @@ class Data
       static size_t rawHash(const unsigned char* c, size_t size);
 
       /**
-        Creates a 32-bit hash based on the contents of this Data.
+        Creates a hash based on the contents of this Data.
       */
       size_t hash() const;
 
       /**
-        Creates a 32-bit hash based on the contents of the indicated
-        buffer, after normalizing any alphabetic characters to lowercase.
+        Creates a hash based on the contents of the indicated buffer,
+        after normalizing any ASCII alphabetic characters to lowercase.
+        Equal to rawHash() of the lowercased buffer.
 
         @param c Pointer to the buffer to hash
         @param size Number of bytes to be hashed
@@ -679,8 +703,8 @@ class Data
       static size_t rawCaseInsensitiveHash(const unsigned char* c, size_t size);
 
       /**
-        Creates a 32-bit hash based on the contents of this Data, after
-        normalizing any alphabetic characters to lowercase.
+        Creates a hash based on the contents of this Data, after
+        normalizing any ASCII alphabetic characters to lowercase.
       */
       size_t caseInsensitivehash() const;
 
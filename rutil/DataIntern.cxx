@@ -0,0 +1,133 @@
+#include "rutil/DataIntern.hxx"
+#include "rutil/AtomicCounter.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Mutex.hxx"
+
+using namespace resip;
+
+// Open addressing with linear probing, never more than half full, so every
+// probe sequence ends at an empty slot.  A slot is written once: the value
+// is complete (and the counter increment is a full barrier) before its
+// pointer is stored, so a reader that sees the pointer sees the value.
+static const size_t SlotCount = 2 * DataIntern::MaxEntries;
+static const Data* volatile slots[SlotCount];
+static AtomicCounter entries;
+static Mutex addMutex;
+
+static size_t
+probe(const Data& value, const Data*& found)
+{
+   size_t i = value.caseInsensitivehash() & (SlotCount - 1);
+   for (;;)
+   {
+      const Data* entry = slots[i];
+      if (entry == 0 ||
+          (entry->size() == value.size() && isEqualNoCase(*entry, value)))
+      {
+         found = entry;
+         return i;
+      }
+      i = (i + 1) & (SlotCount - 1);
+   }
+}
+
+const Data*
+DataIntern::find(const Data& value)
+{
+   const Data* found;
+   probe(value, found);
+   return found;
+}
+
+const Data*
+DataIntern::intern(const Data& value)
+{
+   return add(value, MaxEntries);
+}
+
+const Data*
+DataIntern::tryIntern(const Data& value)
+{
+   return add(value, MaxUntrustedEntries);
+}
+
+size_t
+DataIntern::size()
+{
+   return (size_t)entries.value();
+}
+
+const Data*
+DataIntern::add(const Data& value, size_t limit)
+{
+   const Data* found;
+   probe(value, found);
+   if (found)
+   {
+      return found;
+   }
+
+   Lock lock(addMutex); (void)lock;
+   // another thread may have added it since
+   size_t i = probe(value, found);
+   if (found || (size_t)entries.value() >= limit)
+   {
+      return found;
+   }
+
+   Data* entry = new Data(value.data(), value.size());
+   entry->lowercase();
+   entries.increment();
+   slots[i] = entry;
+   return entry;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
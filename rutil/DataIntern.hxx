@@ -0,0 +1,104 @@
+#ifndef RESIP_DataIntern_hxx
+#define RESIP_DataIntern_hxx
+
+#include "rutil/Data.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Process wide table of interned Data values, for tokens (host
+   names, domains) that are compared much more often than they change.
+
+   Values are compared without regard to case and stored lowercased, once;
+   the returned pointer stays valid for the life of the process.  Two
+   values are equal ignoring case exactly when their interned pointers are
+   equal, so callers can keep the pointer and compare it instead of the
+   string.
+
+   The table has a fixed capacity.  Lookups take no lock; adding a value
+   takes a Mutex.  Values from the network should be added with tryIntern(),
+   which stops early and so leaves room for intern() of configured names.
+*/
+class DataIntern
+{
+   public:
+      enum 
+      {
+         MaxEntries = 4096,
+         /// tryIntern() adds values while fewer than this many are interned
+         MaxUntrustedEntries = 3 * MaxEntries / 4
+      };
+
+      /// Returns the interned value equal to value ignoring case, adding it 
+      /// if needed; 0 only when the table is full.
+      static const Data* intern(const Data& value);
+
+      /// As intern(), but does not add value once MaxUntrustedEntries are in 
+      /// use.
+      static const Data* tryIntern(const Data& value);
+
+      /// Returns the interned value equal to value ignoring case, or 0; never 
+      /// adds.
+      static const Data* find(const Data& value);
+
+      /// Number of interned values.
+      static size_t size();
+
+   private:
+      static const Data* add(const Data& value, size_t limit);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 #include "rutil/DataStream.hxx"
 #include "rutil/Data.hxx"
 
@@ -71,6 +72,19 @@ size_t DataBuffer::putbuf(char ch)
    return 1;
 }
 #else
+void
+DataBuffer::catchUp(size_t len)
+{
+   // The Data may have been cleared or truncated while the stream was
+   // attached; the pending output belongs after what is left of it.
+   char* end = mStr.mBuf + mStr.mSize;
+   if (pbase() != end && len > 0)
+   {
+      assert(mStr.mBuf <= pbase() && end < pbase());
+      memmove(end, pbase(), len);
+   }
+}
+
 int
 DataBuffer::sync()
 {
@@ -78,6 +92,7 @@ DataBuffer::sync()
    if (len > 0)
    {
       size_t pos = gptr() - eback();  // remember the get position
+      catchUp(len);
       mStr.mSize += len;
       char* gbuf = const_cast<char*>(mStr.data());
       // reset the get buffer
@@ -98,6 +113,7 @@ DataBuffer::overflow(int c)
       size_t pos = gptr() - eback();  // remember the get position
 
       // update the length
+      catchUp(len);
       mStr.mSize += len;
 
       // resize the underlying Data and reset the input buffer
@@ -27,6 +27,7 @@ class DataBuffer :
 #ifdef RESIP_USE_STL_STREAMS
       virtual int sync();
       virtual int overflow(int c = -1);
+      void catchUp(size_t len);
 #else
       virtual size_t writebuf(const char *s, size_t count);
       virtual size_t readbuf(char *buf, size_t count);
@@ -14,6 +14,7 @@
 #include <time.h>
 
 #include "rutil/Log.hxx"
+#include "rutil/AsyncLogWriter.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/ThreadIf.hxx"
@@ -57,6 +58,7 @@ const char
 Log::mDescriptions[][32] = {"NONE", "EMERG", "ALERT", "CRIT", "ERR", "WARNING", "NOTICE", "INFO", "DEBUG", "STACK", "CERR", ""}; 
 
 Mutex Log::_mutex;
+AsyncLogWriter* volatile Log::mAsyncWriter = 0;
 
 extern "C"
 {
@@ -131,6 +133,9 @@ Log::initialize(Type type, Level level, const Data& appName,
                 const char * logFileName,
                 ExternalLogger* externalLogger)
 {
+   // records queued for the old settings go to the old destination
+   flushAsyncWriter();
+
    Lock lock(_mutex);
    mDefaultLoggerData.reset();   
    
@@ -217,7 +222,6 @@ Log::level(Log::LocalLoggerId loggerId)
    }
    else
    {
-      Lock lock(_mutex);
       level = mDefaultLoggerData.mLevel;
    }
    return level;
@@ -526,11 +530,14 @@ int Log::localLoggerReinitialize(Log::LocalLoggerId loggerId,
                                  const char * logFileName,
                                  ExternalLogger* externalLogger)
 {
+   flushAsyncWriter();
    return mLocalLoggerMap.reinitialize(loggerId, type, level, logFileName, externalLogger);
 }
 
 int Log::localLoggerRemove(Log::LocalLoggerId loggerId)
 {
+   // queued records refer to the logger
+   flushAsyncWriter();
    return mLocalLoggerMap.remove(loggerId);
 }
 
@@ -558,6 +565,53 @@ Log::Instance()
    return getLoggerData().Instance();
 }
 
+void
+Log::startAsyncWriter(unsigned int bufferSizePerThread)
+{
+   Lock lock(_mutex);
+   if (mAsyncWriter == 0)
+   {
+      AsyncLogWriter* writer = new AsyncLogWriter(bufferSizePerThread);
+      writer->run();
+      mAsyncWriter = writer;
+   }
+}
+
+void
+Log::stopAsyncWriter()
+{
+   AsyncLogWriter* writer;
+   {
+      Lock lock(_mutex);
+      writer = mAsyncWriter;
+      mAsyncWriter = 0;
+   }
+   if (writer)
+   {
+      // the writer takes _mutex while writing out the remaining records.  Logging threads may
+      // have read mAsyncWriter before it was cleared and still call it, so it is stopped - those
+      // calls then write their record themselves - but never freed.
+      writer->stop();
+   }
+}
+
+void
+Log::flushAsyncWriter()
+{
+   AsyncLogWriter* writer = mAsyncWriter;
+   if (writer)
+   {
+      writer->flush();
+   }
+}
+
+unsigned long
+Log::getAsyncDropCount()
+{
+   AsyncLogWriter* writer = mAsyncWriter;
+   return writer ? writer->getDropCount() : 0;
+}
+
 void 
 Log::reset()
 {
@@ -725,6 +779,13 @@ Log::Guard::~Guard()
       return;
    }
 
+   AsyncLogWriter* asyncWriter = resip::Log::mAsyncWriter;
+   if (asyncWriter && logType != resip::Log::VSDebugWindow &&
+       asyncWriter->log(&resip::Log::getLoggerData(), mLevel, mData) != AsyncLogWriter::Stopped)
+   {
+      return;
+   }
+
    resip::Lock lock(resip::Log::_mutex);
    // !dlb! implement VSDebugWindow as an external logger
    if (logType == resip::Log::VSDebugWindow)
@@ -794,6 +855,49 @@ Log::ThreadData::reset()
    mLogger = NULL;
 }
 
+void
+Log::ThreadData::write(const char* data, size_t size, unsigned int numLines)
+{
+   switch (mType)
+   {
+      case Log::Cerr:
+      case Log::Cout:
+      {
+         std::ostream& strm = (mType == Log::Cerr) ? std::cerr : std::cout;
+         strm.write(data, size);
+         strm.flush();
+         break;
+      }
+      case Log::File:
+      {
+         const char* fileName = mLogFileName.empty() ? "resiprocate.log" : mLogFileName.c_str();
+         if (mLogger == 0)
+         {
+            mLogger = new std::ofstream(fileName, std::ios_base::out | std::ios_base::trunc);
+            mLineCount = 0;
+         }
+         mLogger->write(data, size);
+         mLogger->flush();
+         mLineCount += numLines;
+
+         // a batch is never split, so the file may go over the limit by part of a batch
+         if (maxLineCount() && mLineCount >= maxLineCount())
+         {
+            // keep the full file around as <file>.1 - the next write starts a new one
+            delete mLogger;
+            mLogger = 0;
+            Data rotated(fileName);
+            rotated += ".1";
+            ::remove(rotated.c_str());
+            ::rename(fileName, rotated.c_str());
+         }
+         break;
+      }
+      default:
+         assert(0);
+   }
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
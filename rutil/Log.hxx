@@ -44,6 +44,7 @@ namespace resip
 
 class ExternalLogger;
 class Subsystem;
+class AsyncLogWriter;
 
 /**
    @brief Singleton that handles logging calls.
@@ -194,7 +195,7 @@ class Log
       /** @brief Return logging level for current thread.
       * If thread has no local logger attached, then return global logging level.
       */
-      static Level level() { Lock lock(_mutex); return getLoggerData().mLevel; }
+      static Level level() { return getLoggerData().mLevel; }
       /** Return logging level for given local logger. Use 0 to set global logging level. */
       static Level level(LocalLoggerId loggerId);
       static void setMaxLineCount(unsigned int maxLineCount);
@@ -251,6 +252,24 @@ class Log
       static void OutputToWin32DebugWindow(const Data& result);      
       static void reset(); ///< Frees logger stream
 
+      /** @brief Write log records from a background thread.
+      * Logging threads then queue their formatted records in a thread local
+      * buffer of bufferSizePerThread bytes instead of writing them, and never
+      * block on the log output.  Records that do not fit in the buffer are
+      * dropped (see getAsyncDropCount).  External loggers are still called
+      * from the logging thread.  VSDebugWindow logging is not affected.
+      */
+      static void startAsyncWriter(unsigned int bufferSizePerThread = 65536);
+      /** @brief Write out all queued records and go back to writing from the
+      * logging threads.  Other threads may keep logging while this is called; 
+      * the stopped writer is not freed, so a start/stop cycle costs one writer.
+      */
+      static void stopAsyncWriter();
+      /// Wait until all records queued by the async writer so far are written
+      static void flushAsyncWriter();
+      /// Number of records dropped because a thread's async buffer was full
+      static unsigned long getAsyncDropCount();
+
    public:
       static unsigned int MaxLineCount; ///< Left for compatibility for global logger
 
@@ -298,6 +317,9 @@ class Log
 
             std::ostream& Instance(); ///< Return logger stream instance, creating it if needed.
             void reset(); ///< Frees logger stream
+            /** Write numLines records at once (not for Syslog) - a File logger
+                is rotated to <file>.1 when it reaches its maximum line count. */
+            void write(const char* data, size_t size, unsigned int numLines);
 
             volatile Level mLevel;
             volatile unsigned int mMaxLineCount;
@@ -305,6 +327,7 @@ class Log
 
          protected:
             friend class Guard;
+            friend class AsyncLogWriter;
             const LocalLoggerId mId;
             Type mType;
             Data mLogFileName;
@@ -312,6 +335,9 @@ class Log
             unsigned int mLineCount;
       };
 
+      friend class AsyncLogWriter;
+      static AsyncLogWriter* volatile mAsyncWriter;
+
       static ThreadData mDefaultLoggerData; ///< Default logger settings.
       static Data mAppName;
       static Data mHostname;
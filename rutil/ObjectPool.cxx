@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cassert>
+
+#include "rutil/ObjectPool.hxx"
+#include "rutil/Lock.hxx"
+
+using namespace resip;
+
+namespace
+{
+// registry of every pool, for dump(); pools are never destroyed
+Mutex& registryMutex()
+{
+   static Mutex* mutex = new Mutex;
+   return *mutex;
+}
+
+std::vector<ObjectPool*>& registry()
+{
+   static std::vector<ObjectPool*>* pools = new std::vector<ObjectPool*>;
+   return *pools;
+}
+
+size_t 
+roundToSlot(size_t bytes)
+{
+   const size_t align = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+   return (bytes + align - 1) / align * align;
+}
+}
+
+extern "C"
+{
+   static void releaseObjectPoolCache(void* cache)
+   {
+      ObjectPool::releaseThreadCache(cache);
+   }
+}
+
+ObjectPool::ObjectPool(const char* name, size_t objectSize, size_t objectsPerChunk)
+   : mName(name),
+     mObjectSize(objectSize),
+     mSlotSize(roundToSlot(objectSize < sizeof(FreeNode) ? sizeof(FreeNode) : objectSize)),
+     mObjectsPerChunk(objectsPerChunk ? objectsPerChunk : 1),
+     mFreeList(0),
+     mInUse(0)
+{
+   ThreadIf::tlsKeyCreate(mCacheKey, releaseObjectPoolCache);
+   Lock lock(registryMutex()); (void)lock;
+   registry().push_back(this);
+}
+
+ObjectPool::~ObjectPool()
+{
+   assert(0);
+}
+
+void*
+ObjectPool::allocate(size_t bytes)
+{
+   if (bytes != mObjectSize)
+   {
+      return ::operator new(bytes);
+   }
+
+   ThreadCache* cache = threadCache();
+   if (!cache->mFreeList)
+   {
+      refill(*cache);
+   }
+   FreeNode* node = cache->mFreeList;
+   cache->mFreeList = node->next;
+   --cache->mCount;
+   return node;
+}
+
+void
+ObjectPool::deallocate(void* addr, size_t bytes)
+{
+   if (!addr)
+   {
+      return;
+   }
+   if (bytes != mObjectSize)
+   {
+      ::operator delete(addr);
+      return;
+   }
+
+   ThreadCache* cache = threadCache();
+   FreeNode* node = static_cast<FreeNode*>(addr);
+   node->next = cache->mFreeList;
+   cache->mFreeList = node;
+   // a thread that only frees (e.g. objects handed over by another thread)
+   // gives them back a batch at a time
+   if (++cache->mCount >= 2 * CacheBatch)
+   {
+      spill(*cache, CacheBatch);
+   }
+}
+
+ObjectPool::ThreadCache*
+ObjectPool::threadCache()
+{
+   ThreadCache* cache = static_cast<ThreadCache*>(ThreadIf::tlsGetValue(mCacheKey));
+   if (!cache)
+   {
+      cache = new ThreadCache;
+      cache->mPool = this;
+      cache->mFreeList = 0;
+      cache->mCount = 0;
+      {
+         Lock lock(mMutex); (void)lock;
+         mCaches.push_back(cache);
+      }
+      ThreadIf::tlsSetValue(mCacheKey, cache);
+   }
+   return cache;
+}
+
+void
+ObjectPool::refill(ThreadCache& cache)
+{
+   Lock lock(mMutex); (void)lock;
+   for (size_t i = 0; i < CacheBatch; ++i)
+   {
+      if (!mFreeList)
+      {
+         grow();
+      }
+      FreeNode* node = mFreeList;
+      mFreeList = node->next;
+      node->next = cache.mFreeList;
+      cache.mFreeList = node;
+      ++cache.mCount;
+      ++mInUse;
+   }
+}
+
+void
+ObjectPool::spill(ThreadCache& cache, size_t count)
+{
+   Lock lock(mMutex); (void)lock;
+   for (size_t i = 0; i < count && cache.mFreeList; ++i)
+   {
+      FreeNode* node = cache.mFreeList;
+      cache.mFreeList = node->next;
+      --cache.mCount;
+      node->next = mFreeList;
+      mFreeList = node;
+      assert(mInUse > 0);
+      --mInUse;
+   }
+}
+
+void
+ObjectPool::releaseThreadCache(void* arg)
+{
+   ThreadCache* cache = static_cast<ThreadCache*>(arg);
+   ObjectPool* pool = cache->mPool;
+   pool->spill(*cache, cache->mCount);
+   {
+      Lock lock(pool->mMutex); (void)lock;
+      pool->mCaches.erase(std::find(pool->mCaches.begin(), pool->mCaches.end(), cache));
+   }
+   delete cache;
+}
+
+void
+ObjectPool::grow()
+{
+   char* chunk = static_cast<char*>(::operator new(mSlotSize * mObjectsPerChunk));
+   mChunks.push_back(chunk);
+   // thread the free list through the new chunk, lowest address first
+   for (size_t i = mObjectsPerChunk; i > 0; --i)
+   {
+      FreeNode* node = reinterpret_cast<FreeNode*>(chunk + (i - 1) * mSlotSize);
+      node->next = mFreeList;
+      mFreeList = node;
+   }
+}
+
+size_t
+ObjectPool::inUse() const
+{
+   Lock lock(mMutex); (void)lock;
+   size_t cached = 0;
+   for (std::vector<ThreadCache*>::const_iterator i = mCaches.begin(); i != mCaches.end(); ++i)
+   {
+      cached += (*i)->mCount;
+   }
+   // the caches' counts are read while their threads may be changing them
+   return cached < mInUse ? mInUse - cached : 0;
+}
+
+size_t
+ObjectPool::capacity() const
+{
+   Lock lock(mMutex); (void)lock;
+   return mChunks.size() * mObjectsPerChunk;
+}
+
+size_t
+ObjectPool::bytesReserved() const
+{
+   return capacity() * mSlotSize;
+}
+
+void
+ObjectPool::dump(EncodeStream& strm)
+{
+   Lock lock(registryMutex()); (void)lock;
+   for (std::vector<ObjectPool*>::const_iterator i = registry().begin(); 
+        i != registry().end(); ++i)
+   {
+      strm << (*i)->name() << " size=" << (*i)->objectSize()
+           << " inUse=" << (*i)->inUse()
+           << " capacity=" << (*i)->capacity()
+           << " bytes=" << (*i)->bytesReserved() << "\n";
+   }
+}
+
+size_t
+ObjectPool::totalBytesReserved()
+{
+   Lock lock(registryMutex()); (void)lock;
+   size_t total = 0;
+   for (std::vector<ObjectPool*>::const_iterator i = registry().begin(); 
+        i != registry().end(); ++i)
+   {
+      total += (*i)->bytesReserved();
+   }
+   return total;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,171 @@
+#if !defined(RESIP_OBJECTPOOL_HXX)
+#define RESIP_OBJECTPOOL_HXX
+
+#include <cstddef>
+#include <vector>
+
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/resipfaststreams.hxx"
+
+/** Serves fixed size allocations for one class from a free list carved out
+    of large chunks. Place RESIP_ObjectPool(ClassName) in the public section
+    of the class; only allocations of exactly sizeof(ClassName) come from the
+    pool, so derived classes transparently fall back to the global heap.
+
+    Each thread keeps a small cache of free objects in front of the shared
+    free list, so allocation and deallocation normally take no lock; the
+    pool's mutex is only taken to move a batch of objects between a thread's
+    cache and the shared list, or to grow.  Objects may be freed by a thread
+    other than the one that allocated them.  A thread's cache goes back to
+    the shared list when the thread exits.
+
+    Chunks are never returned to the system; the pool keeps its high water
+    mark, which gives long running servers a predictable footprint.
+
+    Define RESIP_NO_OBJECT_POOL at compile time to disable (e.g. when running
+    under a memory checker).
+*/
+#ifndef RESIP_NO_OBJECT_POOL
+#define RESIP_ObjectPool(type_)                                                 \
+      static resip::ObjectPool& objectPool()                                    \
+      {                                                                         \
+         static resip::ObjectPool* pool = new resip::ObjectPool(#type_, sizeof(type_)); \
+         return *pool;                                                          \
+      }                                                                         \
+      static void* operator new (size_t bytes)                                  \
+      {                                                                         \
+         return objectPool().allocate(bytes);                                   \
+      }                                                                         \
+      static void* operator new (size_t bytes, void* p)                         \
+      {                                                                         \
+         return p;                                                              \
+      }                                                                         \
+      static void operator delete (void* addr, size_t bytes)                    \
+      {                                                                         \
+         objectPool().deallocate(addr, bytes);                                  \
+      }
+#else
+#define RESIP_ObjectPool(type_)
+#endif
+
+namespace resip
+{
+
+class ObjectPool
+{
+   public:
+      ObjectPool(const char* name, size_t objectSize, size_t objectsPerChunk = 64);
+
+      void* allocate(size_t bytes);
+      void deallocate(void* addr, size_t bytes);
+
+      const char* name() const { return mName; }
+      size_t objectSize() const { return mObjectSize; }
+      // objects currently handed out by this pool; only exact while no
+      // other thread is using the pool
+      size_t inUse() const;
+      // objects the pool has room for without growing
+      size_t capacity() const;
+      size_t bytesReserved() const;
+
+      /// writes one line per pool created in this process
+      static void dump(EncodeStream& strm);
+      static size_t totalBytesReserved();
+
+      /// TLS destructor - returns an exiting thread's cached objects to its pool
+      static void releaseThreadCache(void* cache);
+
+   private:
+      // never destroyed; objects may outlive static destruction
+      ~ObjectPool();
+
+      struct FreeNode
+      {
+         FreeNode* next;
+      };
+
+      // free objects owned by one thread - only that thread touches the
+      // list, mCount is also read by inUse()
+      struct ThreadCache
+      {
+         ObjectPool* mPool;
+         FreeNode* mFreeList;
+         volatile size_t mCount;
+      };
+
+      // objects moved between a thread's cache and the shared list at a time
+      static const size_t CacheBatch = 32;
+
+      ThreadCache* threadCache();
+      void refill(ThreadCache& cache);
+      void spill(ThreadCache& cache, size_t count);
+      void grow();
+
+
+      const char* mName;
+      const size_t mObjectSize;
+      const size_t mSlotSize;
+      const size_t mObjectsPerChunk;
+      mutable Mutex mMutex;
+      FreeNode* mFreeList;
+      std::vector<char*> mChunks;
+      // objects not on the shared free list, including those in thread caches
+      size_t mInUse;
+      ThreadIf::TlsKey mCacheKey;
+      std::vector<ThreadCache*> mCaches;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -4,6 +4,7 @@
 
 #include <cassert>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef WIN32
 #include "rutil/Socket.hxx"
@@ -14,6 +15,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #endif
 
 #include "rutil/Random.hxx"
@@ -21,6 +23,8 @@
 #include "rutil/Mutex.hxx"
 #include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/compat.hxx"
 
 
 #ifdef USE_SSL
@@ -52,6 +56,239 @@ bool Random::mIsInitialized = false;
 Random::Initializer Random::mInitializer;
 #endif
 
+namespace
+{
+
+// Per-thread generator behind the getRandom family: the ChaCha20 block
+// function (RFC 7539) run in counter mode over a key drawn from the system
+// random source.
+class RandomStream
+{
+   public:
+      RandomStream(unsigned int generation) : mGeneration(generation)
+      {
+         rekey();
+      }
+
+      void fill(unsigned char* buf, unsigned int len)
+      {
+         while (len > 0)
+         {
+            if (mUsed == sizeof(mBlock))
+            {
+               refill();
+            }
+            unsigned int n = sizeof(mBlock) - mUsed;
+            if (n > len)
+            {
+               n = len;
+            }
+            memcpy(buf, mBlock + mUsed, n);
+            // handed out bytes are not kept around
+            memset(mBlock + mUsed, 0, n);
+            mUsed += n;
+            buf += n;
+            len -= n;
+         }
+      }
+
+      // a forked child would otherwise repeat its parent's stream
+      void checkGeneration(unsigned int generation)
+      {
+         if (generation != mGeneration)
+         {
+            mGeneration = generation;
+            rekey();
+         }
+      }
+
+   private:
+      static UInt32 rotate(UInt32 v, int c)
+      {
+         return (v << c) | (v >> (32 - c));
+      }
+
+      static void quarterRound(UInt32* x, int a, int b, int c, int d)
+      {
+         x[a] += x[b]; x[d] = rotate(x[d] ^ x[a], 16);
+         x[c] += x[d]; x[b] = rotate(x[b] ^ x[c], 12);
+         x[a] += x[b]; x[d] = rotate(x[d] ^ x[a], 8);
+         x[c] += x[d]; x[b] = rotate(x[b] ^ x[c], 7);
+      }
+
+      void rekey();
+
+      void refill()
+      {
+         UInt32 x[16];
+         memcpy(x, mState, sizeof(x));
+         for (int i = 0; i < 10; ++i)
+         {
+            quarterRound(x, 0, 4, 8, 12);
+            quarterRound(x, 1, 5, 9, 13);
+            quarterRound(x, 2, 6, 10, 14);
+            quarterRound(x, 3, 7, 11, 15);
+            quarterRound(x, 0, 5, 10, 15);
+            quarterRound(x, 1, 6, 11, 12);
+            quarterRound(x, 2, 7, 8, 13);
+            quarterRound(x, 3, 4, 9, 14);
+         }
+         for (int i = 0; i < 16; ++i)
+         {
+            const UInt32 v = x[i] + mState[i];
+            mBlock[4*i] = (unsigned char)v;
+            mBlock[4*i+1] = (unsigned char)(v >> 8);
+            mBlock[4*i+2] = (unsigned char)(v >> 16);
+            mBlock[4*i+3] = (unsigned char)(v >> 24);
+         }
+         // 64 bit block counter, words 14 and 15 hold the nonce
+         if (++mState[12] == 0)
+         {
+            ++mState[13];
+         }
+         mUsed = 0;
+      }
+
+      UInt32 mState[16];
+      unsigned char mBlock[64];
+      unsigned int mUsed;
+      unsigned int mGeneration;
+};
+
+void
+systemRandom(unsigned char* buf, unsigned int len)
+{
+#if ( USE_OPENSSL == 1 )
+   if (RAND_bytes(buf, len) == 1)
+   {
+      return;
+   }
+   ErrLog( << "RAND_bytes failed, falling back to the system random source" );
+#endif
+#ifndef WIN32
+   int fd = open("/dev/urandom", O_RDONLY);
+   if (fd != -1)
+   {
+      unsigned int got = 0;
+      while (got < len)
+      {
+         ssize_t s = read(fd, buf + got, len - got);
+         if (s <= 0)
+         {
+            break;
+         }
+         got += (unsigned int)s;
+      }
+      ::close(fd);
+      if (got == len)
+      {
+         return;
+      }
+      ErrLog( << "System is short of randomness" );
+   }
+   else
+   {
+      ErrLog( << "Could not open /dev/urandom" );
+   }
+#endif
+   // last resort: the libc generator seeded by Random::initialize, mixed
+   // with the clock
+   UInt64 now = Timer::getTimeMicroSec();
+   for (unsigned int i = 0; i < len; ++i)
+   {
+#ifdef WIN32
+      buf[i] = (unsigned char)(rand() ^ (now >> (8*(i%8))));
+#else
+      buf[i] = (unsigned char)(random() ^ (now >> (8*(i%8))));
+#endif
+   }
+}
+
+void
+RandomStream::rekey()
+{
+   // "expand 32-byte k"
+   mState[0] = 0x61707865;
+   mState[1] = 0x3320646e;
+   mState[2] = 0x79622d32;
+   mState[3] = 0x6b206574;
+
+   unsigned char seed[40];
+   systemRandom(seed, sizeof(seed));
+   for (int i = 0; i < 10; ++i)
+   {
+      mState[4+i] = (UInt32)seed[4*i] | ((UInt32)seed[4*i+1] << 8) |
+         ((UInt32)seed[4*i+2] << 16) | ((UInt32)seed[4*i+3] << 24);
+   }
+   memset(seed, 0, sizeof(seed));
+
+   // the seed filled key and nonce words 4 to 13; move the nonce up to
+   // 14 and 15 and start the block counter at 0
+   mState[14] = mState[12];
+   mState[15] = mState[13];
+   mState[12] = 0;
+   mState[13] = 0;
+
+   mUsed = sizeof(mBlock);
+}
+
+ThreadIf::TlsKey* streamKey = 0;
+volatile unsigned int forkGeneration = 0;
+
+void
+freeStream(void* stream)
+{
+   delete static_cast<RandomStream*>(stream);
+}
+
+#ifndef WIN32
+void
+childAfterFork()
+{
+   ++forkGeneration;
+}
+#endif
+
+}
+
+unsigned int RandomStaticInitializer::mInstanceCounter=0;
+RandomStaticInitializer::RandomStaticInitializer()
+{
+   if (mInstanceCounter++ == 0)
+   {
+      streamKey = new ThreadIf::TlsKey;
+      ThreadIf::tlsKeyCreate(*streamKey, freeStream);
+#ifndef WIN32
+      pthread_atfork(0, 0, childAfterFork);
+#endif
+   }
+}
+RandomStaticInitializer::~RandomStaticInitializer()
+{
+   if (--mInstanceCounter == 0)
+   {
+      ThreadIf::tlsKeyDelete(*streamKey);
+      delete streamKey;
+   }
+}
+
+void
+Random::getStreamRandom(unsigned char* buf, unsigned int len)
+{
+   RandomStream* stream = static_cast<RandomStream*>(ThreadIf::tlsGetValue(*streamKey));
+   if (stream == 0)
+   {
+      initialize();
+      stream = new RandomStream(forkGeneration);
+      ThreadIf::tlsSetValue(*streamKey, stream);
+   }
+   else
+   {
+      stream->checkGeneration(forkGeneration);
+   }
+   stream->fill(buf, len);
+}
+
 void
 Random::initialize()
 {  
@@ -156,19 +393,10 @@ Random::initialize()
 int
 Random::getRandom()
 {
-   initialize();
-
-#ifdef WIN32
-   assert( RAND_MAX == 0x7fff );
-   int r1 = rand();
-   int r2 = rand();
-
-   int ret = (r1<<16) + r2;
-
-   return ret;
-#else
-   return random(); 
-#endif
+   UInt32 ret;
+   getStreamRandom((unsigned char*)&ret, sizeof(ret));
+   // same range as random(), callers take it modulo
+   return (int)(ret & 0x7fffffff);
 }
 
 int
@@ -199,20 +427,11 @@ Random::getCryptoRandom()
 Data 
 Random::getRandom(unsigned int len)
 {
-   initialize();
    assert(len < Random::maxLength+1);
-   
-   union 
-   {
-         char cbuf[Random::maxLength+1];
-         unsigned int  ibuf[(Random::maxLength+1)/sizeof(int)];
-   };
-   
-   for (unsigned int count=0; count<(len+sizeof(int)-1)/sizeof(int); ++count)
-   {
-      ibuf[count] = Random::getRandom();
-   }
-   return Data(cbuf, len);
+
+   unsigned char buf[Random::maxLength];
+   getStreamRandom(buf, len);
+   return Data((const char*)buf, len);
 }
 
 Data 
@@ -237,14 +456,31 @@ Random::getCryptoRandom(unsigned int len)
 Data 
 Random::getRandomHex(unsigned int numBytes)
 {
-   initialize();
-   return Random::getRandom(numBytes).hex();
+   Data ret(2*numBytes, Data::Preallocate);
+   appendRandomHex(ret, numBytes);
+   return ret;
+}
+
+void
+Random::appendRandomHex(Data& target, unsigned int numBytes)
+{
+   static const char hexmap[] = "0123456789abcdef";
+   assert(numBytes < Random::maxLength+1);
+
+   unsigned char buf[Random::maxLength];
+   char hex[2*Random::maxLength];
+   getStreamRandom(buf, numBytes);
+   for (unsigned int i = 0; i < numBytes; ++i)
+   {
+      hex[2*i] = hexmap[buf[i] >> 4];
+      hex[2*i+1] = hexmap[buf[i] & 0xf];
+   }
+   target.append(hex, 2*numBytes);
 }
 
 Data 
 Random::getRandomBase64(unsigned int numBytes)
 {
-   initialize();
    return Random::getRandom(numBytes).base64encode();
 }
 
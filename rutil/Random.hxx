@@ -18,11 +18,21 @@ class Random
       static void initialize();
 
       enum {maxLength = 512};
-      
+
+      // The getRandom family draws from a ChaCha20 keystream kept per
+      // thread, keyed from the system random source the first time the
+      // thread asks. After that, no lock is taken and no system call is
+      // made, so threads generating tags and branches do not contend.
       static Data getRandom(unsigned int numBytes);
       static Data getRandomHex(unsigned int numBytes); // actual length is 2*numBytes
       static Data getRandomBase64(unsigned int numBytes); // actual length is 1.5*numBytes
 
+      /**
+        Appends 2*numBytes random hex digits to target, encoding straight
+        from the keystream into target without a temporary Data.
+      */
+      static void appendRandomHex(Data& target, unsigned int numBytes);
+
       static Data getCryptoRandom(unsigned int numBytes);
       static Data getCryptoRandomHex(unsigned int numBytes); // actual length is 2*numBytes
       static Data getCryptoRandomBase64(unsigned int numBytes); // actual length is 1.5*numBytes
@@ -44,6 +54,8 @@ class Random
       static int  getCryptoRandom();
 
    private:
+      static void getStreamRandom(unsigned char* buf, unsigned int len);
+
       static Mutex mMutex;
       static bool  mIsInitialized;
       
@@ -64,6 +76,16 @@ class Random
 #endif
       
 };
+
+/// Creates the key of the per-thread streams before any thread can ask for random data
+class RandomStaticInitializer {
+public:
+   RandomStaticInitializer();
+   ~RandomStaticInitializer();
+protected:
+   static unsigned int mInstanceCounter;
+};
+static RandomStaticInitializer _staticRandomInit;
  
 }
 
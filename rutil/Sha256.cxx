@@ -0,0 +1,180 @@
+#include <string.h>
+
+#include "rutil/Sha256.hxx"
+
+using namespace resip;
+
+static const u_int32_t K[64] =
+{
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void
+sha256Transform(u_int32_t state[8], const unsigned char block[64])
+{
+   u_int32_t w[64];
+   for (int i = 0; i < 16; ++i)
+   {
+      w[i] = ((u_int32_t)block[i*4] << 24) | ((u_int32_t)block[i*4+1] << 16) |
+             ((u_int32_t)block[i*4+2] << 8) | (u_int32_t)block[i*4+3];
+   }
+   for (int i = 16; i < 64; ++i)
+   {
+      u_int32_t s0 = ROTR(w[i-15], 7) ^ ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+      u_int32_t s1 = ROTR(w[i-2], 17) ^ ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+      w[i] = w[i-16] + s0 + w[i-7] + s1;
+   }
+
+   u_int32_t a = state[0], b = state[1], c = state[2], d = state[3];
+   u_int32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+   for (int i = 0; i < 64; ++i)
+   {
+      u_int32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      u_int32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+   }
+
+   state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+   state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void
+resip::Sha256Init(struct Sha256Context* ctx)
+{
+   ctx->state[0] = 0x6a09e667;
+   ctx->state[1] = 0xbb67ae85;
+   ctx->state[2] = 0x3c6ef372;
+   ctx->state[3] = 0xa54ff53a;
+   ctx->state[4] = 0x510e527f;
+   ctx->state[5] = 0x9b05688c;
+   ctx->state[6] = 0x1f83d9ab;
+   ctx->state[7] = 0x5be0cd19;
+   ctx->bytes = 0;
+}
+
+void
+resip::Sha256Update(struct Sha256Context* ctx, unsigned char const* buf, unsigned len)
+{
+   unsigned int used = (unsigned int)(ctx->bytes & 0x3f);
+   ctx->bytes += len;
+
+   if (used)
+   {
+      unsigned int avail = 64 - used;
+      if (len < avail)
+      {
+         memcpy(ctx->in + used, buf, len);
+         return;
+      }
+      memcpy(ctx->in + used, buf, avail);
+      sha256Transform(ctx->state, ctx->in);
+      buf += avail;
+      len -= avail;
+   }
+
+   while (len >= 64)
+   {
+      sha256Transform(ctx->state, buf);
+      buf += 64;
+      len -= 64;
+   }
+
+   memcpy(ctx->in, buf, len);
+}
+
+void
+resip::Sha256Final(unsigned char digest[32], struct Sha256Context* ctx)
+{
+   UInt64 bits = ctx->bytes << 3;
+   unsigned int used = (unsigned int)(ctx->bytes & 0x3f);
+
+   ctx->in[used++] = 0x80;
+   if (used > 56)
+   {
+      memset(ctx->in + used, 0, 64 - used);
+      sha256Transform(ctx->state, ctx->in);
+      used = 0;
+   }
+   memset(ctx->in + used, 0, 56 - used);
+   for (int i = 0; i < 8; ++i)
+   {
+      ctx->in[63 - i] = (unsigned char)(bits >> (i * 8));
+   }
+   sha256Transform(ctx->state, ctx->in);
+
+   for (int i = 0; i < 8; ++i)
+   {
+      digest[i*4] = (unsigned char)(ctx->state[i] >> 24);
+      digest[i*4+1] = (unsigned char)(ctx->state[i] >> 16);
+      digest[i*4+2] = (unsigned char)(ctx->state[i] >> 8);
+      digest[i*4+3] = (unsigned char)ctx->state[i];
+   }
+   memset(ctx, 0, sizeof(*ctx));
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
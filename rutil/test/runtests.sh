@@ -19,6 +19,7 @@ for i in \
 	testIntrusiveList \
 	testLogger \
 	testMD5Stream \
+	testObjectPool \
 	testRandomHex \
 	testSHA1Stream \
 	testThreadIf;
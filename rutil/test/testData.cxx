@@ -1286,6 +1286,85 @@ class TestData
             assert(  Data("1234567" ).base64encode() == d7 );
          }
          
+         {
+            assert(Data("Content-Length").caseInsensitivehash() ==
+                   Data("content-LENGTH").caseInsensitivehash());
+            assert(Data("z9hG4bK74bf9").caseInsensitivehash() ==
+                   Data("Z9HG4BK74BF9").caseInsensitivehash());
+            assert(Data("[").caseInsensitivehash() != Data("{").caseInsensitivehash());
+            assert(Data("@").caseInsensitivehash() != Data("`").caseInsensitivehash());
+            assert(Data("\xc1").caseInsensitivehash() != Data("\xe1").caseInsensitivehash());
+            assert(Data("alice").hash() != Data("Alice").hash());
+            assert(Data("alice").hash() != Data("alice ").hash());
+            assert(Data::Empty.hash() != Data("\0", 1).hash());
+
+            Data longer("sip:alice@atlanta.example.com;transport=tcp");
+            for (Data::size_type i = 0; i <= longer.size(); ++i)
+            {
+               Data prefix(longer.data(), i);
+               Data upper(prefix);
+               upper.uppercase();
+               assert(prefix.hash() == Data(prefix.data(), prefix.size()).hash());
+               assert(prefix.caseInsensitivehash() == upper.caseInsensitivehash());
+               if (i > 0)
+               {
+                  assert(prefix.hash() != Data(longer.data(), i - 1).hash());
+               }
+            }
+         }
+
+#ifdef RESIP_HAS_RVALUE_REFS
+         {
+            Data big("a value that is far too long for the local buffer");
+            const char* buf = big.data();
+            Data moved(std::move(big));
+            assert(moved.data() == buf);
+            assert(moved == "a value that is far too long for the local buffer");
+            assert(big.empty());
+            big = "reusable";
+            assert(big == "reusable");
+
+            Data small("tag");
+            Data movedSmall(std::move(small));
+            assert(movedSmall == "tag");
+            assert(small.empty());
+
+            Data target("short");
+            target = std::move(moved);
+            assert(target.data() == buf);
+            assert(moved.empty());
+
+            Data heap("another value that must live on the heap");
+            target = std::move(heap);
+            assert(target == "another value that must live on the heap");
+            assert(heap.empty());
+
+            const char* txt = "shared";
+            Data shared(Data::Share, txt, strlen(txt));
+            Data fromShared(std::move(shared));
+            assert(fromShared.data() == txt);
+            assert(shared.empty());
+
+            Data shared2(Data::Share, txt, strlen(txt));
+            target = std::move(shared2);
+            assert(target == "shared");
+            assert(target.data() != txt);
+            assert(shared2.empty());
+
+            char external[64];
+            Data borrowed(Data::Borrow, external, sizeof(external));
+            borrowed = std::move(target);
+            assert(borrowed == "shared");
+            assert(borrowed.data() == external);
+            assert(target.empty());
+
+            Data self("self");
+            Data& alias = self;
+            self = std::move(alias);
+            assert(self == "self");
+         }
+#endif
+
          std::cerr << "All OK" << endl;
          return 0;
       }
@@ -0,0 +1,161 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/DataIntern.hxx"
+#include "rutil/ThreadIf.hxx"
+
+using namespace resip;
+using namespace std;
+
+static const int NamesPerThread = 500;
+
+static Data
+name(int i)
+{
+   return Data("host") + Data(i) + ".example.com";
+}
+
+class InternThread : public ThreadIf
+{
+   public:
+      InternThread(int offset)
+         : mOffset(offset)
+      {
+         mFound.resize(NamesPerThread);
+      }
+
+      void thread()
+      {
+         // threads overlap on half of their names
+         for (int i = 0; i < NamesPerThread; ++i)
+         {
+            mFound[i] = DataIntern::tryIntern(name(mOffset + i));
+         }
+      }
+
+      int mOffset;
+      vector<const Data*> mFound;
+};
+
+int
+main()
+{
+   {
+      assert(DataIntern::size() == 0);
+      assert(DataIntern::find("atlanta.example.com") == 0);
+
+      const Data* atlanta = DataIntern::intern("Atlanta.Example.COM");
+      assert(atlanta);
+      assert(*atlanta == "atlanta.example.com");
+      assert(DataIntern::intern("atlanta.example.com") == atlanta);
+      assert(DataIntern::find("ATLANTA.example.com") == atlanta);
+      assert(DataIntern::tryIntern("atlanta.EXAMPLE.com") == atlanta);
+
+      const Data* biloxi = DataIntern::tryIntern("biloxi.example.com");
+      assert(biloxi && biloxi != atlanta);
+      assert(DataIntern::find("biloxi.example.co") == 0);
+      assert(DataIntern::find(Data::Empty) == 0);
+      assert(DataIntern::size() == 2);
+   }
+
+   {
+      vector<InternThread*> threads;
+      for (int t = 0; t < 4; ++t)
+      {
+         threads.push_back(new InternThread(t * NamesPerThread / 2));
+         threads.back()->run();
+      }
+      for (int t = 0; t < 4; ++t)
+      {
+         threads[t]->join();
+      }
+      for (int t = 0; t < 4; ++t)
+      {
+         for (int i = 0; i < NamesPerThread; ++i)
+         {
+            const Data* found = threads[t]->mFound[i];
+            assert(found);
+            assert(*found == name(threads[t]->mOffset + i));
+            assert(DataIntern::find(name(threads[t]->mOffset + i)) == found);
+         }
+         delete threads[t];
+      }
+      assert(DataIntern::size() == 2 + 5 * NamesPerThread / 2);
+   }
+
+   {
+      // untrusted values stop early, leaving room for configured ones
+      int i = 0;
+      while (DataIntern::tryIntern(Data("untrusted") + Data(i)))
+      {
+         ++i;
+      }
+      assert(DataIntern::size() == DataIntern::MaxUntrustedEntries);
+      assert(DataIntern::tryIntern("atlanta.example.com") != 0);
+
+      const Data* configured = DataIntern::intern("configured.example.com");
+      assert(configured);
+      assert(DataIntern::find("Configured.Example.com") == configured);
+
+      while (DataIntern::intern(Data("configured") + Data(i)))
+      {
+         ++i;
+      }
+      assert(DataIntern::size() == DataIntern::MaxEntries);
+      assert(DataIntern::find("configured.example.com") == configured);
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
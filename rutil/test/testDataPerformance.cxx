@@ -1,12 +1,247 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "rutil/Data.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/ParseBuffer.hxx"
 #include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
 
 using namespace resip;
+using namespace std;
 
-int 
-main()
+// every heap allocation made by the process; this test is single threaded
+static unsigned long allocations = 0;
+
+void*
+operator new(size_t size)
+{
+   ++allocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void*
+operator new[](size_t size)
+{
+   ++allocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void
+operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void
+operator delete[](void* p) throw()
+{
+   free(p);
+}
+
+static const char* typicalInvite =
+   "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+   "Via: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf9\r\n"
+   "Max-Forwards: 70\r\n"
+   "From: Alice <sip:alice@atlanta.example.com>;tag=9fxced76sl\r\n"
+   "To: Bob <sip:bob@biloxi.example.com>\r\n"
+   "Call-ID: 3848276298220188511@atlanta.example.com\r\n"
+   "CSeq: 1 INVITE\r\n"
+   "Contact: <sip:alice@client.atlanta.example.com;transport=tcp>\r\n"
+   "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, UPDATE\r\n"
+   "Supported: replaces, timer\r\n"
+   "User-Agent: resip/1.0\r\n"
+   "Content-Type: application/sdp\r\n"
+   "Content-Length: 151\r\n"
+   "\r\n"
+   "v=0\r\n"
+   "o=alice 2890844526 2890844526 IN IP4 client.atlanta.example.com\r\n"
+   "s=-\r\n"
+   "c=IN IP4 192.0.2.101\r\n"
+   "t=0 0\r\n"
+   "m=audio 49172 RTP/AVP 0\r\n"
+   "a=rtpmap:0 PCMU/8000\r\n";
+
+static const char* delimiters = " \t\r\n;:<>@=,\"/?";
+
+// Splits the headers of msg into the pieces a SIP parser keeps (header
+// names, users, hosts, ports, parameter names and values) and copies each
+// one, as copying a message or building a response from a request does.
+static void
+parse(const Data& msg, vector<Data>& tokens, Data& body)
+{
+   Data::size_type bodyStart = msg.find("\r\n\r\n");
+   assert(bodyStart != Data::npos);
+
+   ParseBuffer pb(msg.data(), bodyStart);
+   Data token;
+   while (!pb.eof())
+   {
+      while (!pb.eof() && strchr(delimiters, *pb.position()))
+      {
+         pb.skipChar();
+      }
+      if (pb.eof())
+      {
+         break;
+      }
+      const char* start = pb.position();
+      pb.skipToOneOf(delimiters);
+      pb.data(token, start);
+      tokens.push_back(token);
+   }
+
+   body = msg.substr(bodyStart + 4);
+}
+
+static void
+encode(const vector<Data>& tokens, const Data& body, Data& out)
+{
+   DataStream strm(out);
+   for (vector<Data>::const_iterator i = tokens.begin(); i != tokens.end(); ++i)
+   {
+      strm << *i << ' ';
+   }
+   strm << "\r\n\r\n" << body;
+   strm.flush();
+}
+
+static void
+reportTokenLengths(const vector<Data>& tokens)
+{
+   const Data::size_type limits[] = {8, 16, RESIP_DATA_LOCAL_SIZE, 32, 64};
+   cerr << "sizeof(Data)=" << sizeof(Data) 
+        << " RESIP_DATA_LOCAL_SIZE=" << RESIP_DATA_LOCAL_SIZE << endl;
+   cerr << tokens.size() << " tokens in a typical INVITE:";
+   for (size_t l = 0; l < sizeof(limits)/sizeof(*limits); ++l)
+   {
+      size_t fit = 0;
+      for (vector<Data>::const_iterator i = tokens.begin(); i != tokens.end(); ++i)
+      {
+         if (i->size() <= limits[l])
+         {
+            ++fit;
+         }
+      }
+      cerr << " <=" << limits[l] << ": " << (100 * fit) / tokens.size() << "%";
+   }
+   cerr << endl;
+}
+
+static void
+testInvite()
+{
+   const Data msg(typicalInvite);
+   const int runs = 20000;
+
+   vector<Data> tokens;
+   Data body;
+   parse(msg, tokens, body);
+   reportTokenLengths(tokens);
+
+   size_t longTokens = 0;
+   for (vector<Data>::const_iterator i = tokens.begin(); i != tokens.end(); ++i)
+   {
+      if (i->size() > RESIP_DATA_LOCAL_SIZE)
+      {
+         ++longTokens;
+      }
+   }
+
+   unsigned long parseAllocs = 0;
+   unsigned long copyAllocs = 0;
+   unsigned long encodeAllocs = 0;
+   UInt64 parseTime = 0;
+   UInt64 copyTime = 0;
+   UInt64 encodeTime = 0;
+   for (int r = 0; r < runs; ++r)
+   {
+      unsigned long before = allocations;
+      UInt64 start = Timer::getTimeMicroSec();
+      vector<Data> parsed;
+      parsed.reserve(tokens.size());
+      Data parsedBody;
+      parse(msg, parsed, parsedBody);
+      parseTime += Timer::getTimeMicroSec() - start;
+      parseAllocs += allocations - before;
+
+      before = allocations;
+      start = Timer::getTimeMicroSec();
+      vector<Data> copied(parsed);
+      copyTime += Timer::getTimeMicroSec() - start;
+      copyAllocs += allocations - before;
+
+      before = allocations;
+      start = Timer::getTimeMicroSec();
+      Data out(msg.size() + tokens.size(), Data::Preallocate);
+      encode(copied, parsedBody, out);
+      encodeTime += Timer::getTimeMicroSec() - start;
+      encodeAllocs += allocations - before;
+   }
+
+   cerr << "parse: " << double(parseAllocs) / runs << " allocations, "
+        << double(parseTime) / runs << " us per INVITE" << endl;
+   cerr << "copy: " << double(copyAllocs) / runs << " allocations, "
+        << double(copyTime) / runs << " us per INVITE" << endl;
+   cerr << "encode: " << double(encodeAllocs) / runs << " allocations, "
+        << double(encodeTime) / runs << " us per INVITE" << endl;
+
+   // the token vector, the body and one buffer per token that doesn't fit
+   assert(parseAllocs / runs == longTokens + 2);
+   assert(copyAllocs / runs == longTokens + 1);
+
+#ifdef RESIP_HAS_RVALUE_REFS
+   {
+      vector<Data> copied(tokens);
+      vector<Data> moved;
+      moved.reserve(copied.size());
+      unsigned long before = allocations;
+      for (vector<Data>::iterator i = copied.begin(); i != copied.end(); ++i)
+      {
+         moved.push_back(std::move(*i));
+      }
+      assert(allocations == before);
+      assert(moved == tokens);
+   }
+#endif
+
+   {
+      size_t sum = 0;
+      const int hashRuns = 20000;
+      UInt64 start = Timer::getTimeMicroSec();
+      for (int r = 0; r < hashRuns; ++r)
+      {
+         for (vector<Data>::const_iterator i = tokens.begin(); i != tokens.end(); ++i)
+         {
+            sum += i->hash();
+            sum += i->caseInsensitivehash();
+         }
+      }
+      UInt64 elapsed = Timer::getTimeMicroSec() - start;
+      cerr << "hash: " << (elapsed * 1000.0) / (2.0 * hashRuns * tokens.size())
+           << " ns per token (" << sum % 10 << ")" << endl;
+   }
+}
+
+static void
+testStream()
 {
    Data data = Random::getRandomHex(8);
+   UInt64 start = Timer::getTimeMicroSec();
    for (int j=0; j<100; j++)
    {
       Data output(1000000, Data::Preallocate);
@@ -19,6 +254,15 @@ main()
          strm << "chars";
       }
    }
+   cerr << "stream: " << (Timer::getTimeMicroSec() - start) / 1000 << " ms" << endl;
+}
+
+int 
+main()
+{
+   testInvite();
+   testStream();
+   cerr << "All OK" << endl;
    return 0;
 }
 /* ====================================================================
@@ -1,4 +1,5 @@
 
+#include "rutil/AtomicCounter.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/ThreadIf.hxx"
@@ -6,6 +7,9 @@
 
 #include "TestSubsystemLogLevel.hxx"
 
+#include <cassert>
+#include <fstream>
+
 #ifdef WIN32
 #define usleep(x) Sleep(x/1000)
 #define sleep(x) Sleep(x*1000)
@@ -74,6 +78,141 @@ class TestExternalLogger : public ExternalLogger
       }
 };
 
+class CountingExternalLogger : public ExternalLogger
+{
+   public:
+      CountingExternalLogger() : mCount(0) {}
+      virtual bool operator()(Log::Level level,
+                              const Subsystem& subsystem, 
+                              const Data& appName,
+                              const char* file,
+                              int line,
+                              const Data& message,
+                              const Data& messageWithHeaders)
+      {
+         mCount.increment();
+         return true;
+      }
+      AtomicCounter mCount;
+};
+
+class AsyncLogThread : public ThreadIf
+{
+   public:
+      AsyncLogThread(const Data& description, int count)
+         : mDescription(description),
+           mCount(count)
+      {}
+
+      void thread()
+      {
+         for (int i = 0; i < mCount; ++i)
+         {
+            InfoLog(<< mDescription << " record " << i);
+         }
+      }
+   private:
+      Data mDescription;
+      int mCount;
+};
+
+static int
+countLines(const char* fileName)
+{
+   std::ifstream file(fileName);
+   std::string line;
+   int count = 0;
+   while (std::getline(file, line))
+   {
+      ++count;
+   }
+   return count;
+}
+
+void
+testAsyncWriter(const char *appname)
+{
+   const int numThreads = 4;
+   const int numRecords = 500;
+
+   remove("testLogger-async.txt");
+   remove("testLogger-async.txt.1");
+
+   CountingExternalLogger counter;
+   Log::initialize(Log::File, Log::Info, appname, "testLogger-async.txt", &counter);
+   Log::setMaxLineCount(1500);
+   Log::startAsyncWriter(1 << 20);
+   {
+      AsyncLogThread* threads[numThreads];
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i] = new AsyncLogThread(Data("async-") + Data(i), numRecords);
+         threads[i]->run();
+      }
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i]->join();
+         delete threads[i];
+      }
+   }
+   Log::flushAsyncWriter();
+
+   // the external logger is still called from each logging thread
+   assert(counter.mCount.value() == numThreads * numRecords);
+   assert(Log::getAsyncDropCount() == 0);
+   // the file was rotated once it reached 1500 lines
+   int rotatedLines = countLines("testLogger-async.txt.1");
+   int lines = countLines("testLogger-async.txt");
+   cerr << "async: " << rotatedLines << " rotated lines, " << lines << " lines" << endl;
+   assert(rotatedLines >= 1500);
+   assert(rotatedLines + lines == numThreads * numRecords);
+   Log::stopAsyncWriter();
+
+   // a small buffer drops records that the writer does not get to in time
+   Log::initialize(Log::File, Log::Info, appname, "testLogger-async-drop.txt");
+   Log::setMaxLineCount(0);
+   Log::startAsyncWriter(1024);
+   for (int i = 0; i < 5000; ++i)
+   {
+      InfoLog(<< "async drop test record " << i);
+   }
+   Log::flushAsyncWriter();
+   cerr << "async: dropped " << Log::getAsyncDropCount() << " of 5000 records" << endl;
+   assert(Log::getAsyncDropCount() > 0);
+   Log::stopAsyncWriter();
+
+   // stopping and restarting the writer while threads log loses nothing - records logged
+   // to a stopped writer are written by the logging thread
+   remove("testLogger-async-restart.txt");
+   Log::initialize(Log::File, Log::Info, appname, "testLogger-async-restart.txt");
+   Log::setMaxLineCount(0);
+   {
+      const int numRestartRecords = 5000;
+      AsyncLogThread* threads[numThreads];
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i] = new AsyncLogThread(Data("async-restart-") + Data(i), numRestartRecords);
+         threads[i]->run();
+      }
+      for (int i = 0; i < 20; ++i)
+      {
+         Log::startAsyncWriter(1 << 20);
+         usleep(1000);
+         Log::stopAsyncWriter();
+      }
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i]->join();
+         delete threads[i];
+      }
+      int restartLines = countLines("testLogger-async-restart.txt");
+      cerr << "async: " << restartLines << " lines across writer restarts" << endl;
+      assert(restartLines == numThreads * numRestartRecords);
+   }
+
+   Log::initialize(Log::Cout, Log::Info, appname);
+}
+
 void
 testThreadLocalLoggers(const char *appname)
 {
@@ -242,6 +381,8 @@ main(int argc, char* argv[])
    cout << endl;
    testThreadLocalLoggers(argv[0]);
 
+   testAsyncWriter(argv[0]);
+
    return 0;
 }
 
@@ -0,0 +1,208 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "rutil/ObjectPool.hxx"
+#include "rutil/ThreadIf.hxx"
+
+using namespace resip;
+using namespace std;
+
+struct Object
+{
+   int mOwner;
+   int mIndex;
+   char mPayload[40];
+};
+
+// pools are never destroyed
+static ObjectPool& pool = *new ObjectPool("Object", sizeof(Object), 16);
+
+static Object*
+allocate(int owner, int index)
+{
+   Object* object = static_cast<Object*>(pool.allocate(sizeof(Object)));
+   object->mOwner = owner;
+   object->mIndex = index;
+   memset(object->mPayload, owner, sizeof(object->mPayload));
+   return object;
+}
+
+static void
+check(const Object* object, int owner, int index)
+{
+   assert(object->mOwner == owner);
+   assert(object->mIndex == index);
+   for (size_t i = 0; i < sizeof(object->mPayload); ++i)
+   {
+      assert(object->mPayload[i] == (char)owner);
+   }
+}
+
+// allocates objects that another thread frees
+class Allocator : public ThreadIf
+{
+   public:
+      Allocator(vector<Object*>& objects) : mObjects(objects) {}
+      void thread()
+      {
+         for (size_t i = 0; i < mObjects.size(); ++i)
+         {
+            mObjects[i] = allocate(1, (int)i);
+         }
+      }
+      vector<Object*>& mObjects;
+};
+
+class Freer : public ThreadIf
+{
+   public:
+      Freer(vector<Object*>& objects) : mObjects(objects) {}
+      void thread()
+      {
+         for (size_t i = 0; i < mObjects.size(); ++i)
+         {
+            check(mObjects[i], 1, (int)i);
+            pool.deallocate(mObjects[i], sizeof(Object));
+         }
+      }
+      vector<Object*>& mObjects;
+};
+
+// allocates and frees in rounds; no object may be handed to two threads at once
+class Churner : public ThreadIf
+{
+   public:
+      Churner(int id) : mId(id) {}
+      void thread()
+      {
+         vector<Object*> objects(50);
+         for (int round = 0; round < 2000; ++round)
+         {
+            const size_t count = 1 + (round * 7) % objects.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+               objects[i] = allocate(mId, (int)i);
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+               check(objects[i], mId, (int)i);
+               pool.deallocate(objects[i], sizeof(Object));
+            }
+         }
+      }
+      int mId;
+};
+
+int
+main()
+{
+   {
+      vector<Object*> objects;
+      for (int i = 0; i < 100; ++i)
+      {
+         objects.push_back(allocate(0, i));
+      }
+      assert(pool.inUse() == 100);
+      assert(pool.capacity() >= 100);
+
+      // other sizes come from the heap
+      void* other = pool.allocate(sizeof(Object) + 1);
+      assert(pool.inUse() == 100);
+      pool.deallocate(other, sizeof(Object) + 1);
+
+      for (int i = 0; i < 100; ++i)
+      {
+         check(objects[i], 0, i);
+         pool.deallocate(objects[i], sizeof(Object));
+      }
+      // objects in this thread's cache are not in use
+      assert(pool.inUse() == 0);
+   }
+
+   {
+      // objects allocated by one thread and freed by another
+      vector<Object*> objects(1000);
+      Allocator allocator(objects);
+      allocator.run();
+      allocator.join();
+      assert(pool.inUse() == objects.size());
+
+      Freer freer(objects);
+      freer.run();
+      freer.join();
+      assert(pool.inUse() == 0);
+   }
+
+   {
+      const size_t capacity = pool.capacity();
+      vector<Churner*> threads;
+      for (int t = 0; t < 4; ++t)
+      {
+         threads.push_back(new Churner(t + 2));
+         threads.back()->run();
+      }
+      for (int t = 0; t < 4; ++t)
+      {
+         threads[t]->join();
+         delete threads[t];
+      }
+      // exited threads gave their caches back
+      assert(pool.inUse() == 0);
+      cerr << "capacity " << capacity << " -> " << pool.capacity() << endl;
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000-2005
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,248 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "rutil/Data.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+// what getRandomHex did before it had a stream per thread: the libc
+// generator, which takes a process wide lock, then a second Data for hex
+static Data
+libcRandomHex(unsigned int len)
+{
+   union
+   {
+         char cbuf[Random::maxLength+1];
+         unsigned int ibuf[(Random::maxLength+1)/sizeof(int)];
+   };
+   for (unsigned int count = 0; count < (len+sizeof(int)-1)/sizeof(int); ++count)
+   {
+#ifdef WIN32
+      ibuf[count] = (rand() << 16) + rand();
+#else
+      ibuf[count] = random();
+#endif
+   }
+   return Data(cbuf, len).hex();
+}
+
+// Generates ids the way Helper does for tags and branches, and keeps the
+// first few so the threads can be checked against each other.
+class IdThread : public ThreadIf
+{
+   public:
+      IdThread(int count, bool libc)
+         : mCount(count),
+           mLibc(libc),
+           mMicroSec(0)
+      {}
+
+      virtual void thread()
+      {
+         UInt64 start = Timer::getTimeMicroSec();
+         for (int i = 0; i < mCount; ++i)
+         {
+            Data id;
+            if (mLibc)
+            {
+               id = libcRandomHex(8);
+            }
+            else
+            {
+               id = Random::getRandomHex(8);
+            }
+            if (i < Kept)
+            {
+               mKept.push_back(id);
+            }
+         }
+         mMicroSec = Timer::getTimeMicroSec() - start;
+      }
+
+      double idsPerSec() const
+      {
+         return mMicroSec ? double(mCount) * 1000000 / mMicroSec : 0;
+      }
+
+      enum {Kept = 1000};
+
+      const int mCount;
+      const bool mLibc;
+      UInt64 mMicroSec;
+      vector<Data> mKept;
+};
+
+static void
+run(int threads, int count, bool libc)
+{
+   vector<IdThread*> all;
+   for (int t = 0; t < threads; ++t)
+   {
+      all.push_back(new IdThread(count, libc));
+   }
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int t = 0; t < threads; ++t)
+   {
+      all[t]->run();
+   }
+   for (int t = 0; t < threads; ++t)
+   {
+      all[t]->join();
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+
+   set<Data> seen;
+   double slowest = 0;
+   for (int t = 0; t < threads; ++t)
+   {
+      for (vector<Data>::const_iterator i = all[t]->mKept.begin();
+           i != all[t]->mKept.end(); ++i)
+      {
+         assert(i->size() == 16);
+         assert(seen.insert(*i).second);
+      }
+      if (t == 0 || all[t]->idsPerSec() < slowest)
+      {
+         slowest = all[t]->idsPerSec();
+      }
+      delete all[t];
+   }
+
+   cerr << (libc ? "libc random: " : "getRandomHex: ")
+        << threads << " threads, "
+        << slowest << " ids/s in the slowest thread, "
+        << (elapsed ? double(threads) * count * 1000000 / elapsed : 0)
+        << " ids/s in total" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   int threads = 4;
+   int count = 200000;
+   if (argc > 1)
+   {
+      threads = atoi(argv[1]);
+   }
+   if (argc > 2)
+   {
+      count = atoi(argv[2]);
+   }
+   assert(threads > 0 && count > 0);
+
+   {
+      // hex digits straight into the target, after what is there
+      Data branch("z9hG4bK");
+      Random::appendRandomHex(branch, 4);
+      assert(branch.size() == 15);
+      assert(branch.prefix("z9hG4bK"));
+      for (Data::size_type i = 7; i < branch.size(); ++i)
+      {
+         assert(isxdigit(branch[i]) && !isupper(branch[i]));
+      }
+
+      assert(Random::getRandom(Random::maxLength).size() == Random::maxLength);
+      assert(Random::getRandomHex(1).size() == 2);
+      assert(Random::getRandomHex(0).empty());
+      for (int i = 0; i < 1000; ++i)
+      {
+         assert(Random::getRandom() >= 0);
+      }
+   }
+
+#ifndef WIN32
+   {
+      // a forked child must not repeat its parent's stream
+      int fds[2];
+      assert(pipe(fds) == 0);
+      pid_t pid = fork();
+      assert(pid >= 0);
+      if (pid == 0)
+      {
+         Data id = Random::getRandomHex(8);
+         ssize_t n = write(fds[1], id.data(), id.size());
+         _exit(n == (ssize_t)id.size() ? 0 : 1);
+      }
+      Data mine = Random::getRandomHex(8);
+      char buf[16];
+      assert(read(fds[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+      int status = 0;
+      waitpid(pid, &status, 0);
+      assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+      assert(mine != Data(buf, sizeof(buf)));
+      close(fds[0]);
+      close(fds[1]);
+   }
+#endif
+
+   run(1, count, false);
+   run(threads, count, false);
+   run(1, count, true);
+   run(threads, count, true);
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */